@@ -12,7 +12,7 @@
 
 int pthread_mutex_init(pthread_mutex_t *__RESTRICT mutex,
                        const pthread_mutexattr_t *__RESTRICT attr) {
-    int type = MUTEX_TYPE_NORMAL, old, rv = 0;
+    int type = MUTEX_TYPE_NORMAL, protocol = MUTEX_PRIO_INHERIT, old, rv = 0;
 
     if(attr) {
         switch(attr->mtype) {
@@ -31,10 +31,24 @@ int pthread_mutex_init(pthread_mutex_t *__RESTRICT mutex,
             default:
                 return EINVAL;
         }
+
+        switch(attr->protocol) {
+            case PTHREAD_PRIO_INHERIT:
+                protocol = MUTEX_PRIO_INHERIT;
+                break;
+
+            case PTHREAD_PRIO_NONE:
+                protocol = MUTEX_PRIO_NONE;
+                break;
+
+            default:
+                return EINVAL;
+        }
     }
 
     old = errno;
-    if(mutex_init(&mutex->mutex, type))
+    if(mutex_init(&mutex->mutex, type) ||
+       mutex_set_protocol(&mutex->mutex, protocol))
         rv = errno;
 
     errno = old;
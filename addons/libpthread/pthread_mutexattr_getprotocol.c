@@ -0,0 +1,22 @@
+/* KallistiOS ##version##
+
+   pthread_mutexattr_getprotocol.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+#include "pthread-internal.h"
+#include <pthread.h>
+#include <errno.h>
+
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *__RESTRICT attr,
+                                  int *__RESTRICT protocol) {
+    if(!attr)
+        return EINVAL;
+
+    if(!protocol)
+        return EFAULT;
+
+    *protocol = attr->protocol;
+    return 0;
+}
@@ -15,5 +15,6 @@ int pthread_mutexattr_init(pthread_mutexattr_t *attr) {
 
     attr->mtype = PTHREAD_MUTEX_NORMAL;
     attr->robust = PTHREAD_MUTEX_STALLED;
+    attr->protocol = PTHREAD_PRIO_INHERIT;
     return 0;
 }
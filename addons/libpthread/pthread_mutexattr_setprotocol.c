@@ -0,0 +1,29 @@
+/* KallistiOS ##version##
+
+   pthread_mutexattr_setprotocol.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+#include "pthread-internal.h"
+#include <pthread.h>
+#include <errno.h>
+
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol) {
+    if(!attr)
+        return EINVAL;
+
+    switch(protocol) {
+        case PTHREAD_PRIO_NONE:
+        case PTHREAD_PRIO_INHERIT:
+            attr->protocol = protocol;
+            return 0;
+
+        /* We don't currently support priority ceilings. */
+        case PTHREAD_PRIO_PROTECT:
+            return ENOTSUP;
+
+        default:
+            return EINVAL;
+    }
+}
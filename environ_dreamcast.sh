@@ -24,7 +24,16 @@ if [ -z "${KOS_SH4_PRECISION}" ] || [ "${KOS_SH4_PRECISION}" = "-m4-single" ]; t
     fi
 fi
 
-export KOS_CFLAGS="${KOS_CFLAGS} ${KOS_SH4_PRECISION} -ml -mfsrra -mfsca -ffunction-sections -fdata-sections -matomic-model=soft-imask -ftls-model=local-exec"
+# Default the atomic model if it isn't already set. The kernel supports both
+# soft-imask and soft-gusa, and code built with either can be mixed freely.
+if [ -z "${KOS_ATOMIC_MODEL}" ]; then
+    export KOS_ATOMIC_MODEL="soft-imask"
+elif [ "${KOS_ATOMIC_MODEL}" != "soft-imask" ] && [ "${KOS_ATOMIC_MODEL}" != "soft-gusa" ]; then
+    echo "WARNING: Unsupported atomic model ${KOS_ATOMIC_MODEL} -- falling back to soft-imask." >&2
+    export KOS_ATOMIC_MODEL="soft-imask"
+fi
+
+export KOS_CFLAGS="${KOS_CFLAGS} ${KOS_SH4_PRECISION} -ml -mfsrra -mfsca -ffunction-sections -fdata-sections -matomic-model=${KOS_ATOMIC_MODEL} -ftls-model=local-exec"
 export KOS_AFLAGS="${KOS_AFLAGS} -little"
 export KOS_LDFLAGS="${KOS_LDFLAGS} ${KOS_SH4_PRECISION} -ml -Wl,--gc-sections"
 export KOS_LD_SCRIPT="-T${KOS_BASE}/utils/ldscripts/shlelf.xc"
@@ -0,0 +1,109 @@
+/* KallistiOS ##version##
+
+   alloc_trace.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program shows how to take an allocation trace with
+   kos/alloc_trace.h. It needs KOS to be built with MALLOC_TRACE defined (see
+   kos/opts.h), and dcload for the /pc filesystem.
+
+   A few simulated "frames" allocate and free a mix of blocks, with a marker
+   at the end of each one, and one of the call sites leaks on purpose. The
+   trace is streamed to /pc/alloc_trace.kalc, which can be looked at with:
+
+     kosheap -s alloc_trace.kalc alloc_trace.elf
+
+   Building with frame pointers (-fno-omit-frame-pointer -DFRAME_POINTERS)
+   gives deeper call sites. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <kos/alloc_trace.h>
+#include <kos/thread.h>
+
+#define FRAMES      60
+#define OBJECTS     64
+
+static void *objects[OBJECTS];
+static void *leaked[FRAMES];
+
+static __no_inline void *new_object(size_t size) {
+    return malloc(size);
+}
+
+static __no_inline char *new_string(const char *fmt, int n) {
+    char *str = malloc(32);
+
+    if(str)
+        snprintf(str, 32, fmt, n);
+
+    return str;
+}
+
+static void frame(int n) {
+    char *label;
+    int i, j;
+
+    /* Replace some of the long-lived objects. */
+    for(i = 0; i < OBJECTS / 4; i++) {
+        j = rand() % OBJECTS;
+        free(objects[j]);
+        objects[j] = new_object(16 + rand() % 2048);
+    }
+
+    /* Grow one of them. */
+    j = rand() % OBJECTS;
+    objects[j] = realloc(objects[j], 4096);
+
+    /* Short-lived scratch data. */
+    label = new_string("frame %d", n);
+    free(label);
+
+    /* And something nobody ever frees. */
+    leaked[n] = new_string("leak %d", n);
+
+    alloc_trace_mark(n);
+    thd_sleep(16);
+}
+
+int main(int argc, char **argv) {
+    int i;
+
+    (void)argc;
+    (void)argv;
+
+    printf("KallistiOS allocation trace example\n\n");
+
+    if(alloc_trace_start(4096)) {
+        if(errno == ENOSYS)
+            printf("KOS was built without MALLOC_TRACE, nothing to do.\n");
+        else
+            perror("alloc_trace_start");
+
+        return EXIT_FAILURE;
+    }
+
+    if(alloc_trace_stream("/pc/alloc_trace.kalc")) {
+        perror("alloc_trace_stream");
+        alloc_trace_release();
+        return EXIT_FAILURE;
+    }
+
+    for(i = 0; i < FRAMES; i++)
+        frame(i);
+
+    for(i = 0; i < OBJECTS; i++)
+        free(objects[i]);
+
+    alloc_trace_release();
+
+    printf("Trace written to /pc/alloc_trace.kalc (%d blocks leaked on "
+           "purpose)\n", FRAMES);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+/* KallistiOS ##version##
+
+   arena_bench.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program compares two ways of handling data which only lives for one
+   frame: allocating each piece with malloc() and freeing it all at the end of
+   the frame, and allocating it from an arena which is reset once per frame.
+
+   Each simulated frame allocates a mix of small and medium blocks (think
+   draw commands, sort keys and strings), touches them, and drops them. A
+   nested pass shows scoped markers, which give back temporary allocations
+   made in the middle of a frame. Finally, the heap is checked to have
+   stayed where it was. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <malloc.h>
+
+#include <kos/arena.h>
+#include <arch/timer.h>
+
+#define FRAMES          600
+#define ALLOCS          1000
+#define ARENA_SIZE      (512 * 1024)
+
+static size_t sizes[ALLOCS];
+static void *ptrs[ALLOCS];
+static unsigned int errors;
+
+/* The frame arena lives in its own region of BSS, away from the heap. */
+ARENA_DEFINE(frame_arena, ARENA_SIZE);
+
+static void make_sizes(void) {
+    unsigned int i;
+
+    srand(1234);
+
+    for(i = 0; i < ALLOCS; i++) {
+        if(rand() % 10)
+            sizes[i] = 16 + rand() % 112;
+        else
+            sizes[i] = 256 + rand() % 1792;
+    }
+}
+
+static void touch(void *ptr, size_t size, unsigned int i) {
+    uint8_t *p = ptr;
+
+    p[0] = (uint8_t)i;
+    p[size - 1] = (uint8_t)~i;
+}
+
+static void check(const void *ptr, size_t size, unsigned int i) {
+    const uint8_t *p = ptr;
+
+    if(p[0] != (uint8_t)i || p[size - 1] != (uint8_t)~i)
+        errors++;
+}
+
+static uint64_t frames_malloc(void) {
+    uint64_t start = timer_ns_gettime64();
+    unsigned int f, i;
+
+    for(f = 0; f < FRAMES; f++) {
+        for(i = 0; i < ALLOCS; i++) {
+            ptrs[i] = malloc(sizes[i]);
+            touch(ptrs[i], sizes[i], i);
+        }
+
+        for(i = 0; i < ALLOCS; i++) {
+            check(ptrs[i], sizes[i], i);
+            free(ptrs[i]);
+        }
+    }
+
+    return timer_ns_gettime64() - start;
+}
+
+static uint64_t frames_arena(void) {
+    uint64_t start = timer_ns_gettime64();
+    unsigned int f, i;
+
+    for(f = 0; f < FRAMES; f++) {
+        for(i = 0; i < ALLOCS; i++) {
+            ptrs[i] = arena_alloc(&frame_arena, sizes[i]);
+
+            if(!ptrs[i] || ((uintptr_t)ptrs[i] & (ARENA_ALIGN - 1))) {
+                errors++;
+                return 0;
+            }
+
+            touch(ptrs[i], sizes[i], i);
+        }
+
+        for(i = 0; i < ALLOCS; i++)
+            check(ptrs[i], sizes[i], i);
+
+        arena_reset(&frame_arena);
+    }
+
+    return timer_ns_gettime64() - start;
+}
+
+/* Half of each frame's data is temporary, and given back half-way through
+   the frame with a scoped marker. */
+static uint64_t frames_scoped(void) {
+    uint64_t start = timer_ns_gettime64();
+    unsigned int f, i;
+    size_t before;
+
+    for(f = 0; f < FRAMES; f++) {
+        for(i = 0; i < ALLOCS / 2; i++) {
+            ptrs[i] = arena_alloc(&frame_arena, sizes[i]);
+            touch(ptrs[i], sizes[i], i);
+        }
+
+        before = arena_used(&frame_arena);
+
+        {
+            arena_scoped(&frame_arena);
+
+            for(; i < ALLOCS; i++) {
+                ptrs[i] = arena_alloc(&frame_arena, sizes[i]);
+                touch(ptrs[i], sizes[i], i);
+            }
+
+            for(i = ALLOCS / 2; i < ALLOCS; i++)
+                check(ptrs[i], sizes[i], i);
+        }
+
+        if(arena_used(&frame_arena) != before)
+            errors++;
+
+        for(i = 0; i < ALLOCS / 2; i++)
+            check(ptrs[i], sizes[i], i);
+
+        arena_reset(&frame_arena);
+    }
+
+    return timer_ns_gettime64() - start;
+}
+
+static void report(const char *name, uint64_t ns) {
+    printf("%-24s %8llu us  %6llu ns/alloc\n", name, ns / 1000,
+           ns / (FRAMES * ALLOCS));
+}
+
+int main(int argc, char **argv) {
+    struct mallinfo before, after;
+    size_t total = 0;
+    unsigned int i;
+
+    (void)argc;
+    (void)argv;
+
+    printf("KallistiOS arena allocator example\n\n");
+
+    make_sizes();
+
+    for(i = 0; i < ALLOCS; i++)
+        total += sizes[i];
+
+    printf("%d frames of %d allocations (%lu bytes per frame)\n\n",
+           FRAMES, ALLOCS, (unsigned long)total);
+
+    before = mallinfo();
+
+    report("malloc + free", frames_malloc());
+    report("arena", frames_arena());
+    report("arena + scoped marker", frames_scoped());
+
+    after = mallinfo();
+
+    printf("\nArena peak usage: %lu of %lu bytes\n",
+           (unsigned long)arena_peak(&frame_arena), (unsigned long)ARENA_SIZE);
+    printf("Heap in use before: %d bytes, after: %d bytes\n",
+           before.uordblks, after.uordblks);
+
+    if(errors) {
+        printf("\n===== ARENA TEST FAILED (%u errors) =====\n", errors);
+        return EXIT_FAILURE;
+    }
+
+    printf("\n===== ARENA TEST DONE =====\n");
+
+    return EXIT_SUCCESS;
+}
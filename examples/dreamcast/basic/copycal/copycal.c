@@ -0,0 +1,205 @@
+/* KallistiOS ##version##
+
+   copycal.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program calibrates kos_copy(). For each destination region (RAM,
+   VRAM and sound RAM), it times copies of growing sizes with each engine
+   forced in turn, checks that every one of them copied the right data, and
+   prints the sizes from which the store queues and DMA win. Those are then
+   passed to kos_copy_set_thresholds(), and printed in a form that can be
+   pasted into a program to do the same at startup.
+
+   The crossover points differ a lot between real hardware and emulators,
+   which is why the defaults are only rough guesses. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <string.h>
+
+#include <kos/cdefs.h>
+#include <arch/copy.h>
+#include <arch/timer.h>
+#include <dc/pvr.h>
+#include <dc/spu.h>
+
+#define MAX_SIZE        (64 * 1024)
+
+/* Roughly how many bytes each measurement moves. */
+#define BYTES_PER_RUN   (256 * 1024)
+
+/* Where the copies to sound RAM go; no sound driver is running. */
+#define SPU_OFFSET      0x20000
+
+#define ENGINES         3
+
+static alignas(32) uint8_t src_buf[MAX_SIZE];
+static alignas(32) uint8_t ram_buf[MAX_SIZE];
+static alignas(32) uint8_t check_buf[MAX_SIZE];
+
+static const size_t sizes[] = {
+    64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, MAX_SIZE
+};
+
+static const char *const engine_names[ENGINES] = { "CPU", "SQ", "DMA" };
+
+static const char *const region_names[] = {
+    [KOS_COPY_REGION_RAM] = "RAM",
+    [KOS_COPY_REGION_VRAM] = "VRAM",
+    [KOS_COPY_REGION_SPU] = "SPU RAM",
+};
+
+/* Time taken per copy, in ns. */
+static uint64_t times[__array_size(sizes)][ENGINES];
+
+static unsigned int errors;
+
+static void check(kos_copy_region_t region, uint8_t *dst, size_t size,
+                  int engine) {
+    const uint8_t *data = dst;
+
+    if(region == KOS_COPY_REGION_SPU) {
+        spu_memread(check_buf, SPU_OFFSET, size);
+        data = check_buf;
+    }
+
+    if(memcmp(data, src_buf, size)) {
+        printf("  ERROR: %s copy of %u bytes to %s was wrong\n",
+               engine_names[engine], (unsigned int)size, region_names[region]);
+        errors++;
+    }
+}
+
+static void measure(kos_copy_region_t region, uint8_t *dst) {
+    unsigned int reps, r;
+    uint64_t start;
+    size_t i;
+    int e;
+
+    printf("%s (MB/s)\n    size", region_names[region]);
+
+    for(e = 0; e < ENGINES; e++)
+        printf("  %8s", engine_names[e]);
+
+    printf("\n");
+
+    for(i = 0; i < __array_size(sizes); i++) {
+        reps = BYTES_PER_RUN / sizes[i];
+
+        printf("  %6u", (unsigned int)sizes[i]);
+
+        for(e = 0; e < ENGINES; e++) {
+            start = timer_ns_gettime64();
+
+            for(r = 0; r < reps; r++)
+                kos_copy(dst, src_buf, sizes[i], 1 << e);
+
+            times[i][e] = (timer_ns_gettime64() - start) / reps;
+            check(region, dst, sizes[i], e);
+
+            printf("  %8.1f", times[i][e] ?
+                   (double)sizes[i] * 1000.0 / times[i][e] : 0.0);
+        }
+
+        printf("\n");
+    }
+
+    printf("\n");
+}
+
+/* The smallest size from which the engine is at least as fast as all of
+   the ones before it, for that size and every larger one. */
+static size_t crossover(int engine) {
+    size_t i, found = SIZE_MAX;
+    int e;
+
+    for(i = __array_size(sizes); i-- > 0;) {
+        for(e = 0; e < engine; e++) {
+            if(times[i][engine] > times[i][e])
+                return found;
+        }
+
+        found = sizes[i];
+    }
+
+    return found;
+}
+
+static void print_size(size_t size) {
+    if(size == SIZE_MAX)
+        printf("  %10s", "never");
+    else
+        printf("  %10u", (unsigned int)size);
+}
+
+int main(int argc, char **argv) {
+    kos_copy_thresholds_t th;
+    uint8_t *dst[KOS_COPY_REGION_OTHER];
+    size_t i, dma_threshold;
+
+    (void)argc;
+    (void)argv;
+
+    printf("KallistiOS copy calibration\n\n");
+
+    pvr_init_defaults();
+
+    srand(1234);
+
+    for(i = 0; i < MAX_SIZE; i++)
+        src_buf[i] = (uint8_t)rand();
+
+    dst[KOS_COPY_REGION_RAM] = ram_buf;
+    dst[KOS_COPY_REGION_VRAM] = pvr_mem_malloc(MAX_SIZE);
+    dst[KOS_COPY_REGION_SPU] = (uint8_t *)(SPU_RAM_UNCACHED_BASE + SPU_OFFSET);
+
+    /* Have the DMAC queue take even the smallest RAM copies, so that they
+       are really timed. */
+    dma_threshold = dma_copy_get_threshold();
+    dma_copy_set_threshold(0);
+
+    kos_copy_get_thresholds(&th);
+
+    for(i = 0; i < KOS_COPY_REGION_OTHER; i++) {
+        measure(i, dst[i]);
+        th.sq[i] = crossover(KOS_COPY_ENGINE_SQ);
+        th.dma[i] = crossover(KOS_COPY_ENGINE_DMA);
+    }
+
+    printf("Crossover points (bytes)\n  region       SQ from    DMA from\n");
+
+    for(i = 0; i < KOS_COPY_REGION_OTHER; i++) {
+        printf("  %-7s", region_names[i]);
+        print_size(th.sq[i]);
+        print_size(th.dma[i]);
+        printf("\n");
+    }
+
+    dma_copy_set_threshold(dma_threshold);
+    kos_copy_set_thresholds(&th);
+
+    printf("\nkos_copy_thresholds_t th = {\n    .sq = {");
+
+    for(i = 0; i < KOS_COPY_REGION_COUNT; i++)
+        printf(i ? ", %u" : " %u", (unsigned int)th.sq[i]);
+
+    printf(" },\n    .dma = {");
+
+    for(i = 0; i < KOS_COPY_REGION_COUNT; i++)
+        printf(i ? ", %u" : " %u", (unsigned int)th.dma[i]);
+
+    printf(" },\n};\n\n");
+
+    pvr_mem_free(dst[KOS_COPY_REGION_VRAM]);
+
+    if(errors)
+        printf("%u errors!\n", errors);
+    else
+        printf("All copies were correct.\n");
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/* KallistiOS ##version##
+
+   dmacopy_bench.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program exercises the DMA copy queue. It first checks a set of
+   copies of various sizes and alignments, and a chain in which each copy
+   reads what the previous one wrote, against memcpy(). It then times large
+   copies done with memcpy() and with the queue, and measures how much of
+   the CPU is left to the program while the DMAC does the work, by spinning
+   on a counter until the copy completes. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <string.h>
+
+#include <kos/cdefs.h>
+#include <kos/sem.h>
+#include <arch/dmac.h>
+#include <arch/timer.h>
+
+#define BUF_SIZE        (256 * 1024)
+
+static alignas(32) uint8_t src_buf[BUF_SIZE];
+static alignas(32) uint8_t dst_buf[BUF_SIZE];
+static alignas(32) uint8_t ref_buf[BUF_SIZE];
+
+static const size_t sizes[] = { 100, 4096, 10000, 65536, BUF_SIZE - 64 };
+
+/* Destination and source offsets from a cache line boundary. */
+static const struct {
+    size_t dst, src;
+} aligns[] = {
+    { 0, 0 }, { 8, 8 }, { 4, 4 }, { 0, 4 }, { 3, 1 }, { 17, 2 }, { 5, 5 }
+};
+
+static unsigned int errors;
+static volatile unsigned int callbacks;
+
+static void count_callback(void *data) {
+    (void)data;
+    callbacks++;
+}
+
+static void check_copies(void) {
+    dma_copy_t desc = { 0 };
+    size_t i, j;
+
+    printf("Checking copies...\n");
+
+    for(i = 0; i < __array_size(sizes); i++) {
+        for(j = 0; j < __array_size(aligns); j++) {
+            memset(dst_buf, 0xa5, BUF_SIZE);
+            memset(ref_buf, 0xa5, BUF_SIZE);
+            memcpy(ref_buf + aligns[j].dst, src_buf + aligns[j].src,
+                   sizes[i]);
+
+            desc.dst = dst_buf + aligns[j].dst;
+            desc.src = src_buf + aligns[j].src;
+            desc.len = sizes[i];
+            desc.callback = count_callback;
+
+            if(dma_copy_submit(&desc) || dma_copy_wait(&desc) ||
+               desc.state != DMA_COPY_DONE ||
+               memcmp(dst_buf, ref_buf, BUF_SIZE)) {
+                printf("  ERROR: copy of %u bytes (%u, %u) failed\n",
+                       (unsigned int)sizes[i], (unsigned int)aligns[j].dst,
+                       (unsigned int)aligns[j].src);
+                errors++;
+            }
+        }
+    }
+
+    if(callbacks != __array_size(sizes) * __array_size(aligns)) {
+        printf("  ERROR: %u callbacks for %u copies\n", callbacks,
+               (unsigned int)(__array_size(sizes) * __array_size(aligns)));
+        errors++;
+    }
+}
+
+/* Move a block forward through the destination in three hops, each
+   reading what the previous one wrote. */
+static void check_chain(void) {
+    const size_t len = 48 * 1024;
+    dma_copy_t desc[4] = { 0 };
+    size_t i;
+
+    printf("Checking a chain...\n");
+
+    memset(dst_buf, 0, BUF_SIZE);
+
+    desc[0].dst = dst_buf;
+    desc[0].src = src_buf;
+    desc[1].dst = dst_buf + len + 32;
+    desc[1].src = desc[0].dst;
+    desc[2].dst = dst_buf + 2 * len + 72;
+    desc[2].src = desc[1].dst;
+    desc[3].dst = dst_buf + 3 * len + 100;
+    desc[3].src = desc[2].dst;
+
+    for(i = 0; i < __array_size(desc); i++) {
+        desc[i].len = len;
+
+        if(i)
+            desc[i - 1].next = &desc[i];
+    }
+
+    if(dma_copy_submit(&desc[0]) || dma_copy_wait(&desc[3]) ||
+       memcmp(desc[3].dst, src_buf, len)) {
+        printf("  ERROR: the chain gave the wrong result\n");
+        errors++;
+    }
+}
+
+static void bench(size_t len) {
+    semaphore_t sem;
+    dma_copy_t desc = { 0 };
+    uint64_t start, cpu_ns, dma_ns;
+    unsigned int spins = 0, idle_spins = 0;
+
+    sem_init(&sem, 0);
+
+    desc.dst = dst_buf;
+    desc.src = src_buf;
+    desc.len = len;
+    desc.sem = &sem;
+
+    start = timer_ns_gettime64();
+    memcpy(dst_buf, src_buf, len);
+    cpu_ns = timer_ns_gettime64() - start;
+
+    /* How fast the counter goes with the bus to itself... */
+    start = timer_ns_gettime64();
+    while(timer_ns_gettime64() - start < cpu_ns)
+        idle_spins++;
+
+    /* ...and with the DMAC copying in the background. */
+    start = timer_ns_gettime64();
+    dma_copy_submit(&desc);
+
+    while(!dma_copy_done(&desc))
+        spins++;
+
+    dma_ns = timer_ns_gettime64() - start;
+    sem_wait(&sem);
+    sem_destroy(&sem);
+
+    printf("  %7u  %10.1f %10.1f      %5.1f%%\n", (unsigned int)len,
+           (double)len * 1000.0 / cpu_ns, (double)len * 1000.0 / dma_ns,
+           idle_spins ? 100.0 * spins * cpu_ns / ((double)idle_spins * dma_ns)
+                      : 0.0);
+}
+
+int main(int argc, char **argv) {
+    size_t i;
+
+    (void)argc;
+    (void)argv;
+
+    printf("KallistiOS DMA copy queue benchmark\n\n");
+
+    srand(1234);
+
+    for(i = 0; i < BUF_SIZE; i++)
+        src_buf[i] = (uint8_t)rand();
+
+    check_copies();
+    check_chain();
+
+    printf("\n     size  memcpy MB/s   DMA MB/s   CPU left\n");
+
+    for(i = 16 * 1024; i <= BUF_SIZE; i *= 2)
+        bench(i);
+
+    printf("\n");
+
+    if(errors)
+        printf("%u errors!\n", errors);
+    else
+        printf("All results were correct.\n");
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
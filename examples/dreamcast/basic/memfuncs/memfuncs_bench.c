@@ -0,0 +1,372 @@
+/* KallistiOS ##version##
+
+   memfuncs_bench.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program measures the throughput of memcpy(), memmove(), memset() and
+   memcmp() over a matrix of sizes and alignments, to a cached destination
+   and to the same memory through the uncached P2 area. Each one is compared
+   with a plain C loop moving 32-bit words when it can and bytes otherwise,
+   which is about what a generic implementation does, and every result is
+   checked against a byte-by-byte reference. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <string.h>
+
+#include <kos/cdefs.h>
+#include <arch/cache.h>
+#include <arch/memory.h>
+#include <arch/timer.h>
+
+#define MAX_SIZE        (64 * 1024)
+#define BUF_SIZE        (MAX_SIZE + 64)
+
+/* Roughly how many bytes each measurement moves. */
+#define BYTES_PER_RUN   (1024 * 1024)
+
+static alignas(32) uint8_t src_buf[BUF_SIZE];
+static alignas(32) uint8_t dst_buf[BUF_SIZE];
+static alignas(32) uint8_t ref_buf[BUF_SIZE];
+
+static const size_t sizes[] = { 16, 64, 256, 1024, 4096, MAX_SIZE };
+
+/* Destination and source offsets from a cache line boundary. */
+static const struct {
+    size_t dst, src;
+} aligns[] = {
+    { 0, 0 }, { 8, 8 }, { 4, 4 }, { 0, 4 }, { 1, 1 }, { 0, 1 }, { 3, 2 }
+};
+
+static const size_t set_aligns[] = { 0, 4, 1 };
+
+static unsigned int errors;
+
+typedef uint32_t __attribute__((may_alias)) word_t;
+
+typedef void *(*copy_fn)(void *, const void *, size_t);
+typedef void *(*set_fn)(void *, int, size_t);
+typedef int (*cmp_fn)(const void *, const void *, size_t);
+
+/* The plain loops everything is compared with. */
+static void *loop_copy(void *dest, const void *src, size_t count) {
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+
+    if(!(((uintptr_t)d | (uintptr_t)s) & 3)) {
+        for(; count >= 4; count -= 4, d += 4, s += 4)
+            *(word_t *)d = *(const word_t *)s;
+    }
+
+    while(count--)
+        *d++ = *s++;
+
+    return dest;
+}
+
+static void *loop_move(void *dest, const void *src, size_t count) {
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+
+    if(d <= s)
+        return loop_copy(dest, src, count);
+
+    d += count;
+    s += count;
+
+    while(count--)
+        *--d = *--s;
+
+    return dest;
+}
+
+static void *loop_set(void *dest, int c, size_t count) {
+    uint8_t *d = dest;
+    uint32_t v = (uint8_t)c * 0x01010101u;
+
+    for(; count && ((uintptr_t)d & 3); count--)
+        *d++ = (uint8_t)c;
+
+    for(; count >= 4; count -= 4, d += 4)
+        *(word_t *)d = v;
+
+    while(count--)
+        *d++ = (uint8_t)c;
+
+    return dest;
+}
+
+static int loop_cmp(const void *s1, const void *s2, size_t count) {
+    const uint8_t *a = s1, *b = s2;
+
+    for(; count; count--, a++, b++) {
+        if(*a != *b)
+            return *a - *b;
+    }
+
+    return 0;
+}
+
+static uint8_t *uncached(uint8_t *ptr) {
+    return (uint8_t *)(((uintptr_t)ptr & MEM_AREA_CACHE_MASK) |
+                       MEM_AREA_P2_BASE);
+}
+
+static unsigned int reps_for(size_t size) {
+    return BYTES_PER_RUN / size;
+}
+
+static double mbps(size_t size, unsigned int reps, uint64_t ns) {
+    return ns ? (double)size * reps * 1000.0 / ns : 0.0;
+}
+
+/* Reset the destination, and the reference to what it should hold before
+   the operation. */
+static void fill(uint8_t *buf) {
+    size_t i;
+
+    for(i = 0; i < BUF_SIZE; i++)
+        buf[i] = (uint8_t)~i;
+
+    /* Nothing dirty must be left to be written back over the uncached
+       runs. */
+    dcache_purge_range((uintptr_t)dst_buf, BUF_SIZE);
+}
+
+static void check(const char *what, const uint8_t *dst, size_t size) {
+    if(memcmp(uncached((uint8_t *)dst_buf), ref_buf, BUF_SIZE)) {
+        printf("  ERROR: %s of %u bytes to %p gave the wrong result\n",
+               what, (unsigned int)size, (void *)dst);
+        errors++;
+    }
+}
+
+static uint64_t time_copy(copy_fn fn, uint8_t *dst, const uint8_t *src,
+                          size_t size, unsigned int reps) {
+    uint64_t start = timer_ns_gettime64();
+
+    while(reps--)
+        fn(dst, src, size);
+
+    return timer_ns_gettime64() - start;
+}
+
+static uint64_t time_set(set_fn fn, uint8_t *dst, size_t size,
+                         unsigned int reps) {
+    uint64_t start = timer_ns_gettime64();
+
+    while(reps--)
+        fn(dst, 0x5a, size);
+
+    return timer_ns_gettime64() - start;
+}
+
+static uint64_t time_cmp(cmp_fn fn, const uint8_t *a, const uint8_t *b,
+                         size_t size, unsigned int reps) {
+    volatile int rv;
+    uint64_t start = timer_ns_gettime64();
+
+    while(reps--)
+        rv = fn(a, b, size);
+
+    (void)rv;
+    return timer_ns_gettime64() - start;
+}
+
+static void bench_memcpy(void) {
+    size_t i, j, size;
+    unsigned int reps;
+    uint8_t *dst, *udst;
+    const uint8_t *src;
+    double r[4];
+
+    printf("memcpy                     cached (MB/s)      uncached (MB/s)\n");
+    printf("   size  dst src          kos     loop        kos     loop\n");
+
+    for(i = 0; i < __array_size(sizes); i++) {
+        for(j = 0; j < __array_size(aligns); j++) {
+            size = sizes[i];
+            reps = reps_for(size);
+            dst = dst_buf + aligns[j].dst;
+            udst = uncached(dst);
+            src = src_buf + aligns[j].src;
+
+            fill(ref_buf);
+            loop_copy(ref_buf + aligns[j].dst, src, size);
+
+            fill(dst_buf);
+
+            r[0] = mbps(size, reps, time_copy(memcpy, dst, src, size, reps));
+            r[1] = mbps(size, reps, time_copy(loop_copy, dst, src, size, reps));
+            dcache_purge_range((uintptr_t)dst_buf, BUF_SIZE);
+            check("memcpy", dst, size);
+
+            fill(dst_buf);
+            r[2] = mbps(size, reps / 4 + 1,
+                        time_copy(memcpy, udst, src, size, reps / 4 + 1));
+            check("memcpy", udst, size);
+            r[3] = mbps(size, reps / 4 + 1,
+                        time_copy(loop_copy, udst, src, size, reps / 4 + 1));
+
+            printf("  %5u  %3u %3u     %8.1f %8.1f   %8.1f %8.1f\n",
+                   (unsigned int)size, (unsigned int)aligns[j].dst,
+                   (unsigned int)aligns[j].src, r[0], r[1], r[2], r[3]);
+        }
+    }
+
+    printf("\n");
+}
+
+static void bench_memset(void) {
+    size_t i, j, size;
+    unsigned int reps;
+    uint8_t *dst, *udst;
+    double r[4];
+
+    printf("memset                     cached (MB/s)      uncached (MB/s)\n");
+    printf("   size  dst              kos     loop        kos     loop\n");
+
+    for(i = 0; i < __array_size(sizes); i++) {
+        for(j = 0; j < __array_size(set_aligns); j++) {
+            size = sizes[i];
+            reps = reps_for(size);
+            dst = dst_buf + set_aligns[j];
+            udst = uncached(dst);
+
+            fill(ref_buf);
+            loop_set(ref_buf + set_aligns[j], 0x5a, size);
+
+            fill(dst_buf);
+
+            r[0] = mbps(size, reps, time_set(memset, dst, size, reps));
+            r[1] = mbps(size, reps, time_set(loop_set, dst, size, reps));
+            dcache_purge_range((uintptr_t)dst_buf, BUF_SIZE);
+            check("memset", dst, size);
+
+            fill(dst_buf);
+            r[2] = mbps(size, reps / 4 + 1,
+                        time_set(memset, udst, size, reps / 4 + 1));
+            check("memset", udst, size);
+            r[3] = mbps(size, reps / 4 + 1,
+                        time_set(loop_set, udst, size, reps / 4 + 1));
+
+            printf("  %5u  %3u             %8.1f %8.1f   %8.1f %8.1f\n",
+                   (unsigned int)size, (unsigned int)set_aligns[j], r[0], r[1],
+                   r[2], r[3]);
+        }
+    }
+
+    printf("\n");
+}
+
+static void bench_memmove(void) {
+    static const int shifts[] = { -32, -8, -3, 3, 8, 32 };
+    size_t i, j, size;
+    unsigned int reps;
+    uint8_t *dst, *src;
+    double r[2];
+
+    printf("memmove (overlapping)      cached (MB/s)\n");
+    printf("   size  shift            kos     loop\n");
+
+    for(i = 0; i < __array_size(sizes) - 1; i++) {
+        for(j = 0; j < __array_size(shifts); j++) {
+            size = sizes[i];
+            reps = reps_for(size);
+            src = dst_buf + 32;
+            dst = src + shifts[j];
+
+            fill(dst_buf);
+            fill(ref_buf);
+            loop_move(ref_buf + (dst - dst_buf), ref_buf + (src - dst_buf),
+                      size);
+
+            memmove(dst, src, size);
+            dcache_purge_range((uintptr_t)dst_buf, BUF_SIZE);
+            check("memmove", dst, size);
+
+            r[0] = mbps(size, reps, time_copy(memmove, dst, src, size, reps));
+            r[1] = mbps(size, reps, time_copy(loop_move, dst, src, size, reps));
+
+            printf("  %5u  %4d            %8.1f %8.1f\n", (unsigned int)size,
+                   shifts[j], r[0], r[1]);
+        }
+    }
+
+    printf("\n");
+}
+
+static void bench_memcmp(void) {
+    size_t i, j, size;
+    unsigned int reps;
+    uint8_t *a, *b;
+    double r[2];
+    int bad;
+
+    printf("memcmp (equal)             cached (MB/s)\n");
+    printf("   size  a   b                kos     loop\n");
+
+    for(i = 0; i < __array_size(sizes); i++) {
+        for(j = 0; j < __array_size(aligns); j++) {
+            size = sizes[i];
+            reps = reps_for(size);
+            a = dst_buf + aligns[j].dst;
+            b = src_buf + aligns[j].src;
+
+            fill(dst_buf);
+            memcpy(a, b, size);
+
+            /* Equal, then with a difference in the middle. */
+            bad = memcmp(a, b, size) != 0;
+            a[size / 2] ^= 0x81;
+            bad |= !memcmp(a, b, size) ||
+                   (memcmp(a, b, size) > 0) != (loop_cmp(a, b, size) > 0);
+            a[size / 2] ^= 0x81;
+
+            if(bad) {
+                printf("  ERROR: memcmp of %u bytes gave the wrong result\n",
+                       (unsigned int)size);
+                errors++;
+            }
+
+            r[0] = mbps(size, reps, time_cmp(memcmp, a, b, size, reps));
+            r[1] = mbps(size, reps, time_cmp(loop_cmp, a, b, size, reps));
+
+            printf("  %5u  %3u %3u            %8.1f %8.1f\n",
+                   (unsigned int)size, (unsigned int)aligns[j].dst,
+                   (unsigned int)aligns[j].src, r[0], r[1]);
+        }
+    }
+
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    size_t i;
+
+    (void)argc;
+    (void)argv;
+
+    printf("KallistiOS memory function benchmark\n\n");
+
+    srand(1234);
+
+    for(i = 0; i < BUF_SIZE; i++)
+        src_buf[i] = (uint8_t)rand();
+
+    bench_memcpy();
+    bench_memset();
+    bench_memmove();
+    bench_memcmp();
+
+    if(errors)
+        printf("%u errors!\n", errors);
+    else
+        printf("All results were correct.\n");
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
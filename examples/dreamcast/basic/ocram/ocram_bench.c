@@ -0,0 +1,183 @@
+/* KallistiOS ##version##
+
+   ocram_bench.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program measures vertex transform throughput with the data the
+   transform keeps going back to (a palette of bone matrices, and the batch
+   buffer on the stack) in main RAM, and then in the operand cache RAM.
+
+   Each vertex picks one of the bone matrices, so with a large enough mesh
+   streaming through the 8 KB of cache left, the palette keeps getting
+   evicted; in OCRAM, it never is. The last run does the same from a thread
+   whose stack was allocated with ocram_alloc(), so that the batch buffer
+   lives there too. The results of all runs are checked to be identical. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <kos/init.h>
+#include <kos/thread.h>
+#include <arch/ocram.h>
+#include <arch/timer.h>
+#include <dc/vector.h>
+
+KOS_INIT_FLAGS(INIT_DEFAULT | INIT_OCRAM);
+
+#define VERTS       16384
+#define BONES       32
+#define BATCH       64
+#define PASSES      20
+
+typedef struct {
+    float x, y, z;
+    uint32_t bone;
+} vert_t;
+
+typedef struct {
+    float x, y, z, w;
+} out_t;
+
+static vert_t verts[VERTS];
+static out_t out[VERTS];
+static out_t ref[VERTS];
+
+static matrix_t ram_palette[BONES];
+static matrix_t ocram_palette[BONES] __ocram;
+
+typedef struct {
+    const matrix_t *palette;
+    uint64_t time;
+} run_t;
+
+static void transform(const matrix_t *palette, const vert_t *in, out_t *dst,
+                      size_t count) {
+    out_t batch[BATCH];
+    size_t i, j;
+
+    for(i = 0; i < count; i += BATCH) {
+        for(j = 0; j < BATCH; j++) {
+            const vert_t *v = &in[i + j];
+            const float (*m)[4] = palette[v->bone];
+            float w = m[0][3] * v->x + m[1][3] * v->y + m[2][3] * v->z + m[3][3];
+
+            w = 1.0f / w;
+            batch[j].x = (m[0][0] * v->x + m[1][0] * v->y + m[2][0] * v->z + m[3][0]) * w;
+            batch[j].y = (m[0][1] * v->x + m[1][1] * v->y + m[2][1] * v->z + m[3][1]) * w;
+            batch[j].z = w;
+            batch[j].w = (float)v->bone;
+        }
+
+        /* Hand the batch off, as it would be to the PVR. */
+        memcpy(&dst[i], batch, sizeof(batch));
+    }
+}
+
+static void *run_thd(void *param) {
+    run_t *run = param;
+    uint64_t start;
+    int i;
+
+    start = timer_us_gettime64();
+
+    for(i = 0; i < PASSES; i++)
+        transform(run->palette, verts, out, VERTS);
+
+    run->time = timer_us_gettime64() - start;
+
+    return NULL;
+}
+
+static void report(const char *name, const run_t *run, int check) {
+    double mverts = (double)VERTS * PASSES / run->time;
+
+    printf("  %-28s %8llu us  %6.2f Mverts/s", name,
+           (unsigned long long)run->time, mverts);
+
+    if(check && memcmp(out, ref, sizeof(out)))
+        printf("  MISMATCH");
+
+    printf("\n");
+}
+
+static void setup(void) {
+    int i, j, k;
+
+    srand(1234);
+
+    for(i = 0; i < VERTS; i++) {
+        verts[i].x = (float)(rand() % 2000 - 1000) / 100.0f;
+        verts[i].y = (float)(rand() % 2000 - 1000) / 100.0f;
+        verts[i].z = (float)(rand() % 2000 - 1000) / 100.0f;
+        verts[i].bone = rand() % BONES;
+    }
+
+    for(i = 0; i < BONES; i++) {
+        for(j = 0; j < 4; j++)
+            for(k = 0; k < 4; k++)
+                ram_palette[i][j][k] = (j == k) ? 1.0f : 0.0f;
+
+        ram_palette[i][3][0] = (float)i;
+        ram_palette[i][3][1] = (float)-i;
+        ram_palette[i][2][3] = 0.01f;
+        ram_palette[i][3][3] = 20.0f;
+    }
+
+    memcpy(ocram_palette, ram_palette, sizeof(ram_palette));
+}
+
+int main(int argc, char **argv) {
+    kthread_attr_t attr = { 0 };
+    kthread_t *thd;
+    void *stack;
+    run_t run;
+
+    (void)argc;
+    (void)argv;
+
+    printf("KallistiOS OCRAM benchmark\n\n");
+
+    if(!ocram_enabled()) {
+        printf("OCRAM is not enabled, nothing to do.\n");
+        return EXIT_FAILURE;
+    }
+
+    setup();
+
+    printf("%d vertices x %d passes, %d bone matrices, %u bytes of OCRAM "
+           "free\n\n", VERTS, PASSES, BONES, (unsigned int)ocram_available());
+
+    run.palette = ram_palette;
+    run_thd(&run);
+    memcpy(ref, out, sizeof(out));
+    report("palette and stack in RAM", &run, 0);
+
+    run.palette = ocram_palette;
+    run_thd(&run);
+    report("palette in OCRAM", &run, 1);
+
+    if(!(stack = ocram_alloc(OCRAM_BANK_SIZE))) {
+        perror("ocram_alloc");
+        return EXIT_FAILURE;
+    }
+
+    attr.stack_ptr = stack;
+    attr.stack_size = OCRAM_BANK_SIZE;
+    attr.label = "ocram_bench";
+
+    if(!(thd = thd_create_ex(&attr, run_thd, &run))) {
+        perror("thd_create_ex");
+        ocram_free(stack);
+        return EXIT_FAILURE;
+    }
+
+    thd_join(thd, NULL);
+    ocram_free(stack);
+    report("palette and stack in OCRAM", &run, 1);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/* KallistiOS ##version##
+
+   fiber_bench.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program compares the cost of switching between fibers with the cost
+   of switching between threads with thd_pass(). It then runs a large number
+   of fibers round-robin on a single thread, to show that they stay cheap
+   even when there are thousands of them. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <kos/thread.h>
+#include <kos/fiber.h>
+
+#include <arch/arch.h>
+#include <arch/timer.h>
+
+#define ITERATIONS      100000
+#define MANY_FIBERS     2000
+#define MANY_ROUNDS     50
+#define STACK_SIZE      1024
+
+static void *pass_thd(void *param) {
+    unsigned int i;
+
+    (void)param;
+
+    for(i = 0; i < ITERATIONS; ++i)
+        thd_pass();
+
+    return NULL;
+}
+
+static void bench_threads(void) {
+    kthread_t *t1, *t2;
+    uint64_t start, elapsed;
+
+    start = timer_ns_gettime64();
+
+    t1 = thd_create(false, pass_thd, NULL);
+    t2 = thd_create(false, pass_thd, NULL);
+    thd_join(t1, NULL);
+    thd_join(t2, NULL);
+
+    elapsed = timer_ns_gettime64() - start;
+
+    printf("thd_pass():     %6llu ns/switch\n", elapsed / (2 * ITERATIONS));
+}
+
+static void *yield_fiber(void *param) {
+    unsigned int i, rounds = (unsigned int)(uintptr_t)param;
+
+    for(i = 0; i < rounds; ++i)
+        fiber_yield();
+
+    return NULL;
+}
+
+static void bench_fibers(void) {
+    static uint8_t stack[STACK_SIZE] __attribute__((aligned(8)));
+    kfiber_t fiber;
+    uint64_t start, elapsed;
+
+    fiber_create(&fiber, stack, sizeof(stack), yield_fiber,
+                 (void *)ITERATIONS);
+
+    start = timer_ns_gettime64();
+    fiber_join(&fiber, NULL);
+    elapsed = timer_ns_gettime64() - start;
+
+    /* Each iteration is a resume and a yield. */
+    printf("fiber switch:   %6llu ns/switch\n", elapsed / (2 * ITERATIONS));
+}
+
+static void bench_many_fibers(void) {
+    kfiber_t *fibers;
+    uint8_t *stacks;
+    uint64_t start, elapsed;
+    unsigned int i, live = MANY_FIBERS, switches = 0;
+
+    fibers = malloc(MANY_FIBERS * sizeof(kfiber_t));
+    stacks = aligned_alloc(8, MANY_FIBERS * STACK_SIZE);
+
+    if(!fibers || !stacks) {
+        printf("Out of memory for %d fibers\n", MANY_FIBERS);
+        free(fibers);
+        free(stacks);
+        return;
+    }
+
+    for(i = 0; i < MANY_FIBERS; ++i)
+        fiber_create(&fibers[i], stacks + i * STACK_SIZE, STACK_SIZE,
+                     yield_fiber, (void *)MANY_ROUNDS);
+
+    start = timer_ns_gettime64();
+
+    while(live) {
+        for(i = 0; i < MANY_FIBERS; ++i) {
+            switch(fiber_resume(&fibers[i])) {
+                case 1:
+                    --live;
+                    /* Fall through */
+                case 0:
+                    switches += 2;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    elapsed = timer_ns_gettime64() - start;
+
+    printf("%d fibers:    %6llu ns/switch (%u switches)\n", MANY_FIBERS,
+           elapsed / switches, switches);
+
+    free(stacks);
+    free(fibers);
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    printf("Fiber benchmark starting\n");
+
+    bench_threads();
+    bench_fibers();
+    bench_many_fibers();
+
+    printf("Fiber benchmark finished\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,261 @@
+/* KallistiOS ##version##
+
+   msgqueue.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program compares three ways of handing work from one thread to
+   another:
+
+   - a linked list of malloc'ed nodes, protected by a mutex and a condition
+     variable, which is what a lot of code does by hand;
+   - a kernel message queue, copying the messages in and out;
+   - a kernel message queue, building and reading the messages in place with
+     the reserve/commit functions.
+
+   It then shows the POSIX message queue API built on top of the kernel one,
+   including message priorities. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <mqueue.h>
+
+#include <kos/thread.h>
+#include <kos/mutex.h>
+#include <kos/cond.h>
+#include <kos/msgqueue.h>
+
+#include <arch/timer.h>
+
+#define MESSAGES    20000
+#define MSG_SIZE    256
+#define SLOTS       16
+
+typedef struct msg {
+    uint32_t seq;
+    uint8_t payload[MSG_SIZE - sizeof(uint32_t)];
+} msg_t;
+
+static unsigned int errors;
+
+static void check_msg(const msg_t *msg, uint32_t seq) {
+    if(msg->seq != seq || msg->payload[0] != (uint8_t)seq ||
+       msg->payload[sizeof(msg->payload) - 1] != (uint8_t)~seq)
+        errors++;
+}
+
+static void fill_msg(msg_t *msg, uint32_t seq) {
+    msg->seq = seq;
+    memset(msg->payload, 0, sizeof(msg->payload));
+    msg->payload[0] = (uint8_t)seq;
+    msg->payload[sizeof(msg->payload) - 1] = (uint8_t)~seq;
+}
+
+/* Mutex, condition variable and malloc'ed nodes. */
+typedef struct node {
+    struct node *next;
+    msg_t msg;
+} node_t;
+
+static mutex_t list_mutex = MUTEX_INITIALIZER;
+static condvar_t list_cv = COND_INITIALIZER;
+static node_t *list_head, *list_tail;
+
+static void *list_consumer(void *param) {
+    uint32_t seq;
+    node_t *node;
+
+    (void)param;
+
+    for(seq = 0; seq < MESSAGES; seq++) {
+        mutex_lock(&list_mutex);
+
+        while(!list_head)
+            cond_wait(&list_cv, &list_mutex);
+
+        node = list_head;
+        list_head = node->next;
+        if(!list_head)
+            list_tail = NULL;
+
+        mutex_unlock(&list_mutex);
+
+        check_msg(&node->msg, seq);
+        free(node);
+    }
+
+    return NULL;
+}
+
+static void list_producer(void) {
+    uint32_t seq;
+    node_t *node;
+
+    for(seq = 0; seq < MESSAGES; seq++) {
+        node = malloc(sizeof(*node));
+        fill_msg(&node->msg, seq);
+        node->next = NULL;
+
+        mutex_lock(&list_mutex);
+
+        if(list_tail)
+            list_tail->next = node;
+        else
+            list_head = node;
+
+        list_tail = node;
+
+        cond_signal(&list_cv);
+        mutex_unlock(&list_mutex);
+    }
+}
+
+/* Kernel message queue, copying. */
+static msgqueue_t queue;
+
+static void *copy_consumer(void *param) {
+    uint32_t seq;
+    msg_t msg;
+
+    (void)param;
+
+    for(seq = 0; seq < MESSAGES; seq++) {
+        if(msgq_recv(&queue, &msg, sizeof(msg), NULL) != sizeof(msg))
+            errors++;
+
+        check_msg(&msg, seq);
+    }
+
+    return NULL;
+}
+
+static void copy_producer(void) {
+    uint32_t seq;
+    msg_t msg;
+
+    for(seq = 0; seq < MESSAGES; seq++) {
+        fill_msg(&msg, seq);
+        msgq_send(&queue, &msg, sizeof(msg), 0);
+    }
+}
+
+/* Kernel message queue, in place. */
+static void *zc_consumer(void *param) {
+    uint32_t seq;
+    msg_t *msg;
+    size_t len;
+
+    (void)param;
+
+    for(seq = 0; seq < MESSAGES; seq++) {
+        msg = msgq_recv_reserve(&queue, &len, NULL, 0);
+        check_msg(msg, seq);
+        msgq_recv_commit(&queue, msg);
+    }
+
+    return NULL;
+}
+
+static void zc_producer(void) {
+    uint32_t seq;
+    msg_t *msg;
+
+    for(seq = 0; seq < MESSAGES; seq++) {
+        msg = msgq_send_reserve(&queue, 0);
+        fill_msg(msg, seq);
+        msgq_send_commit(&queue, msg, sizeof(*msg), 0);
+    }
+}
+
+static void run(const char *name, void *(*consumer)(void *),
+                void (*producer)(void)) {
+    uint64_t start, end;
+    kthread_t *thd;
+
+    start = timer_ns_gettime64();
+
+    thd = thd_create(false, consumer, NULL);
+    producer();
+    thd_join(thd, NULL);
+
+    end = timer_ns_gettime64();
+
+    printf("%-24s %8llu us  %6llu ns/msg\n", name, (end - start) / 1000,
+           (end - start) / MESSAGES);
+}
+
+static int posix_demo(void) {
+    struct mq_attr attr = { 0, 4, 32, 0 };
+    unsigned int prio;
+    char buf[32];
+    ssize_t len;
+    mqd_t mq;
+
+    mq = mq_open("/demo", O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+    if(mq == (mqd_t)-1) {
+        perror("mq_open");
+        return -1;
+    }
+
+    mq_send(mq, "low", 4, 1);
+    mq_send(mq, "normal", 7, 5);
+    mq_send(mq, "urgent", 7, 10);
+    mq_send(mq, "normal again", 13, 5);
+
+    /* The queue is full, and O_NONBLOCK makes this fail right away. */
+    attr.mq_flags = O_NONBLOCK;
+    mq_setattr(mq, &attr, NULL);
+
+    if(mq_send(mq, "overflow", 9, 0) != -1 || errno != EAGAIN) {
+        printf("Sending to a full queue didn't fail\n");
+        errors++;
+    }
+
+    while((len = mq_receive(mq, buf, sizeof(buf), &prio)) >= 0)
+        printf("  received \"%s\" (%d bytes, priority %u)\n", buf, (int)len,
+               prio);
+
+    if(errno != EAGAIN)
+        errors++;
+
+    mq_close(mq);
+    mq_unlink("/demo");
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    printf("KallistiOS message queue example\n\n");
+    printf("%d messages of %d bytes, %d slots\n\n", MESSAGES, MSG_SIZE, SLOTS);
+
+    run("mutex + cond + malloc", list_consumer, list_producer);
+
+    if(msgq_init(&queue, sizeof(msg_t), SLOTS, NULL)) {
+        perror("msgq_init");
+        return EXIT_FAILURE;
+    }
+
+    run("msgq copy", copy_consumer, copy_producer);
+    run("msgq reserve/commit", zc_consumer, zc_producer);
+
+    msgq_destroy(&queue);
+
+    printf("\nPOSIX message queue, in order of priority:\n");
+
+    if(posix_demo() || errors) {
+        printf("\n===== MESSAGE QUEUE TEST FAILED (%u errors) =====\n", errors);
+        return EXIT_FAILURE;
+    }
+
+    printf("\n===== MESSAGE QUEUE TEST DONE =====\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+/* KallistiOS ##version##
+
+   periodic.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program demonstrates the periodic real-time scheduling class. One
+   thread is released on every vblank and another every 5ms, while a couple of
+   normal threads keep the CPU busy. The periodic threads record how late
+   each release was, and a third periodic thread deliberately blows its
+   budget every few jobs to show overrun accounting. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include <kos/thread.h>
+
+#include <arch/arch.h>
+#include <arch/timer.h>
+
+#define JOBS            300
+#define PERIOD_US       5000
+#define BUSY_THREADS    2
+
+static atomic_bool done;
+
+typedef struct {
+    uint64_t max_late;
+    uint64_t total_late;
+    uint64_t min_interval;
+    uint64_t max_interval;
+} jitter_t;
+
+static void jitter_add(jitter_t *j, uint64_t prev, uint64_t now,
+                       uint64_t expected) {
+    uint64_t interval = now - prev;
+    uint64_t late = interval > expected ? interval - expected : 0;
+
+    if(late > j->max_late)
+        j->max_late = late;
+
+    if(!j->min_interval || interval < j->min_interval)
+        j->min_interval = interval;
+
+    if(interval > j->max_interval)
+        j->max_interval = interval;
+
+    j->total_late += late;
+}
+
+static void report(const char *name, const jitter_t *j, kthread_t *thd) {
+    thd_period_stats_t stats;
+
+    thd_get_period_stats(thd, &stats);
+
+    printf("%s: interval %llu..%llu us, avg late %llu us, max late %llu us\n",
+           name, j->min_interval / 1000, j->max_interval / 1000,
+           j->total_late / 1000 / JOBS, j->max_late / 1000);
+    printf("    %lu releases, %lu overruns, %lu misses, "
+           "longest job %llu us\n", (unsigned long)stats.releases,
+           (unsigned long)stats.overruns, (unsigned long)stats.misses,
+           stats.max_cpu_ns / 1000);
+}
+
+static void *vblank_thd(void *param) {
+    jitter_t j = { 0 };
+    uint64_t prev, now;
+    int i;
+
+    (void)param;
+
+    thd_set_period_vblank(1, 2000);
+    thd_wait_period();
+    prev = timer_ns_gettime64();
+
+    for(i = 0; i < JOBS; ++i) {
+        thd_wait_period();
+        now = timer_ns_gettime64();
+
+        /* NTSC/VGA vblank is ~16.7ms; PAL is 20ms. We don't know which one
+           we're on, so only the spread of intervals is really meaningful. */
+        jitter_add(&j, prev, now, 16683000);
+        prev = now;
+    }
+
+    report("vblank", &j, thd_get_current());
+    thd_clear_period();
+
+    return NULL;
+}
+
+static void *timed_thd(void *param) {
+    jitter_t j = { 0 };
+    uint64_t prev, now;
+    int i;
+
+    (void)param;
+
+    thd_set_period_us(PERIOD_US, 1000);
+    thd_wait_period();
+    prev = timer_ns_gettime64();
+
+    for(i = 0; i < JOBS; ++i) {
+        thd_wait_period();
+        now = timer_ns_gettime64();
+        jitter_add(&j, prev, now, PERIOD_US * 1000);
+        prev = now;
+    }
+
+    report("5ms", &j, thd_get_current());
+    thd_clear_period();
+
+    return NULL;
+}
+
+static void *greedy_thd(void *param) {
+    jitter_t j = { 0 };
+    uint64_t prev, now;
+    int i;
+
+    (void)param;
+
+    /* 20ms period with a 1ms budget, but every tenth job spins for 15ms. */
+    thd_set_period_us(20000, 1000);
+    thd_wait_period();
+    prev = timer_ns_gettime64();
+
+    for(i = 0; i < JOBS; ++i) {
+        if(!(i % 10))
+            timer_spin_delay_us(15000);
+
+        thd_wait_period();
+        now = timer_ns_gettime64();
+        jitter_add(&j, prev, now, 20000000);
+        prev = now;
+    }
+
+    report("greedy", &j, thd_get_current());
+    thd_clear_period();
+
+    return NULL;
+}
+
+static void *busy_thd(void *param) {
+    (void)param;
+
+    while(!done)
+        ;
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    kthread_t *busy[BUSY_THREADS], *rt[3];
+    int i;
+
+    (void)argc;
+    (void)argv;
+
+    printf("Periodic scheduling test starting\n");
+
+    for(i = 0; i < BUSY_THREADS; ++i)
+        busy[i] = thd_create(false, busy_thd, NULL);
+
+    rt[0] = thd_create(false, vblank_thd, NULL);
+    rt[1] = thd_create(false, timed_thd, NULL);
+    rt[2] = thd_create(false, greedy_thd, NULL);
+
+    for(i = 0; i < 3; ++i)
+        thd_join(rt[i], NULL);
+
+    done = true;
+
+    for(i = 0; i < BUSY_THREADS; ++i)
+        thd_join(busy[i], NULL);
+
+    printf("Periodic scheduling test finished\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,242 @@
+/* KallistiOS ##version##
+
+   prio_inherit.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program stresses priority inheritance through chains of locks, and
+   measures the worst-case time a high priority thread waits for a lock.
+
+   Each round sets up the classic inversion, one lock deeper than usual:
+
+   - a low priority "loader" thread takes lock B and has some work to do,
+   - a medium priority thread takes lock A, then blocks on lock B,
+   - a "hog" thread, above both of them, starts burning CPU,
+   - a high priority "audio" thread blocks on lock A.
+
+   Without inheritance (or with inheritance that only boosts the direct
+   holder of a lock), the loader never gets to run while the hog is busy, so
+   the audio thread waits for as long as the hog runs. With transitive
+   inheritance, the audio thread's priority reaches the loader through the
+   medium thread, and it only waits for the loader's (and the medium thread's)
+   work to be done.
+
+   The test is run with mutexes using MUTEX_PRIO_NONE for reference, then
+   with MUTEX_PRIO_INHERIT, then with lock B replaced by a reader/writer
+   semaphore held for writing by the loader. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <kos/thread.h>
+#include <kos/mutex.h>
+#include <kos/rwsem.h>
+#include <kos/sem.h>
+
+#include <arch/arch.h>
+#include <arch/timer.h>
+#include <dc/maple.h>
+#include <dc/maple/controller.h>
+
+#define ROUNDS          200
+#define WORK_US         500
+#define HOG_US          20000
+
+#define PRIO_MAIN       1
+#define PRIO_AUDIO      3
+#define PRIO_HOG        5
+#define PRIO_MEDIUM     7
+#define PRIO_LOADER     9
+
+enum { MODE_NONE, MODE_INHERIT, MODE_RWSEM };
+
+static mutex_t lock_a, lock_b;
+static rw_semaphore_t lock_rw;
+static semaphore_t ready, done;
+static volatile int start, stop, mode;
+static uint64_t latency;
+static int failed;
+
+static void busy_wait(uint64_t us) {
+    uint64_t end = timer_us_gettime64() + us;
+
+    while(timer_us_gettime64() < end)
+        ;
+}
+
+static void *loader_thd(void *param) {
+    (void)param;
+
+    if(mode == MODE_RWSEM)
+        rwsem_write_lock(&lock_rw);
+    else
+        mutex_lock(&lock_b);
+
+    sem_signal(&ready);
+
+    while(!start)
+        thd_pass();
+
+    busy_wait(WORK_US);
+
+    /* Check that we were boosted, and that releasing the lock also gives
+       the boost back. */
+    if(mode != MODE_NONE && thd_get_prio(NULL) != PRIO_AUDIO)
+        ++failed;
+
+    if(mode == MODE_RWSEM)
+        rwsem_write_unlock(&lock_rw);
+    else
+        mutex_unlock(&lock_b);
+
+    if(thd_get_prio(NULL) != PRIO_LOADER)
+        ++failed;
+
+    return NULL;
+}
+
+static void *medium_thd(void *param) {
+    (void)param;
+
+    mutex_lock(&lock_a);
+    sem_signal(&ready);
+
+    if(mode == MODE_RWSEM) {
+        rwsem_read_lock(&lock_rw);
+        rwsem_read_unlock(&lock_rw);
+    }
+    else {
+        mutex_lock(&lock_b);
+        mutex_unlock(&lock_b);
+    }
+
+    mutex_unlock(&lock_a);
+
+    if(thd_get_prio(NULL) != PRIO_MEDIUM)
+        ++failed;
+
+    return NULL;
+}
+
+static void *hog_thd(void *param) {
+    uint64_t end = timer_us_gettime64() + HOG_US;
+
+    (void)param;
+
+    while(!stop && timer_us_gettime64() < end)
+        ;
+
+    return NULL;
+}
+
+static void *audio_thd(void *param) {
+    uint64_t t;
+
+    (void)param;
+
+    t = timer_us_gettime64();
+    mutex_lock(&lock_a);
+    latency = timer_us_gettime64() - t;
+    mutex_unlock(&lock_a);
+
+    stop = 1;
+    sem_signal(&done);
+
+    return NULL;
+}
+
+static kthread_t *spawn(void *(*routine)(void *), prio_t prio,
+                        const char *label) {
+    kthread_attr_t attr = { .prio = prio, .label = label };
+    kthread_t *thd = thd_create_ex(&attr, routine, NULL);
+
+    if(!thd) {
+        printf("Could not create %s thread\n", label);
+        exit(EXIT_FAILURE);
+    }
+
+    return thd;
+}
+
+static void run(int m, const char *name) {
+    kthread_t *thds[4];
+    uint64_t worst = 0, total = 0;
+    int i, j;
+
+    mode = m;
+    mutex_set_protocol(&lock_a, m == MODE_NONE ? MUTEX_PRIO_NONE :
+                       MUTEX_PRIO_INHERIT);
+    mutex_set_protocol(&lock_b, m == MODE_NONE ? MUTEX_PRIO_NONE :
+                       MUTEX_PRIO_INHERIT);
+
+    for(i = 0; i < ROUNDS; ++i) {
+        start = stop = 0;
+
+        thds[0] = spawn(loader_thd, PRIO_LOADER, "loader");
+        sem_wait(&ready);
+        thds[1] = spawn(medium_thd, PRIO_MEDIUM, "medium");
+        sem_wait(&ready);
+
+        /* Give the medium thread time to block on the loader's lock. */
+        thd_sleep(1);
+
+        thds[2] = spawn(hog_thd, PRIO_HOG, "hog");
+        start = 1;
+        thds[3] = spawn(audio_thd, PRIO_AUDIO, "audio");
+        sem_wait(&done);
+
+        for(j = 0; j < 4; ++j)
+            thd_join(thds[j], NULL);
+
+        total += latency;
+
+        if(latency > worst)
+            worst = latency;
+    }
+
+    printf("%-22s  %8llu us  %8llu us\n", name, total / ROUNDS, worst);
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    cont_btn_callback(0, CONT_START | CONT_A | CONT_B | CONT_X | CONT_Y,
+                      (cont_btn_callback_t)arch_exit);
+
+    /* Stay above all the test threads, so we can set each round up. */
+    thd_set_prio(thd_current, PRIO_MAIN);
+
+    mutex_init(&lock_a, MUTEX_TYPE_NORMAL);
+    mutex_init(&lock_b, MUTEX_TYPE_NORMAL);
+    rwsem_init(&lock_rw);
+    sem_init(&ready, 0);
+    sem_init(&done, 0);
+
+    printf("KallistiOS priority inheritance stress test\n\n");
+    printf("Work in the chain: %d us, hog: %d us, %d rounds\n\n", WORK_US,
+           HOG_US, ROUNDS);
+    printf("lock chain              average      worst\n");
+
+    run(MODE_NONE, "mutex, no inheritance");
+    run(MODE_INHERIT, "mutex, inheritance");
+    run(MODE_RWSEM, "mutex + rwsem");
+
+    mutex_destroy(&lock_a);
+    mutex_destroy(&lock_b);
+    rwsem_destroy(&lock_rw);
+    sem_destroy(&ready);
+    sem_destroy(&done);
+
+    if(failed) {
+        printf("\n%d priority restore errors!\n", failed);
+        printf("\n===== PRIORITY INHERITANCE TEST FAILED =====\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("\n===== PRIORITY INHERITANCE TEST DONE =====\n");
+
+    return EXIT_SUCCESS;
+}
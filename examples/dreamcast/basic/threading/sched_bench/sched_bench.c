@@ -0,0 +1,115 @@
+/* KallistiOS ##version##
+
+   sched_bench.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program measures the cost of a context switch as the number of threads
+   in the system grows. For each round, a number of threads are created which
+   do nothing but yield to each other with thd_pass(), while the main thread
+   sleeps for a fixed amount of time. A set of blocked "background" threads at
+   various priorities is also kept around, so that the system has a realistic
+   number of threads. With a constant-time scheduler, the cost per switch
+   should stay flat regardless of the thread count. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include <kos/thread.h>
+#include <kos/sem.h>
+
+#include <arch/arch.h>
+#include <arch/timer.h>
+#include <dc/maple.h>
+#include <dc/maple/controller.h>
+
+#define MAX_THREADS     64
+#define BG_THREADS      32
+#define ROUND_MS        1000
+
+static atomic_bool done;
+static atomic_uint switches;
+static semaphore_t bg_sem = SEM_INITIALIZER(0);
+
+static void *yield_thd(void *param) {
+    unsigned int cnt = 0;
+
+    (void)param;
+
+    while(!done) {
+        thd_pass();
+        ++cnt;
+    }
+
+    switches += cnt;
+    return NULL;
+}
+
+static void *bg_thd(void *param) {
+    (void)param;
+
+    /* Just sit on the semaphore until the end of the test. */
+    sem_wait(&bg_sem);
+    return NULL;
+}
+
+static void run_round(unsigned int nthds) {
+    kthread_t *thds[MAX_THREADS];
+    uint64_t start, elapsed;
+    unsigned int i;
+
+    done = false;
+    switches = 0;
+
+    for(i = 0; i < nthds; ++i)
+        thds[i] = thd_create(false, yield_thd, NULL);
+
+    start = timer_ns_gettime64();
+    thd_sleep(ROUND_MS);
+    done = true;
+    elapsed = timer_ns_gettime64() - start;
+
+    for(i = 0; i < nthds; ++i)
+        thd_join(thds[i], NULL);
+
+    printf("%3u threads: %8u switches, %6llu ns/switch\n", nthds,
+           (unsigned int)switches,
+           switches ? elapsed / switches : 0ULL);
+}
+
+int main(int argc, char *argv[]) {
+    kthread_attr_t attr = { 0 };
+    kthread_t *bg[BG_THREADS];
+    unsigned int i;
+
+    (void)argc;
+    (void)argv;
+
+    cont_btn_callback(0, CONT_START | CONT_A | CONT_B | CONT_X | CONT_Y,
+                      (cont_btn_callback_t)arch_exit);
+
+    printf("KallistiOS scheduler benchmark\n\n");
+
+    /* Spread some blocked threads across the priority range. */
+    for(i = 0; i < BG_THREADS; ++i) {
+        attr.prio = PRIO_DEFAULT + (i * 97) % (PRIO_MAX - PRIO_DEFAULT);
+        attr.label = "bg";
+        bg[i] = thd_create_ex(&attr, bg_thd, NULL);
+    }
+
+    for(i = 1; i <= MAX_THREADS; i *= 2)
+        run_round(i);
+
+    for(i = 0; i < BG_THREADS; ++i)
+        sem_signal(&bg_sem);
+
+    for(i = 0; i < BG_THREADS; ++i)
+        thd_join(bg[i], NULL);
+
+    printf("\n===== SCHEDULER BENCHMARK DONE =====\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/* KallistiOS ##version##
+
+   stack_usage.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program shows how to measure how much stack threads actually use, so
+   that their stacks can be sized accordingly.
+
+   Stack painting is enabled before creating a few threads which recurse to
+   different depths. Once they're done, their high-water marks are read with
+   thd_get_stack_hwm(), and thd_pslist_stack() prints a report covering every
+   thread in the system along with a suggested stack size for each. Finally,
+   the guard mode is turned on, which checks every thread being switched out
+   for a stack overflow. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <kos/thread.h>
+
+#define THREAD_COUNT    4
+
+static kthread_t *threads[THREAD_COUNT];
+
+/* Use up roughly 256 bytes of stack per level. */
+static unsigned int recurse(unsigned int depth) {
+    volatile uint8_t buf[224];
+    unsigned int i, sum = 0;
+
+    for(i = 0; i < sizeof(buf); i++)
+        buf[i] = (uint8_t)(depth + i);
+
+    if(depth)
+        sum = recurse(depth - 1);
+
+    for(i = 0; i < sizeof(buf); i++)
+        sum += buf[i];
+
+    return sum;
+}
+
+static void *thd_func(void *param) {
+    unsigned int depth = (unsigned int)param;
+    unsigned int i, sum = 0;
+
+    /* Yield in between, so that guard mode gets to check the thread while
+       it's deep in its stack. */
+    for(i = 0; i < 10; i++) {
+        sum += recurse(depth);
+        thd_pass();
+    }
+
+    return (void *)sum;
+}
+
+static void run_threads(void) {
+    kthread_attr_t attr = { 0 };
+    unsigned int i;
+    ssize_t hwm;
+
+    attr.stack_size = 16 * 1024;
+
+    for(i = 0; i < THREAD_COUNT; i++) {
+        attr.label = "recurse";
+        threads[i] = thd_create_ex(&attr, thd_func, (void *)(i * 12));
+
+        if(!threads[i]) {
+            fprintf(stderr, "Cannot create thread %u\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* Don't join them yet, so they show up in the report below. */
+    thd_sleep(100);
+
+    for(i = 0; i < THREAD_COUNT; i++) {
+        hwm = thd_get_stack_hwm(threads[i]);
+        printf("Thread %d (depth %u): %d of %u bytes used\n",
+               thd_get_id(threads[i]), i * 12, (int)hwm,
+               (unsigned int)attr.stack_size);
+    }
+
+    thd_pslist_stack(printf);
+
+    for(i = 0; i < THREAD_COUNT; i++)
+        thd_join(threads[i], NULL);
+}
+
+int main(int argc, char **argv) {
+    /* The main thread was created before stack checking was enabled, so
+       there's nothing to measure there. */
+    if(thd_get_stack_hwm(NULL) < 0 && errno == EINVAL)
+        printf("Main thread stack isn't painted, as expected\n");
+
+    printf("Painting thread stacks...\n");
+    thd_set_stack_check(THD_STACK_CHECK_PAINT);
+    run_threads();
+
+    /* Any overflow from here on will stop the program at the next context
+       switch, with the thread list printed. */
+    printf("\nEnabling guard mode...\n");
+    thd_set_stack_check(THD_STACK_CHECK_GUARD);
+    run_threads();
+
+    thd_set_stack_check(THD_STACK_CHECK_OFF);
+
+    printf("Test finished successfully!\n");
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/* KallistiOS ##version##
+
+   thread_pool.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program shows how a thread pool overlaps blocking I/O with CPU work.
+
+   It simulates loading a set of assets: each one is "read" (a job that just
+   sleeps, like a thread waiting on the CD drive or a DMA transfer would),
+   then "decoded" (a job that keeps the CPU busy), as a continuation of the
+   read. A final job, which is a continuation of all the decoding jobs, stands
+   in for uploading everything to the PVR. A few high priority jobs are thrown
+   in along the way, to show that they jump ahead of the queued ones.
+
+   The whole set is loaded with pools of increasing sizes, and the time it
+   takes and the pool's queue statistics are printed for each. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <kos/thread.h>
+#include <kos/thread_pool.h>
+
+#include <arch/arch.h>
+#include <arch/timer.h>
+#include <dc/maple.h>
+#include <dc/maple/controller.h>
+
+#define ASSETS          32
+#define READ_MS         8
+#define DECODE_US       3000
+#define URGENT_JOBS     8
+
+typedef struct asset {
+    kthread_pool_job_t read;
+    kthread_pool_job_t decode;
+    int loaded;
+} asset_t;
+
+static asset_t assets[ASSETS];
+static kthread_pool_job_t upload, urgent[URGENT_JOBS];
+static int uploaded;
+
+static void busy_wait(uint64_t us) {
+    uint64_t end = timer_us_gettime64() + us;
+
+    while(timer_us_gettime64() < end)
+        ;
+}
+
+static void read_job(void *data) {
+    (void)data;
+
+    thd_sleep(READ_MS);
+}
+
+static void decode_job(void *data) {
+    asset_t *a = data;
+
+    busy_wait(DECODE_US);
+    a->loaded = 1;
+}
+
+static void upload_job(void *data) {
+    int i;
+
+    (void)data;
+
+    for(i = 0; i < ASSETS; i++)
+        uploaded += assets[i].loaded;
+}
+
+static void urgent_job(void *data) {
+    (void)data;
+
+    busy_wait(100);
+}
+
+static int run(size_t threads) {
+    kthread_attr_t attr = { .label = "pool worker" };
+    kthread_pool_t *pool;
+    thd_pool_stats_t stats;
+    uint64_t start;
+    int i;
+
+    if(!(pool = thd_pool_create(threads, &attr))) {
+        printf("Could not create a pool of %u threads\n", threads);
+        return -1;
+    }
+
+    thd_pool_job_init(&upload, upload_job, NULL, THD_POOL_PRIO_NORMAL);
+    uploaded = 0;
+
+    for(i = 0; i < ASSETS; i++) {
+        assets[i].loaded = 0;
+        thd_pool_job_init(&assets[i].read, read_job, &assets[i],
+                          THD_POOL_PRIO_LOW);
+        thd_pool_job_init(&assets[i].decode, decode_job, &assets[i],
+                          THD_POOL_PRIO_NORMAL);
+        thd_pool_job_after(&assets[i].decode, &assets[i].read);
+        thd_pool_job_after(&upload, &assets[i].decode);
+    }
+
+    start = timer_us_gettime64();
+
+    /* Submit the continuations first, to show that they only run once what
+       they depend on is done. */
+    thd_pool_submit(pool, &upload);
+
+    for(i = 0; i < ASSETS; i++) {
+        thd_pool_submit(pool, &assets[i].decode);
+        thd_pool_submit(pool, &assets[i].read);
+    }
+
+    for(i = 0; i < URGENT_JOBS; i++) {
+        thd_pool_job_init(&urgent[i], urgent_job, NULL, THD_POOL_PRIO_HIGH);
+        thd_pool_submit(pool, &urgent[i]);
+    }
+
+    thd_pool_wait_all(pool, 0);
+    start = timer_us_gettime64() - start;
+
+    thd_pool_get_stats(pool, &stats, false);
+    thd_pool_destroy(pool);
+
+    printf("%7u  %8llu us  %6u  %9llu us  %9llu us  %s\n", threads, start,
+           stats.max_queued,
+           stats.latency_total / 1000 / (stats.completed ? stats.completed : 1),
+           stats.latency_max / 1000, uploaded == ASSETS ? "ok" : "MISSING ASSETS");
+
+    return uploaded == ASSETS ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    size_t threads;
+    int rv = 0;
+
+    (void)argc;
+    (void)argv;
+
+    cont_btn_callback(0, CONT_START | CONT_A | CONT_B | CONT_X | CONT_Y,
+                      (cont_btn_callback_t)arch_exit);
+
+    printf("KallistiOS thread pool example\n\n");
+    printf("%d assets, %d ms read + %d us decode each\n\n", ASSETS, READ_MS,
+           DECODE_US);
+    printf("threads     total  max q  avg latency  max latency\n");
+
+    for(threads = 1; threads <= 8; threads *= 2)
+        rv |= run(threads);
+
+    if(rv) {
+        printf("\n===== THREAD POOL TEST FAILED =====\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("\n===== THREAD POOL TEST DONE =====\n");
+
+    return EXIT_SUCCESS;
+}
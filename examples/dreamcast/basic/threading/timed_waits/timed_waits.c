@@ -0,0 +1,125 @@
+/* KallistiOS ##version##
+
+   timed_waits.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program stresses the kernel's timer queue, which holds every thread
+   blocked in a timed wait (thd_sleep(), sem_wait_timed(), mutex_lock_timed(),
+   etc). Thousands of threads repeatedly wait on a semaphore that is never
+   signaled, each with its own pseudo-random timeout, so that the timer queue
+   is constantly being inserted into and expired out of. For each round, we
+   report how late the waits were on average, how many timed waits expired per
+   second, and how much CPU time the main thread could still get while all of
+   that is going on. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include <kos/thread.h>
+#include <kos/sem.h>
+
+#include <arch/arch.h>
+#include <arch/timer.h>
+#include <dc/maple.h>
+#include <dc/maple/controller.h>
+
+#define MAX_WAITERS     2048
+#define WAITER_STACK    2048
+#define ROUND_MS        2000
+#define MAX_TIMEOUT_MS  50
+
+static atomic_bool done;
+static atomic_ullong total_late_us;
+static atomic_uint total_waits;
+static semaphore_t never = SEM_INITIALIZER(0);
+static kthread_t *waiters[MAX_WAITERS];
+
+static void *waiter_thd(void *param) {
+    unsigned int seed = (unsigned int)param;
+    uint64_t late = 0, start, end;
+    unsigned int cnt = 0, timeout;
+
+    while(!done) {
+        /* Cheap LCG, so that every thread wakes up at a different time. */
+        seed = seed * 1103515245 + 12345;
+        timeout = 1 + (seed >> 16) % MAX_TIMEOUT_MS;
+
+        start = timer_us_gettime64();
+        sem_wait_timed(&never, timeout);
+        end = timer_us_gettime64();
+
+        if(end - start > timeout * 1000)
+            late += end - start - timeout * 1000;
+
+        ++cnt;
+    }
+
+    total_late_us += late;
+    total_waits += cnt;
+    return NULL;
+}
+
+static void run_round(unsigned int nthds) {
+    kthread_attr_t attr = {
+        .stack_size = WAITER_STACK,
+        .label = "waiter"
+    };
+    uint64_t start, elapsed, spins = 0;
+    unsigned int i, created;
+
+    done = false;
+    total_late_us = 0;
+    total_waits = 0;
+
+    for(created = 0; created < nthds; ++created) {
+        waiters[created] = thd_create_ex(&attr, waiter_thd,
+                                         (void *)(created + 1));
+
+        if(!waiters[created]) {
+            printf("Could only create %u threads\n", created);
+            break;
+        }
+    }
+
+    /* Soak up whatever CPU time is left for the main thread. */
+    start = timer_ms_gettime64();
+
+    while((elapsed = timer_ms_gettime64() - start) < ROUND_MS) {
+        ++spins;
+        thd_pass();
+    }
+
+    done = true;
+
+    for(i = 0; i < created; ++i)
+        thd_join(waiters[i], NULL);
+
+    printf("%5u waiters: %7u waits/s, avg lateness %5llu us, "
+           "main thread %7llu passes/s\n", created,
+           (unsigned int)(total_waits * 1000ULL / elapsed),
+           total_waits ? total_late_us / total_waits : 0ULL,
+           spins * 1000 / elapsed);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int i;
+
+    (void)argc;
+    (void)argv;
+
+    cont_btn_callback(0, CONT_START | CONT_A | CONT_B | CONT_X | CONT_Y,
+                      (cont_btn_callback_t)arch_exit);
+
+    printf("KallistiOS timed wait benchmark\n\n");
+
+    for(i = 64; i <= MAX_WAITERS; i *= 2)
+        run_round(i);
+
+    printf("\n===== TIMED WAIT BENCHMARK DONE =====\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/* KallistiOS ##version##
+
+   tls_bench.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program measures the cost of looking up thread-specific data and
+   threads by ID as the number of keys and threads grows. With per-thread slot
+   arrays and a hashed thread ID lookup, all of the numbers printed should stay
+   flat no matter how many keys or threads exist. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <kos/thread.h>
+#include <kos/tls.h>
+#include <kos/sem.h>
+
+#include <arch/arch.h>
+#include <arch/timer.h>
+
+#define MAX_KEYS        256
+#define MAX_THREADS     256
+#define ITERATIONS      100000
+
+static kthread_key_t keys[MAX_KEYS];
+static kthread_t *thds[MAX_THREADS];
+static semaphore_t park_sem = SEM_INITIALIZER(0);
+
+static void *park_thd(void *param) {
+    (void)param;
+
+    /* Just sit on the semaphore until the end of the test. */
+    sem_wait(&park_sem);
+    return NULL;
+}
+
+static void bench_keys(unsigned int nkeys) {
+    uint64_t start, set_ns, get_ns;
+    volatile uintptr_t sum = 0;
+    unsigned int i;
+
+    /* Always hit the most recently created key, which was the worst case for
+       the old list-based storage. */
+    kthread_key_t key = keys[nkeys - 1];
+
+    start = timer_ns_gettime64();
+
+    for(i = 0; i < ITERATIONS; ++i)
+        kthread_setspecific(key, (void *)(uintptr_t)(i + 1));
+
+    set_ns = timer_ns_gettime64() - start;
+
+    start = timer_ns_gettime64();
+
+    for(i = 0; i < ITERATIONS; ++i)
+        sum += (uintptr_t)kthread_getspecific(key);
+
+    get_ns = timer_ns_gettime64() - start;
+
+    printf("%3u keys:    set %4llu ns, get %4llu ns\n", nkeys,
+           set_ns / ITERATIONS, get_ns / ITERATIONS);
+}
+
+static void bench_tids(unsigned int nthds) {
+    uint64_t start, elapsed;
+    unsigned int i;
+    tid_t tid = thds[nthds - 1]->tid;
+
+    start = timer_ns_gettime64();
+
+    for(i = 0; i < ITERATIONS; ++i) {
+        if(thd_by_tid(tid) != thds[nthds - 1]) {
+            printf("thd_by_tid returned the wrong thread!\n");
+            return;
+        }
+    }
+
+    elapsed = timer_ns_gettime64() - start;
+
+    printf("%3u threads: thd_by_tid %4llu ns\n", nthds, elapsed / ITERATIONS);
+}
+
+int main(int argc, char **argv) {
+    unsigned int i, n;
+
+    (void)argc;
+    (void)argv;
+
+    printf("TLS benchmark starting\n");
+
+    n = 1;
+
+    for(i = 0; i < MAX_KEYS; ++i) {
+        if(kthread_key_create(&keys[i], NULL)) {
+            printf("Failed to create key %u\n", i);
+            return EXIT_FAILURE;
+        }
+
+        /* Give every key a value, so the thread has lots of them stored. */
+        kthread_setspecific(keys[i], (void *)(uintptr_t)i);
+
+        if(i + 1 == n) {
+            bench_keys(n);
+            n <<= 2;
+        }
+    }
+
+    n = 1;
+
+    for(i = 0; i < MAX_THREADS; ++i) {
+        if(!(thds[i] = thd_create(false, park_thd, NULL))) {
+            printf("Failed to create thread %u\n", i);
+            return EXIT_FAILURE;
+        }
+
+        if(i + 1 == n) {
+            bench_tids(n);
+            n <<= 2;
+        }
+    }
+
+    for(i = 0; i < MAX_THREADS; ++i)
+        sem_signal(&park_sem);
+
+    for(i = 0; i < MAX_THREADS; ++i)
+        thd_join(thds[i], NULL);
+
+    for(i = 0; i < MAX_KEYS; ++i)
+        kthread_key_delete(keys[i]);
+
+    printf("TLS benchmark finished\n");
+    return EXIT_SUCCESS;
+}
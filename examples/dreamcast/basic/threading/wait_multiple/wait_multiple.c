@@ -0,0 +1,179 @@
+/* KallistiOS ##version##
+
+   wait_multiple.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program shows how one thread can serve several event sources with
+   thd_wait_multiple(), instead of polling them or using one thread each.
+
+   An "input" thread signals a semaphore at a fast rate, an "audio" thread
+   signals a condition variable at a slower one, and a worker thread stands in
+   for a loader that gets restarted every time it's done. The main thread
+   waits on all three at once, and at the end checks that it didn't miss a
+   single event. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <kos/thread.h>
+#include <kos/sem.h>
+#include <kos/cond.h>
+#include <kos/mutex.h>
+#include <kos/worker_thread.h>
+#include <kos/wait_multiple.h>
+
+#include <arch/arch.h>
+#include <arch/timer.h>
+#include <dc/maple.h>
+#include <dc/maple/controller.h>
+
+#define TEST_MS         3000
+#define INPUT_MS        7
+#define AUDIO_MS        23
+#define LOADER_MS       40
+
+static semaphore_t input_sem = SEM_INITIALIZER(0);
+static condvar_t audio_cv = COND_INITIALIZER;
+static mutex_t audio_mutex = MUTEX_INITIALIZER;
+static volatile int running = 1;
+
+static int input_sent, audio_sent, audio_pending, loader_runs;
+
+static void *input_thread(void *data) {
+    (void)data;
+
+    while(running) {
+        thd_sleep(INPUT_MS);
+        input_sent++;
+        sem_signal(&input_sem);
+    }
+
+    return NULL;
+}
+
+static void *audio_thread(void *data) {
+    (void)data;
+
+    while(running) {
+        thd_sleep(AUDIO_MS);
+
+        mutex_lock(&audio_mutex);
+        audio_sent++;
+        audio_pending++;
+        cond_signal(&audio_cv);
+        mutex_unlock(&audio_mutex);
+    }
+
+    return NULL;
+}
+
+static void loader(void *data) {
+    (void)data;
+
+    thd_sleep(LOADER_MS);
+    loader_runs++;
+}
+
+int main(int argc, char *argv[]) {
+    kthread_worker_t *worker;
+    kthread_t *input, *audio;
+    int input_got = 0, audio_got = 0, loader_got = 0, wakeups = 0;
+    uint64_t end;
+    int rv;
+
+    (void)argc;
+    (void)argv;
+
+    cont_btn_callback(0, CONT_START | CONT_A | CONT_B | CONT_X | CONT_Y,
+                      (cont_btn_callback_t)arch_exit);
+
+    printf("KallistiOS wait multiple example\n\n");
+
+    worker = thd_worker_create(loader, NULL);
+    input = thd_create(0, input_thread, NULL);
+    audio = thd_create(0, audio_thread, NULL);
+
+    if(!worker || !input || !audio) {
+        printf("Could not create threads\n");
+        return EXIT_FAILURE;
+    }
+
+    thd_worker_wakeup(worker);
+
+    thd_wait_t objs[] = {
+        THD_WAIT_SEM_INIT(&input_sem),
+        THD_WAIT_COND_INIT(&audio_cv, &audio_mutex),
+        THD_WAIT_WORKER_INIT(worker),
+    };
+
+    end = timer_ms_gettime64() + TEST_MS;
+    mutex_lock(&audio_mutex);
+
+    while(timer_ms_gettime64() < end) {
+        /* Pending audio events are checked with the mutex held, so a signal
+           can't slip in between the check and the wait. */
+        if(audio_pending) {
+            audio_got += audio_pending;
+            audio_pending = 0;
+        }
+
+        rv = thd_wait_multiple(objs, sizeof(objs) / sizeof(objs[0]), 100);
+        wakeups++;
+
+        switch(rv) {
+            case 0:
+                input_got++;
+                break;
+
+            case 1:
+                /* Counted at the top of the loop. */
+                break;
+
+            case 2:
+                loader_got++;
+                thd_worker_wakeup(worker);
+                break;
+
+            default:
+                if(errno != ETIMEDOUT) {
+                    printf("thd_wait_multiple failed: %d\n", errno);
+                    running = 0;
+                }
+
+                break;
+        }
+    }
+
+    running = 0;
+    audio_got += audio_pending;
+    mutex_unlock(&audio_mutex);
+
+    thd_join(input, NULL);
+    thd_join(audio, NULL);
+    thd_worker_destroy(worker);
+
+    /* Signals sent after the loop ended are still pending. */
+    while(!sem_trywait(&input_sem))
+        input_got++;
+
+    printf("source    sent  received\n");
+    printf("input   %6d  %8d\n", input_sent, input_got);
+    printf("audio   %6d  %8d\n", audio_sent, audio_got);
+    printf("loader  %6d  %8d\n", loader_runs, loader_got);
+    printf("\n%d wakeups for %d events\n", wakeups,
+           input_got + audio_got + loader_got);
+
+    if(input_got != input_sent || audio_got != audio_sent ||
+       loader_got < loader_runs - 1) {
+        printf("\n===== WAIT MULTIPLE TEST FAILED =====\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("\n===== WAIT MULTIPLE TEST DONE =====\n");
+
+    return EXIT_SUCCESS;
+}
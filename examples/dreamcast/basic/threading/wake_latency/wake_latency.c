@@ -0,0 +1,180 @@
+/* KallistiOS ##version##
+
+   wake_latency.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program measures how long it takes to hand control from one thread to
+   another through a sleep/wake pair, depending on how many unrelated threads
+   are sleeping "nearby".
+
+   Threads sleeping with genwait_wait() on arbitrary objects are kept in a
+   table of sleep queues hashed by the address of the object, so objects that
+   are close together in memory share a queue, and waking up the sleepers of
+   one of them means walking past the sleepers of all the others. The kernel's
+   sync primitives (semaphores, mutexes, condvars and rwsems) each carry their
+   own wait queue instead, so they are unaffected by this.
+
+   For each round, a growing number of "bystander" threads are put to sleep on
+   objects that live right next to the ones used for the test, then two
+   threads ping-pong, first through genwait_wait()/genwait_wake_one() on those
+   neighboring objects, then through a pair of semaphores. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <kos/thread.h>
+#include <kos/genwait.h>
+#include <kos/sem.h>
+
+#include <arch/arch.h>
+#include <arch/timer.h>
+#include <dc/maple.h>
+#include <dc/maple/controller.h>
+
+#define MAX_BYSTANDERS  512
+#define ITERATIONS      10000
+
+/* All of these are close enough together to share a hashed sleep queue. */
+static struct {
+    uint8_t ping;
+    uint8_t pong;
+    uint8_t bystander;
+    semaphore_t sem_ping;
+    semaphore_t sem_pong;
+} objs;
+
+static volatile int pp_turn;
+
+static void *bystander_thd(void *param) {
+    (void)param;
+
+    genwait_wait(&objs.bystander, "bystander", 0, NULL);
+    return NULL;
+}
+
+/* Ping-pong through the hashed sleep queues. The turn variable guards against
+   lost wakeups, since there's no count attached to a raw genwait object. */
+static void *genwait_pong_thd(void *param) {
+    int i;
+
+    (void)param;
+
+    for(i = 0; i < ITERATIONS; ++i) {
+        irq_disable_scoped();
+
+        while(pp_turn != 1)
+            genwait_wait(&objs.pong, "pong", 0, NULL);
+
+        pp_turn = 0;
+        genwait_wake_one(&objs.ping);
+    }
+
+    return NULL;
+}
+
+static uint64_t genwait_round(void) {
+    kthread_t *thd;
+    uint64_t start;
+    int i;
+
+    pp_turn = 0;
+    thd = thd_create(false, genwait_pong_thd, NULL);
+    start = timer_ns_gettime64();
+
+    for(i = 0; i < ITERATIONS; ++i) {
+        irq_disable_scoped();
+
+        pp_turn = 1;
+        genwait_wake_one(&objs.pong);
+
+        while(pp_turn != 0)
+            genwait_wait(&objs.ping, "ping", 0, NULL);
+    }
+
+    start = timer_ns_gettime64() - start;
+    thd_join(thd, NULL);
+
+    return start / ITERATIONS;
+}
+
+static void *sem_pong_thd(void *param) {
+    int i;
+
+    (void)param;
+
+    for(i = 0; i < ITERATIONS; ++i) {
+        sem_wait(&objs.sem_pong);
+        sem_signal(&objs.sem_ping);
+    }
+
+    return NULL;
+}
+
+static uint64_t sem_round(void) {
+    kthread_t *thd;
+    uint64_t start;
+    int i;
+
+    thd = thd_create(false, sem_pong_thd, NULL);
+    start = timer_ns_gettime64();
+
+    for(i = 0; i < ITERATIONS; ++i) {
+        sem_signal(&objs.sem_pong);
+        sem_wait(&objs.sem_ping);
+    }
+
+    start = timer_ns_gettime64() - start;
+    thd_join(thd, NULL);
+
+    return start / ITERATIONS;
+}
+
+int main(int argc, char *argv[]) {
+    static kthread_t *bystanders[MAX_BYSTANDERS];
+    kthread_attr_t attr = { .stack_size = 1024, .label = "bystander" };
+    unsigned int i, count = 0, target;
+
+    (void)argc;
+    (void)argv;
+
+    cont_btn_callback(0, CONT_START | CONT_A | CONT_B | CONT_X | CONT_Y,
+                      (cont_btn_callback_t)arch_exit);
+
+    sem_init(&objs.sem_ping, 0);
+    sem_init(&objs.sem_pong, 0);
+
+    printf("KallistiOS wake latency benchmark\n\n");
+    printf("bystanders  genwait round trip  semaphore round trip\n");
+
+    for(target = 0; target <= MAX_BYSTANDERS; target = target ? target * 2 : 8) {
+        for(; count < target; ++count) {
+            bystanders[count] = thd_create_ex(&attr, bystander_thd, NULL);
+
+            if(!bystanders[count]) {
+                printf("Could not create bystander thread\n");
+                break;
+            }
+        }
+
+        /* Let them all get to sleep */
+        thd_sleep(10);
+
+        printf("%10u  %15llu ns  %17llu ns\n", count,
+               genwait_round(), sem_round());
+    }
+
+    genwait_wake_all(&objs.bystander);
+
+    for(i = 0; i < count; ++i)
+        thd_join(bystanders[i], NULL);
+
+    sem_destroy(&objs.sem_ping);
+    sem_destroy(&objs.sem_pong);
+
+    printf("\n===== WAKE LATENCY BENCHMARK DONE =====\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+/* KallistiOS ##version##
+
+   atomic_ops.cpp
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* The benchmarked loops. This file is built once for each atomic model, with
+   ATOMIC_MODEL set to the suffix of the functions to define (see the
+   Makefile).
+
+   The loops are flattened, so that every atomic operation they use, including
+   the ones inside std::shared_ptr's inline members, is compiled into them
+   with this file's model. Otherwise the linker would keep a single copy of
+   those members for both builds. */
+
+#include "atomic_ops.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <arch/timer.h>
+
+#define CONCAT_(a, b)   a##b
+#define CONCAT(a, b)    CONCAT_(a, b)
+#define BENCH_FN        CONCAT(atomic_bench_, ATOMIC_MODEL)
+#define CHECK_FN        CONCAT(atomic_check_, ATOMIC_MODEL)
+
+static std::atomic<uint32_t> counter;
+static std::atomic<uint32_t> cas_counter;
+static std::shared_ptr<int> shared;
+
+__attribute__((flatten))
+static void fetch_add_loop(unsigned iters) {
+    for(unsigned i = 0; i < iters; ++i)
+        counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+__attribute__((flatten))
+static void cas_loop(unsigned iters) {
+    for(unsigned i = 0; i < iters; ++i) {
+        uint32_t val = cas_counter.load(std::memory_order_relaxed);
+
+        while(!cas_counter.compare_exchange_weak(val, val + 1))
+            ;
+    }
+}
+
+__attribute__((flatten))
+static void shared_ptr_loop(unsigned iters) {
+    for(unsigned i = 0; i < iters; ++i) {
+        std::shared_ptr<int> copy(shared);
+
+        /* Keep the copy from being optimized away. */
+        __asm__ __volatile__("" : : "r"(copy.get()));
+    }
+}
+
+template<typename F>
+static uint64_t timed(F fn, unsigned iters) {
+    uint64_t start = timer_ns_gettime64();
+
+    fn(iters);
+
+    return timer_ns_gettime64() - start;
+}
+
+void BENCH_FN(atomic_results &res, unsigned iters) {
+    shared = std::make_shared<int>(42);
+
+    res.fetch_add = timed(fetch_add_loop, iters);
+    res.cas = timed(cas_loop, iters);
+    res.shared_ptr_copy = timed(shared_ptr_loop, iters);
+
+    shared.reset();
+}
+
+bool CHECK_FN(unsigned iters) {
+    auto worker = [iters] {
+        fetch_add_loop(iters);
+        cas_loop(iters);
+    };
+
+    counter = 0;
+    cas_counter = 0;
+
+    std::thread a(worker), b(worker);
+    a.join();
+    b.join();
+
+    return counter == 2 * iters && cas_counter == 2 * iters;
+}
@@ -0,0 +1,30 @@
+/* KallistiOS ##version##
+
+   atomic_ops.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+#ifndef ATOMIC_OPS_H
+#define ATOMIC_OPS_H
+
+#include <cstdint>
+
+/* Time taken by each benchmark, in nanoseconds for the whole run. */
+struct atomic_results {
+    uint64_t fetch_add;
+    uint64_t cas;
+    uint64_t shared_ptr_copy;
+};
+
+/* atomic_ops.cpp is built once per atomic model, each copy providing one of
+   these pairs of functions. The check functions hammer shared counters from
+   two threads, so that operations get interrupted halfway through, and
+   return whether no update was lost. */
+void atomic_bench_imask(atomic_results &res, unsigned iters);
+bool atomic_check_imask(unsigned iters);
+
+void atomic_bench_gusa(atomic_results &res, unsigned iters);
+bool atomic_check_gusa(unsigned iters);
+
+#endif /* ATOMIC_OPS_H */
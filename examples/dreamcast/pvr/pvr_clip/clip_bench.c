@@ -0,0 +1,252 @@
+/* KallistiOS ##version##
+
+   clip_bench.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program measures the throughput of the near plane clipper. Each
+   frame, a set of random strips, with about a third of their vertices
+   behind the near plane, is drawn with pvr_clip_txr() and with
+   pvr_clip_gouraud(), and a set of boxes cut by the plane is sent as
+   modifier volumes with pvr_clip_mod(). The same strips, entirely in
+   front of the plane, are also sent as they are through Direct Rendering,
+   to give an idea of the cost of clipping over plain submission.
+
+   The correctness of the clipper is checked on the host by clip_test.c
+   (make host). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <string.h>
+
+#include <arch/timer.h>
+#include <dc/pvr.h>
+
+#define STRIP_VERTS     6000
+#define BOXES           64
+#define FRAMES          120
+
+#define NEAR_W          1.0f
+
+enum { TEST_PLAIN, TEST_TXR, TEST_GOURAUD, TEST_MOD, TESTS };
+
+static const char *const test_names[TESTS] = {
+    "unclipped", "textured", "Gouraud", "modifier"
+};
+
+static pvr_init_params_t pvr_params = {
+    { PVR_BINSIZE_16, PVR_BINSIZE_16, PVR_BINSIZE_0, PVR_BINSIZE_0, PVR_BINSIZE_0 },
+    1024 * 1024, 0, 0, 0, 0, 0
+};
+
+static alignas(32) pvr_vertex_t strips[STRIP_VERTS];
+static alignas(32) pvr_vertex_t plain[STRIP_VERTS];
+static alignas(32) pvr_modifier_vol_t boxes[BOXES][12];
+
+static pvr_poly_hdr_t txr_hdr, col_hdr;
+static pvr_mod_hdr_t mod_hdr;
+
+static uint64_t times[TESTS];
+static size_t in_count[TESTS], out_count[TESTS];
+
+static float frand(float lo, float hi) {
+    return lo + (hi - lo) * (rand() & 0xffff) / 65535.0f;
+}
+
+/* Random strips over the screen, in homogeneous form. */
+static void setup_strips(void) {
+    size_t n = 0, len, i;
+    float w, sx = 0.0f, sy = 0.0f;
+
+    while(n + 16 <= STRIP_VERTS) {
+        len = 4 + rand() % 13;
+        sx = frand(40.0f, 600.0f);
+        sy = frand(40.0f, 440.0f);
+
+        for(i = 0; i < len; i++, n++) {
+            w = frand(-1.5f, 6.0f);
+            sx += frand(-30.0f, 30.0f);
+            sy += frand(-30.0f, 30.0f);
+
+            strips[n].flags = i == len - 1 ? PVR_CMD_VERTEX_EOL : PVR_CMD_VERTEX;
+            strips[n].x = sx * w;
+            strips[n].y = sy * w;
+            strips[n].z = w;
+            strips[n].u = frand(0.0f, 1.0f);
+            strips[n].v = frand(0.0f, 1.0f);
+            strips[n].argb = 0xff000000 | rand();
+            strips[n].oargb = 0;
+
+            /* The same vertex in front of the plane, divided. */
+            plain[n] = strips[n];
+            plain[n].x = sx;
+            plain[n].y = sy;
+            plain[n].z = 1.0f / (w < NEAR_W ? NEAR_W : w);
+        }
+    }
+
+    in_count[TEST_PLAIN] = in_count[TEST_TXR] = in_count[TEST_GOURAUD] = n;
+}
+
+/* Boxes in (x, y, w), all crossing the near plane. */
+static void setup_boxes(void) {
+    static const int faces[6][4] = {
+        { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 },
+        { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 }
+    };
+    static const int split[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+    float lo[3], hi[3], c[8][3], *p;
+    int b, i, f, h, k;
+
+    for(b = 0; b < BOXES; b++) {
+        lo[0] = frand(0.0f, 500.0f);
+        lo[1] = frand(0.0f, 400.0f);
+        lo[2] = frand(-2.0f, NEAR_W);
+        hi[0] = lo[0] + frand(40.0f, 200.0f);
+        hi[1] = lo[1] + frand(40.0f, 200.0f);
+        hi[2] = frand(NEAR_W + 0.5f, 6.0f);
+
+        for(i = 0; i < 8; i++) {
+            c[i][0] = i & 1 ? hi[0] : lo[0];
+            c[i][1] = i & 2 ? hi[1] : lo[1];
+            c[i][2] = i & 4 ? hi[2] : lo[2];
+
+            /* Screen coordinates scale with w. */
+            c[i][0] *= c[i][2];
+            c[i][1] *= c[i][2];
+        }
+
+        for(f = 0; f < 6; f++) {
+            for(h = 0; h < 2; h++) {
+                boxes[b][f * 2 + h].flags = PVR_CMD_VERTEX_EOL;
+                p = &boxes[b][f * 2 + h].ax;
+
+                for(k = 0; k < 3; k++)
+                    memcpy(p + k * 3, c[faces[f][split[h][k]]], sizeof(c[0]));
+            }
+        }
+    }
+
+    in_count[TEST_MOD] = BOXES * 12;
+}
+
+static void send_plain(pvr_dr_state_t *dr) {
+    pvr_vertex_t *v;
+    size_t i;
+
+    for(i = 0; i < in_count[TEST_PLAIN]; i++) {
+        v = pvr_dr_target(*dr);
+        *v = plain[i];
+        pvr_dr_commit(v);
+    }
+}
+
+static void do_frame(void) {
+    pvr_dr_state_t dr;
+    uint64_t start;
+    size_t out = 0;
+    int b;
+
+    pvr_wait_ready();
+    pvr_scene_begin();
+
+    pvr_list_begin(PVR_LIST_OP_POLY);
+    pvr_dr_init(&dr);
+
+    pvr_prim(&col_hdr, sizeof(col_hdr));
+    start = timer_ns_gettime64();
+    send_plain(&dr);
+    times[TEST_PLAIN] += timer_ns_gettime64() - start;
+    out_count[TEST_PLAIN] += in_count[TEST_PLAIN];
+
+    pvr_prim(&txr_hdr, sizeof(txr_hdr));
+    start = timer_ns_gettime64();
+    out_count[TEST_TXR] += pvr_clip_txr(&dr, strips, in_count[TEST_TXR],
+                                        NEAR_W);
+    times[TEST_TXR] += timer_ns_gettime64() - start;
+
+    pvr_prim(&col_hdr, sizeof(col_hdr));
+    start = timer_ns_gettime64();
+    out_count[TEST_GOURAUD] += pvr_clip_gouraud(&dr, strips,
+                                                in_count[TEST_GOURAUD], NEAR_W);
+    times[TEST_GOURAUD] += timer_ns_gettime64() - start;
+
+    pvr_list_finish();
+
+    pvr_list_begin(PVR_LIST_OP_MOD);
+    pvr_dr_init(&dr);
+
+    start = timer_ns_gettime64();
+
+    for(b = 0; b < BOXES; b++)
+        out += pvr_clip_mod(&dr, &mod_hdr, boxes[b], 12, NEAR_W);
+
+    times[TEST_MOD] += timer_ns_gettime64() - start;
+    out_count[TEST_MOD] += out;
+
+    pvr_list_finish();
+    pvr_scene_finish();
+}
+
+int main(int argc, char **argv) {
+    pvr_poly_cxt_t cxt;
+    pvr_ptr_t txr;
+    uint16_t *pixels;
+    int i;
+
+    (void)argc;
+    (void)argv;
+
+    printf("KallistiOS near plane clipper benchmark\n\n");
+
+    pvr_init(&pvr_params);
+    pvr_set_bg_color(0.0f, 0.0f, 0.2f);
+
+    /* A small checkerboard texture. */
+    txr = pvr_mem_malloc(8 * 8 * 2);
+    pixels = malloc(8 * 8 * 2);
+
+    for(i = 0; i < 8 * 8; i++)
+        pixels[i] = ((i ^ (i >> 3)) & 1) ? 0xffff : 0x001f;
+
+    pvr_txr_load(pixels, txr, 8 * 8 * 2);
+    free(pixels);
+
+    pvr_poly_cxt_txr(&cxt, PVR_LIST_OP_POLY,
+                     PVR_TXRFMT_RGB565 | PVR_TXRFMT_NONTWIDDLED, 8, 8, txr,
+                     PVR_FILTER_NONE);
+    pvr_poly_compile(&txr_hdr, &cxt);
+
+    pvr_poly_cxt_col(&cxt, PVR_LIST_OP_POLY);
+    pvr_poly_compile(&col_hdr, &cxt);
+
+    pvr_mod_compile(&mod_hdr, PVR_LIST_OP_MOD, PVR_MODIFIER_INCLUDE_LAST_POLY,
+                    PVR_CULLING_NONE);
+
+    srand(1234);
+    setup_strips();
+    setup_boxes();
+
+    for(i = 0; i < FRAMES; i++)
+        do_frame();
+
+    printf("  %-10s  %10s  %10s  %8s  %9s\n", "path", "in/frame",
+           "out/frame", "us/frame", "Min/s");
+
+    for(i = 0; i < TESTS; i++) {
+        printf("  %-10s  %10u  %10u  %8.1f  %9.2f\n", test_names[i],
+               (unsigned int)in_count[i],
+               (unsigned int)(out_count[i] / FRAMES),
+               times[i] / 1000.0 / FRAMES,
+               (double)in_count[i] * FRAMES * 1000.0 / times[i]);
+    }
+
+    printf("\n(vertices for strips, triangles for modifier volumes)\n");
+
+    pvr_mem_free(txr);
+
+    return 0;
+}
@@ -0,0 +1,499 @@
+/* KallistiOS ##version##
+
+   clip_test.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* Host test of the near plane clipper in kernel/arch/dreamcast/hardware/pvr/
+   pvr_clip.c. It is built with the host's compiler (make host), with the
+   store queues replaced by a buffer, and checks the clipper against a plain
+   reference on random input:
+
+   - strips: the output must be well-formed strips, cover the screen exactly
+     like the reference (clipping each triangle in double precision and
+     splitting the result in a fan), with the same winding, and every vertex
+     must match one of the reference's, attributes included. Strips entirely
+     in front of the plane must come out unchanged;
+   - modifier volumes: boxes cut by the plane must come out with the right
+     headers, and a point in front of the plane must be crossed by an odd
+     number of the output triangles between it and the eye exactly when it
+     is inside the box. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Stand-ins for what dc/pvr.h provides, with Direct Rendering writing to
+   a buffer of 32-byte blocks. */
+#define PVR_CLIP_HOST           1
+
+#define PVR_CMD_VERTEX          0xe0000000
+#define PVR_CMD_VERTEX_EOL      0xf0000000
+#define PVR_TA_PM1_MODIFIERINST (3u << 29)
+
+typedef uint32_t pvr_dr_state_t;
+
+typedef struct pvr_vertex {
+    uint32_t flags;
+    float x, y, z, u, v;
+    uint32_t argb, oargb;
+} pvr_vertex_t;
+
+typedef struct pvr_modifier_vol {
+    uint32_t flags;
+    float ax, ay, az, bx, by, bz, cx, cy, cz;
+    uint32_t d1, d2, d3, d4, d5, d6;
+} pvr_modifier_vol_t;
+
+typedef struct pvr_mod_hdr {
+    uint32_t cmd, mode1, mode2, mode3, d[4];
+} pvr_mod_hdr_t;
+
+#define MAX_BLOCKS      16384
+
+static uint32_t blocks[MAX_BLOCKS][8];
+static size_t nblocks;
+
+static void *dr_next(void) {
+    if(nblocks == MAX_BLOCKS) {
+        fprintf(stderr, "output buffer overflow\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(blocks[nblocks], 0, sizeof(blocks[0]));
+    return blocks[nblocks++];
+}
+
+#define pvr_dr_target(s)    ((void)(s), (pvr_vertex_t *)dr_next())
+#define pvr_dr_commit(a)    ((void)(a))
+#define clip_rcp(w)         (1.0f / (w))
+
+#include "pvr_clip.h"
+#include "pvr_clip.c"
+
+#define NEAR            0.5f
+#define SAMPLES         4000
+#define MAX_TRIS        8192
+
+typedef struct tri {
+    double x[3], y[3], z[3];
+} tri_t;
+
+static tri_t out_tris[MAX_TRIS], ref_tris[MAX_TRIS];
+static size_t n_out, n_ref;
+
+static pvr_vertex_t ref_verts[MAX_TRIS * 3];
+static size_t n_ref_verts;
+
+static unsigned int errors;
+
+static void fail(const char *test, const char *what) {
+    printf("  ERROR: %s: %s\n", test, what);
+    errors++;
+}
+
+static double frand(double lo, double hi) {
+    return lo + (hi - lo) * rand() / (double)RAND_MAX;
+}
+
+static void add_tri(tri_t *tris, size_t *n, const double *x, const double *y,
+                    const double *z) {
+    if(*n == MAX_TRIS) {
+        fprintf(stderr, "too many triangles\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(tris[*n].x, x, sizeof(tris[0].x));
+    memcpy(tris[*n].y, y, sizeof(tris[0].y));
+    memcpy(tris[*n].z, z, sizeof(tris[0].z));
+    (*n)++;
+}
+
+static double area2(const tri_t *t) {
+    return (t->x[1] - t->x[0]) * (t->y[2] - t->y[0]) -
+           (t->x[2] - t->x[0]) * (t->y[1] - t->y[0]);
+}
+
+/* Whether the point is in the triangle, and the depth there. */
+static bool tri_hit(const tri_t *t, double px, double py, double *z) {
+    double a = area2(t), b0, b1, b2;
+
+    if(fabs(a) < 1e-12)
+        return false;
+
+    b0 = ((t->x[1] - px) * (t->y[2] - py) -
+          (t->x[2] - px) * (t->y[1] - py)) / a;
+    b1 = ((t->x[2] - px) * (t->y[0] - py) -
+          (t->x[0] - px) * (t->y[2] - py)) / a;
+    b2 = 1.0 - b0 - b1;
+
+    if(b0 < 0 || b1 < 0 || b2 < 0)
+        return false;
+
+    *z = b0 * t->z[0] + b1 * t->z[1] + b2 * t->z[2];
+    return true;
+}
+
+/* Coverage of a point, counting triangles wound the other way negatively. */
+static int coverage(const tri_t *tris, size_t n, double px, double py) {
+    size_t i;
+    double z;
+    int c = 0;
+
+    for(i = 0; i < n; i++) {
+        if(tri_hit(&tris[i], px, py, &z))
+            c += area2(&tris[i]) > 0 ? 1 : -1;
+    }
+
+    return c;
+}
+
+/* Reference: clip one triangle in double precision, and split the result
+   in a fan, keeping the new vertices for the attribute check. */
+static void ref_clip(const pvr_vertex_t *tri[3], bool txr) {
+    double px[4], py[4], pz[4], x[3], y[3], z[3], t, w;
+    const pvr_vertex_t *a, *b, *in, *out;
+    pvr_vertex_t *v;
+    int i, n = 0;
+
+    for(i = 0; i < 3; i++) {
+        a = tri[i];
+        b = tri[(i + 1) % 3];
+
+        if(a->z >= NEAR) {
+            v = &ref_verts[n_ref_verts++];
+            *v = *a;
+            v->x = a->x / a->z;
+            v->y = a->y / a->z;
+            v->z = 1.0f / a->z;
+            px[n] = v->x;
+            py[n] = v->y;
+            pz[n++] = v->z;
+        }
+
+        if((a->z >= NEAR) != (b->z >= NEAR)) {
+            in = a->z >= NEAR ? a : b;
+            out = a->z >= NEAR ? b : a;
+            t = ((double)in->z - NEAR) / ((double)in->z - out->z);
+            w = NEAR;
+
+            v = &ref_verts[n_ref_verts++];
+            v->x = (in->x + t * (out->x - in->x)) / w;
+            v->y = (in->y + t * (out->y - in->y)) / w;
+            v->z = 1.0 / w;
+            v->u = in->u + t * (out->u - in->u);
+            v->v = in->v + t * (out->v - in->v);
+            v->argb = in->argb;
+            v->oargb = in->oargb;
+
+            /* The colors are compared with a tolerance; blend roughly. */
+            for(int s = 0; s < 32; s += 8) {
+                double ci = (in->argb >> s) & 0xff, co = (out->argb >> s) & 0xff;
+                double oi = (in->oargb >> s) & 0xff, oo = (out->oargb >> s) & 0xff;
+
+                v->argb = (v->argb & ~(0xffu << s)) |
+                          (uint32_t)(ci + t * (co - ci) + 0.5) << s;
+                v->oargb = (v->oargb & ~(0xffu << s)) |
+                           (uint32_t)(oi + t * (oo - oi) + 0.5) << s;
+            }
+
+            if(!txr)
+                v->u = v->v = 0.0f, v->oargb = 0;
+
+            px[n] = v->x;
+            py[n] = v->y;
+            pz[n++] = v->z;
+        }
+    }
+
+    for(i = 1; i + 1 < n; i++) {
+        x[0] = px[0], x[1] = px[i], x[2] = px[i + 1];
+        y[0] = py[0], y[1] = py[i], y[2] = py[i + 1];
+        z[0] = pz[0], z[1] = pz[i], z[2] = pz[i + 1];
+        add_tri(ref_tris, &n_ref, x, y, z);
+    }
+}
+
+static bool close_to(double a, double b, double tol) {
+    return fabs(a - b) <= tol * (1.0 + fabs(b));
+}
+
+static bool color_close(uint32_t a, uint32_t b) {
+    int s;
+
+    for(s = 0; s < 32; s += 8) {
+        if(abs((int)((a >> s) & 0xff) - (int)((b >> s) & 0xff)) > 2)
+            return false;
+    }
+
+    return true;
+}
+
+static bool vert_known(const pvr_vertex_t *v, bool txr) {
+    const pvr_vertex_t *r;
+    size_t i;
+
+    for(i = 0; i < n_ref_verts; i++) {
+        r = &ref_verts[i];
+
+        if(close_to(v->x, r->x, 1e-4) && close_to(v->y, r->y, 1e-4) &&
+           close_to(v->z, r->z, 1e-4) && color_close(v->argb, r->argb) &&
+           (!txr || (close_to(v->u, r->u, 1e-4) && close_to(v->v, r->v, 1e-4) &&
+                     color_close(v->oargb, r->oargb))))
+            return true;
+    }
+
+    return false;
+}
+
+/* Turn the output back into triangles, checking it on the way. */
+static void decode_strips(const char *test, size_t sent, bool txr) {
+    const pvr_vertex_t *s = (const pvr_vertex_t *)blocks;
+    double x[3], y[3], z[3];
+    size_t i, start = 0, j;
+    bool bad_vert = false;
+
+    if(sent != nblocks)
+        fail(test, "returned count differs from what was sent");
+
+    for(i = 0; i < nblocks; i++) {
+        if(s[i].flags != PVR_CMD_VERTEX && s[i].flags != PVR_CMD_VERTEX_EOL) {
+            fail(test, "bad vertex flags");
+            return;
+        }
+
+        if(!bad_vert && !vert_known(&s[i], txr)) {
+            fail(test, "a vertex doesn't match the reference");
+            bad_vert = true;
+        }
+
+        if(s[i].flags != PVR_CMD_VERTEX_EOL)
+            continue;
+
+        if(i - start < 2)
+            fail(test, "strip of less than three vertices");
+
+        for(j = start; j + 2 <= i; j++) {
+            size_t a = (j - start) & 1 ? j + 1 : j, b = (j - start) & 1 ? j : j + 1;
+
+            x[0] = s[a].x, x[1] = s[b].x, x[2] = s[j + 2].x;
+            y[0] = s[a].y, y[1] = s[b].y, y[2] = s[j + 2].y;
+            z[0] = s[a].z, z[1] = s[b].z, z[2] = s[j + 2].z;
+            add_tri(out_tris, &n_out, x, y, z);
+        }
+
+        start = i + 1;
+    }
+
+    if(start != nblocks)
+        fail(test, "last strip not terminated");
+}
+
+static void gen_strips(pvr_vertex_t *v, size_t *count, size_t max,
+                       double wlo, double whi) {
+    size_t n = 0, len, i;
+
+    while(n + 12 <= max) {
+        len = 3 + rand() % 10;
+
+        for(i = 0; i < len; i++, n++) {
+            v[n].flags = i == len - 1 ? PVR_CMD_VERTEX_EOL : PVR_CMD_VERTEX;
+            v[n].z = frand(wlo, whi);
+            v[n].x = frand(-2.0, 2.0);
+            v[n].y = frand(-2.0, 2.0);
+            v[n].u = frand(0.0, 1.0);
+            v[n].v = frand(0.0, 1.0);
+            v[n].argb = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+            v[n].oargb = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+        }
+    }
+
+    *count = n;
+}
+
+static void test_strips(const char *test, bool txr, double wlo, double whi) {
+    static pvr_vertex_t in[600];
+    const pvr_vertex_t *tri[3];
+    pvr_dr_state_t dr = 0;
+    size_t count, sent, i, start = 0, k, bad = 0;
+    int s;
+
+    gen_strips(in, &count, sizeof(in) / sizeof(in[0]), wlo, whi);
+
+    n_out = n_ref = n_ref_verts = nblocks = 0;
+    sent = txr ? pvr_clip_txr(&dr, in, count, NEAR)
+               : pvr_clip_gouraud(&dr, in, count, NEAR);
+
+    /* The reference, on the triangles of each strip as they are wound. */
+    for(i = 0; i < count; i++) {
+        if(in[i].flags != PVR_CMD_VERTEX_EOL)
+            continue;
+
+        for(k = start + 2; k <= i; k++) {
+            tri[0] = &in[(k - start) & 1 ? k - 1 : k - 2];
+            tri[1] = &in[(k - start) & 1 ? k - 2 : k - 1];
+            tri[2] = &in[k];
+            ref_clip(tri, txr);
+        }
+
+        start = i + 1;
+    }
+
+    decode_strips(test, sent, txr);
+
+    for(s = 0; s < SAMPLES; s++) {
+        double px = frand(-8.0, 8.0), py = frand(-8.0, 8.0);
+
+        if(coverage(out_tris, n_out, px, py) !=
+           coverage(ref_tris, n_ref, px, py))
+            bad++;
+    }
+
+    /* A sample right on an edge may go either way. */
+    if(bad > SAMPLES / 500)
+        fail(test, "coverage differs from the reference");
+
+    if(wlo >= NEAR && sent != count)
+        fail(test, "strips in front of the plane were changed");
+
+    printf("  %-28s %4u in, %4u out, %u/%u samples differ\n", test,
+           (unsigned int)count, (unsigned int)sent, (unsigned int)bad, SAMPLES);
+}
+
+/* The twelve triangles of a box in (x, y, w). */
+static size_t make_box(pvr_modifier_vol_t *t, const double lo[3],
+                       const double hi[3]) {
+    static const int faces[6][4] = {
+        { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 },
+        { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 }
+    };
+    static const int split[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+    float c[8][3];
+    int i, f, h, k;
+    float *p;
+
+    for(i = 0; i < 8; i++) {
+        c[i][0] = i & 1 ? hi[0] : lo[0];
+        c[i][1] = i & 2 ? hi[1] : lo[1];
+        c[i][2] = i & 4 ? hi[2] : lo[2];
+    }
+
+    for(f = 0; f < 6; f++) {
+        for(h = 0; h < 2; h++) {
+            t->flags = PVR_CMD_VERTEX_EOL;
+            p = &t->ax;
+
+            for(k = 0; k < 3; k++)
+                memcpy(p + k * 3, c[faces[f][split[h][k]]], sizeof(c[0]));
+
+            t++;
+        }
+    }
+
+    return 12;
+}
+
+static void test_mod(void) {
+    static const char *test = "modifier volumes";
+    pvr_mod_hdr_t hdr = { 0x80000000, (1u << 29) | 3, 0, 0, { 0 } };
+    pvr_modifier_vol_t box[12];
+    double lo[3], hi[3], z, px, py, pw;
+    pvr_dr_state_t dr = 0;
+    size_t sent, i, b, bad = 0, hits, samples = 0;
+    const float *f;
+    int s, axis;
+
+    for(b = 0; b < 200; b++) {
+        for(axis = 0; axis < 3; axis++) {
+            lo[axis] = frand(-2.0, 1.0);
+            hi[axis] = lo[axis] + frand(0.3, 2.5);
+        }
+
+        make_box(box, lo, hi);
+
+        n_out = nblocks = 0;
+        sent = pvr_clip_mod(&dr, &hdr, box, 12, NEAR);
+
+        if(hi[2] < NEAR) {
+            if(sent || nblocks)
+                fail(test, "a volume behind the plane was sent");
+
+            continue;
+        }
+
+        /* Header, triangles, header, last triangle. */
+        if(nblocks != sent * 2 + (sent > 1 ? 2 : 1) ||
+           blocks[0][0] != hdr.cmd ||
+           blocks[0][1] != (sent > 1 ? hdr.mode1 & ~PVR_TA_PM1_MODIFIERINST
+                                     : hdr.mode1) ||
+           blocks[nblocks - 3][1] != hdr.mode1) {
+            fail(test, "bad header sequence");
+            continue;
+        }
+
+        for(i = 0; i < sent; i++) {
+            size_t at = 1 + i * 2 + (sent > 1 && i == sent - 1);
+            double x[3], y[3], zz[3];
+
+            f = (const float *)blocks[at];
+
+            if(blocks[at][0] != PVR_CMD_VERTEX_EOL)
+                fail(test, "bad triangle flags");
+
+            x[0] = f[1], y[0] = f[2], zz[0] = f[3];
+            x[1] = f[4], y[1] = f[5], zz[1] = f[6];
+            x[2] = f[7];
+            f = (const float *)blocks[at + 1];
+            y[2] = f[0], zz[2] = f[1];
+            add_tri(out_tris, &n_out, x, y, zz);
+        }
+
+        /* Odd crossings between the eye and a point inside. */
+        for(s = 0; s < 40; s++) {
+            pw = frand(NEAR + 1e-3, hi[2] + 1.0);
+            px = frand(lo[0] - 0.5, hi[0] + 0.5);
+            py = frand(lo[1] - 0.5, hi[1] + 0.5);
+
+            for(i = 0, hits = 0; i < n_out; i++) {
+                if(tri_hit(&out_tris[i], px / pw, py / pw, &z) && z > 1.0 / pw)
+                    hits++;
+            }
+
+            if((hits & 1) != (px > lo[0] && px < hi[0] && py > lo[1] &&
+                              py < hi[1] && pw > lo[2] && pw < hi[2]))
+                bad++;
+
+            samples++;
+        }
+    }
+
+    if(bad > samples / 500)
+        fail(test, "inside and outside are mixed up");
+
+    printf("  %-28s %u/%u samples differ\n", test, (unsigned int)bad,
+           (unsigned int)samples);
+}
+
+int main(void) {
+    srand(1234);
+
+    printf("Near plane clipper test\n");
+
+    test_strips("textured, crossing", true, -1.0, 3.0);
+    test_strips("textured, behind", true, -2.0, 0.4);
+    test_strips("textured, in front", true, 0.6, 3.0);
+    test_strips("Gouraud, crossing", false, -1.0, 3.0);
+    test_strips("Gouraud, in front", false, 0.6, 3.0);
+    test_mod();
+
+    if(errors)
+        printf("%u errors!\n", errors);
+    else
+        printf("All results were correct.\n");
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,285 @@
+/* KallistiOS ##version##
+
+   xform_bench.c
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/* This program exercises the vertex pipeline: mat_transform_pvr(),
+   pvr_xform_tris_dr() and, for the triangles crossing the near bound,
+   pvr_xform_side_verts() and pvr_clip_gouraud(). It flies a camera low over
+   a terrain mesh, so that parts of it are off the sides of the screen and
+   parts cross the near bound, and draws it with two transform stages in
+   turn:
+
+   - the usual C loop, transforming each vertex with mat_trans_nodiv(),
+     computing its outcode, dividing and packing a pvr_vertex_t;
+   - mat_transform_pvr().
+
+   The records and outcodes of both are compared on the first frame, and
+   the time spent transforming, clipping and submitting is printed for
+   each. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <math.h>
+
+#include <arch/timer.h>
+#include <dc/matrix.h>
+#include <dc/matrix3d.h>
+#include <dc/pvr.h>
+
+#define GRID        48
+#define VERTS       (GRID * GRID)
+#define TRIS        ((GRID - 1) * (GRID - 1) * 2)
+
+/* Room for the triangles crossing the near bound; any more are dropped. */
+#define SIDE_MAX    1024
+
+#define FRAMES      300
+
+/* mat_perspective() leaves w = 1 - z in eye space, so this sets the near
+   bound just in front of the eye. */
+#define NEAR_W      1.1f
+
+static pvr_init_params_t pvr_params = {
+    { PVR_BINSIZE_16, PVR_BINSIZE_0, PVR_BINSIZE_0, PVR_BINSIZE_0, PVR_BINSIZE_0 },
+    512 * 1024, 0, 0, 0, 0, 0
+};
+
+static float pos[VERTS][3];
+static float uv[VERTS][2];
+static uint32_t argb[VERTS];
+static uint16_t indices[TRIS * 3];
+
+static alignas(32) pvr_vertex_t pool[VERTS];
+static alignas(32) pvr_vertex_t ref_pool[VERTS];
+static uint8_t codes[VERTS];
+static uint8_t ref_codes[VERTS];
+static uint32_t side_tris[SIDE_MAX * 3];
+static alignas(32) pvr_vertex_t side_verts[SIDE_MAX * 3];
+
+static const mat_vstream_t stream = {
+    .pos = &pos[0][0],
+    .uv = &uv[0][0],
+    .argb = argb,
+    .pos_stride = sizeof(pos[0]),
+    .uv_stride = sizeof(uv[0]),
+    .argb_stride = sizeof(argb[0]),
+    .strip_len = 3,
+    .xmin = 0.0f,
+    .xmax = 640.0f,
+    .ymin = 0.0f,
+    .ymax = 480.0f,
+    .near = NEAR_W,
+};
+
+static pvr_poly_hdr_t hdr;
+static unsigned int errors;
+
+static void setup_mesh(void) {
+    unsigned int x, z, i, v;
+    uint16_t *idx = indices;
+
+    for(z = 0; z < GRID; z++) {
+        for(x = 0; x < GRID; x++) {
+            i = z * GRID + x;
+
+            pos[i][0] = (float)x - GRID / 2;
+            pos[i][1] = sinf(x * 0.4f) * cosf(z * 0.3f) * 1.5f;
+            pos[i][2] = (float)z - GRID / 2;
+            uv[i][0] = x / (float)(GRID - 1);
+            uv[i][1] = z / (float)(GRID - 1);
+            argb[i] = 0xff000000 | (x * 5) << 16 | 0x40 << 8 | (z * 5);
+        }
+    }
+
+    for(z = 0; z < GRID - 1; z++) {
+        for(x = 0; x < GRID - 1; x++) {
+            v = z * GRID + x;
+
+            *idx++ = v;
+            *idx++ = v + 1;
+            *idx++ = v + GRID;
+            *idx++ = v + 1;
+            *idx++ = v + GRID + 1;
+            *idx++ = v + GRID;
+        }
+    }
+}
+
+static void setup_matrix(int frame) {
+    float a = frame * 0.01f;
+    point_t eye = { sinf(a) * 8.0f, 2.5f, cosf(a) * 8.0f, 1.0f };
+    point_t center = { sinf(a + 1.0f) * 16.0f, 0.0f, cosf(a + 1.0f) * 16.0f, 1.0f };
+    vector_t up = { 0.0f, 1.0f, 0.0f, 0.0f };
+
+    mat_identity();
+    mat_perspective(320.0f, 240.0f, 1.5f, 0.1f, 100.0f);
+    mat_lookat(&eye, &center, &up);
+}
+
+/* The transform stage as it is usually written in C. */
+static void ref_transform(void) {
+    float x, y, z, w, rw;
+    unsigned int i, c;
+
+    for(i = 0; i < VERTS; i++) {
+        x = pos[i][0];
+        y = pos[i][1];
+        z = pos[i][2];
+        w = 1.0f;
+        mat_trans_nodiv(x, y, z, w);
+
+        c = 0;
+
+        if(x < stream.xmin * w)
+            c |= MAT_CLIP_LEFT;
+        if(x > stream.xmax * w)
+            c |= MAT_CLIP_RIGHT;
+        if(y < stream.ymin * w)
+            c |= MAT_CLIP_TOP;
+        if(y > stream.ymax * w)
+            c |= MAT_CLIP_BOTTOM;
+        if(w < stream.near)
+            c |= MAT_CLIP_NEAR;
+
+        ref_codes[i] = c;
+
+        rw = 1.0f / fabsf(w);
+        ref_pool[i].flags = PVR_CMD_VERTEX;
+        ref_pool[i].x = x * rw;
+        ref_pool[i].y = y * rw;
+        ref_pool[i].z = rw;
+        ref_pool[i].u = uv[i][0];
+        ref_pool[i].v = uv[i][1];
+        ref_pool[i].argb = argb[i];
+        ref_pool[i].oargb = 0;
+    }
+}
+
+static int close_enough(float a, float b) {
+    return fabsf(a - b) <= fabsf(b) * 1e-4f + 1e-4f;
+}
+
+static void check(void) {
+    unsigned int i, bad = 0;
+
+    for(i = 0; i < VERTS; i++) {
+        /* The two can disagree on a vertex right on a bound. */
+        if(codes[i] != ref_codes[i] && !(ref_codes[i] & MAT_CLIP_NEAR))
+            bad++;
+        else if(!(ref_codes[i] & MAT_CLIP_NEAR) &&
+                (!close_enough(pool[i].x, ref_pool[i].x) ||
+                 !close_enough(pool[i].y, ref_pool[i].y) ||
+                 !close_enough(pool[i].z, ref_pool[i].z) ||
+                 pool[i].u != ref_pool[i].u || pool[i].v != ref_pool[i].v ||
+                 pool[i].argb != ref_pool[i].argb || pool[i].oargb ||
+                 (pool[i].flags != PVR_CMD_VERTEX) != (i % 3 == 2)))
+            bad++;
+    }
+
+    if(bad) {
+        printf("  ERROR: %u vertices differ from the C transform\n", bad);
+        errors++;
+    }
+}
+
+/* Draw a frame, returning the time spent transforming, clipping and
+   submitting. */
+static uint64_t do_frame(int frame, bool use_asm, size_t *sent,
+                         size_t *culled, size_t *clipped) {
+    pvr_xform_side_t side = { side_tris, SIDE_MAX, 0 };
+    pvr_dr_state_t dr;
+    uint64_t start, ns;
+    size_t n;
+
+    pvr_wait_ready();
+    pvr_scene_begin();
+    pvr_list_begin(PVR_LIST_OP_POLY);
+    pvr_prim(&hdr, sizeof(hdr));
+
+    setup_matrix(frame);
+    pvr_dr_init(&dr);
+
+    start = timer_ns_gettime64();
+
+    if(use_asm)
+        mat_transform_pvr(&stream, pool, codes, VERTS);
+    else
+        ref_transform();
+
+    *sent = pvr_xform_tris_dr(&dr, use_asm ? pool : ref_pool,
+                              use_asm ? codes : ref_codes, indices, TRIS,
+                              &side);
+
+    /* Transform the triangles set aside again, and clip them. */
+    n = pvr_xform_side_verts(&stream, &side, side_verts);
+    pvr_clip_gouraud(&dr, side_verts, n, NEAR_W);
+
+    ns = timer_ns_gettime64() - start;
+
+    *clipped = side.count;
+    *culled = TRIS - *sent - side.count;
+
+    pvr_list_finish();
+    pvr_scene_finish();
+
+    return ns;
+}
+
+static void bench(bool use_asm) {
+    size_t sent, culled, clipped;
+    uint64_t total = 0;
+    int f;
+
+    for(f = 0; f < FRAMES; f++) {
+        total += do_frame(f, use_asm, &sent, &culled, &clipped);
+
+        if(!f && use_asm) {
+            setup_matrix(f);
+            ref_transform();
+            check();
+        }
+    }
+
+    printf("  %-4s  %8.1f us/frame  %6.2f Mvert/s   (last frame: %u sent, "
+           "%u culled, %u clipped)\n", use_asm ? "asm" : "C",
+           total / 1000.0 / FRAMES, (double)VERTS * FRAMES * 1000.0 / total,
+           (unsigned int)sent, (unsigned int)culled, (unsigned int)clipped);
+}
+
+int main(int argc, char **argv) {
+    pvr_poly_cxt_t cxt;
+
+    (void)argc;
+    (void)argv;
+
+    printf("KallistiOS vertex pipeline benchmark\n\n");
+
+    pvr_init(&pvr_params);
+    pvr_set_bg_color(0.1f, 0.1f, 0.2f);
+
+    pvr_poly_cxt_col(&cxt, PVR_LIST_OP_POLY);
+    pvr_poly_compile(&hdr, &cxt);
+
+    setup_mesh();
+
+    printf("%u vertices, %u triangles, %d frames each\n", VERTS, TRIS,
+           FRAMES);
+
+    bench(false);
+    bench(true);
+
+    printf("\n");
+
+    if(errors)
+        printf("%u errors!\n", errors);
+    else
+        printf("All results were correct.\n");
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
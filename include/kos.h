@@ -44,8 +44,11 @@ __BEGIN_DECLS
 #include <kos/rwsem.h>
 #include <kos/once.h>
 #include <kos/tls.h>
+#include <kos/fiber.h>
 #include <kos/mutex.h>
 #include <kos/cond.h>
+#include <kos/msgqueue.h>
+#include <kos/arena.h>
 #include <kos/genwait.h>
 #include <kos/library.h>
 #include <kos/net.h>
@@ -75,7 +78,9 @@ __BEGIN_DECLS
 #ifdef _arch_dreamcast
 #   include <arch/gdb.h>
 #   include <arch/mmu.h>
+#   include <arch/copy.h>
 #   include <arch/memory.h>
+#   include <arch/ocram.h>
 #   include <arch/wdt.h>
 
 #   include <dc/asic.h>
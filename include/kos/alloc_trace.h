@@ -0,0 +1,198 @@
+/* KallistiOS ##version##
+
+   kos/alloc_trace.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    kos/alloc_trace.h
+    \brief   Heap allocation tracing.
+    \ingroup alloc_trace
+
+    This file contains a low-overhead tracer for malloc(), calloc(),
+    realloc(), memalign() and free(). When it is enabled, each call is
+    recorded into a ring buffer, along with the resulting pointer, the size,
+    the calling thread and a short backtrace of the call site. The buffer can
+    be dumped to a file when done, or streamed to one (for instance on /pc,
+    when using dcload) while the program runs, so that traces much longer than
+    what fits in memory can be taken.
+
+    The kosheap utility in utils/kosheap rebuilds the state of the heap over
+    time from a trace, and reports fragmentation, peak usage by call site and
+    leaks. It can also replay the trace into a few alternative allocation
+    strategies, or convert it for utils/slabbench.
+
+    Tracing is compiled out unless MALLOC_TRACE is defined when building KOS
+    (see kos/opts.h). Without it, the allocator isn't touched at all and the
+    functions below just fail with ENOSYS.
+
+    Backtraces beyond the immediate caller need KOS and the program to be
+    built with frame pointers (see arch/stack.h); the remaining slots are zero
+    otherwise.
+*/
+
+#ifndef __KOS_ALLOC_TRACE_H
+#define __KOS_ALLOC_TRACE_H
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kos/opts.h>
+
+/** \defgroup alloc_trace   Allocation Tracing
+    \brief                  Heap allocation tracing
+    \ingroup                system_allocator
+
+    @{
+*/
+
+/** \brief  Magic value at the start of an allocation trace ("KALC"). */
+#define ALLOC_TRACE_MAGIC       0x4b414c43
+
+/** \brief  Version of the allocation trace format. */
+#define ALLOC_TRACE_VERSION     1
+
+/** \brief  Maximum length of a thread label in an allocation trace. */
+#define ALLOC_TRACE_LABEL_LEN   32
+
+/** \brief  Number of return addresses kept for each call. */
+#define ALLOC_TRACE_DEPTH       3
+
+/** \brief  Record count of a streamed trace: records follow until the end of
+            the file. */
+#define ALLOC_TRACE_STREAMED    0xffffffff
+
+/** \defgroup alloc_trace_ops   Operations
+    \brief                      Types of records in an allocation trace
+
+    @{
+*/
+#define ALLOC_OP_MALLOC     1   /**< \brief malloc(), ptr = result */
+#define ALLOC_OP_CALLOC     2   /**< \brief calloc(), ptr = result */
+#define ALLOC_OP_REALLOC    3   /**< \brief realloc(), ptr = result, arg = old */
+#define ALLOC_OP_MEMALIGN   4   /**< \brief memalign(), ptr = result, arg = alignment */
+#define ALLOC_OP_FREE       5   /**< \brief free(), ptr = block */
+#define ALLOC_OP_MARK       6   /**< \brief Marker, arg = any (see alloc_trace_mark()) */
+#define ALLOC_OP_DROPPED    7   /**< \brief size = records lost while streaming */
+/** @} */
+
+/** \brief  A single allocation trace record.
+
+    Records are 32 bytes, so that each takes exactly one cache line. A failed
+    allocation is recorded with a NULL pointer.
+*/
+typedef struct alloc_trace_rec {
+    uint32_t time;      /**< \brief Timestamp, in microseconds (wraps around) */
+    uint32_t ptr;       /**< \brief Resulting or freed pointer */
+    uint32_t arg;       /**< \brief Operation-specific argument */
+    uint32_t size;      /**< \brief Requested size */
+    uint16_t tid;       /**< \brief Thread that made the call */
+    uint16_t op;        /**< \brief Operation (see \ref alloc_trace_ops) */
+    uint32_t callers[ALLOC_TRACE_DEPTH];    /**< \brief Return addresses,
+                                                        innermost first */
+} alloc_trace_rec_t;
+
+/** \brief  Header at the start of an allocation trace.
+
+    A trace consists of this header, followed by thread_count
+    alloc_trace_thread_t entries, followed by record_count alloc_trace_rec_t
+    entries, oldest first (or as many as there are until the end of the file,
+    for a streamed trace). All fields are stored in the Dreamcast's (little
+    endian) byte order.
+*/
+typedef struct alloc_trace_header {
+    uint32_t magic;         /**< \brief Always ALLOC_TRACE_MAGIC */
+    uint32_t version;       /**< \brief Always ALLOC_TRACE_VERSION */
+    uint32_t thread_count;  /**< \brief Number of thread entries */
+    uint32_t record_count;  /**< \brief Number of records, or
+                                        ALLOC_TRACE_STREAMED */
+    uint32_t dropped;       /**< \brief Records overwritten before the dump */
+    uint32_t mem_top;       /**< \brief End of RAM */
+} alloc_trace_header_t;
+
+/** \brief  A thread's label, as stored in an allocation trace. */
+typedef struct alloc_trace_thread {
+    uint32_t tid;                           /**< \brief Thread ID */
+    char label[ALLOC_TRACE_LABEL_LEN];      /**< \brief NUL-terminated label */
+} alloc_trace_thread_t;
+
+/** \brief  Start tracing allocations.
+
+    This function allocates a ring buffer for the given number of records
+    (rounded up to a power of two) and starts recording into it. Unless the
+    trace is being streamed, the oldest records are overwritten once the
+    buffer is full. Any previous trace is discarded.
+
+    \param  count           The number of records to keep.
+    \retval 0               On success.
+    \retval -1              On error, setting errno to ENOMEM if the buffer
+                            could not be allocated, or ENOSYS if KOS was built
+                            without MALLOC_TRACE.
+*/
+int alloc_trace_start(size_t count);
+
+/** \brief  Stream the trace to a file.
+
+    This writes the records collected so far to the given file, and starts a
+    thread which keeps appending new records to it as they come, until
+    alloc_trace_stop() is called. If the program allocates faster than the
+    records can be written, the newest ones are dropped, and the number
+    dropped is recorded in the file.
+
+    Calls made by the streaming thread itself are not recorded.
+
+    \param  fn              The file to write to (e.g. "/pc/heap.kalc").
+    \retval 0               On success.
+    \retval -1              On error, setting errno as appropriate (EINVAL if
+                            tracing wasn't started or is already streamed,
+                            ENOSYS if KOS was built without MALLOC_TRACE).
+*/
+int alloc_trace_stream(const char *fn);
+
+/** \brief  Stop tracing allocations.
+
+    If the trace is being streamed, the remaining records are written out and
+    the file is closed. Otherwise, the records are kept until
+    alloc_trace_start() or alloc_trace_release() is called, so that they can
+    be written out with alloc_trace_dump().
+*/
+void alloc_trace_stop(void);
+
+/** \brief  Write the recorded allocations to a file.
+
+    Recording is paused while the dump is written, and then resumed if it was
+    active.
+
+    \param  fn              The file to write to (e.g. "/pc/heap.kalc").
+    \retval 0               On success.
+    \retval -1              On error, setting errno as appropriate (EINVAL if
+                            there is no trace or it is being streamed, ENOSYS
+                            if KOS was built without MALLOC_TRACE).
+*/
+int alloc_trace_dump(const char *fn);
+
+/** \brief  Stop tracing and free the record buffer. */
+void alloc_trace_release(void);
+
+/** \brief  Drop a marker into the trace.
+
+    Markers let the analyzer report the state of the heap at points that mean
+    something to the program, such as the end of each frame or level.
+
+    \param  arg             Any value, reported by the analyzer.
+*/
+void alloc_trace_mark(uint32_t arg);
+
+/** \cond */
+/* Called by the allocator, don't call this directly. */
+void alloc_trace_record(uint16_t op, void *ptr, uintptr_t arg, size_t size,
+                        uintptr_t pr, uintptr_t fp);
+/** \endcond */
+
+/** @} */
+
+__END_DECLS
+
+#endif /* __KOS_ALLOC_TRACE_H */
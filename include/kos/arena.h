@@ -0,0 +1,272 @@
+/* KallistiOS ##version##
+
+   include/kos/arena.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    kos/arena.h
+    \brief   Arena (bump) allocator for transient data.
+    \ingroup system_allocator
+
+    An arena hands out memory from a single block by bumping a pointer, and
+    gets it all back at once: there is no per-allocation free. This makes it a
+    good fit for data that only lives for a frame (vertex batches, sort keys,
+    decoded audio, etc.), which would otherwise go through malloc() and free()
+    every frame.
+
+    All allocations are aligned to (and their sizes rounded up to) 32 bytes,
+    which is the cache line size. They can be handed to the DMA controller or
+    the store queues as is, and purging or flushing one never touches another.
+
+    Besides resetting the whole arena, a marker can be taken with arena_mark()
+    and rolled back to with arena_release(), or automatically at the end of a
+    block with arena_scoped().
+
+    arena_frame_t pairs two arenas for double-buffered frame data: after
+    arena_frame_flip(), allocations from the previous frame stay valid for one
+    more frame, which is what data read by the hardware in the background
+    (like PVR vertex DMA) needs. See pvr_set_frame_arena() and
+    snd_stream_set_arena() for the hooks in the PVR and sound stream code.
+
+    The arena functions are not thread-safe: each arena should be used by one
+    thread at a time.
+
+    \see    malloc.h
+*/
+
+#ifndef __KOS_ARENA_H
+#define __KOS_ARENA_H
+
+#include <kos/cdefs.h>
+__BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdalign.h>
+
+/** \brief  Alignment of all arena allocations. */
+#define ARENA_ALIGN     32
+
+/** \brief  Arena type.
+
+    All members of this structure should be considered to be private.
+
+    \headerfile kos/arena.h
+*/
+typedef struct arena {
+    uint8_t *base;          /**< \brief Start of the arena's memory */
+    size_t size;            /**< \brief Size of the arena's memory */
+    size_t used;            /**< \brief Bytes handed out */
+    size_t peak;            /**< \brief Highest value of used since reset */
+    int owned;              /**< \brief Was the memory allocated by us? */
+} arena_t;
+
+/** \brief  Arena marker type, see arena_mark(). */
+typedef size_t arena_marker_t;
+
+/** \brief  Initializer for an arena over existing memory.
+
+    \param  mem             The memory to use, aligned to ARENA_ALIGN.
+    \param  len             The size of the memory, in bytes.
+*/
+#define ARENA_INITIALIZER(mem, len) { (uint8_t *)(mem), (len), 0, 0, 0 }
+
+/** \brief  Define an arena with its own statically allocated memory.
+
+    This sets aside a region of the given size in the program's BSS section,
+    so that the arena never competes with the heap.
+
+    \param  name            The name of the arena variable.
+    \param  len             The size of the arena, in bytes.
+*/
+#define ARENA_DEFINE(name, len) \
+    static alignas(ARENA_ALIGN) uint8_t __arena_mem_##name[(len)]; \
+    arena_t name = ARENA_INITIALIZER(__arena_mem_##name, (len))
+
+/** \brief  Initialize an arena.
+
+    \param  arena           The arena to initialize.
+    \param  mem             The memory to use, aligned to ARENA_ALIGN, or NULL
+                            to allocate it from the heap.
+    \param  size            The size of the arena, in bytes.
+    \retval 0               On success.
+    \retval -1              On error, errno will be set to EINVAL if mem is
+                            misaligned, or ENOMEM.
+*/
+int arena_init(arena_t *arena, void *mem, size_t size);
+
+/** \brief  Destroy an arena.
+
+    The arena's memory is freed if it was allocated by arena_init().
+
+    \param  arena           The arena to destroy.
+*/
+void arena_destroy(arena_t *arena);
+
+/** \brief  Allocate memory from an arena.
+
+    \param  arena           The arena to allocate from.
+    \param  size            The number of bytes to allocate.
+    \return                 The memory, aligned to ARENA_ALIGN, or NULL if the
+                            arena doesn't have enough room left.
+*/
+static inline void *arena_alloc(arena_t *arena, size_t size) {
+    size_t used = arena->used;
+
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if(__unlikely(size > arena->size - used))
+        return NULL;
+
+    arena->used = used + size;
+
+    if(arena->used > arena->peak)
+        arena->peak = arena->used;
+
+    return arena->base + used;
+}
+
+/** \brief  Allocate memory with a larger alignment from an arena.
+
+    \param  arena           The arena to allocate from.
+    \param  align           The alignment, a power of two.
+    \param  size            The number of bytes to allocate.
+    \return                 The memory, or NULL if the arena doesn't have
+                            enough room left.
+*/
+void *arena_alloc_aligned(arena_t *arena, size_t align, size_t size);
+
+/** \brief  Take a marker of the current position in an arena.
+
+    \param  arena           The arena.
+    \return                 A marker to pass to arena_release().
+*/
+static inline arena_marker_t arena_mark(const arena_t *arena) {
+    return arena->used;
+}
+
+/** \brief  Roll an arena back to a marker.
+
+    Everything allocated since the marker was taken is freed at once.
+
+    \param  arena           The arena.
+    \param  marker          A marker returned by arena_mark().
+*/
+static inline void arena_release(arena_t *arena, arena_marker_t marker) {
+    if(marker < arena->used)
+        arena->used = marker;
+}
+
+/** \brief  Free everything allocated from an arena.
+
+    \param  arena           The arena to reset.
+*/
+static inline void arena_reset(arena_t *arena) {
+    arena->used = 0;
+}
+
+/** \brief  Retrieve the number of bytes in use in an arena. */
+static inline size_t arena_used(const arena_t *arena) {
+    return arena->used;
+}
+
+/** \brief  Retrieve the number of bytes still available in an arena. */
+static inline size_t arena_available(const arena_t *arena) {
+    return arena->size - arena->used;
+}
+
+/** \brief  Retrieve the highest number of bytes used in an arena.
+
+    This is useful to size arenas. The peak is only reset by
+    arena_reset_peak().
+*/
+static inline size_t arena_peak(const arena_t *arena) {
+    return arena->peak;
+}
+
+/** \brief  Reset the peak usage of an arena. */
+static inline void arena_reset_peak(arena_t *arena) {
+    arena->peak = arena->used;
+}
+
+/** \cond */
+typedef struct {
+    arena_t *arena;
+    arena_marker_t marker;
+} __arena_scope_t;
+
+static inline void __arena_scoped_cleanup(__arena_scope_t *scope) {
+    arena_release(scope->arena, scope->marker);
+}
+
+#define ___arena_scoped(a, l) \
+    __arena_scope_t __scoped_arena_##l __attribute__((cleanup(__arena_scoped_cleanup))) = \
+        { (a), arena_mark(a) }
+
+#define __arena_scoped(a, l) ___arena_scoped(a, l)
+/** \endcond */
+
+/** \brief  Free what is allocated from an arena at the end of the scope.
+
+    This macro takes a marker of the arena, and rolls the arena back to it
+    when the enclosing block is exited, whichever way that happens.
+
+    \param  a               The arena.
+*/
+#define arena_scoped(a) __arena_scoped(a, __LINE__)
+
+/** \brief  Double-buffered frame arena type.
+
+    All members of this structure should be considered to be private.
+
+    \headerfile kos/arena.h
+*/
+typedef struct arena_frame {
+    arena_t arenas[2];      /**< \brief One arena for each frame */
+    unsigned int current;   /**< \brief Arena used for the current frame */
+} arena_frame_t;
+
+/** \brief  Initialize a frame arena.
+
+    The memory is split in two halves, one for each frame.
+
+    \param  frame           The frame arena to initialize.
+    \param  mem             The memory to use, aligned to ARENA_ALIGN, or NULL
+                            to allocate it from the heap.
+    \param  size            The total size of the memory, in bytes.
+    \retval 0               On success.
+    \retval -1              On error, errno will be set as for arena_init().
+*/
+int arena_frame_init(arena_frame_t *frame, void *mem, size_t size);
+
+/** \brief  Destroy a frame arena.
+
+    \param  frame           The frame arena to destroy.
+*/
+void arena_frame_destroy(arena_frame_t *frame);
+
+/** \brief  Start a new frame.
+
+    This switches to the other arena and resets it. Whatever was allocated
+    during the frame before the one that just ended is freed.
+
+    \param  frame           The frame arena.
+*/
+static inline void arena_frame_flip(arena_frame_t *frame) {
+    frame->current ^= 1;
+    arena_reset(&frame->arenas[frame->current]);
+}
+
+/** \brief  Retrieve the arena of the current frame.
+
+    \param  frame           The frame arena.
+    \return                 The arena to allocate this frame's data from.
+*/
+static inline arena_t *arena_frame_get(arena_frame_t *frame) {
+    return &frame->arenas[frame->current];
+}
+
+__END_DECLS
+
+#endif /* __KOS_ARENA_H */
@@ -59,12 +59,12 @@ __BEGIN_DECLS
     \headerfile kos/cond.h
 */
 typedef struct condvar {
-    int dummy;
+    genwait_queue_t waiters;
     int dynamic;
 } condvar_t;
 
 /** \brief  Initializer for a transient condvar. */
-#define COND_INITIALIZER    { 0, 0 }
+#define COND_INITIALIZER    { GENWAIT_QUEUE_INITIALIZER, 0 }
 
 /** \brief  Allocate a new condition variable.
 
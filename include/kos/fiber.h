@@ -0,0 +1,143 @@
+/* KallistiOS ##version##
+
+   include/kos/fiber.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    kos/fiber.h
+    \brief   Lightweight cooperative fibers.
+    \ingroup fibers
+
+    This file contains a small fiber (coroutine) API. Fibers run on top of an
+    existing kthread and are switched explicitly, so they don't need a
+    kthread_t, a reent structure or a slot on the run queue, and switching
+    between them only saves the registers that the calling convention says
+    must survive a function call.
+
+    \author KallistiOS Team
+*/
+
+#ifndef __KOS_FIBER_H
+#define __KOS_FIBER_H
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+#include <stddef.h>
+
+/** \defgroup fibers    Fibers
+    \brief              Lightweight cooperative fibers
+    \ingroup            kthreads
+
+    A fiber is a function with its own stack, which can give up the CPU with
+    fiber_yield() at any point and later be continued with fiber_resume(),
+    exactly where it left off. Fibers are never preempted by each other; the
+    kthread that a fiber runs on is still preempted normally, of course.
+
+    Fibers are resumed by, and yield back to, whoever resumed them, which may
+    be a plain kthread or another fiber. Since all fibers on a kthread share
+    that kthread, they also share its errno and thread-local storage, and
+    blocking inside a fiber blocks the whole kthread.
+
+    Both the fiber structure and its stack are provided by the caller, so
+    creating a fiber never allocates memory.
+
+    @{
+*/
+
+/** \brief  Smallest stack that fiber_create() will accept, in bytes. */
+#define FIBER_STACK_MIN     256
+
+/** \brief  Fiber states. */
+typedef enum kfiber_state {
+    FIBER_READY,        /**< \brief Created or yielded, can be resumed */
+    FIBER_RUNNING,      /**< \brief Running (or resumed another fiber) */
+    FIBER_FINISHED      /**< \brief Routine has returned */
+} kfiber_state_t;
+
+/** \brief  Structure describing one fiber.
+
+    All of the fields in here are private; use the functions below.
+
+    \headerfile kos/fiber.h
+*/
+typedef struct kfiber {
+    /** \cond */
+    void *sp;                       /* Saved stack pointer while switched out */
+    void *caller_sp;                /* Stack pointer of whoever resumed us */
+    struct kfiber *caller;          /* Fiber that resumed us, or NULL */
+    void *(*routine)(void *);
+    void *param;
+    void *retval;
+    kfiber_state_t state;
+    /** \endcond */
+} kfiber_t;
+
+/** \brief  Create a new fiber.
+
+    This function sets up a fiber to run the given routine on the given stack.
+    The fiber does not start running until it is first resumed.
+
+    \param  fiber           The fiber structure to initialize.
+    \param  stack           The stack for the fiber to run on. This must stay
+                            valid until the fiber has finished.
+    \param  stack_size      The size of the stack, at least FIBER_STACK_MIN.
+    \param  routine         The function to run in the fiber.
+    \param  param           The parameter to pass to the routine.
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EINVAL if the stack is
+                            too small.
+*/
+int fiber_create(kfiber_t *fiber, void *stack, size_t stack_size,
+                 void *(*routine)(void *), void *param);
+
+/** \brief  Switch to a fiber.
+
+    This function runs the given fiber until it yields or its routine returns,
+    and then returns to the caller.
+
+    \param  fiber           The fiber to resume.
+    \retval 0               If the fiber yielded.
+    \retval 1               If the fiber finished.
+    \retval -1              On error, setting errno to EINVAL if the fiber has
+                            already finished, or EBUSY if it is already running.
+*/
+int fiber_resume(kfiber_t *fiber);
+
+/** \brief  Give the CPU back to whoever resumed the current fiber.
+
+    This function returns when the current fiber is next resumed.
+
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EPERM if not called
+                            from inside a fiber.
+*/
+int fiber_yield(void);
+
+/** \brief  Run a fiber to completion.
+
+    This function keeps resuming the given fiber until its routine returns.
+
+    \param  fiber           The fiber to join.
+    \param  retval          Where to store the routine's return value. May be
+                            NULL.
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EDEADLK if the fiber is
+                            running (i.e. it is the caller, or one of the
+                            fibers that resumed it).
+*/
+int fiber_join(kfiber_t *fiber, void **retval);
+
+/** \brief  Retrieve the currently running fiber.
+
+    \return                 The fiber running on the current thread, or NULL
+                            if it isn't running a fiber.
+*/
+kfiber_t *fiber_self(void);
+
+/** @} */
+
+__END_DECLS
+
+#endif /* __KOS_FIBER_H */
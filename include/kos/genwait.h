@@ -28,6 +28,55 @@ __BEGIN_DECLS
 
 #include <kos/thread.h>
 #include <stdint.h>
+#include <sys/queue.h>
+
+/** \brief  Embedded wait queue.
+
+    By default, threads sleeping with genwait_wait() are kept in a fixed-size
+    table of sleep queues indexed by a hash of the object's address, so waking
+    up the sleepers of one object may require skipping over the sleepers of
+    unrelated objects which happen to hash to the same queue.
+
+    Objects that get waited on a lot (such as the kernel's synchronization
+    primitives) can instead embed one of these, and use genwait_queue_wait()
+    and genwait_queue_wake_cnt() to only ever deal with their own sleepers.
+
+    A wait queue that has been zeroed out is valid and empty, so it does not
+    need any explicit initialization.
+
+    \headerfile kos/genwait.h
+*/
+typedef struct ktqueue genwait_queue_t;
+
+/** \brief  Initializer for an embedded wait queue. */
+#define GENWAIT_QUEUE_INITIALIZER   { NULL, NULL }
+
+/** \brief  Watch on an object, for waiting on several objects at once.
+
+    An array of these is passed to genwait_wait_multiple() to sleep until any
+    one of the objects is woken up. Only the queue and obj fields are to be set
+    by the caller; the rest is private. Set queue to the wait queue embedded in
+    the object if it has one (as the sync primitives do), and obj to the object
+    itself. Whether an object is woken up through genwait_wake_cnt() or
+    genwait_queue_wake_cnt(), its watchers are only woken up once the threads
+    actually sleeping on it have been, and only as far as the number of threads
+    to wake up allows.
+
+    \headerfile kos/genwait.h
+*/
+typedef struct genwait_watch {
+    genwait_queue_t *queue;     /**< \brief Embedded wait queue, or NULL */
+    void *obj;                  /**< \brief Object to watch */
+
+    /** \cond */
+    LIST_ENTRY(genwait_watch) entry;
+    struct genwait_watch *set;
+    kthread_t *thd;
+    int index;
+    int fired;
+    int err;
+    /** \endcond */
+} genwait_watch_t;
 
 /** \brief  Sleep on an object.
 
@@ -49,6 +98,116 @@ __BEGIN_DECLS
 */
 int genwait_wait(void * obj, const char * mesg, int timeout, void (*callback)(void *));
 
+/** \brief  Sleep on an object, using an embedded wait queue.
+
+    This function works just like genwait_wait(), but puts the calling thread
+    on the given wait queue instead of the hashed sleep queue of the object.
+    Threads sleeping this way can only be woken up in bulk with
+    genwait_queue_wake_cnt() on the same queue, or individually with
+    genwait_wake_thd().
+
+    \param  queue           The wait queue embedded in the object
+    \param  obj             The object to sleep on
+    \param  mesg            A message to show in the status
+    \param  timeout         If not woken before this many milliseconds have
+                            passed, wake up anyway
+    \param  callback        If non-NULL, call this function with obj as its
+                            argument if the wait times out (but before the
+                            calling thread has been woken back up)
+    \retval 0               On successfully being woken up (not by timeout)
+    \retval -1              On error or being woken by timeout
+
+    \par    Error Conditions:
+    \em     EAGAIN - on timeout
+
+    \sa genwait_queue_wake_cnt()
+*/
+int genwait_queue_wait(genwait_queue_t *queue, void *obj, const char *mesg,
+                       int timeout, void (*callback)(void *));
+
+/** \brief  Wake up a number of threads sleeping on an embedded wait queue.
+
+    This function wakes up the specified number of threads sleeping on the
+    given wait queue, in the order they started waiting.
+
+    \param  queue           The wait queue to wake threads from
+    \param  cnt             The number of threads to wake, if <= 0, wake all
+    \param  err             The errno code to set as the errno value on the
+                            woken threads, or 0 to have genwait_queue_wait()
+                            return 0, as in genwait_wake_cnt().
+    \return                 The number of threads woken
+
+    \sa genwait_queue_wait()
+*/
+int genwait_queue_wake_cnt(genwait_queue_t *queue, int cnt, int err);
+
+/** \brief  Sleep on several objects at once.
+
+    This function sleeps until any one of the watched objects is woken up, or
+    the timeout expires. Each wake up of an object counts the watching thread
+    as one of the threads woken up, even if it was already woken up by another
+    one of its objects, so a wake-one does not get wasted on a thread that is
+    already running again.
+
+    This is the same as calling genwait_watch_arm() followed by
+    genwait_watch_wait(). Use those directly if the condition that is waited
+    for has to be checked after the watches are in place (which is how lost
+    wake ups are avoided without keeping interrupts disabled).
+
+    \param  watches         The array of objects to watch
+    \param  count           The number of objects in the array
+    \param  mesg            A message to show in the status
+    \param  timeout         If not woken before this many milliseconds have
+                            passed, wake up anyway (0 for no timeout)
+    \return                 The index of the object that woke the thread up,
+                            or -1 on error or timeout
+
+    \par    Error Conditions:
+    \em     EAGAIN - on timeout \n
+    \em     EINVAL - if count is 0 \n
+    \em     EPERM - if called inside an interrupt \n
+    Any error the object was woken up with (see genwait_wake_cnt()).
+*/
+int genwait_wait_multiple(genwait_watch_t *watches, size_t count,
+                          const char *mesg, int timeout);
+
+/** \brief  Start watching several objects.
+
+    From the moment this function is called, wake ups of any of the objects
+    will be recorded, and the next genwait_watch_wait() call will return right
+    away if one happened.
+
+    \param  watches         The array of objects to watch
+    \param  count           The number of objects in the array (at least 1)
+*/
+void genwait_watch_arm(genwait_watch_t *watches, size_t count);
+
+/** \brief  Stop watching objects without sleeping on them.
+
+    \param  watches         The array of objects passed to genwait_watch_arm()
+    \param  count           The number of objects in the array
+    \return                 The index of the object that fired since the
+                            watches were armed, or -1 if none did
+*/
+int genwait_watch_disarm(genwait_watch_t *watches, size_t count);
+
+/** \brief  Sleep on objects that are being watched.
+
+    This function works like genwait_wait_multiple(), on watches armed with
+    genwait_watch_arm(). It disarms them before returning.
+
+    \param  watches         The array of objects passed to genwait_watch_arm()
+    \param  count           The number of objects in the array
+    \param  mesg            A message to show in the status
+    \param  timeout         If not woken before this many milliseconds have
+                            passed, wake up anyway (0 for no timeout)
+    \return                 The index of the object that woke the thread up,
+                            or -1 on error or timeout (see
+                            genwait_wait_multiple())
+*/
+int genwait_watch_wait(genwait_watch_t *watches, size_t count,
+                       const char *mesg, int timeout);
+
 /* Wake up N threads waiting on the given object. If cnt is <=0, then we
    wake all threads. Returns the number of threads actually woken. */
 /** \brief  Wake up a number of threads sleeping on an object.
@@ -147,6 +306,13 @@ void genwait_check_timeouts(uint64_t now);
 uint64_t genwait_next_timeout(void);
 
 /** \cond */
+/* Make room in the timer queue for the given number of threads. This is called
+   by the threading system whenever a thread is created. */
+int genwait_reserve(size_t count);
+
+/* Drop any watches a thread being destroyed still has armed. */
+void genwait_watch_cancel(kthread_t *thd);
+
 /* Initialize the genwait system */
 int genwait_init(void);
 
@@ -0,0 +1,316 @@
+/* KallistiOS ##version##
+
+   include/kos/msgqueue.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    kos/msgqueue.h
+    \brief   Message queues.
+    \ingroup kthreads
+
+    This file defines message queues. A message queue passes messages of up to
+    a fixed size between threads (or from interrupt handlers to threads),
+    without any allocation: all of the slots holding the messages are set up
+    when the queue is initialized.
+
+    Messages are received in order of priority, and in the order they were
+    sent within a priority level.
+
+    Besides the usual copying send and receive functions, messages can be
+    built and consumed in place: msgq_send_reserve() hands out a free slot to
+    write a message into, which msgq_send_commit() then queues, and
+    msgq_recv_reserve() hands out the next message, whose slot
+    msgq_recv_commit() gives back once done with it. This way, large messages
+    never have to be copied around.
+
+    All of the functions that don't block (msgq_trysend(), msgq_tryrecv(), and
+    their reserve counterparts, as well as the commit functions) can be used
+    from interrupt handlers.
+
+    \see    kos/sem.h
+    \see    mqueue.h
+*/
+
+#ifndef __KOS_MSGQUEUE_H
+#define __KOS_MSGQUEUE_H
+
+#include <kos/cdefs.h>
+
+__BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <kos/genwait.h>
+
+/** \brief  Message queue type.
+
+    This structure defines a message queue. There are no public members of
+    this structure for you to actually do anything with in your code, so don't
+    try.
+
+    \headerfile kos/msgqueue.h
+*/
+typedef struct msgqueue {
+    int initialized;                /**< \brief Are we initialized? */
+    size_t msg_size;                /**< \brief Largest message size */
+    size_t count;                   /**< \brief Number of slots */
+    size_t stride;                  /**< \brief Bytes between two slots */
+    size_t queued;                  /**< \brief Messages waiting */
+    unsigned char *slots;           /**< \brief Slot storage */
+    uint32_t free;                  /**< \brief First free slot */
+    uint32_t head;                  /**< \brief Next message to receive */
+    uint32_t tail;                  /**< \brief Last message queued */
+    genwait_queue_t send_waiters;   /**< \brief Threads waiting for a slot */
+    genwait_queue_t recv_waiters;   /**< \brief Threads waiting for a message */
+} msgqueue_t;
+
+/** \brief  Size of the storage needed by a message queue.
+
+    \param  msg_size        The largest message size, in bytes.
+    \param  count           The number of messages the queue can hold.
+    \return                 The size of the storage, in bytes.
+*/
+#define MSGQ_STORAGE_SIZE(msg_size, count) \
+    (((((msg_size) + 7) & ~(size_t)7) + 16) * (count))
+
+/** \brief  Initialize a message queue for use.
+
+    \param  q               The message queue to initialize.
+    \param  msg_size        The largest message size, in bytes.
+    \param  count           The number of messages the queue can hold.
+    \param  storage         Memory to hold the messages, at least
+                            MSGQ_STORAGE_SIZE(msg_size, count) bytes large
+                            and 8-byte aligned, or NULL to have it allocated.
+    \retval 0               On success.
+    \retval -1              On error, errno will be set as appropriate.
+
+    \par    Error Conditions:
+    \em     EINVAL - the message size or count is zero \n
+    \em     ENOMEM - out of memory
+*/
+int msgq_init(msgqueue_t *q, size_t msg_size, size_t count, void *storage);
+
+/** \brief  Destroy a message queue.
+
+    Any threads waiting on the queue are woken up with an error, and the
+    storage is freed if it was allocated by msgq_init(). Messages still in the
+    queue are lost.
+
+    \param  q               The message queue to destroy.
+    \retval 0               On success.
+*/
+int msgq_destroy(msgqueue_t *q);
+
+/** \brief  Send a message, blocking until there is room for it.
+
+    \param  q               The message queue to send to.
+    \param  data            The message.
+    \param  len             The length of the message, in bytes.
+    \param  prio            The priority of the message; higher priority
+                            messages are received first.
+    \retval 0               On success.
+    \retval -1              On error, errno will be set as appropriate.
+
+    \par    Error Conditions:
+    \em     EMSGSIZE - the message is too large for the queue \n
+    \em     EPERM - called inside an interrupt \n
+    \em     EINVAL - the queue is not initialized \n
+    \em     ENOTRECOVERABLE - the queue was destroyed while waiting
+*/
+int msgq_send(msgqueue_t *q, const void *data, size_t len, unsigned int prio);
+
+/** \brief  Send a message, blocking until there is room for it, with a
+            timeout.
+
+    \param  q               The message queue to send to.
+    \param  data            The message.
+    \param  len             The length of the message, in bytes.
+    \param  prio            The priority of the message.
+    \param  timeout         The maximum time to wait, in milliseconds (0 for
+                            no timeout).
+    \retval 0               On success.
+    \retval -1              On error, errno will be set as appropriate.
+
+    \par    Error Conditions:
+    \em     ETIMEDOUT - timed out while waiting for room \n
+    \em     EMSGSIZE - the message is too large for the queue \n
+    \em     EPERM - called inside an interrupt \n
+    \em     EINVAL - the queue is not initialized, or timeout is negative \n
+    \em     ENOTRECOVERABLE - the queue was destroyed while waiting
+*/
+int msgq_send_timed(msgqueue_t *q, const void *data, size_t len,
+                    unsigned int prio, int timeout);
+
+/** \brief  Send a message if there is room for it.
+
+    This function never blocks, and is safe to use in an interrupt handler.
+
+    \param  q               The message queue to send to.
+    \param  data            The message.
+    \param  len             The length of the message, in bytes.
+    \param  prio            The priority of the message.
+    \retval 0               On success.
+    \retval -1              On error, errno will be set as appropriate.
+
+    \par    Error Conditions:
+    \em     EWOULDBLOCK - the queue is full \n
+    \em     EMSGSIZE - the message is too large for the queue \n
+    \em     EINVAL - the queue is not initialized
+*/
+int msgq_trysend(msgqueue_t *q, const void *data, size_t len,
+                 unsigned int prio);
+
+/** \brief  Reserve a slot to build a message in.
+
+    This function blocks until a slot is free, and returns it. Up to the
+    queue's message size bytes can be written into it, after which it must be
+    passed to either msgq_send_commit() or msgq_send_cancel().
+
+    \param  q               The message queue to send to.
+    \param  timeout         The maximum time to wait, in milliseconds (0 for
+                            no timeout).
+    \return                 The slot on success, NULL on error (errno will be
+                            set as for msgq_send_timed()).
+*/
+void *msgq_send_reserve(msgqueue_t *q, int timeout);
+
+/** \brief  Reserve a slot to build a message in, if one is free.
+
+    This function never blocks, and is safe to use in an interrupt handler.
+
+    \param  q               The message queue to send to.
+    \return                 The slot on success, NULL on error (errno will be
+                            set as for msgq_trysend()).
+*/
+void *msgq_trysend_reserve(msgqueue_t *q);
+
+/** \brief  Queue a message built in a reserved slot.
+
+    \param  q               The message queue to send to.
+    \param  msg             The slot returned by msgq_send_reserve() or
+                            msgq_trysend_reserve().
+    \param  len             The length of the message, in bytes.
+    \param  prio            The priority of the message.
+    \retval 0               On success.
+    \retval -1              On error, errno will be set to EMSGSIZE if the
+                            message is too large for the queue (the slot is
+                            then still reserved).
+*/
+int msgq_send_commit(msgqueue_t *q, void *msg, size_t len, unsigned int prio);
+
+/** \brief  Give back a reserved slot without sending anything.
+
+    \param  q               The message queue the slot was reserved from.
+    \param  msg             The slot returned by msgq_send_reserve() or
+                            msgq_trysend_reserve().
+*/
+void msgq_send_cancel(msgqueue_t *q, void *msg);
+
+/** \brief  Receive a message, blocking until there is one.
+
+    \param  q               The message queue to receive from.
+    \param  buf             Where to copy the message.
+    \param  size            The size of the buffer, which must be at least
+                            the queue's message size.
+    \param  prio            Where to store the message priority, or NULL.
+    \return                 The length of the message on success, -1 on
+                            error (errno will be set as appropriate).
+
+    \par    Error Conditions:
+    \em     EMSGSIZE - the buffer is smaller than the queue's message size \n
+    \em     EPERM - called inside an interrupt \n
+    \em     EINVAL - the queue is not initialized \n
+    \em     ENOTRECOVERABLE - the queue was destroyed while waiting
+*/
+ssize_t msgq_recv(msgqueue_t *q, void *buf, size_t size, unsigned int *prio);
+
+/** \brief  Receive a message, blocking until there is one, with a timeout.
+
+    \param  q               The message queue to receive from.
+    \param  buf             Where to copy the message.
+    \param  size            The size of the buffer.
+    \param  prio            Where to store the message priority, or NULL.
+    \param  timeout         The maximum time to wait, in milliseconds (0 for
+                            no timeout).
+    \return                 The length of the message on success, -1 on
+                            error (errno will be set as appropriate).
+
+    \par    Error Conditions:
+    \em     ETIMEDOUT - timed out while waiting for a message \n
+    \em     EMSGSIZE - the buffer is smaller than the queue's message size \n
+    \em     EPERM - called inside an interrupt \n
+    \em     EINVAL - the queue is not initialized, or timeout is negative \n
+    \em     ENOTRECOVERABLE - the queue was destroyed while waiting
+*/
+ssize_t msgq_recv_timed(msgqueue_t *q, void *buf, size_t size,
+                        unsigned int *prio, int timeout);
+
+/** \brief  Receive a message if there is one.
+
+    This function never blocks, and is safe to use in an interrupt handler.
+
+    \param  q               The message queue to receive from.
+    \param  buf             Where to copy the message.
+    \param  size            The size of the buffer.
+    \param  prio            Where to store the message priority, or NULL.
+    \return                 The length of the message on success, -1 on
+                            error (errno will be set as appropriate).
+
+    \par    Error Conditions:
+    \em     EWOULDBLOCK - the queue is empty \n
+    \em     EMSGSIZE - the buffer is smaller than the queue's message size \n
+    \em     EINVAL - the queue is not initialized
+*/
+ssize_t msgq_tryrecv(msgqueue_t *q, void *buf, size_t size,
+                     unsigned int *prio);
+
+/** \brief  Take the next message out of the queue, without copying it.
+
+    The returned slot must be given back with msgq_recv_commit() once done
+    with the message.
+
+    \param  q               The message queue to receive from.
+    \param  len             Where to store the length of the message.
+    \param  prio            Where to store the message priority, or NULL.
+    \param  timeout         The maximum time to wait, in milliseconds (0 for
+                            no timeout).
+    \return                 The message on success, NULL on error (errno will
+                            be set as for msgq_recv_timed()).
+*/
+void *msgq_recv_reserve(msgqueue_t *q, size_t *len, unsigned int *prio,
+                        int timeout);
+
+/** \brief  Take the next message out of the queue without copying it, if
+            there is one.
+
+    This function never blocks, and is safe to use in an interrupt handler.
+
+    \param  q               The message queue to receive from.
+    \param  len             Where to store the length of the message.
+    \param  prio            Where to store the message priority, or NULL.
+    \return                 The message on success, NULL on error (errno will
+                            be set as for msgq_tryrecv()).
+*/
+void *msgq_tryrecv_reserve(msgqueue_t *q, size_t *len, unsigned int *prio);
+
+/** \brief  Give back the slot of a received message.
+
+    \param  q               The message queue the message was received from.
+    \param  msg             The message returned by msgq_recv_reserve() or
+                            msgq_tryrecv_reserve().
+*/
+void msgq_recv_commit(msgqueue_t *q, void *msg);
+
+/** \brief  Retrieve the number of messages waiting in a queue.
+
+    \param  q               The message queue.
+    \return                 The number of messages that can be received
+                            without blocking.
+*/
+size_t msgq_count(const msgqueue_t *q);
+
+__END_DECLS
+
+#endif /* __KOS_MSGQUEUE_H */
@@ -45,6 +45,14 @@
     There is a fourth type of mutex defined (MUTEX_TYPE_DEFAULT), which maps to
     the MUTEX_TYPE_NORMAL type. This is simply for alignment with POSIX.
 
+    By default, all types of mutexes use priority inheritance: while a thread
+    is blocked on a mutex, the thread holding it runs at (at least) the blocked
+    thread's priority, and so does the holder of any lock that thread is itself
+    blocked on, and so on down the chain. Each thread drops back to the
+    priority it would otherwise have as soon as it releases the lock that
+    earned it the boost. This can be turned off for a given mutex with
+    mutex_set_protocol().
+
     \author Lawrence Sebald
     \see    kos/sem.h
 */
@@ -57,6 +65,7 @@
 __BEGIN_DECLS
 
 #include <kos/thread.h>
+#include <kos/genwait.h>
 
 /** \brief  Mutual exclusion lock type.
 
@@ -70,6 +79,8 @@ typedef struct kos_mutex {
     int dynamic;
     kthread_t *holder;
     int count;
+    genwait_queue_t waiters;
+    int protocol;
 } mutex_t;
 
 /** \name  Mutex types
@@ -89,14 +100,29 @@ typedef struct kos_mutex {
 #define MUTEX_TYPE_DEFAULT      MUTEX_TYPE_NORMAL
 /** @} */
 
+/** \name  Mutex protocols
+    \brief Priority protocols supported by KOS mutexes
+
+    @{
+*/
+#define MUTEX_PRIO_INHERIT      0   /**< \brief Holder inherits priority */
+#define MUTEX_PRIO_NONE         1   /**< \brief No priority inheritance */
+/** @} */
+
 /** \brief  Initializer for a transient mutex. */
-#define MUTEX_INITIALIZER               { MUTEX_TYPE_NORMAL, 0, NULL, 0 }
+#define MUTEX_INITIALIZER               { MUTEX_TYPE_NORMAL, 0, NULL, 0, \
+                                          GENWAIT_QUEUE_INITIALIZER, \
+                                          MUTEX_PRIO_INHERIT }
 
 /** \brief  Initializer for a transient error-checking mutex. */
-#define ERRORCHECK_MUTEX_INITIALIZER    { MUTEX_TYPE_ERRORCHECK, 0, NULL, 0 }
+#define ERRORCHECK_MUTEX_INITIALIZER    { MUTEX_TYPE_ERRORCHECK, 0, NULL, 0, \
+                                          GENWAIT_QUEUE_INITIALIZER, \
+                                          MUTEX_PRIO_INHERIT }
 
 /** \brief  Initializer for a transient recursive mutex. */
-#define RECURSIVE_MUTEX_INITIALIZER     { MUTEX_TYPE_RECURSIVE, 0, NULL, 0 }
+#define RECURSIVE_MUTEX_INITIALIZER     { MUTEX_TYPE_RECURSIVE, 0, NULL, 0, \
+                                          GENWAIT_QUEUE_INITIALIZER, \
+                                          MUTEX_PRIO_INHERIT }
 
 /** \brief  Allocate a new mutex.
 
@@ -130,6 +156,26 @@ mutex_t *mutex_create(void) __depr("Use mutex_init or an initializer.");
 */
 int mutex_init(mutex_t *m, int mtype);
 
+/** \brief  Set the priority protocol of a mutex.
+
+    This function selects whether threads blocked on the mutex lend their
+    priority to the thread holding it (MUTEX_PRIO_INHERIT, the default) or not
+    (MUTEX_PRIO_NONE). It must not be called while the mutex is locked.
+
+    \param  m               The mutex to modify
+    \param  protocol        The protocol to use
+
+    \retval 0               On success
+    \retval -1              On error, errno will be set as appropriate
+
+    \par    Error Conditions:
+    \em     EINVAL - an invalid protocol was specified \n
+    \em     EBUSY - the mutex is currently locked
+
+    \sa     mutex_protocols
+*/
+int mutex_set_protocol(mutex_t *m, int protocol);
+
 /** \brief  Destroy a mutex.
 
     This function destroys a mutex, releasing any memory that may have been
@@ -60,6 +60,15 @@ __BEGIN_DECLS
    serious issues. */
 /* #define KM_DBG_VERBOSE 1 */
 
+/* Enable this define to have malloc() serve small allocations from the main
+   heap, rather than from the size class front-end (see kos/slab.h). The
+   front-end is always disabled with KM_DBG, so that every block is tracked. */
+/* #define MALLOC_NO_SLAB 1 */
+
+/* Enable the allocation tracer (see kos/alloc_trace.h). Without this, the
+   allocator doesn't check whether a trace is running at all. */
+/* #define MALLOC_TRACE 1 */
+
 
 /* The following three macros are similar to the ones above, but for the PVR
    memory pool malloc. */
@@ -71,6 +80,10 @@ __BEGIN_DECLS
    handler print them when they occur.  */
 /* #define PVR_RENDER_DBG */
 
+/* Enable the scheduler/interrupt event tracer (see kos/trace.h). Without this,
+   all of the trace points in the kernel compile to nothing. */
+/* #define KOS_TRACE 1 */
+
 /* Aggregate debugging levels. It's probably best to enable these with your
    KOS_CFLAGS when compiling KOS itself, but they're all documented here and
    can be enabled here, if you really want to. */
@@ -0,0 +1,399 @@
+/* KallistiOS ##version##
+
+   include/kos/ringbuf.h
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/** \file    kos/ringbuf.h
+    \brief   Lock-free ring buffers.
+    \ingroup ringbuf
+
+    This file contains a generic ring buffer of fixed-size elements, for
+    passing data from one context to another (an interrupt handler to a
+    thread, one thread to another, etc) without any locking.
+
+    \see    kos/genwait.h
+*/
+
+#ifndef __KOS_RINGBUF_H
+#define __KOS_RINGBUF_H
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+/** \defgroup ringbuf   Ring Buffers
+    \brief              Lock-free single and multi-producer ring buffers
+    \ingroup            system
+
+    A ring buffer holds a power-of-two number of fixed-size elements, in
+    storage provided by the caller. The producer only ever writes the head
+    index, and the consumer only ever writes the tail index, so as long as
+    there is a single producer and a single consumer, neither side needs any
+    locking at all: it doesn't matter whether they are two threads, or an
+    interrupt handler and a thread, and neither side ever waits on the other.
+
+    All of the inline functions in this file are only safe with a single
+    producer and a single consumer. For several producers (for instance a few
+    threads and an interrupt handler feeding the same consumer), the producers
+    must use ringbuf_mp_write() and ringbuf_mp_push() instead, which serialize
+    them. A thread can sleep until there is data (or room) with
+    ringbuf_wait_read() and ringbuf_wait_write(); the other side then has to
+    call ringbuf_notify() after reading or writing.
+
+    Besides copying elements in and out, both sides can work on the buffer in
+    place: ringbuf_write_reserve() and ringbuf_read_peek() give direct access
+    to the largest contiguous region that can be written or read, which is
+    then handed over with ringbuf_write_commit() and ringbuf_read_commit().
+
+    The inline functions only rely on compiler atomics, so this header can also
+    be used in host programs.
+
+    @{
+*/
+
+/** \brief  Ring buffer structure.
+
+    All of the members of this structure should be considered private; use
+    ringbuf_init() to set one up.
+
+    \headerfile kos/ringbuf.h
+*/
+typedef struct ringbuf {
+    uint8_t *data;          /**< \brief Element storage */
+    size_t mask;            /**< \brief Number of elements - 1 */
+    size_t esize;           /**< \brief Size of an element, in bytes */
+    size_t head;            /**< \brief Next element to write (producer) */
+    size_t tail;            /**< \brief Next element to read (consumer) */
+    volatile int waiting;   /**< \brief Threads sleeping on the buffer */
+} ringbuf_t;
+
+/** \brief  Static initializer for a ring buffer.
+
+    \param  storage         Storage for the elements.
+    \param  count           The number of elements (must be a power of two).
+    \param  esize           The size of one element, in bytes.
+*/
+#define RINGBUF_INITIALIZER(storage, count, esize) \
+    { (uint8_t *)(storage), (count) - 1, (esize), 0, 0, 0 }
+
+/** \brief  Initialize a ring buffer.
+
+    \param  rb              The ring buffer to initialize.
+    \param  storage         Storage for the elements, at least count * esize
+                            bytes large.
+    \param  count           The number of elements (must be a power of two).
+    \param  esize           The size of one element, in bytes.
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EINVAL if count is not a
+                            power of two or esize is 0.
+*/
+static inline int ringbuf_init(ringbuf_t *rb, void *storage, size_t count,
+                               size_t esize) {
+    if(!count || (count & (count - 1)) || !esize) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    rb->data = (uint8_t *)storage;
+    rb->mask = count - 1;
+    rb->esize = esize;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->waiting = 0;
+
+    return 0;
+}
+
+/** \brief  Get the capacity of a ring buffer, in elements. */
+static inline size_t ringbuf_capacity(const ringbuf_t *rb) {
+    return rb->mask + 1;
+}
+
+/** \brief  Get the number of elements that can be read from a ring buffer.
+
+    When called from the consumer side, more elements may have been written by
+    the time this returns, but never fewer.
+*/
+static inline size_t ringbuf_used(const ringbuf_t *rb) {
+    return __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE);
+}
+
+/** \brief  Get the number of elements that can be written to a ring buffer.
+
+    When called from the producer side, more room may have been made by the
+    time this returns, but never less.
+*/
+static inline size_t ringbuf_space(const ringbuf_t *rb) {
+    return ringbuf_capacity(rb) - ringbuf_used(rb);
+}
+
+/** \cond */
+static inline void __ringbuf_copy(uint8_t *dst, const uint8_t *src,
+                                  size_t size) {
+    /* Single elements are small, don't bother with memcpy() for those. Most
+       rings are of bytes, so make those as quick as possible. */
+    if(size == 1) {
+        *dst = *src;
+        return;
+    }
+
+    do {
+        *dst++ = *src++;
+    } while(--size);
+}
+/** \endcond */
+
+/** \brief  Reserve contiguous room in a ring buffer (producer side).
+
+    This function returns a pointer to the start of the free space, and the
+    number of elements that can be written there without wrapping around.
+    Nothing is visible to the consumer until ringbuf_write_commit() is called.
+
+    \param  rb              The ring buffer.
+    \param  ptr             Where to store the pointer to the free space.
+    \return                 The number of elements that can be written.
+*/
+static inline size_t ringbuf_write_reserve(ringbuf_t *rb, void **ptr) {
+    size_t head = rb->head;
+    size_t space = ringbuf_capacity(rb) -
+                   (head - __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE));
+    size_t idx = head & rb->mask;
+
+    if(space > ringbuf_capacity(rb) - idx)
+        space = ringbuf_capacity(rb) - idx;
+
+    *ptr = rb->data + idx * rb->esize;
+
+    return space;
+}
+
+/** \brief  Hand elements written in place over to the consumer.
+
+    \param  rb              The ring buffer.
+    \param  count           The number of elements written, no more than what
+                            ringbuf_write_reserve() returned.
+*/
+static inline void ringbuf_write_commit(ringbuf_t *rb, size_t count) {
+    __atomic_store_n(&rb->head, rb->head + count, __ATOMIC_RELEASE);
+}
+
+/** \brief  Get the contiguous elements ready in a ring buffer (consumer side).
+
+    This function returns a pointer to the oldest element, and the number of
+    elements that can be read from there without wrapping around. They stay in
+    the buffer until ringbuf_read_commit() is called.
+
+    \param  rb              The ring buffer.
+    \param  ptr             Where to store the pointer to the elements.
+    \return                 The number of elements that can be read.
+*/
+static inline size_t ringbuf_read_peek(ringbuf_t *rb, void **ptr) {
+    size_t tail = rb->tail;
+    size_t used = __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE) - tail;
+    size_t idx = tail & rb->mask;
+
+    if(used > ringbuf_capacity(rb) - idx)
+        used = ringbuf_capacity(rb) - idx;
+
+    *ptr = rb->data + idx * rb->esize;
+
+    return used;
+}
+
+/** \brief  Release elements read in place back to the producer.
+
+    \param  rb              The ring buffer.
+    \param  count           The number of elements consumed, no more than what
+                            ringbuf_read_peek() returned.
+*/
+static inline void ringbuf_read_commit(ringbuf_t *rb, size_t count) {
+    __atomic_store_n(&rb->tail, rb->tail + count, __ATOMIC_RELEASE);
+}
+
+/** \brief  Write elements to a ring buffer (producer side).
+
+    \param  rb              The ring buffer.
+    \param  src             The elements to write.
+    \param  count           The number of elements to write.
+    \return                 The number of elements written, which is less than
+                            count if the buffer filled up.
+*/
+static inline size_t ringbuf_write(ringbuf_t *rb, const void *src,
+                                   size_t count) {
+    size_t head = rb->head;
+    size_t space = ringbuf_capacity(rb) -
+                   (head - __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE));
+    size_t idx = head & rb->mask, first;
+
+    if(count > space)
+        count = space;
+
+    first = ringbuf_capacity(rb) - idx;
+
+    if(first > count)
+        first = count;
+
+    memcpy(rb->data + idx * rb->esize, src, first * rb->esize);
+    memcpy(rb->data, (const uint8_t *)src + first * rb->esize,
+           (count - first) * rb->esize);
+
+    __atomic_store_n(&rb->head, head + count, __ATOMIC_RELEASE);
+
+    return count;
+}
+
+/** \brief  Read elements from a ring buffer (consumer side).
+
+    \param  rb              The ring buffer.
+    \param  dst             Where to store the elements.
+    \param  count           The maximum number of elements to read.
+    \return                 The number of elements read.
+*/
+static inline size_t ringbuf_read(ringbuf_t *rb, void *dst, size_t count) {
+    size_t tail = rb->tail;
+    size_t used = __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE) - tail;
+    size_t idx = tail & rb->mask, first;
+
+    if(count > used)
+        count = used;
+
+    first = ringbuf_capacity(rb) - idx;
+
+    if(first > count)
+        first = count;
+
+    memcpy(dst, rb->data + idx * rb->esize, first * rb->esize);
+    memcpy((uint8_t *)dst + first * rb->esize, rb->data,
+           (count - first) * rb->esize);
+
+    __atomic_store_n(&rb->tail, tail + count, __ATOMIC_RELEASE);
+
+    return count;
+}
+
+/** \brief  Write one element to a ring buffer (producer side).
+
+    \param  rb              The ring buffer.
+    \param  elem            The element to write.
+    \return                 true on success, false if the buffer is full.
+*/
+static inline bool ringbuf_push(ringbuf_t *rb, const void *elem) {
+    size_t head = rb->head;
+
+    if(head - __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE) > rb->mask)
+        return false;
+
+    __ringbuf_copy(rb->data + (head & rb->mask) * rb->esize,
+                   (const uint8_t *)elem, rb->esize);
+    __atomic_store_n(&rb->head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/** \brief  Read one element from a ring buffer (consumer side).
+
+    \param  rb              The ring buffer.
+    \param  elem            Where to store the element.
+    \return                 true on success, false if the buffer is empty.
+*/
+static inline bool ringbuf_pop(ringbuf_t *rb, void *elem) {
+    size_t tail = rb->tail;
+
+    if(__atomic_load_n(&rb->head, __ATOMIC_ACQUIRE) == tail)
+        return false;
+
+    __ringbuf_copy((uint8_t *)elem,
+                   rb->data + (tail & rb->mask) * rb->esize, rb->esize);
+    __atomic_store_n(&rb->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/** \brief  Drop everything in a ring buffer (consumer side). */
+static inline void ringbuf_clear(ringbuf_t *rb) {
+    __atomic_store_n(&rb->tail, __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE),
+                     __ATOMIC_RELEASE);
+}
+
+/** \brief  Write elements to a ring buffer with several producers.
+
+    This works like ringbuf_write(), but can be used by any number of
+    producers at once, including interrupt handlers. Interrupts are disabled
+    while the elements are copied, which on a single CPU is all it takes to
+    keep the producers out of each other's way.
+
+    \param  rb              The ring buffer.
+    \param  src             The elements to write.
+    \param  count           The number of elements to write.
+    \return                 The number of elements written.
+*/
+size_t ringbuf_mp_write(ringbuf_t *rb, const void *src, size_t count);
+
+/** \brief  Write one element to a ring buffer with several producers.
+
+    \param  rb              The ring buffer.
+    \param  elem            The element to write.
+    \return                 true on success, false if the buffer is full.
+    \see    ringbuf_mp_write()
+*/
+bool ringbuf_mp_push(ringbuf_t *rb, const void *elem);
+
+/** \brief  Sleep until a ring buffer has enough elements to read.
+
+    The producer has to call ringbuf_notify() after writing for this to wake
+    up. This can't be called from an interrupt handler.
+
+    \param  rb              The ring buffer.
+    \param  count           The number of elements to wait for (at most the
+                            capacity of the buffer).
+    \param  timeout         Maximum time to wait, in milliseconds (0 for no
+                            timeout).
+    \retval 0               On success.
+    \retval -1              On error, setting errno to ETIMEDOUT, EINVAL if
+                            count is larger than the buffer, or EPERM if called
+                            inside an interrupt.
+*/
+int ringbuf_wait_read(ringbuf_t *rb, size_t count, int timeout);
+
+/** \brief  Sleep until a ring buffer has enough room to write.
+
+    The consumer has to call ringbuf_notify() after reading for this to wake
+    up.
+
+    \param  rb              The ring buffer.
+    \param  count           The number of elements to wait for room for.
+    \param  timeout         Maximum time to wait, in milliseconds (0 for no
+                            timeout).
+    \retval 0               On success.
+    \retval -1              On error (see ringbuf_wait_read()).
+*/
+int ringbuf_wait_write(ringbuf_t *rb, size_t count, int timeout);
+
+/** \cond */
+void ringbuf_wake(ringbuf_t *rb);
+/** \endcond */
+
+/** \brief  Wake up threads sleeping on a ring buffer.
+
+    This is cheap when nobody is sleeping, so it can be called after every
+    read or write, including from interrupt handlers.
+
+    \param  rb              The ring buffer.
+*/
+static inline void ringbuf_notify(ringbuf_t *rb) {
+    if(rb->waiting)
+        ringbuf_wake(rb);
+}
+
+/** @} */
+
+__END_DECLS
+
+#endif /* __KOS_RINGBUF_H */
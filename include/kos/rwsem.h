@@ -20,6 +20,11 @@
     a reader either (since the reader might attempt to read while the writer is
     changing data).
 
+    The thread holding the write lock inherits the priority of the threads
+    (readers or writers) waiting for it, in the same way as with mutexes (see
+    kos/mutex.h). Threads holding read locks are not tracked individually, so
+    they are not boosted by writers waiting on them.
+
     \author Lawrence Sebald
 */
 
@@ -32,6 +37,7 @@ __BEGIN_DECLS
 
 #include <stddef.h>
 #include <kos/thread.h>
+#include <kos/genwait.h>
 
 /** \brief  Reader/writer semaphore structure.
 
@@ -52,10 +58,17 @@ typedef struct rw_semaphore {
 
     /** \brief  Space for one reader who's trying to upgrade to a writer. */
     kthread_t *reader_waiting;
+
+    /** \brief  Readers waiting for the write lock to be released. */
+    genwait_queue_t readers;
+
+    /** \brief  Writers (and upgrading readers) waiting for the lock. */
+    genwait_queue_t writers;
 } rw_semaphore_t;
 
 /** \brief  Initializer for a transient reader/writer semaphore */
-#define RWSEM_INITIALIZER   { 0, 0, NULL, NULL }
+#define RWSEM_INITIALIZER   { 0, 0, NULL, NULL, GENWAIT_QUEUE_INITIALIZER, \
+                              GENWAIT_QUEUE_INITIALIZER }
 
 /** \brief  Allocate a reader/writer semaphore.
 
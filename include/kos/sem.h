@@ -27,6 +27,8 @@
 
 __BEGIN_DECLS
 
+#include <kos/genwait.h>
+
 /** \brief  Semaphore type.
 
     This structure defines a semaphore. There are no public members of this
@@ -35,13 +37,14 @@ __BEGIN_DECLS
     \headerfile kos/sem.h
 */
 typedef struct semaphore {
-    int initialized;    /**< \brief Are we initialized? */
-    int count;          /**< \brief The semaphore count */
+    int initialized;            /**< \brief Are we initialized? */
+    int count;                  /**< \brief The semaphore count */
+    genwait_queue_t waiters;    /**< \brief Threads waiting on it */
 } semaphore_t;
 
 /** \brief  Initializer for a transient semaphore.
     \param  value           The initial count of the semaphore. */
-#define SEM_INITIALIZER(value) { 1, value }
+#define SEM_INITIALIZER(value) { 1, value, GENWAIT_QUEUE_INITIALIZER }
 
 /** \brief  Allocate a new semaphore.
 
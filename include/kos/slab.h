@@ -0,0 +1,116 @@
+/* KallistiOS ##version##
+
+   include/kos/slab.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    kos/slab.h
+    \brief   Small object front-end for malloc().
+    \ingroup system_allocator
+
+    Allocations of up to SLAB_MAX_SIZE bytes made through malloc(), calloc()
+    and realloc() don't go to the main heap directly. Instead, they are
+    rounded up to one of a handful of size classes, and carved out of pages
+    which only hold objects of that class. Allocating and freeing such an
+    object takes constant time, and doesn't need the main heap's lock, so it
+    can't be held up by (or hold up) larger allocations. Since small objects
+    don't end up interleaved with large blocks anymore, they can't fragment
+    the heap either.
+
+    Pages are taken from the main heap as needed, and given back once empty
+    (one empty page is kept around for each class, to avoid thrashing).
+
+    The front-end is disabled if KM_DBG or MALLOC_NO_SLAB is defined in
+    kos/opts.h when building KOS.
+
+    \see    malloc.h
+*/
+
+#ifndef __KOS_SLAB_H
+#define __KOS_SLAB_H
+
+#include <kos/cdefs.h>
+__BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief  Largest allocation served by the small object front-end. */
+#define SLAB_MAX_SIZE       256
+
+/** \brief  Number of size classes. */
+#define SLAB_CLASS_COUNT    12
+
+/** \brief  Size of the pages objects are carved out of. */
+#define SLAB_PAGE_SIZE      4096
+
+/** \brief  Statistics for one size class.
+    \headerfile kos/slab.h
+*/
+typedef struct slab_stats {
+    size_t obj_size;        /**< \brief Size of the objects of this class */
+    size_t pages;           /**< \brief Pages currently held by the class */
+    size_t reserved_pages;  /**< \brief Pages kept by slab_reserve() */
+    size_t used;            /**< \brief Objects currently allocated */
+    size_t free;            /**< \brief Objects available in the pages */
+    size_t peak;            /**< \brief Highest number of allocated objects */
+    uint32_t allocs;        /**< \brief Number of allocations */
+    uint32_t frees;         /**< \brief Number of frees */
+    uint32_t fails;         /**< \brief Allocations that fell back to the heap */
+} slab_stats_t;
+
+/** \brief  Retrieve the statistics of a size class.
+
+    \param  cls             The size class, below SLAB_CLASS_COUNT. Classes
+                            are sorted by increasing object size.
+    \param  stats           Where to store the statistics.
+    \retval 0               On success.
+    \retval -1              On error, errno will be set to EINVAL if the class
+                            doesn't exist.
+*/
+int slab_get_stats(unsigned int cls, slab_stats_t *stats);
+
+/** \brief  Print the statistics of all size classes using the given print
+            function.
+
+    \param  pf              The printf-like function to print with.
+    \retval 0               On success.
+*/
+int slab_print_stats(int (*pf)(const char *fmt, ...));
+
+/** \brief  Keep enough pages around for a number of small objects.
+
+    malloc() can't normally be used inside an interrupt handler, unless
+    malloc_irq_safe() says so. Allocations served by the small object
+    front-end are an exception, as long as the size class has a free object
+    left: this only needs interrupts to be disabled for a few instructions.
+
+    This function makes sure the size class for the given size holds enough
+    pages for at least the given number of objects, and keeps them even when
+    they are empty. As long as threads don't use them up, that many
+    allocations of this size can then be made from interrupt handlers.
+
+    \param  size            The size of the objects.
+    \param  count           The number of objects to keep room for.
+    \retval 0               On success.
+    \retval -1              On error, errno will be set to EINVAL if the size
+                            is too large for the front-end (or the front-end
+                            is disabled), or ENOMEM.
+*/
+int slab_reserve(size_t size, size_t count);
+
+/** \cond INTERNAL */
+
+/* Used by malloc(), don't call these directly. slab_alloc() returns NULL if
+   the size is too large or no page could be had, slab_free() and
+   slab_usable_size() return 0 if the pointer isn't a small object. */
+void *slab_alloc(size_t size);
+int slab_free(void *ptr);
+size_t slab_usable_size(void *ptr);
+
+/** \endcond */
+
+__END_DECLS
+
+#endif /* __KOS_SLAB_H */
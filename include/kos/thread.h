@@ -45,6 +45,7 @@ __BEGIN_DECLS
 #include <arch/types.h>
 #include <sys/queue.h>
 #include <sys/reent.h>
+#include <sys/types.h>
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -98,6 +99,13 @@ __BEGIN_DECLS
 */
 #define PRIO_DEFAULT 10
 
+/** \brief   Priority of released periodic threads
+
+    Periodic threads (see thd_set_period_vblank()) run at this priority while
+    they are working on a job, which puts them ahead of all normal threads.
+*/
+#define PRIO_PERIODIC 0
+
 /** \brief   Size of a kthread's label
 
     Maximum number of characters in a thread's label or name
@@ -133,8 +141,22 @@ LIST_HEAD(ktlist, kthread);
 #define THD_QUEUED      2  /**< \brief Thread is in the run queue */
 #define THD_DETACHED    4  /**< \brief Thread is detached */
 #define THD_OWNS_STACK  8  /**< \brief Thread manages stack lifetime */
+#define THD_STACK_PAINTED 16 /**< \brief Stack was painted at creation */
+/** @} */
+
+/** \name     Stack checking modes
+    \brief    Values for thd_set_stack_check()
+
+    @{
+*/
+#define THD_STACK_CHECK_OFF     0  /**< \brief No stack checking (default) */
+#define THD_STACK_CHECK_PAINT   1  /**< \brief Paint stacks to track usage */
+#define THD_STACK_CHECK_GUARD   2  /**< \brief Paint, and check on switches */
 /** @} */
 
+/** \brief Size of the guard zone at the bottom of painted stacks, in bytes. */
+#define THD_STACK_GUARD_SIZE    64
+
 /** \brief Kernel thread flags type */
 typedef uint8_t kthread_flags_t;
 
@@ -165,11 +187,14 @@ typedef __attribute__((aligned(32))) struct kthread {
     /** \brief  Thread list handle. Not a function. */
     LIST_ENTRY(kthread) t_list;
 
+    /** \brief  Thread ID hash chain handle. Not a function. */
+    LIST_ENTRY(kthread) tid_list;
+
     /** \brief  Run/Wait queue handle. Once again, not a function. */
     TAILQ_ENTRY(kthread) thdq;
 
-    /** \brief  Timer queue handle (if applicable). Also not a function. */
-    TAILQ_ENTRY(kthread) timerq;
+    /** \brief  Timer queue index (if applicable). Also not a function. */
+    size_t timerq_idx;
 
     /** \brief  Kernel thread id. */
     tid_t tid;
@@ -192,6 +217,12 @@ typedef __attribute__((aligned(32))) struct kthread {
     */
     void *wait_obj;
 
+    /** \brief  Sleep queue the thread is on, if waiting.
+
+        \see    kos/genwait.h
+    */
+    struct ktqueue *wait_queue;
+
     /** \brief  Generic wait message, if waiting.
 
         \see    kos/genwait.h
@@ -207,6 +238,20 @@ typedef __attribute__((aligned(32))) struct kthread {
     */
     void (*wait_callback)(void *obj);
 
+    /** \brief  Holder of the lock the thread is blocked on, if any.
+
+        This is set while the thread waits on a priority-inheriting lock, so
+        that its priority can be passed along to the holder (and to whatever
+        that thread is itself blocked on, and so on).
+    */
+    struct kthread *wait_owner;
+
+    /** \brief  Threads whose wait_owner is this thread. */
+    struct ktlist pi_waiters;
+
+    /** \brief  Entry in the wait_owner's pi_waiters list. */
+    LIST_ENTRY(kthread) pi_list;
+
     /** \brief  Next scheduled time.
 
         This value is used for sleep and timed block operations. This value is
@@ -245,11 +290,14 @@ typedef __attribute__((aligned(32))) struct kthread {
     /** \brief  Our reent struct for newlib. */
     struct _reent thd_reent;
 
-    /** \brief  OS-level thread-local storage.
+    /** \brief  OS-level thread-local storage values, indexed by key.
 
         \see    kos/tls.h
     */
-    struct kthread_tls_kv_list tls_list;
+    void **tls_values;
+
+    /** \brief  Number of slots allocated in tls_values. */
+    size_t tls_size;
 
     /** \brief Compiler-level thread-local storage. */
     void *tls_hnd;
@@ -259,6 +307,18 @@ typedef __attribute__((aligned(32))) struct kthread {
         This is only used in joinable threads.
     */
     void *rv;
+
+    /** \brief  Fiber currently running on top of this thread, if any.
+
+        \see    kos/fiber.h
+    */
+    struct kfiber *fiber;
+
+    /** \brief  Periodic scheduling state, or NULL for normal threads.
+
+        \see    thd_set_period_vblank(), thd_set_period_us()
+    */
+    struct kthread_period *period;
 } kthread_t;
 
 /** \brief   Thread creation attributes.
@@ -503,7 +563,8 @@ void thd_sleep(unsigned ms);
 
     This function is used to change the priority value of a thread. If the
     thread is scheduled already, it will be rescheduled with the new priority
-    value.
+    value. If the thread holds locks that higher-priority threads are waiting
+    on, it keeps running at their priority until it releases them.
 
     \param  thd             The thread to change the priority of.
     \param  prio            The priority value to assign to the thread.
@@ -700,6 +761,127 @@ int thd_set_hz(unsigned int hertz);
 */
 unsigned thd_get_hz(void);
 
+/** \brief   Enable or disable tickless scheduling.
+
+    By default, the scheduler is invoked by the primary timer at a fixed rate
+    (see thd_set_hz()), regardless of whether there is anything to schedule.
+    In tickless mode, the periodic interrupt is only used while other threads
+    of the same or higher priority than the running one are waiting for the
+    CPU. Otherwise, the primary timer is programmed to fire when the next
+    timed wait expires, which removes needless preemption interrupts and lets
+    thd_sleep() and other timed waits wake up with millisecond precision
+    rather than with the precision of a timeslice.
+
+    \note
+    Tickless mode enforces priorities strictly: a running thread is not
+    periodically interrupted in favor of lower priority threads.
+
+    \param  enable          True to enable tickless mode, false to go back to
+                            periodic scheduling.
+
+    \sa thd_get_tickless()
+*/
+void thd_set_tickless(bool enable);
+
+/** \brief   Check whether tickless scheduling is enabled.
+
+    \return                 True if the scheduler is in tickless mode.
+
+    \sa thd_set_tickless()
+*/
+bool thd_get_tickless(void);
+
+/** \brief   Statistics kept for a periodic thread.
+
+    \sa thd_get_period_stats()
+*/
+typedef struct thd_period_stats {
+    uint32_t releases;      /**< \brief Number of jobs released */
+    uint32_t overruns;      /**< \brief Jobs that used more than their budget */
+    uint32_t misses;        /**< \brief Jobs that ran past the next release */
+    uint64_t max_cpu_ns;    /**< \brief Longest CPU time used by one job */
+} thd_period_stats_t;
+
+/** \brief   Make the current thread periodic, released on vblank.
+
+    This function puts the calling thread in the periodic real-time class. The
+    thread's work is split into jobs: the current one starts right away, and
+    each time the thread calls thd_wait_period() it sleeps until the next
+    release, which happens every \p frames vertical blanks. Released threads
+    run at \ref PRIO_PERIODIC, ahead of all normal threads, and are switched
+    to directly from the vblank interrupt.
+
+    If a job uses more than \p budget_us microseconds of CPU time, it is
+    counted as an overrun and the thread drops back to its normal priority
+    until its next release, so that a runaway periodic thread can't starve
+    the rest of the system. The budget is checked on every scheduler tick.
+
+    \param  frames          The period, in vblanks (at least 1).
+    \param  budget_us       The CPU budget of each job, in microseconds, or 0
+                            for no budget.
+
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EINVAL for a zero period,
+                            EPERM if called in an interrupt, or ENOMEM.
+
+    \sa thd_set_period_us(), thd_wait_period(), thd_clear_period()
+*/
+int thd_set_period_vblank(unsigned int frames, uint32_t budget_us);
+
+/** \brief   Make the current thread periodic, with a period in microseconds.
+
+    This works like thd_set_period_vblank(), except that jobs are released
+    every \p period_us microseconds instead. Releases are kept on an absolute
+    schedule, so lateness doesn't accumulate. They happen through the
+    scheduler's timed waits, with the primary timer armed for each release
+    rather than left to the next scheduler tick, to millisecond precision.
+
+    \param  period_us       The period, in microseconds (at least 1).
+    \param  budget_us       The CPU budget of each job, in microseconds, or 0
+                            for no budget.
+
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EINVAL for a zero period,
+                            EPERM if called in an interrupt, or ENOMEM.
+
+    \sa thd_set_period_vblank(), thd_wait_period(), thd_clear_period()
+*/
+int thd_set_period_us(uint32_t period_us, uint32_t budget_us);
+
+/** \brief   Finish the current job of a periodic thread.
+
+    This function blocks the calling periodic thread until its next release.
+    If the release has already happened (i.e., the job ran too long), the miss
+    is recorded and the next job starts right away.
+
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EINVAL if the thread is
+                            not periodic, or EPERM if called in an interrupt.
+*/
+int thd_wait_period(void);
+
+/** \brief   Take the current thread out of the periodic class.
+
+    The thread goes back to its own priority, which is that it had before it
+    became periodic unless thd_set_prio() changed it in the meantime.
+
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EINVAL if the thread is
+                            not periodic.
+*/
+int thd_clear_period(void);
+
+/** \brief   Retrieve the statistics of a periodic thread.
+
+    \param  thd             The thread to look at.
+    \param  stats           Where to store the statistics.
+
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EINVAL if the thread is
+                            not periodic.
+*/
+int thd_get_period_stats(kthread_t *thd, thd_period_stats_t *stats);
+
 /** \brief       Wait for a thread to exit.
     \relatesalso kthread_t
 
@@ -775,6 +957,67 @@ int thd_pslist(int (*pf)(const char *fmt, ...));
 */
 int thd_pslist_queue(int (*pf)(const char *fmt, ...));
 
+/** \brief   Set the stack checking mode for new threads.
+
+    When enabled, the stacks of the threads created afterwards are filled with
+    a known pattern, so that the deepest point they ever reached (their
+    high-water mark) can be found later on with thd_get_stack_hwm() or
+    thd_pslist_stack(). Painting costs a pass over the whole stack at
+    creation time, so this is meant for debugging and tuning.
+
+    In THD_STACK_CHECK_GUARD mode, the outgoing thread is also checked at every
+    context switch: if its stack pointer went into the lowest
+    THD_STACK_GUARD_SIZE bytes of its stack, or anything wrote there, the
+    thread list is printed and the kernel asserts. This catches overflows at
+    the switch that follows them, instead of whenever the overwritten memory
+    is used next.
+
+    Threads created before this call are not affected.
+
+    \param  mode            One of the \ref THD_STACK_CHECK_OFF "stack
+                            checking modes".
+
+    \retval 0               On success.
+    \retval -1              On error, errno will be set to EINVAL if the
+                            mode is invalid.
+
+    \sa thd_get_stack_hwm, thd_pslist_stack
+*/
+int thd_set_stack_check(int mode);
+
+/** \brief       Retrieve the stack high-water mark of a thread.
+    \relatesalso kthread_t
+
+    This function returns the largest amount of stack the thread has used so
+    far. It only works for threads created while stack checking was enabled.
+
+    \param  thd             The thread to inspect, or NULL for the current
+                            thread.
+
+    \return                 The peak stack usage, in bytes, or -1 on error
+                            (errno will be set to EINVAL if the thread's stack
+                            was not painted).
+
+    \sa thd_set_stack_check
+*/
+ssize_t thd_get_stack_hwm(kthread_t *thd);
+
+/** \brief   Print the stack usage of all threads using the given print
+             function.
+
+    Each thread is printed with its tid, stack size, peak stack usage, the
+    amount of stack it never touched, a suggested stack size (the peak usage
+    plus a 25% margin, rounded up to a kilobyte) and its name. Threads whose
+    stack was not painted only have their stack size printed.
+
+    \param  pf              The printf-like function to print with.
+
+    \retval 0               On success.
+
+    \sa thd_set_stack_check, thd_pslist
+*/
+int thd_pslist_stack(int (*pf)(const char *fmt, ...));
+
 /** \cond INTERNAL */
 
 /** \brief  Initialize the threading system.
@@ -797,6 +1040,35 @@ int thd_init(void);
 */
 void thd_shutdown(void);
 
+/* Periodic class hooks: release vblank-driven threads (called from the vblank
+   interrupt), enforce the budget of the running thread (called by the
+   scheduler), give the earliest time after now (in ms since boot, or 0 if
+   none) that a time-driven thread is waiting to be released at, give the
+   priority the class runs a thread at (or its own when throttled) and clean
+   up after a dying thread. */
+void thd_period_vblank(void);
+void thd_period_check(kthread_t *thd);
+uint64_t thd_period_next_wakeup(uint64_t now);
+prio_t thd_period_prio(kthread_t *thd);
+void thd_period_destroy(kthread_t *thd);
+
+/* Scheduler hooks for the periodic class, called with interrupts disabled:
+   recompute a thread's dynamic priority after the class changed what it gives
+   the thread, and make sure the scheduler runs by the given time (in ms since
+   boot), for a periodic release that must not wait for the next tick. */
+void thd_prio_refresh(kthread_t *thd);
+void thd_wakeup_by(uint64_t when);
+
+/* Priority inheritance hooks for the lock implementations, all called with
+   interrupts disabled. thd_pi_block() is called by a thread about to block on
+   a lock held by owner, thd_pi_unblock() when a thread stops waiting (from
+   genwait), thd_pi_release() when owner releases the lock the given queue
+   belongs to, and thd_pi_adopt() when owner takes a lock with waiters. */
+void thd_pi_block(kthread_t *owner);
+void thd_pi_unblock(kthread_t *thd);
+void thd_pi_release(struct ktqueue *queue, kthread_t *owner);
+void thd_pi_adopt(struct ktqueue *queue, kthread_t *owner);
+
 /** \endcond */
 
 /** @} */
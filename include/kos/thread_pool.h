@@ -0,0 +1,238 @@
+/* KallistiOS ##version##
+
+   include/kos/thread_pool.h
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/** \file    kos/thread_pool.h
+    \brief   Pool of worker threads sharing prioritized job queues.
+    \ingroup kthreads
+
+    This file contains the thread pool API. A thread pool runs a fixed number
+    of threaded workers (see kos/worker_thread.h), which all pull jobs from the
+    same set of queues, one per job priority level. Whenever one of the workers
+    blocks (waiting on a DMA transfer, the CD drive, the network, etc.), the
+    others keep going, which makes it easy to overlap CPU-heavy work like
+    decompression or texture twiddling with I/O, without having to set up one
+    dedicated worker per kind of job.
+
+    Jobs can be chained: a job can be given a continuation, which is only
+    queued once the job (and any other job it was made a continuation of) has
+    finished. thd_pool_wait_all() waits until every job submitted to the pool
+    has run.
+
+    Job structures are owned by the caller, and must remain valid until the
+    job is done (that is, until thd_pool_wait() or thd_pool_wait_all()
+    returns). The pool doesn't allocate anything per job.
+
+    \see    kos/worker_thread.h
+*/
+
+#ifndef __KOS_THREAD_POOL_H
+#define __KOS_THREAD_POOL_H
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/queue.h>
+#include <kos/thread.h>
+
+/** \brief  Number of job priority levels. */
+#define THD_POOL_PRIO_COUNT     3
+
+/** \name   Job priorities
+    \brief  Priority levels of thread pool jobs
+
+    Workers always pick the oldest job of the highest priority level that has
+    jobs ready to run.
+
+    @{
+*/
+#define THD_POOL_PRIO_HIGH      0   /**< \brief Latency-sensitive jobs */
+#define THD_POOL_PRIO_NORMAL    1   /**< \brief Default priority */
+#define THD_POOL_PRIO_LOW       2   /**< \brief Background jobs */
+/** @} */
+
+struct kthread_pool;
+
+/** \struct  kthread_pool_t
+    \brief   Opaque structure describing a thread pool.
+*/
+typedef struct kthread_pool kthread_pool_t;
+
+/** \brief   Structure describing one job for a thread pool.
+
+    All members of this structure should be considered to be private; use
+    thd_pool_job_init() to set one up.
+
+    \headerfile kos/thread_pool.h
+*/
+typedef struct kthread_pool_job {
+    /** \brief  Queue handle. */
+    STAILQ_ENTRY(kthread_pool_job) entry;
+
+    /** \brief  Function to call to run the job. */
+    void (*routine)(void *data);
+
+    /** \brief  User pointer passed to the routine. */
+    void *data;
+
+    /** \brief  Job to release once this one is done, if any. */
+    struct kthread_pool_job *then;
+
+    /** \brief  Pool the job was submitted to, if any. */
+    kthread_pool_t *pool;
+
+    /** \brief  Number of jobs this one still has to wait for. */
+    unsigned int deps;
+
+    /** \brief  Priority level (see \ref THD_POOL_PRIO_COUNT). */
+    int prio;
+
+    /** \brief  Current state of the job. */
+    int state;
+
+    /** \brief  Time the job became ready to run, in nanoseconds. */
+    uint64_t ready_time;
+} kthread_pool_job_t;
+
+/** \brief   Thread pool statistics.
+
+    Latencies are measured from the moment a job is ready to run (submitted,
+    with all of the jobs it depends on done) until a worker starts running it.
+
+    \headerfile kos/thread_pool.h
+*/
+typedef struct thd_pool_stats {
+    size_t queued;          /**< \brief Jobs ready, waiting for a worker */
+    size_t waiting;         /**< \brief Jobs waiting on other jobs */
+    size_t running;         /**< \brief Jobs currently running */
+    size_t max_queued;      /**< \brief Highest number of queued jobs seen */
+    uint64_t completed;     /**< \brief Jobs run to completion */
+    uint64_t latency_total; /**< \brief Sum of job latencies, in ns */
+    uint64_t latency_max;   /**< \brief Worst job latency, in ns */
+    uint64_t run_total;     /**< \brief Sum of job run times, in ns */
+    uint64_t run_max;       /**< \brief Longest job run time, in ns */
+} thd_pool_stats_t;
+
+/** \brief       Create a thread pool.
+    \relatesalso kthread_pool_t
+
+    This function creates a pool of the given number of worker threads, all
+    with the given attributes.
+
+    \param  threads         The number of worker threads.
+    \param  attr            A set of thread attributes for the workers.
+                            Passing NULL will initialize all attributes to
+                            their default values.
+
+    \return                 The new pool on success, NULL on failure (errno
+                            will be set to EINVAL for a zero thread count, or
+                            ENOMEM).
+
+    \sa thd_pool_destroy
+*/
+kthread_pool_t *thd_pool_create(size_t threads, const kthread_attr_t *attr);
+
+/** \brief       Destroy a thread pool.
+    \relatesalso kthread_pool_t
+
+    This function waits for all of the jobs submitted to the pool to be done,
+    then stops the worker threads and frees the pool.
+
+    \param  pool            The pool to destroy.
+
+    \sa thd_pool_create
+*/
+void thd_pool_destroy(kthread_pool_t *pool);
+
+/** \brief       Initialize a job.
+    \relatesalso kthread_pool_job_t
+
+    \param  job             The job to initialize.
+    \param  routine         The function to call to run the job.
+    \param  data            A parameter to pass to the function.
+    \param  prio            The priority level of the job.
+*/
+void thd_pool_job_init(kthread_pool_job_t *job, void (*routine)(void *),
+                       void *data, int prio);
+
+/** \brief       Make a job a continuation of another.
+    \relatesalso kthread_pool_job_t
+
+    This function makes the given job wait for the other one to be done before
+    it can run. Several jobs can share the same continuation (which then runs
+    once all of them are done), but each job can only have one continuation.
+    This must be called before either job is submitted.
+
+    \param  job             The job that has to wait.
+    \param  before          The job it waits for.
+
+    \retval 0               On success.
+    \retval -1              On error, errno will be set to EBUSY if before
+                            already has a continuation or either job has
+                            already been submitted.
+*/
+int thd_pool_job_after(kthread_pool_job_t *job, kthread_pool_job_t *before);
+
+/** \brief       Submit a job to a thread pool.
+    \relatesalso kthread_pool_t
+
+    The job is queued right away if it doesn't wait on any other job, or as
+    soon as the last of them is done otherwise.
+
+    \param  pool            The pool to run the job in.
+    \param  job             The job to submit.
+
+    \retval 0               On success.
+    \retval -1              On error, errno will be set to EBUSY if the job
+                            was already submitted and isn't done yet.
+*/
+int thd_pool_submit(kthread_pool_t *pool, kthread_pool_job_t *job);
+
+/** \brief       Wait for a job to be done.
+    \relatesalso kthread_pool_job_t
+
+    \param  job             The job to wait for.
+    \param  timeout         Maximum time to wait, in milliseconds (0 for no
+                            timeout).
+
+    \retval 0               On success.
+    \retval -1              On error, errno will be set to ETIMEDOUT, or
+                            EINVAL if the job was never submitted.
+*/
+int thd_pool_wait(kthread_pool_job_t *job, int timeout);
+
+/** \brief       Wait for all of the jobs submitted to a pool to be done.
+    \relatesalso kthread_pool_t
+
+    This includes jobs submitted while waiting (for instance, by other jobs).
+    It can't be called from one of the pool's own workers.
+
+    \param  pool            The pool to wait for.
+    \param  timeout         Maximum time to wait, in milliseconds (0 for no
+                            timeout).
+
+    \retval 0               On success.
+    \retval -1              On error, errno will be set to ETIMEDOUT, or
+                            EDEADLK if called from one of the pool's workers.
+*/
+int thd_pool_wait_all(kthread_pool_t *pool, int timeout);
+
+/** \brief       Retrieve the statistics of a thread pool.
+    \relatesalso kthread_pool_t
+
+    \param  pool            The pool to get the statistics of.
+    \param  stats           Where to store the statistics.
+    \param  reset           If true, reset the counters (but not the current
+                            queue depths) after reading them.
+*/
+void thd_pool_get_stats(kthread_pool_t *pool, thd_pool_stats_t *stats,
+                        bool reset);
+
+__END_DECLS
+
+#endif /* __KOS_THREAD_POOL_H */
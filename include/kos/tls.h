@@ -22,38 +22,9 @@
 
 __BEGIN_DECLS
 
-#include <sys/queue.h>
-
 /** \brief  Thread-local storage key type. */
 typedef int kthread_key_t;
 
-/** \brief  Thread-local storage key-value pair.
-
-    This is the structure that is actually used to store the specific value for
-    a thread for a single TLS key.
-
-    You will not end up using these directly at all in programs, as they are
-    only used internally.
-*/
-typedef struct kthread_tls_kv {
-    /** \brief  List handle -- NOT a function. */
-    LIST_ENTRY(kthread_tls_kv) kv_list;
-
-    /** \brief  The key associated with this data. */
-    kthread_key_t key;
-
-    /** \brief  The value of the data. */
-    void *data;
-
-    /** \brief  Optional destructor for the value (set per key). */
-    void (*destructor)(void *);
-} kthread_tls_kv_t;
-
-/** \cond */
-/* TLS Key-Value pair list type. */
-LIST_HEAD(kthread_tls_kv_list, kthread_tls_kv);
-/** \endcond */
-
 /** \cond */
 /* Retrieve the next key value (i.e, what key the next kthread_key_create will
    use). This function is not meant for external use (although it won't really
@@ -100,7 +71,8 @@ void *kthread_getspecific(kthread_key_t key);
     \retval -1      On failure, and sets errno to one of the following: EINVAL
                     if the key is not valid, ENOMEM if out of memory, or EPERM
                     if called inside an interrupt and another call is in
-                    progress.
+                    progress, or the thread's storage has to grow and
+                    malloc_irq_safe() says the heap can't be used.
     \retval 0       On success.
 */
 int kthread_setspecific(kthread_key_t key, const void *value);
@@ -111,8 +83,7 @@ int kthread_setspecific(kthread_key_t key, const void *value);
     key. This function <em>does not</em> cause any destructors to be called.
 
     \param  key     The key to delete.
-    \retval -1      On failure, and sets errno to one of the following: EINVAL
-                    if the key is invalid, EPERM if unsafe to call free.
+    \retval -1      On failure, and sets errno to EINVAL if the key is invalid.
     \retval 0       On success.
 */
 int kthread_key_delete(kthread_key_t key);
@@ -122,6 +93,11 @@ int kthread_key_delete(kthread_key_t key);
    only! */
 void kthread_key_delete_destructor(kthread_key_t key);
 
+/* Run the destructors for, and free, all of a thread's TLS values. Called when
+   the thread is destroyed. Internal use only. */
+struct kthread;
+void kthread_tls_destroy(struct kthread *thd);
+
 /* Initialization and shutdown. Once again, internal use only. */
 int kthread_tls_init(void);
 void kthread_tls_shutdown(void);
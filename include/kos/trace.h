@@ -0,0 +1,164 @@
+/* KallistiOS ##version##
+
+   kos/trace.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    kos/trace.h
+    \brief   Scheduler and interrupt event tracing.
+    \ingroup tracing
+
+    This file contains a small, low-overhead event tracer. When it is enabled,
+    the kernel records timestamped events into a ring buffer whenever a thread
+    is switched in, blocks on or is woken from a genwait object, or an IRQ or
+    ASIC event is handled. The buffer can then be dumped to a file (for
+    instance on /pc, when using dcload) and converted into Chrome/Perfetto
+    trace JSON with the kostrace utility in utils/kostrace.
+
+    Tracing is compiled out unless KOS_TRACE is defined when building KOS (see
+    kos/opts.h). Without it, every trace_record() call disappears and the
+    control functions below just fail with ENOSYS, so release builds pay
+    nothing for it.
+*/
+
+#ifndef __KOS_TRACE_H
+#define __KOS_TRACE_H
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kos/opts.h>
+
+/** \defgroup tracing   Tracing
+    \brief              Scheduler and interrupt event tracing
+    \ingroup            debugging
+
+    @{
+*/
+
+/** \brief  Magic value at the start of a trace dump ("KTRC"). */
+#define TRACE_MAGIC     0x4b545243
+
+/** \brief  Version of the trace dump format. */
+#define TRACE_VERSION   1
+
+/** \brief  Maximum length of a thread label in a trace dump. */
+#define TRACE_LABEL_LEN 32
+
+/** \defgroup trace_events  Event Types
+    \brief                  Types of events recorded by the tracer
+
+    The thread ID recorded with each event is that of the thread that was
+    running when it was recorded (which, for IRQ and ASIC events, is the thread
+    that was interrupted, and for switches is the thread being switched
+    out).
+
+    @{
+*/
+#define TRACE_EVT_SWITCH     1  /**< \brief Thread switched out, arg = new tid */
+#define TRACE_EVT_WAIT       2  /**< \brief Thread blocks, arg = object */
+#define TRACE_EVT_WAIT_DONE  3  /**< \brief Thread resumes, arg = object */
+#define TRACE_EVT_WAKE       4  /**< \brief Thread woken, arg = its tid */
+#define TRACE_EVT_IRQ_ENTER  5  /**< \brief IRQ entry, arg = event code */
+#define TRACE_EVT_IRQ_EXIT   6  /**< \brief IRQ exit, arg = event code */
+#define TRACE_EVT_ASIC_ENTER 7  /**< \brief ASIC event start, arg = code */
+#define TRACE_EVT_ASIC_EXIT  8  /**< \brief ASIC event end, arg = code */
+#define TRACE_EVT_USER       9  /**< \brief User-defined marker, arg = any */
+/** @} */
+
+/** \brief  A single recorded trace event. */
+typedef struct trace_event {
+    uint64_t time;      /**< \brief Timestamp, in nanoseconds since boot */
+    uint32_t arg;       /**< \brief Event-specific argument */
+    uint16_t tid;       /**< \brief Thread that was running */
+    uint16_t type;      /**< \brief Event type (see \ref trace_events) */
+} trace_event_t;
+
+/** \brief  Header at the start of a trace dump.
+
+    A dump consists of this header, followed by thread_count trace_thread_t
+    entries, followed by event_count trace_event_t entries, oldest first. All
+    fields are stored in the Dreamcast's (little endian) byte order.
+*/
+typedef struct trace_header {
+    uint32_t magic;         /**< \brief Always TRACE_MAGIC */
+    uint32_t version;       /**< \brief Always TRACE_VERSION */
+    uint32_t thread_count;  /**< \brief Number of thread entries */
+    uint32_t event_count;   /**< \brief Number of events in the dump */
+    uint32_t dropped;       /**< \brief Events overwritten before the dump */
+    uint32_t reserved;      /**< \brief Padding, always 0 */
+} trace_header_t;
+
+/** \brief  A thread's label, as stored in a trace dump. */
+typedef struct trace_thread {
+    uint32_t tid;                   /**< \brief Thread ID */
+    char label[TRACE_LABEL_LEN];    /**< \brief NUL-terminated label */
+} trace_thread_t;
+
+/** \brief  Start recording events.
+
+    This function allocates a ring buffer for the given number of events
+    (rounded up to a power of two) and starts recording into it. Once the
+    buffer is full, the oldest events are overwritten. Any previous trace is
+    discarded.
+
+    \param  count           The number of events to keep.
+    \retval 0               On success.
+    \retval -1              On error, setting errno to ENOMEM if the buffer
+                            could not be allocated, or ENOSYS if KOS was built
+                            without KOS_TRACE.
+*/
+int trace_start(size_t count);
+
+/** \brief  Stop recording events.
+
+    The recorded events are kept until trace_start() or trace_release() is
+    called, so that they can be written out with trace_dump().
+*/
+void trace_stop(void);
+
+/** \brief  Write the recorded events to a file.
+
+    Recording is paused while the dump is written, and then resumed if it was
+    active. The names of the threads that are alive at the time of the dump are
+    included, so the converter can label them.
+
+    \param  fn              The file to write to (e.g. "/pc/trace.bin").
+    \retval 0               On success.
+    \retval -1              On error, setting errno as appropriate (EINVAL if
+                            there is no trace, ENOSYS if KOS was built without
+                            KOS_TRACE).
+*/
+int trace_dump(const char *fn);
+
+/** \brief  Stop recording and free the event buffer. */
+void trace_release(void);
+
+/** \cond */
+void trace_record_event(uint16_t type, uint32_t arg);
+/** \endcond */
+
+/** \brief  Record an event.
+
+    This is what the kernel uses to record its own events, but it can be used
+    with TRACE_EVT_USER to drop markers (such as frame boundaries) into the
+    trace as well. It compiles to nothing without KOS_TRACE.
+
+    \param  type            The type of event (see \ref trace_events).
+    \param  arg             The event-specific argument.
+*/
+#ifdef KOS_TRACE
+#define trace_record(type, arg) \
+    trace_record_event((type), (uint32_t)(uintptr_t)(arg))
+#else
+#define trace_record(type, arg) ((void)0)
+#endif
+
+/** @} */
+
+__END_DECLS
+
+#endif /* __KOS_TRACE_H */
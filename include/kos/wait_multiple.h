@@ -0,0 +1,133 @@
+/* KallistiOS ##version##
+
+   include/kos/wait_multiple.h
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/** \file    kos/wait_multiple.h
+    \brief   Waiting on several objects at once.
+    \ingroup kthreads
+
+    This file contains thd_wait_multiple(), which lets a single thread block
+    until any one of a set of semaphores, condition variables, worker threads
+    or file descriptors is ready, with a single timeout, and tells it which one
+    it was. This allows an event loop to serve several sources without polling
+    them, or dedicating one thread to each of them.
+
+    It is built on genwait_wait_multiple(): the waiting thread doesn't take up
+    a spot in the wait queue of any of the objects, and is only woken up by
+    the ones that are left over once the threads actually waiting on them have
+    been served.
+
+    \see    kos/genwait.h
+*/
+
+#ifndef __KOS_WAIT_MULTIPLE_H
+#define __KOS_WAIT_MULTIPLE_H
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+#include <stddef.h>
+#include <kos/genwait.h>
+#include <kos/mutex.h>
+
+/** \brief  Maximum number of objects thd_wait_multiple() can wait on. */
+#define THD_WAIT_MAX        32
+
+/** \name   Object types
+    \brief  Types of objects thd_wait_multiple() can wait on
+
+    @{
+*/
+/** \brief  A semaphore (semaphore_t), ready when its count is positive.
+
+    The semaphore is taken (as with sem_trywait()) when it is reported.
+*/
+#define THD_WAIT_SEM        0
+
+/** \brief  A condition variable (condvar_t), ready when it is signaled.
+
+    Like with cond_wait(), the mutex given with it must be locked by the
+    caller. It is unlocked while waiting, and locked again before
+    thd_wait_multiple() returns. All condition variables in one call must use
+    the same mutex.
+*/
+#define THD_WAIT_COND       1
+
+/** \brief  A worker thread (kthread_worker_t), ready when it is idle.
+
+    \see    thd_worker_is_idle()
+*/
+#define THD_WAIT_WORKER     2
+
+/** \brief  A file descriptor, ready when any of the requested poll() events
+            is pending.
+
+    Only file systems that report their events the way sockets do can wake up
+    a waiting thread; the others are either always or never ready, as with
+    poll().
+*/
+#define THD_WAIT_FD         3
+/** @} */
+
+/** \brief   One object to wait on with thd_wait_multiple().
+
+    Use the THD_WAIT_*() initializer macros to fill these in.
+
+    \headerfile kos/wait_multiple.h
+*/
+typedef struct thd_wait {
+    int type;               /**< \brief Object type (THD_WAIT_SEM, etc) */
+    void *obj;              /**< \brief The object, unless it is an fd */
+    mutex_t *mutex;         /**< \brief Mutex of a condition variable */
+    int fd;                 /**< \brief File descriptor */
+    short events;           /**< \brief poll() events to wait for on the fd */
+    short revents;          /**< \brief poll() events pending on the fd */
+} thd_wait_t;
+
+/** \brief  Initializer for waiting on a semaphore. */
+#define THD_WAIT_SEM_INIT(sem) \
+    { .type = THD_WAIT_SEM, .obj = (sem), .fd = -1 }
+
+/** \brief  Initializer for waiting on a condition variable. */
+#define THD_WAIT_COND_INIT(cv, m) \
+    { .type = THD_WAIT_COND, .obj = (cv), .mutex = (m), .fd = -1 }
+
+/** \brief  Initializer for waiting on a worker thread to be idle. */
+#define THD_WAIT_WORKER_INIT(worker) \
+    { .type = THD_WAIT_WORKER, .obj = (worker), .fd = -1 }
+
+/** \brief  Initializer for waiting on events on a file descriptor. */
+#define THD_WAIT_FD_INIT(fd_, ev) \
+    { .type = THD_WAIT_FD, .fd = (fd_), .events = (ev) }
+
+/** \brief  Wait for any of several objects to be ready.
+
+    This function blocks the calling thread until one of the given objects is
+    ready, or the timeout expires. If several objects are ready, the first one
+    in the array is reported. Only that object is consumed (for a semaphore,
+    taken), the others are left untouched.
+
+    For file descriptors, the revents field of the reported object is set to
+    the pending events, as with poll().
+
+    \param  objs            The objects to wait on.
+    \param  count           The number of objects (up to \ref THD_WAIT_MAX).
+    \param  timeout         Maximum time to wait, in milliseconds (0 for no
+                            timeout).
+
+    \return                 The index of the ready object, or -1 on error.
+
+    \par    Error Conditions:
+    \em     ETIMEDOUT - if the timeout expired \n
+    \em     EINVAL - if count or an object is invalid, or condition variables
+                     use different (or unlocked) mutexes \n
+    \em     EPERM - if called inside an interrupt \n
+    \em     ENOTRECOVERABLE - if a semaphore was destroyed while waiting
+*/
+int thd_wait_multiple(thd_wait_t *objs, size_t count, int timeout);
+
+__END_DECLS
+
+#endif /* __KOS_WAIT_MULTIPLE_H */
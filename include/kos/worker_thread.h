@@ -33,6 +33,7 @@
 __BEGIN_DECLS
 
 #include <kos/thread.h>
+#include <stdbool.h>
 #include <sys/queue.h>
 
 struct kthread_worker;
@@ -123,6 +124,24 @@ void thd_worker_wakeup(kthread_worker_t *thd);
 */
 kthread_t *thd_worker_get_thread(kthread_worker_t *thd);
 
+/** \brief       Check if a worker thread is idle.
+    \relatesalso kthread_worker_t
+
+    A worker thread is idle when its work function isn't running, and it
+    hasn't been woken up since it last returned. Use thd_wait_multiple() to
+    wait for a worker thread to become idle.
+
+    \param  thd             The worker thread to check.
+    \return                 true if the worker thread is idle.
+    \sa thd_wait_multiple
+*/
+bool thd_worker_is_idle(kthread_worker_t *thd);
+
+/** \cond */
+/* Object woken up with genwait_wake_all() when the worker becomes idle. */
+void *thd_worker_idle_obj(kthread_worker_t *thd);
+/** \endcond */
+
 /** \brief       Add a new job to the worker thread.
     \relatesalso kthread_worker_t
 
@@ -0,0 +1,187 @@
+/* KallistiOS ##version##
+
+   mqueue.h
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/** \file    mqueue.h
+    \brief   POSIX message queues.
+    \ingroup threading_mqueue
+
+    This file contains the definitions needed for using POSIX message queues,
+    as directed by the POSIX 2008 standard (aka The Open Group Base
+    Specifications Issue 7). They are built on top of the kernel message
+    queues from kos/msgqueue.h.
+
+    There being only one process, queue names live in a flat namespace that
+    only lasts until the program exits. Names must start with a slash.
+    mq_notify() is not supported.
+
+    \see    kos/msgqueue.h
+*/
+
+#ifndef __MQUEUE_H
+#define __MQUEUE_H
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <time.h>
+
+__BEGIN_DECLS
+
+/** \defgroup threading_mqueue  Message Queues
+    \brief                      Implementation of POSIX message queues.
+    \ingroup                    threading_posix
+    @{
+*/
+
+/** \brief  Message queue descriptor type. */
+typedef int mqd_t;
+
+/** \brief  Message queue attributes.
+    \headerfile mqueue.h
+*/
+struct mq_attr {
+    long mq_flags;      /**< \brief Message queue flags (O_NONBLOCK) */
+    long mq_maxmsg;     /**< \brief Maximum number of messages */
+    long mq_msgsize;    /**< \brief Maximum message size */
+    long mq_curmsgs;    /**< \brief Number of messages currently queued */
+};
+
+struct sigevent;
+
+#ifndef MQ_PRIO_MAX
+/** \brief  Number of message priority levels. */
+#define MQ_PRIO_MAX     32768
+#endif
+
+/** \brief  Maximum number of open message queue descriptors. */
+#define MQ_OPEN_MAX     32
+
+/** \brief  Default number of messages of a new queue. */
+#define MQ_DEFAULT_MAXMSG   10
+
+/** \brief  Default message size of a new queue, in bytes. */
+#define MQ_DEFAULT_MSGSIZE  1024
+
+/** \brief   Open a message queue.
+
+    \param  name        The name of the queue, starting with a slash.
+    \param  oflag       O_RDONLY, O_WRONLY or O_RDWR, ORed with any of
+                        O_CREAT, O_EXCL and O_NONBLOCK.
+    \param  ...         With O_CREAT, the mode of the queue (ignored), and a
+                        pointer to its attributes, or NULL for the defaults.
+
+    \return             A descriptor for the queue on success, (mqd_t)-1 on
+                        error (errno will be set as appropriate).
+*/
+mqd_t mq_open(const char *name, int oflag, ...);
+
+/** \brief   Close a message queue descriptor.
+
+    \param  mqdes       The descriptor to close.
+    \retval 0           On success.
+    \retval -1          On error, errno will be set to EBADF.
+*/
+int mq_close(mqd_t mqdes);
+
+/** \brief   Remove a message queue.
+
+    The name is removed right away, but the queue itself only goes away once
+    all of the descriptors referring to it are closed.
+
+    \param  name        The name of the queue.
+    \retval 0           On success.
+    \retval -1          On error, errno will be set to ENOENT.
+*/
+int mq_unlink(const char *name);
+
+/** \brief   Send a message to a queue.
+
+    \param  mqdes       The descriptor of the queue.
+    \param  msg_ptr     The message.
+    \param  msg_len     The length of the message.
+    \param  msg_prio    The priority of the message, below MQ_PRIO_MAX.
+    \retval 0           On success.
+    \retval -1          On error, errno will be set as appropriate.
+*/
+int mq_send(mqd_t mqdes, const char *msg_ptr, size_t msg_len,
+            unsigned int msg_prio);
+
+/** \brief   Send a message to a queue, with a timeout.
+
+    \param  mqdes       The descriptor of the queue.
+    \param  msg_ptr     The message.
+    \param  msg_len     The length of the message.
+    \param  msg_prio    The priority of the message, below MQ_PRIO_MAX.
+    \param  abstime     The time (on CLOCK_REALTIME) to give up at.
+    \retval 0           On success.
+    \retval -1          On error, errno will be set as appropriate.
+*/
+int mq_timedsend(mqd_t mqdes, const char *msg_ptr, size_t msg_len,
+                 unsigned int msg_prio, const struct timespec *abstime);
+
+/** \brief   Receive the oldest of the highest priority messages of a queue.
+
+    \param  mqdes       The descriptor of the queue.
+    \param  msg_ptr     Where to store the message.
+    \param  msg_len     The size of the buffer, at least the message size of
+                        the queue.
+    \param  msg_prio    Where to store the message priority, or NULL.
+    \return             The length of the message on success, -1 on error
+                        (errno will be set as appropriate).
+*/
+ssize_t mq_receive(mqd_t mqdes, char *msg_ptr, size_t msg_len,
+                   unsigned int *msg_prio);
+
+/** \brief   Receive a message from a queue, with a timeout.
+
+    \param  mqdes       The descriptor of the queue.
+    \param  msg_ptr     Where to store the message.
+    \param  msg_len     The size of the buffer.
+    \param  msg_prio    Where to store the message priority, or NULL.
+    \param  abstime     The time (on CLOCK_REALTIME) to give up at.
+    \return             The length of the message on success, -1 on error
+                        (errno will be set as appropriate).
+*/
+ssize_t mq_timedreceive(mqd_t mqdes, char *msg_ptr, size_t msg_len,
+                        unsigned int *msg_prio,
+                        const struct timespec *abstime);
+
+/** \brief   Retrieve the attributes of a message queue.
+
+    \param  mqdes       The descriptor of the queue.
+    \param  mqstat      Where to store the attributes.
+    \retval 0           On success.
+    \retval -1          On error, errno will be set to EBADF.
+*/
+int mq_getattr(mqd_t mqdes, struct mq_attr *mqstat);
+
+/** \brief   Set the flags of a message queue descriptor.
+
+    Only O_NONBLOCK can be changed; the other attributes are ignored.
+
+    \param  mqdes       The descriptor of the queue.
+    \param  mqstat      The new attributes.
+    \param  omqstat     Where to store the previous attributes, or NULL.
+    \retval 0           On success.
+    \retval -1          On error, errno will be set to EBADF.
+*/
+int mq_setattr(mqd_t mqdes, const struct mq_attr *__restrict mqstat,
+               struct mq_attr *__restrict omqstat);
+
+/** \brief   Register for notification of new messages.
+
+    This is not supported, and always fails with ENOSYS.
+
+    \param  mqdes       The descriptor of the queue.
+    \param  notification The notification to register.
+    \retval -1          Always, with errno set to ENOSYS.
+*/
+int mq_notify(mqd_t mqdes, const struct sigevent *notification);
+
+/** @} */
+
+__END_DECLS
+
+#endif /* !__MQUEUE_H */
@@ -167,6 +167,12 @@ int pthread_mutex_destroy(pthread_mutex_t *mutex);
 #define PTHREAD_MUTEX_ROBUST        0
 #define PTHREAD_MUTEX_STALLED       1
 
+/* KOS mutexes use priority inheritance unless told otherwise, so that's the
+   default protocol here too. PTHREAD_PRIO_PROTECT is not supported. */
+#define PTHREAD_PRIO_INHERIT        0
+#define PTHREAD_PRIO_NONE           1
+#define PTHREAD_PRIO_PROTECT        2
+
 int pthread_mutex_lock(pthread_mutex_t *mutex);
 int pthread_mutex_trylock(pthread_mutex_t *mutex);
 int pthread_mutex_timedlock(pthread_mutex_t *__RESTRICT mutex,
@@ -185,6 +191,10 @@ int pthread_mutexattr_gettype(const pthread_mutexattr_t *__RESTRICT attr,
                               int *__RESTRICT type);
 int pthread_mutexattr_settype(pthread_mutexattr_t *attr, int type);
 
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *__RESTRICT attr,
+                                  int *__RESTRICT protocol);
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol);
+
 /* Dynamic package initialization */
 typedef volatile int pthread_once_t;
 #define PTHREAD_ONCE_INIT           0
@@ -16,6 +16,7 @@ typedef unsigned long int pthread_t;
 typedef struct pthread_mutexattr_t {
     int mtype;
     int robust;
+    int protocol;       /* 0 is the default, PTHREAD_PRIO_INHERIT. */
 } pthread_mutexattr_t;
 
 typedef struct pthread_rwlockattr_t {
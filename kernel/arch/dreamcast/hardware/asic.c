@@ -103,6 +103,7 @@
 #include <arch/spinlock.h>
 #include <kos/genwait.h>
 #include <kos/regfield.h>
+#include <kos/trace.h>
 #include <kos/worker_thread.h>
 
 /* XXX These based on g1ata.c and pvr.h and should be replaced by a standardized method */
@@ -168,8 +169,11 @@ static void handler_irq9(irq_t source, irq_context_t *context, void *data) {
         for(i = 0; i < ASIC_EVT_REG_HNDS; i++) {
             entry = &handlers[reg][i];
 
-            if((mask & BIT(i)) && entry->hdl != NULL)
+            if((mask & BIT(i)) && entry->hdl != NULL) {
+                trace_record(TRACE_EVT_ASIC_ENTER, (reg << 8) | i);
                 entry->hdl((reg << 8) | i, entry->data);
+                trace_record(TRACE_EVT_ASIC_EXIT, (reg << 8) | i);
+            }
         }
     }
 }
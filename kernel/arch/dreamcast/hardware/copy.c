@@ -0,0 +1,423 @@
+/* KallistiOS ##version##
+
+   copy.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* kos_copy() and friends: pick the CPU, the store queues or DMA for a copy,
+   by where it goes and how big it is.
+
+   The engines all want the destination on a 32-byte boundary and whole
+   32-byte blocks, so a copy is split into a head, up to that boundary, an
+   aligned body and a tail. The CPU does the head and tail, and the chosen
+   engine does the body. The DMAC queue handles misaligned RAM copies by
+   itself, so RAM copies are given to it whole.
+
+   VRAM is seen through two areas: the 64-bit one, where the textures from
+   pvr_mem_malloc() live, and the 32-bit linear one. Both are the VRAM
+   region, with the PVR's DMA and pvr_sq_load() told which one to use.
+   Neither takes byte writes, so the CPU writes them 16 or 32 bits at a
+   time. */
+
+#include <arch/cache.h>
+#include <arch/copy.h>
+#include <arch/irq.h>
+#include <arch/memory.h>
+#include <dc/g2bus.h>
+#include <dc/pvr.h>
+#include <dc/spu.h>
+#include <dc/sq.h>
+#include <kos/genwait.h>
+#include <kos/platform.h>
+#include <kos/thread.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pvr/pvr_internal.h"
+
+#define COPY_LINE       32
+
+/* Physical address ranges. */
+#define RAM_START       0x0c000000
+#define RAM_END         0x10000000
+#define VRAM64_START    0x04000000
+#define VRAM64_END      (VRAM64_START + PVR_RAM_SIZE)
+#define VRAM32_START    0x05000000
+#define VRAM32_END      (VRAM32_START + PVR_RAM_SIZE)
+#define SPU_START       SPU_RAM_BASE
+#define SPU_END         (SPU_START + (KOS_PLATFORM_IS_NAOMI ? 8 : 2) * 1024 * 1024)
+#define G2_START        0x00600000
+#define G2_END          0x04000000
+
+/* Conservative guesses; see the copycal example for real numbers. */
+static kos_copy_thresholds_t thresholds = {
+    .sq = {
+        [KOS_COPY_REGION_RAM]   = SIZE_MAX,
+        [KOS_COPY_REGION_VRAM]  = 64,
+        [KOS_COPY_REGION_SPU]   = 128,
+        [KOS_COPY_REGION_OTHER] = SIZE_MAX,
+    },
+    .dma = {
+        [KOS_COPY_REGION_RAM]   = 16384,
+        [KOS_COPY_REGION_VRAM]  = 8192,
+        [KOS_COPY_REGION_SPU]   = 2048,
+        [KOS_COPY_REGION_OTHER] = SIZE_MAX,
+    },
+};
+
+static inline uintptr_t copy_phys(uintptr_t addr) {
+    /* Nothing in P4 is memory any engine can reach. */
+    if(addr >= MEM_AREA_P4_BASE)
+        return 0;
+
+    return addr & MEM_AREA_CACHE_MASK;
+}
+
+kos_copy_region_t kos_copy_region(const void *addr) {
+    uintptr_t phys = copy_phys((uintptr_t)addr);
+
+    if(phys >= RAM_START && phys < RAM_END)
+        return KOS_COPY_REGION_RAM;
+
+    if((phys >= VRAM64_START && phys < VRAM64_END) ||
+       (phys >= VRAM32_START && phys < VRAM32_END))
+        return KOS_COPY_REGION_VRAM;
+
+    if(phys >= SPU_START && phys < SPU_END)
+        return KOS_COPY_REGION_SPU;
+
+    return KOS_COPY_REGION_OTHER;
+}
+
+/* The region of a whole block, which must not straddle two. */
+static kos_copy_region_t copy_region(const void *addr, size_t n) {
+    kos_copy_region_t region = kos_copy_region(addr);
+
+    if(n && kos_copy_region((const uint8_t *)addr + n - 1) != region)
+        return KOS_COPY_REGION_OTHER;
+
+    return region;
+}
+
+/* Write to G2 with 32-bit accesses where possible, without letting the G2
+   FIFO overflow. */
+static void g2_copy(uintptr_t dst, const uint8_t *src, size_t n) {
+    size_t count;
+
+    if(!((dst | (uintptr_t)src) & 3)) {
+        for(; n >= 4; n -= count, dst += count, src += count) {
+            count = n < COPY_LINE ? n & ~3 : COPY_LINE;
+
+            g2_fifo_wait();
+            g2_write_block_32((const uint32_t *)src, dst, count >> 2);
+        }
+    }
+
+    for(; n; n -= count, dst += count, src += count) {
+        count = n < COPY_LINE ? n : COPY_LINE;
+
+        g2_fifo_wait();
+        g2_write_block_8(src, dst, count);
+    }
+}
+
+/* The PVR's DMA and SQ mode for a VRAM address. */
+static pvr_dma_type_t vram_mode(const void *addr) {
+    uintptr_t phys = copy_phys((uintptr_t)addr);
+
+    return phys >= VRAM64_START && phys < VRAM64_END ?
+           PVR_DMA_VRAM64 : PVR_DMA_VRAM32;
+}
+
+/* Write to VRAM without byte writes, merging odd bytes at either end into
+   the 16-bit word they belong to. Goes around the cache, like the engines
+   doing the body. */
+static void vram_copy(uintptr_t dst, const uint8_t *src, size_t n) {
+    volatile uint16_t *d16;
+    uint32_t val;
+    size_t step;
+
+    if(dst & 1) {
+        d16 = (volatile uint16_t *)(dst - 1);
+        *d16 = (*d16 & 0x00ff) | (uint16_t)*src++ << 8;
+        dst++;
+        n--;
+    }
+
+    for(; n >= 2; dst += step, src += step, n -= step) {
+        if(!(dst & 3) && n >= 4) {
+            memcpy(&val, src, 4);
+            *(volatile uint32_t *)dst = val;
+            step = 4;
+        }
+        else {
+            *(volatile uint16_t *)dst = src[0] | (uint16_t)src[1] << 8;
+            step = 2;
+        }
+    }
+
+    if(n) {
+        d16 = (volatile uint16_t *)dst;
+        *d16 = (*d16 & 0xff00) | *src;
+    }
+}
+
+static void cpu_copy(void *dst, const void *src, size_t n) {
+    uintptr_t phys = copy_phys((uintptr_t)dst);
+
+    if(!n)
+        return;
+
+    if(phys >= G2_START && phys < G2_END)
+        g2_copy(phys | MEM_AREA_P2_BASE, src, n);
+    else if(kos_copy_region(dst) == KOS_COPY_REGION_VRAM)
+        vram_copy(phys | MEM_AREA_P2_BASE, src, n);
+    else
+        memcpy(dst, src, n);
+}
+
+static bool sq_possible(kos_copy_region_t region, uintptr_t src) {
+    return region != KOS_COPY_REGION_OTHER && !(src & 3);
+}
+
+static bool dma_possible(kos_copy_region_t region, uintptr_t src) {
+    switch(region) {
+        case KOS_COPY_REGION_RAM:
+            return true;
+
+        case KOS_COPY_REGION_VRAM:
+            return pvr_state.valid && !(src & (COPY_LINE - 1));
+
+        case KOS_COPY_REGION_SPU:
+            return !(src & (COPY_LINE - 1));
+
+        default:
+            return false;
+    }
+}
+
+static kos_copy_engine_t copy_pick(kos_copy_region_t region, uintptr_t dst,
+                                   uintptr_t src, size_t n,
+                                   unsigned int flags) {
+    size_t head = -dst & (COPY_LINE - 1);
+    bool dma, sq;
+
+    if(kos_copy_region((const void *)src) != KOS_COPY_REGION_RAM ||
+       n < head + COPY_LINE)
+        return KOS_COPY_ENGINE_CPU;
+
+    /* Where the body starts, for the engines that need an aligned one. */
+    src += head;
+
+    dma = (flags & KOS_COPY_DMA) && dma_possible(region, src);
+    sq = (flags & KOS_COPY_SQ) && sq_possible(region, src);
+
+    if(dma && n >= thresholds.dma[region])
+        return KOS_COPY_ENGINE_DMA;
+
+    if(sq && n >= thresholds.sq[region])
+        return KOS_COPY_ENGINE_SQ;
+
+    /* If the CPU isn't allowed, use whatever is, whatever the size. */
+    if(!(flags & KOS_COPY_CPU)) {
+        if(dma)
+            return KOS_COPY_ENGINE_DMA;
+
+        if(sq)
+            return KOS_COPY_ENGINE_SQ;
+    }
+
+    return KOS_COPY_ENGINE_CPU;
+}
+
+kos_copy_engine_t kos_copy_pick(void *dst, const void *src, size_t n,
+                                unsigned int flags) {
+    if(!flags)
+        flags = KOS_COPY_ANY;
+
+    return copy_pick(copy_region(dst, n), (uintptr_t)dst, (uintptr_t)src, n,
+                     flags);
+}
+
+static void copy_complete(kos_copy_op_t *op) {
+    op->done = true;
+
+    genwait_wake_all(op);
+
+    if(op->callback)
+        op->callback(op->cb_data);
+}
+
+static void copy_dma_done(void *data) {
+    copy_complete(data);
+}
+
+static void sq_body(kos_copy_region_t region, uint8_t *dst,
+                    const uint8_t *src, size_t n) {
+    switch(region) {
+        case KOS_COPY_REGION_VRAM:
+            /* The SQs and the PVR DMA share the path to VRAM. */
+            while(!pvr_dma_ready())
+                thd_pass();
+
+            pvr_sq_load(dst, src, n, vram_mode(dst));
+            break;
+
+        case KOS_COPY_REGION_SPU:
+            spu_memload_sq(copy_phys((uintptr_t)dst), (void *)src, n);
+            break;
+
+        default:
+            /* The SQs write around the cache. */
+            dma_map_dst(dst, n);
+            sq_cpy(dst, src, n);
+            break;
+    }
+}
+
+/* Start a DMA of the body of a copy, and wait for it unless op is given.
+   Fails if the engine isn't usable after all. */
+static int dma_body(kos_copy_op_t *op, kos_copy_region_t region,
+                    uint8_t *dst, const uint8_t *src, size_t n) {
+    dma_copy_t desc = { 0 }, *d = op ? &op->dma : &desc;
+
+    switch(region) {
+        case KOS_COPY_REGION_RAM:
+            memset(d, 0, sizeof(*d));
+            d->dst = dst;
+            d->src = src;
+            d->len = n;
+
+            if(op) {
+                d->callback = copy_dma_done;
+                d->cb_data = op;
+            }
+
+            if(dma_copy_submit(d))
+                return -1;
+
+            if(!op)
+                dma_copy_wait(d);
+
+            return 0;
+
+        case KOS_COPY_REGION_VRAM:
+            for(;;) {
+                while(!pvr_dma_ready())
+                    thd_pass();
+
+                if(!pvr_dma_transfer(src, (uintptr_t)dst, n, vram_mode(dst),
+                                     !op, op ? copy_dma_done : NULL, op))
+                    return 0;
+
+                if(errno != EINPROGRESS)
+                    return -1;
+            }
+
+        case KOS_COPY_REGION_SPU:
+            /* The G2 DMA leaves the cache to the caller. */
+            dcache_flush_range((uintptr_t)src, n);
+
+            for(;;) {
+                if(!spu_dma_transfer((void *)src, copy_phys((uintptr_t)dst),
+                                     n, !op, op ? copy_dma_done : NULL, op))
+                    return 0;
+
+                if(errno != EINPROGRESS)
+                    return -1;
+
+                thd_pass();
+            }
+
+        default:
+            return -1;
+    }
+}
+
+static int copy_run(kos_copy_op_t *op, void *dst, const void *src, size_t n,
+                    unsigned int flags) {
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+    kos_copy_region_t region;
+    kos_copy_engine_t engine;
+    size_t head, body;
+
+    if(!flags)
+        flags = KOS_COPY_ANY;
+
+    if(flags & ~KOS_COPY_ANY) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    region = copy_region(dst, n);
+    engine = copy_pick(region, (uintptr_t)dst, (uintptr_t)src, n, flags);
+
+    if(engine == KOS_COPY_ENGINE_DMA && region == KOS_COPY_REGION_RAM) {
+        if(!dma_body(op, region, d, s, n))
+            return 0;
+
+        engine = KOS_COPY_ENGINE_CPU;
+    }
+
+    if(engine == KOS_COPY_ENGINE_CPU) {
+        cpu_copy(d, s, n);
+    }
+    else {
+        head = -(uintptr_t)d & (COPY_LINE - 1);
+        body = (n - head) & ~(COPY_LINE - 1);
+
+        cpu_copy(d, s, head);
+        cpu_copy(d + head + body, s + head + body, n - head - body);
+
+        d += head;
+        s += head;
+
+        if(engine == KOS_COPY_ENGINE_DMA) {
+            if(!dma_body(op, region, d, s, body))
+                return 0;
+
+            /* Only fall back on the SQs if they're allowed. */
+            if(!(flags & KOS_COPY_SQ) || !sq_possible(region, (uintptr_t)s))
+                engine = KOS_COPY_ENGINE_CPU;
+        }
+
+        if(engine == KOS_COPY_ENGINE_CPU)
+            cpu_copy(d, s, body);
+        else
+            sq_body(region, d, s, body);
+    }
+
+    if(op)
+        copy_complete(op);
+
+    return 0;
+}
+
+int kos_copy(void *dst, const void *src, size_t n, unsigned int flags) {
+    return copy_run(NULL, dst, src, n, flags);
+}
+
+int kos_copy_async(kos_copy_op_t *op, void *dst, const void *src, size_t n,
+                   unsigned int flags) {
+    op->done = false;
+
+    return copy_run(op, dst, src, n, flags);
+}
+
+void kos_copy_wait(kos_copy_op_t *op) {
+    irq_disable_scoped();
+
+    while(!op->done)
+        genwait_wait(op, "kos_copy_wait", 0, NULL);
+}
+
+void kos_copy_get_thresholds(kos_copy_thresholds_t *out) {
+    *out = thresholds;
+}
+
+void kos_copy_set_thresholds(const kos_copy_thresholds_t *in) {
+    thresholds = *in;
+}
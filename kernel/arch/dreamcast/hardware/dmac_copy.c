@@ -0,0 +1,395 @@
+/* KallistiOS ##version##
+
+   dmac_copy.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* A queue of memory-to-memory copies on top of dma_transfer().
+
+   Submissions (chains of descriptors) wait in a single FIFO, and each
+   channel in use takes the next chain whenever it becomes idle. A channel
+   then works through its chain from its end-of-transfer interrupt: small
+   copies are done right there by the CPU, and the next large one is
+   programmed, after copying its unaligned ends by hand. The DMAC thus only
+   ever writes whole cache lines, which is what makes it safe to invalidate
+   the destination.
+
+   All of that happens with interrupts disabled, so a channel only does one
+   CPU copy at a time: when it meets another one right after, it leaves the
+   rest of its chain to a worker thread, which goes on with interrupts
+   enabled in between copies. */
+
+#include <arch/cache.h>
+#include <arch/dmac.h>
+#include <arch/irq.h>
+#include <arch/memory.h>
+#include <kos/cdefs.h>
+#include <kos/genwait.h>
+#include <kos/sem.h>
+#include <kos/thread.h>
+#include <kos/worker_thread.h>
+
+#include <errno.h>
+#include <string.h>
+
+#define COPY_LINE           32
+#define COPY_MIN_THRESHOLD  64
+
+/* Physical address range of the system RAM, which is all the DMAC is used
+   for here. */
+#define RAM_START           0x0c000000
+#define RAM_END             0x10000000
+
+typedef struct copy_channel {
+    dma_config_t cfg;
+    dma_copy_t *cur;
+    bool in_use;
+    bool deferred;
+} copy_channel_t;
+
+static copy_channel_t channels[] = {
+    [DMA_CHANNEL_1] = { .cfg.channel = DMA_CHANNEL_1 },
+    [DMA_CHANNEL_3] = { .cfg.channel = DMA_CHANNEL_3 },
+};
+
+static dma_copy_t *queue_head, *queue_tail;
+static size_t threshold = DMA_COPY_THRESHOLD_DEFAULT;
+static bool initted;
+static kthread_worker_t *worker;
+
+static void copy_irq(void *data);
+
+static bool dma_reachable(uintptr_t addr, size_t len) {
+    uintptr_t phys = addr & MEM_AREA_CACHE_MASK;
+
+    if(addr >= MEM_AREA_P4_BASE)
+        return false;
+
+    return phys >= RAM_START && phys + len <= RAM_END;
+}
+
+/* Pick the widest unit both addresses can be aligned to at the same time.
+   The 32-byte unit needs both to be on a cache line. */
+static dma_unitsize_t copy_unit(uintptr_t dst, uintptr_t src) {
+    uintptr_t diff = (dst ^ src) & (COPY_LINE - 1);
+
+    if(!diff)
+        return DMA_UNITSIZE_32BYTE;
+    else if(!(diff & 7))
+        return DMA_UNITSIZE_64BIT;
+    else if(!(diff & 3))
+        return DMA_UNITSIZE_32BIT;
+    else if(!(diff & 1))
+        return DMA_UNITSIZE_16BIT;
+    else
+        return DMA_UNITSIZE_8BIT;
+}
+
+static void copy_complete(dma_copy_t *desc, dma_copy_state_t state) {
+    desc->state = state;
+
+    genwait_wake_all(desc);
+
+    if(desc->callback)
+        desc->callback(desc->cb_data);
+
+    if(desc->sem)
+        sem_signal(desc->sem);
+}
+
+/* Whether desc is to be done entirely by the CPU. */
+static bool copy_by_cpu(const dma_copy_t *desc) {
+    size_t head = -(uintptr_t)desc->dst & (COPY_LINE - 1);
+
+    return desc->len < threshold || desc->len < head + COPY_LINE ||
+           !dma_reachable((uintptr_t)desc->dst, desc->len) ||
+           !dma_reachable((uintptr_t)desc->src, desc->len);
+}
+
+/* Start the copy of desc on the channel. Returns false if it was done by
+   the CPU, and is already complete. */
+static bool copy_start(copy_channel_t *ch, dma_copy_t *desc) {
+    uint8_t *dst = desc->dst;
+    const uint8_t *src = desc->src;
+    size_t len = desc->len, head, body;
+    dma_addr_t dma_dst, dma_src;
+
+    desc->state = DMA_COPY_RUNNING;
+
+    if(copy_by_cpu(desc)) {
+        memcpy(dst, src, len);
+        copy_complete(desc, DMA_COPY_DONE);
+        return false;
+    }
+
+    head = -(uintptr_t)dst & (COPY_LINE - 1);
+    body = (len - head) & ~(COPY_LINE - 1);
+
+    /* The ends are outside of the lines the DMAC writes to. */
+    memcpy(dst, src, head);
+    memcpy(dst + head + body, src + head + body, len - head - body);
+
+    dst += head;
+    src += head;
+
+    dma_src = dma_map_src(src, body);
+    dma_dst = dma_map_dst(dst, body);
+
+    ch->cfg.unit_size = copy_unit((uintptr_t)dst, (uintptr_t)src);
+
+    if(dma_transfer(&ch->cfg, dma_dst, dma_src, body, ch)) {
+        /* Can't happen, as the unit is picked to suit the addresses. */
+        memcpy(dst, src, body);
+        copy_complete(desc, DMA_COPY_DONE);
+        return false;
+    }
+
+    return true;
+}
+
+/* Run the channel until a transfer is in flight, there's nothing left to
+   do, or it's handed to the worker for a second CPU copy in a row. Called
+   with interrupts disabled. */
+static void copy_run(copy_channel_t *ch) {
+    bool cpu_done = false;
+
+    for(;;) {
+        if(!ch->cur) {
+            if(!queue_head)
+                return;
+
+            ch->cur = queue_head;
+            queue_head = queue_head->queue_next;
+
+            if(!queue_head)
+                queue_tail = NULL;
+        }
+
+        if(copy_by_cpu(ch->cur)) {
+            if(cpu_done) {
+                ch->deferred = true;
+                thd_worker_wakeup(worker);
+                return;
+            }
+
+            cpu_done = true;
+        }
+
+        if(copy_start(ch, ch->cur))
+            return;
+
+        ch->cur = ch->cur->next;
+    }
+}
+
+/* Worker: go on with the channels that had a CPU copy left to do, one pass
+   at a time so that interrupts get enabled in between. */
+static void copy_deferred(void *data) {
+    size_t i;
+
+    (void)data;
+
+    for(i = 0; i < __array_size(channels); i++) {
+        irq_disable_scoped();
+
+        if(channels[i].deferred) {
+            channels[i].deferred = false;
+            copy_run(&channels[i]);
+        }
+    }
+}
+
+static void copy_irq(void *data) {
+    copy_channel_t *ch = data;
+    dma_copy_t *desc = ch->cur;
+
+    ch->cur = desc->next;
+    copy_complete(desc, DMA_COPY_DONE);
+    copy_run(ch);
+}
+
+static bool copy_busy(void) {
+    size_t i;
+
+    if(queue_head)
+        return true;
+
+    for(i = 0; i < __array_size(channels); i++) {
+        if(channels[i].cur)
+            return true;
+    }
+
+    return false;
+}
+
+int dma_copy_init(unsigned int channels_mask) {
+    size_t i;
+
+    if(!channels_mask ||
+       (channels_mask & ~((1 << DMA_CHANNEL_1) | (1 << DMA_CHANNEL_3)))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    irq_disable_scoped();
+
+    if(copy_busy()) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    if(!worker) {
+        if(irq_inside_int()) {
+            errno = EPERM;
+            return -1;
+        }
+
+        worker = thd_worker_create(copy_deferred, NULL);
+
+        if(!worker) {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        thd_set_label(thd_worker_get_thread(worker), "dma_copy");
+    }
+
+    for(i = 0; i < __array_size(channels); i++) {
+        channels[i].in_use = !!(channels_mask & (1 << i));
+
+        channels[i].cfg.request = DMA_REQUEST_AUTO_MEM_TO_MEM;
+        channels[i].cfg.src_mode = DMA_ADDRMODE_INCREMENT;
+        channels[i].cfg.dst_mode = DMA_ADDRMODE_INCREMENT;
+
+        /* Let the CPU at the bus between units, so that it keeps running
+           while large copies go on. */
+        channels[i].cfg.transmit_mode = DMA_TRANSMITMODE_CYCLE_STEAL;
+        channels[i].cfg.callback = copy_irq;
+    }
+
+    initted = true;
+
+    return 0;
+}
+
+void dma_copy_shutdown(void) {
+    dma_copy_t *chain, *desc;
+    kthread_worker_t *thd;
+    uint32_t flags;
+    size_t i;
+
+    flags = irq_disable();
+
+    if(!initted) {
+        irq_restore(flags);
+        return;
+    }
+
+    for(i = 0; i < __array_size(channels); i++) {
+        if(!channels[i].cur)
+            continue;
+
+        if(!channels[i].deferred)
+            dma_transfer_abort(channels[i].cfg.channel);
+
+        channels[i].deferred = false;
+
+        for(desc = channels[i].cur; desc; desc = desc->next)
+            copy_complete(desc, DMA_COPY_ABORTED);
+
+        channels[i].cur = NULL;
+    }
+
+    for(chain = queue_head; chain; chain = chain->queue_next) {
+        for(desc = chain; desc; desc = desc->next)
+            copy_complete(desc, DMA_COPY_ABORTED);
+    }
+
+    queue_head = queue_tail = NULL;
+    initted = false;
+
+    thd = worker;
+    worker = NULL;
+
+    irq_restore(flags);
+
+    if(thd)
+        thd_worker_destroy(thd);
+}
+
+void dma_copy_set_threshold(size_t bytes) {
+    if(bytes < COPY_MIN_THRESHOLD)
+        bytes = COPY_MIN_THRESHOLD;
+    else if(bytes > DMA_COPY_CPU_MAX)
+        bytes = DMA_COPY_CPU_MAX;
+
+    threshold = bytes;
+}
+
+size_t dma_copy_get_threshold(void) {
+    return threshold;
+}
+
+int dma_copy_submit(dma_copy_t *chain) {
+    dma_copy_t *desc;
+    size_t i;
+
+    if(!chain) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    irq_disable_scoped();
+
+    for(desc = chain; desc; desc = desc->next) {
+        if(desc->state == DMA_COPY_QUEUED || desc->state == DMA_COPY_RUNNING) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        /* The CPU would have to do it all with interrupts disabled. */
+        if(desc->len > DMA_COPY_CPU_MAX &&
+           (!dma_reachable((uintptr_t)desc->dst, desc->len) ||
+            !dma_reachable((uintptr_t)desc->src, desc->len))) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    if(!initted && dma_copy_init(DMA_COPY_CHANNELS_DEFAULT))
+        return -1;
+
+    for(desc = chain; desc; desc = desc->next)
+        desc->state = DMA_COPY_QUEUED;
+
+    chain->queue_next = NULL;
+
+    if(queue_tail)
+        queue_tail->queue_next = chain;
+    else
+        queue_head = chain;
+
+    queue_tail = chain;
+
+    for(i = 0; i < __array_size(channels); i++) {
+        if(channels[i].in_use && !channels[i].cur)
+            copy_run(&channels[i]);
+    }
+
+    return 0;
+}
+
+int dma_copy_wait(dma_copy_t *desc) {
+    irq_disable_scoped();
+
+    while(desc->state == DMA_COPY_QUEUED || desc->state == DMA_COPY_RUNNING) {
+        if(irq_inside_int()) {
+            errno = EPERM;
+            return -1;
+        }
+
+        genwait_wait(desc, "dma_copy_wait", 0, NULL);
+    }
+
+    return 0;
+}
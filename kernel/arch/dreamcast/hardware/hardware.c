@@ -7,6 +7,7 @@
 
 #include <stdbool.h>
 #include <arch/arch.h>
+#include <arch/dmac.h>
 #include <kos/init.h>
 #include <kos/platform.h>
 #include <dc/spu.h>
@@ -100,6 +101,7 @@ void hardware_shutdown(void) {
             vid_shutdown();
             /* fallthru */
         case 1:
+            dma_copy_shutdown();
             vblank_shutdown();
             asic_shutdown();
             /* fallthru */
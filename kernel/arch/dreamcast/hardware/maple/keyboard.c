@@ -14,6 +14,7 @@
 #include <stdio.h>
 
 #include <kos/dbglog.h>
+#include <kos/ringbuf.h>
 
 #include <arch/timer.h>
 #include <dc/maple.h>
@@ -42,9 +43,7 @@ typedef struct kbd_state_private {
         You should not access this variable directly. Please use the appropriate
         function to access it. */
     kbd_q_key_t key_queue[KBD_QUEUE_SIZE];
-    size_t queue_tail;                     /**< \brief Key queue tail. */
-    size_t queue_head;                     /**< \brief Key queue head. */
-    volatile size_t queue_len;             /**< \brief Current length of queue. */
+    ringbuf_t queue;                       /**< \brief Key queue indices. */
 
     kbd_leds_t leds;                       /**< \brief Persistent LED state for toggles */
 
@@ -460,8 +459,9 @@ char kbd_key_to_ascii(kbd_key_t key, kbd_region_t region, kbd_mods_t mods, kbd_l
 }
 /* The keyboard queue (global for now) */
 static volatile int kbd_queue_active = 1;
-static volatile int kbd_queue_tail = 0, kbd_queue_head = 0;
-static volatile uint16_t  kbd_queue[KBD_QUEUE_SIZE];
+static uint16_t kbd_queue_data[KBD_QUEUE_SIZE];
+static ringbuf_t kbd_queue =
+    RINGBUF_INITIALIZER(kbd_queue_data, KBD_QUEUE_SIZE, sizeof(uint16_t));
 
 /* Turn keyboard queueing on or off. This is mainly useful if you want
    to use the keys for a game where individual keypresses don't mean
@@ -469,18 +469,19 @@ static volatile uint16_t  kbd_queue[KBD_QUEUE_SIZE];
    a new value will clear the queue. */
 void kbd_set_queue(int active) {
     if(kbd_queue_active != active) {
-        kbd_queue_head = kbd_queue_tail = 0;
+        ringbuf_clear(&kbd_queue);
     }
 
     kbd_queue_active = active;
 }
 
 /* Take a key scancode, encode it appropriately, and place it on the
-   keyboard queue. At the moment we assume no key overflows.
+   keyboard queue. Keys that don't fit in a full queue are dropped.
 
-    NOTE: We are only calling this within an IRQ context, so operations on
-          kbd_state::queue_size are essentially atomic. */
+    NOTE: We are only calling this within an IRQ context, which makes it the
+          only producer of both queues, so they need no locking. */
 static int kbd_enqueue(kbd_state_private_t *state, kbd_key_t keycode) {
+    kbd_q_key_t qkey;
     uint16_t ascii = 0;
 
     /* Don't bother with bad keycodes. */
@@ -488,13 +489,10 @@ static int kbd_enqueue(kbd_state_private_t *state, kbd_key_t keycode) {
         return 0;
 
     /* Queue the key up on the device-specific queue. */
-    if(state->queue_len < KBD_QUEUE_SIZE) {
-        state->key_queue[state->queue_head].key = keycode;
-        state->key_queue[state->queue_head].leds = state->base.cond.leds;
-        state->key_queue[state->queue_head].mods = state->base.cond.modifiers;
-        state->queue_head = (state->queue_head + 1) & (KBD_QUEUE_SIZE - 1);
-        ++state->queue_len;
-    }
+    qkey.key = keycode;
+    qkey.leds = state->base.cond.leds;
+    qkey.mods = state->base.cond.modifiers;
+    ringbuf_push(&state->queue, &qkey);
 
     /* If queueing is turned off, don't bother with the global queue. */
     if(!kbd_queue_active)
@@ -508,27 +506,23 @@ static int kbd_enqueue(kbd_state_private_t *state, kbd_key_t keycode) {
         ascii = ((uint16_t)keycode) << 8;
 
     /* Ok... now do the enqueue to the global queue */
-    kbd_queue[kbd_queue_head] = ascii;
-    kbd_queue_head = (kbd_queue_head + 1) & (KBD_QUEUE_SIZE - 1);
+    ringbuf_push(&kbd_queue, &ascii);
 
     return 0;
 }
 
 /* Take a key off the key queue, or return KBD_QUEUE_END if there is none waiting */
 int kbd_get_key(void) {
-    int rv;
+    uint16_t rv;
 
     /* If queueing isn't active, there won't be anything to get */
     if(!kbd_queue_active)
         return KBD_QUEUE_END;
 
     /* Check available */
-    if(kbd_queue_head == kbd_queue_tail)
+    if(!ringbuf_pop(&kbd_queue, &rv))
         return KBD_QUEUE_END;
 
-    rv = kbd_queue[kbd_queue_tail];
-    kbd_queue_tail = (kbd_queue_tail + 1) & (KBD_QUEUE_SIZE - 1);
-
     return rv;
 }
 
@@ -551,18 +545,8 @@ int kbd_queue_pop(maple_device_t *dev, bool xlat) {
     kbd_q_key_t rv;
     char ascii;
 
-    const int irqs = irq_disable();
-
-    if(!state->queue_len) {
-        irq_restore(irqs);
+    if(!ringbuf_pop(&state->queue, &rv))
         return KBD_QUEUE_END;
-    }
-
-    rv = state->key_queue[state->queue_tail];
-    state->queue_tail = (state->queue_tail + 1) & (KBD_QUEUE_SIZE - 1);
-    --state->queue_len;
-
-    irq_restore(irqs);
 
     if(!xlat)
         return (int)(rv.key | (rv.mods.raw << 8) | (rv.leds.raw << 16));
@@ -785,6 +769,7 @@ static void kbd_periodic(maple_driver_t *drv) {
 
 static int kbd_attach(maple_driver_t *drv, maple_device_t *dev) {
     kbd_state_t *state = (kbd_state_t *)dev->status;
+    kbd_state_private_t *pstate = (kbd_state_private_t *)dev->status;
     int d = 0;
 
     (void)drv;
@@ -804,8 +789,10 @@ static int kbd_attach(maple_driver_t *drv, maple_device_t *dev) {
     }
 
     /* Zero out private state data */
-    memset(state + sizeof(kbd_state_t), 0,
+    memset((uint8_t *)pstate + sizeof(kbd_state_t), 0,
             sizeof(kbd_state_private_t) - sizeof(kbd_state_t));
+    ringbuf_init(&pstate->queue, pstate->key_queue, KBD_QUEUE_SIZE,
+                 sizeof(kbd_q_key_t));
 
     return 0;
 }
@@ -0,0 +1,350 @@
+/* KallistiOS ##version##
+
+   pvr_clip.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* Near plane clipping of strips and modifier volumes, sent with Direct
+   Rendering. See dc/pvr/pvr_clip.h for the big picture.
+
+   Strips are walked one triangle at a time, with a bit per vertex of the
+   current triangle telling whether it's in front of the plane. Triangles
+   entirely in front continue the output strip, and since whether the next
+   one will too only depends on the next vertex, the end of a strip is
+   known when its last vertex is sent. Clipped triangles go through
+   Sutherland-Hodgman against the one plane, and are sent as strips of
+   three or four vertices.
+
+   Modifier volumes are lists of triangles, and the PVR wants a different
+   header before the last one, so one triangle is held back until the next
+   is known. The cut is closed with a fan from the first point on it over
+   every edge the cut leaves on the plane: the PVR decides what's inside a
+   volume by counting the surfaces crossed, so the fan doesn't have to be
+   a clean triangulation.
+
+   This file can also be built on a host (see the pvr_clip example), in
+   which case the includer provides the PVR types, the Direct Rendering
+   macros and clip_rcp(). */
+
+#ifndef PVR_CLIP_HOST
+#include <dc/fmath.h>
+#include <dc/pvr.h>
+#include <kos/cdefs.h>
+
+/* 1/w for w > 0, with fsrra rather than a division. */
+#define clip_rcp(w)     frsqrt((w) * (w))
+#endif
+
+#define CLIP_EOL        (PVR_CMD_VERTEX_EOL ^ PVR_CMD_VERTEX)
+
+typedef struct clip_point {
+    float x, y, w;
+} clip_point_t;
+
+/* Blend two packed colors, a channel at a time: t = 0 gives a. */
+static inline uint32_t clip_lerp_argb(uint32_t a, uint32_t b, float t) {
+    uint32_t f = (uint32_t)(t * 256.0f), rb, ag;
+
+    rb = (a & 0x00ff00ff) * (256 - f) + (b & 0x00ff00ff) * f;
+    ag = ((a >> 8) & 0x00ff00ff) * (256 - f) + ((b >> 8) & 0x00ff00ff) * f;
+
+    return ((rb >> 8) & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+
+/* Where the edge from in (in front) to out (behind) crosses the plane. */
+static __always_inline float clip_t(float in_w, float out_w, float near) {
+    return (in_w - near) * clip_rcp(in_w - out_w);
+}
+
+static __always_inline void clip_lerp(pvr_vertex_t *dst, const pvr_vertex_t *in,
+                                      const pvr_vertex_t *out, float near,
+                                      bool txr) {
+    float t = clip_t(in->z, out->z, near);
+
+    dst->x = in->x + t * (out->x - in->x);
+    dst->y = in->y + t * (out->y - in->y);
+    dst->z = near;
+    dst->argb = clip_lerp_argb(in->argb, out->argb, t);
+
+    if(txr) {
+        dst->u = in->u + t * (out->u - in->u);
+        dst->v = in->v + t * (out->v - in->v);
+        dst->oargb = clip_lerp_argb(in->oargb, out->oargb, t);
+    }
+}
+
+static __always_inline void clip_put(pvr_dr_state_t *dr, const pvr_vertex_t *src,
+                                     uint32_t flags, bool txr) {
+    pvr_vertex_t *dst = pvr_dr_target(*dr);
+    float rw = clip_rcp(src->z);
+
+    dst->flags = flags;
+    dst->x = src->x * rw;
+    dst->y = src->y * rw;
+    dst->z = rw;
+    dst->argb = src->argb;
+
+    if(txr) {
+        dst->u = src->u;
+        dst->v = src->v;
+        dst->oargb = src->oargb;
+    }
+
+    pvr_dr_commit(dst);
+}
+
+/* Clip the triangle a, b, c, whose vertices in front of the plane are given
+   by the bits of in, and send what's left as a strip of its own. */
+static __always_inline size_t clip_tri(pvr_dr_state_t *dr,
+                                       const pvr_vertex_t *a,
+                                       const pvr_vertex_t *b,
+                                       const pvr_vertex_t *c,
+                                       unsigned int in, float near, bool txr) {
+    const pvr_vertex_t *tri[3] = { a, b, c }, *poly[4], *cur, *next;
+    pvr_vertex_t cut[2];
+    unsigned int i, n = 0, ncut = 0;
+
+    for(i = 0; i < 3; i++) {
+        cur = tri[i];
+        next = tri[i == 2 ? 0 : i + 1];
+
+        if(in & (1 << i))
+            poly[n++] = cur;
+
+        switch((in >> i | in << (3 - i)) & 3) {
+            case 1:
+                clip_lerp(&cut[ncut], cur, next, near, txr);
+                poly[n++] = &cut[ncut++];
+                break;
+
+            case 2:
+                clip_lerp(&cut[ncut], next, cur, near, txr);
+                poly[n++] = &cut[ncut++];
+                break;
+        }
+    }
+
+    clip_put(dr, poly[0], PVR_CMD_VERTEX, txr);
+    clip_put(dr, poly[1], PVR_CMD_VERTEX, txr);
+
+    if(n == 4)
+        clip_put(dr, poly[3], PVR_CMD_VERTEX, txr);
+
+    clip_put(dr, poly[2], PVR_CMD_VERTEX_EOL, txr);
+
+    return n;
+}
+
+static __always_inline size_t clip_strip(pvr_dr_state_t *dr,
+                                         const pvr_vertex_t *v, size_t n,
+                                         float near, bool txr) {
+    unsigned int in;
+    size_t k, sent = 0;
+    bool open = false, last;
+
+    if(n < 3)
+        return 0;
+
+    /* Bit 0 for v[k - 2], 1 for v[k - 1] and 2 for v[k]. */
+    in = (v[0].z >= near) | (v[1].z >= near) << 1;
+
+    for(k = 2; k < n; k++, in >>= 1) {
+        in |= (v[k].z >= near) << 2;
+
+        if(in == 7) {
+            if(!open) {
+                /* Triangles of odd rank are wound the other way in a
+                   strip; a degenerate one first keeps them so. */
+                if(k & 1) {
+                    clip_put(dr, &v[k - 2], PVR_CMD_VERTEX, txr);
+                    sent++;
+                }
+
+                clip_put(dr, &v[k - 2], PVR_CMD_VERTEX, txr);
+                clip_put(dr, &v[k - 1], PVR_CMD_VERTEX, txr);
+                sent += 2;
+                open = true;
+            }
+
+            last = k == n - 1 || !(v[k + 1].z >= near);
+            clip_put(dr, &v[k], last ? PVR_CMD_VERTEX_EOL : PVR_CMD_VERTEX,
+                     txr);
+            sent++;
+            open = !last;
+        }
+        else if(in) {
+            if(k & 1)
+                sent += clip_tri(dr, &v[k - 1], &v[k - 2], &v[k],
+                                 (in & 4) | (in & 1) << 1 | (in & 2) >> 1,
+                                 near, txr);
+            else
+                sent += clip_tri(dr, &v[k - 2], &v[k - 1], &v[k], in, near,
+                                 txr);
+        }
+    }
+
+    return sent;
+}
+
+static __always_inline size_t clip_strips(pvr_dr_state_t *dr,
+                                          const pvr_vertex_t *verts,
+                                          size_t count, float near, bool txr) {
+    size_t start, end, sent = 0;
+
+    for(start = 0; start < count; start = end) {
+        for(end = start; end < count;) {
+            if(verts[end++].flags & CLIP_EOL)
+                break;
+        }
+
+        sent += clip_strip(dr, verts + start, end - start, near, txr);
+    }
+
+    return sent;
+}
+
+size_t pvr_clip_txr(pvr_dr_state_t *dr, const pvr_vertex_t *verts,
+                    size_t count, float near) {
+    return clip_strips(dr, verts, count, near, true);
+}
+
+size_t pvr_clip_gouraud(pvr_dr_state_t *dr, const pvr_vertex_t *verts,
+                        size_t count, float near) {
+    return clip_strips(dr, verts, count, near, false);
+}
+
+typedef struct clip_mod {
+    pvr_dr_state_t *dr;
+    const pvr_mod_hdr_t *hdr;
+    clip_point_t held[3];
+    size_t sent;
+    clip_point_t hub;
+    bool have_hub;
+} clip_mod_t;
+
+static void clip_mod_hdr(clip_mod_t *m, bool last) {
+    const uint32_t *s = (const uint32_t *)m->hdr;
+    uint32_t *d = (uint32_t *)pvr_dr_target(*m->dr);
+
+    d[0] = s[0];
+    d[1] = last ? s[1] : s[1] & ~PVR_TA_PM1_MODIFIERINST;
+    d[2] = s[2];
+    d[3] = s[3];
+    d[4] = s[4];
+    d[5] = s[5];
+    d[6] = s[6];
+    d[7] = s[7];
+    pvr_dr_commit(d);
+}
+
+/* Send the held triangle, which takes two store queues. */
+static void clip_mod_send(clip_mod_t *m) {
+    const clip_point_t *p = m->held;
+    float *d = (float *)pvr_dr_target(*m->dr);
+    float ra = clip_rcp(p[0].w), rb = clip_rcp(p[1].w);
+    float rc = clip_rcp(p[2].w);
+
+    *(uint32_t *)d = PVR_CMD_VERTEX_EOL;
+    d[1] = p[0].x * ra;
+    d[2] = p[0].y * ra;
+    d[3] = ra;
+    d[4] = p[1].x * rb;
+    d[5] = p[1].y * rb;
+    d[6] = rb;
+    d[7] = p[2].x * rc;
+    pvr_dr_commit(d);
+
+    d = (float *)pvr_dr_target(*m->dr);
+    d[0] = p[2].y * rc;
+    d[1] = rc;
+    pvr_dr_commit(d);
+}
+
+static void clip_mod_tri(clip_mod_t *m, const clip_point_t *a,
+                         const clip_point_t *b, const clip_point_t *c) {
+    if(m->sent) {
+        if(m->sent == 1)
+            clip_mod_hdr(m, false);
+
+        clip_mod_send(m);
+    }
+
+    m->held[0] = *a;
+    m->held[1] = *b;
+    m->held[2] = *c;
+    m->sent++;
+}
+
+static void clip_mod_cut(const clip_point_t *in, const clip_point_t *out,
+                         clip_point_t *dst, float near) {
+    float t = clip_t(in->w, out->w, near);
+
+    dst->x = in->x + t * (out->x - in->x);
+    dst->y = in->y + t * (out->y - in->y);
+    dst->w = near;
+}
+
+size_t pvr_clip_mod(pvr_dr_state_t *dr, const pvr_mod_hdr_t *hdr,
+                    const pvr_modifier_vol_t *tris, size_t count, float near) {
+    clip_mod_t m = { .dr = dr, .hdr = hdr };
+    clip_point_t tri[3], poly[4], seg[2];
+    unsigned int in, i, n, nseg;
+    size_t t;
+
+    for(t = 0; t < count; t++) {
+        tri[0] = (clip_point_t){ tris[t].ax, tris[t].ay, tris[t].az };
+        tri[1] = (clip_point_t){ tris[t].bx, tris[t].by, tris[t].bz };
+        tri[2] = (clip_point_t){ tris[t].cx, tris[t].cy, tris[t].cz };
+
+        in = (tri[0].w >= near) | (tri[1].w >= near) << 1 |
+             (tri[2].w >= near) << 2;
+
+        if(in == 7) {
+            clip_mod_tri(&m, &tri[0], &tri[1], &tri[2]);
+            continue;
+        }
+        else if(!in) {
+            continue;
+        }
+
+        for(i = 0, n = 0, nseg = 0; i < 3; i++) {
+            if(in & (1 << i))
+                poly[n++] = tri[i];
+
+            switch((in >> i | in << (3 - i)) & 3) {
+                case 1:
+                    clip_mod_cut(&tri[i], &tri[i == 2 ? 0 : i + 1], &poly[n],
+                                 near);
+                    seg[nseg++] = poly[n++];
+                    break;
+
+                case 2:
+                    clip_mod_cut(&tri[i == 2 ? 0 : i + 1], &tri[i], &poly[n],
+                                 near);
+                    seg[nseg++] = poly[n++];
+                    break;
+            }
+        }
+
+        clip_mod_tri(&m, &poly[0], &poly[1], &poly[2]);
+
+        if(n == 4)
+            clip_mod_tri(&m, &poly[0], &poly[2], &poly[3]);
+
+        /* Close the cut. */
+        if(!m.have_hub) {
+            m.hub = seg[0];
+            m.have_hub = true;
+        }
+        else {
+            clip_mod_tri(&m, &m.hub, &seg[0], &seg[1]);
+        }
+    }
+
+    if(m.sent) {
+        clip_mod_hdr(&m, true);
+        clip_mod_send(&m);
+    }
+
+    return m.sent;
+}
@@ -18,6 +18,7 @@
 
 #include <stdbool.h>
 #include <kos/mutex.h>
+#include <kos/arena.h>
 
 /**** State stuff ***************************************************/
 
@@ -176,6 +177,8 @@ typedef struct {
 
     // Memory pointers / buffers
     pvr_dma_buffers_t   dma_buffers[2];     // DMA buffers (if any)
+    arena_frame_t       *frame_arena;       // Per-frame arena for DMA buffers (if any)
+    uint32              arena_vertbuf_size[PVR_OPB_COUNT]; // Per-frame size of arena-backed buffers
     pvr_ta_buffers_t    ta_buffers[2];      // TA buffers
     pvr_frame_buffers_t frame_buffers[2];   // Frame buffers
     uint32              texture_base;       // Start of texture RAM
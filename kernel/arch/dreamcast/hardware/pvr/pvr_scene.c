@@ -52,7 +52,18 @@ void *pvr_set_vertbuf(pvr_list_t list, void *buffer, size_t len) {
     assert(!(len & 63));
 
     // Save the old value.
-    oldbuf = pvr_state.dma_buffers[0].base[list];
+    oldbuf = pvr_state.arena_vertbuf_size[list] ? NULL :
+             pvr_state.dma_buffers[0].base[list];
+
+    // With a frame arena, the buffers are allocated by pvr_scene_begin().
+    if(!buffer && len && pvr_state.frame_arena) {
+        pvr_state.arena_vertbuf_size[list] = len / 2;
+        pvr_state.dma_buffers[0].base[list] = NULL;
+        pvr_state.dma_buffers[1].base[list] = NULL;
+        return oldbuf;
+    }
+
+    pvr_state.arena_vertbuf_size[list] = 0;
 
     // Write new values.
     pvr_state.dma_buffers[0].base[list] = (uint8 *)buffer;
@@ -67,6 +78,49 @@ void *pvr_set_vertbuf(pvr_list_t list, void *buffer, size_t len) {
     return oldbuf;
 }
 
+void pvr_set_frame_arena(arena_frame_t *frame) {
+    int i;
+
+    assert(pvr_state.dma_mode);
+
+    pvr_state.frame_arena = frame;
+
+    if(frame)
+        return;
+
+    // Drop the buffers that came from the old arena.
+    for(i = 0; i < PVR_OPB_COUNT; i++) {
+        if(pvr_state.arena_vertbuf_size[i]) {
+            pvr_state.arena_vertbuf_size[i] = 0;
+            pvr_state.dma_buffers[0].base[i] = NULL;
+            pvr_state.dma_buffers[1].base[i] = NULL;
+        }
+    }
+}
+
+/* Carve this frame's vertex buffers out of the frame arena. The other half
+   of the arena holds the buffers of the previous frame, which are either
+   being DMAed, or were done with by the time pvr_scene_finish() got the DMA
+   lock; the ones from two frames ago are certainly done with. */
+static void pvr_alloc_arena_vertbufs(void) {
+    volatile pvr_dma_buffers_t *b = pvr_state.dma_buffers + pvr_state.ram_target;
+    arena_t *arena;
+    uint32 size;
+    int i;
+
+    arena_frame_flip(pvr_state.frame_arena);
+    arena = arena_frame_get(pvr_state.frame_arena);
+
+    for(i = 0; i < PVR_OPB_COUNT; i++) {
+        if(!(size = pvr_state.arena_vertbuf_size[i]))
+            continue;
+
+        // If it doesn't fit, the list will be submitted directly.
+        b->base[i] = arena_alloc(arena, size);
+        b->size[i] = b->base[i] ? size : 0;
+    }
+}
+
 void *pvr_vertbuf_tail(pvr_list_t list) {
     uint8 *bufbase;
 
@@ -131,6 +185,9 @@ void pvr_scene_begin(void) {
 
     // Clear these out in case we're using DMA.
     if(pvr_state.dma_mode) {
+        if(pvr_state.frame_arena)
+            pvr_alloc_arena_vertbufs();
+
         for(i = 0; i < PVR_OPB_COUNT; i++) {
             pvr_state.dma_buffers[pvr_state.ram_target].ptr[i] = 0;
         }
@@ -0,0 +1,143 @@
+/* KallistiOS ##version##
+
+   pvr_xform.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* Second stage of the vertex pipeline: assemble triangles from the pool
+   written by mat_transform_pvr(), cull them with the outcodes, set aside
+   the ones crossing the near bound, and send the rest on. The triangles set
+   aside are transformed again for the clipper, which needs them before the
+   divide. */
+
+#include <dc/matrix.h>
+#include <dc/pvr.h>
+#include <kos/cdefs.h>
+
+static __always_inline void xform_put(pvr_vertex_t *dst,
+                                      const pvr_vertex_t *src,
+                                      uint32_t flags) {
+    const uint32_t *s = (const uint32_t *)src;
+    uint32_t *d = (uint32_t *)dst;
+
+    /* Whole words, so that the store queues are written without a call. */
+    d[0] = flags;
+    d[1] = s[1];
+    d[2] = s[2];
+    d[3] = s[3];
+    d[4] = s[4];
+    d[5] = s[5];
+    d[6] = s[6];
+    d[7] = s[7];
+}
+
+static __always_inline void xform_emit(pvr_dr_state_t *dr, pvr_vertex_t **buf,
+                                       const pvr_vertex_t *src,
+                                       uint32_t flags) {
+    pvr_vertex_t *dst;
+
+    if(dr) {
+        dst = pvr_dr_target(*dr);
+        xform_put(dst, src, flags);
+        pvr_dr_commit(dst);
+    }
+    else {
+        xform_put((*buf)++, src, flags);
+    }
+}
+
+static __always_inline size_t xform_tris(pvr_dr_state_t *dr, pvr_vertex_t *buf,
+                                         const pvr_vertex_t *verts,
+                                         const uint8_t *codes,
+                                         const uint16_t *indices, size_t count,
+                                         pvr_xform_side_t *side) {
+    unsigned int i0, i1, i2, c0, c1, c2;
+    size_t t, sent = 0;
+    uint32_t *tri;
+
+    for(t = 0; t < count; t++) {
+        if(indices) {
+            i0 = indices[0];
+            i1 = indices[1];
+            i2 = indices[2];
+            indices += 3;
+        }
+        else {
+            i0 = t * 3;
+            i1 = i0 + 1;
+            i2 = i0 + 2;
+        }
+
+        c0 = codes[i0];
+        c1 = codes[i1];
+        c2 = codes[i2];
+
+        /* All three beyond the same bound. */
+        if(c0 & c1 & c2)
+            continue;
+
+        if(__unlikely((c0 | c1 | c2) & MAT_CLIP_NEAR)) {
+            if(side && side->count < side->max) {
+                tri = side->tris + side->count++ * 3;
+                tri[0] = i0;
+                tri[1] = i1;
+                tri[2] = i2;
+            }
+
+            continue;
+        }
+
+        xform_emit(dr, &buf, &verts[i0], PVR_CMD_VERTEX);
+        xform_emit(dr, &buf, &verts[i1], PVR_CMD_VERTEX);
+        xform_emit(dr, &buf, &verts[i2], PVR_CMD_VERTEX_EOL);
+        sent++;
+    }
+
+    return sent;
+}
+
+size_t pvr_xform_tris_dr(pvr_dr_state_t *dr, const pvr_vertex_t *verts,
+                         const uint8_t *codes, const uint16_t *indices,
+                         size_t count, pvr_xform_side_t *side) {
+    return xform_tris(dr, NULL, verts, codes, indices, count, side);
+}
+
+size_t pvr_xform_tris_buf(pvr_vertex_t *buf, const pvr_vertex_t *verts,
+                          const uint8_t *codes, const uint16_t *indices,
+                          size_t count, pvr_xform_side_t *side) {
+    return xform_tris(NULL, buf, verts, codes, indices, count, side);
+}
+
+size_t pvr_xform_side_verts(const mat_vstream_t *in,
+                            const pvr_xform_side_t *side, pvr_vertex_t *out) {
+    const uint8_t *pos = (const uint8_t *)in->pos;
+    const uint8_t *uv = (const uint8_t *)in->uv;
+    const uint8_t *argb = (const uint8_t *)in->argb;
+    const float *p, *t;
+    float x, y, z, w;
+    size_t i, n = side->count * 3;
+    unsigned int v;
+
+    for(i = 0; i < n; i++) {
+        v = side->tris[i];
+        p = (const float *)(pos + v * in->pos_stride);
+        t = (const float *)(uv + v * in->uv_stride);
+
+        x = p[0];
+        y = p[1];
+        z = p[2];
+        w = 1.0f;
+        mat_trans_nodiv(x, y, z, w);
+
+        out[i].flags = i % 3 == 2 ? PVR_CMD_VERTEX_EOL : PVR_CMD_VERTEX;
+        out[i].x = x;
+        out[i].y = y;
+        out[i].z = w;
+        out[i].u = t[0];
+        out[i].v = t[1];
+        out[i].argb = *(const uint32_t *)(argb + v * in->argb_stride);
+        out[i].oargb = 0;
+    }
+
+    return n;
+}
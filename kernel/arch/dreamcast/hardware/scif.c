@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <kos/dbgio.h>
+#include <kos/ringbuf.h>
 #include <arch/arch.h>
 #include <arch/spinlock.h>
 #include <arch/irq.h>
@@ -52,37 +53,37 @@ void scif_set_parameters(int baud, int fifo) {
     serial_fifo = fifo;
 }
 
-/* Receive ring buffer */
+/* Receive ring buffer. The IRQ handler is the only producer and scif_read()
+   the only consumer, so it needs no locking. */
 #define BUFSIZE 1024
 static uint8 recvbuf[BUFSIZE];
-static int rb_head = 0, rb_tail = 0, rb_cnt = 0;
-static int rb_paused = 0;
+static ringbuf_t rb;
+static volatile int rb_paused = 0;
 
 static void rb_reset(void) {
-    rb_head = rb_tail = rb_cnt = rb_paused = 0;
+    ringbuf_init(&rb, recvbuf, BUFSIZE, 1);
+    rb_paused = 0;
 }
 
-static void rb_push_char(int c) {
-    recvbuf[rb_head] = c;
-    rb_head = (rb_head + 1) % BUFSIZE;
-    rb_cnt++;
+static void rb_push_char(uint8 c) {
+    ringbuf_push(&rb, &c);
 
     /* If we're within 32 bytes of being out of space, pause for
        the moment. */
-    if(!rb_paused && (BUFSIZE - rb_cnt) < 32) {
+    if(!rb_paused && ringbuf_space(&rb) < 32) {
         rb_paused = 1;
         SCSPTR2 = 0x20;     /* Set CTS=0 */
     }
 }
 
 static int rb_pop_char(void) {
-    int c;
-    c = recvbuf[rb_tail];
-    rb_tail = (rb_tail + 1) % BUFSIZE;
-    rb_cnt--;
+    uint8 c;
+
+    if(!ringbuf_pop(&rb, &c))
+        return -1;
 
     /* If we're paused and clear again, re-enabled receiving. */
-    if(rb_paused && (BUFSIZE - rb_cnt) >= 64) {
+    if(rb_paused && ringbuf_space(&rb) >= 64) {
         rb_paused = 0;
         SCSPTR2 = 0x00;
     }
@@ -90,14 +91,6 @@ static int rb_pop_char(void) {
     return c;
 }
 
-/* static int rb_space_free(void) {
-    return BUFSIZE - rb_cnt;
-} */
-
-static int rb_space_used(void) {
-    return rb_cnt;
-}
-
 
 /* Serial receive and receive error interrupts. When this is triggered we
    must look for available data and error conditions, and clear them all
@@ -144,7 +137,7 @@ static void scif_data_irq(irq_t src, irq_context_t *cxt, void *data) {
     /* Check for received data available. */
     if(SCFSR2 & 3) {
         while(SCFDR2 & 0x1f) {
-            int c = SCFRDR2;
+            uint8 c = SCFRDR2;
             rb_push_char(c);
         }
 
@@ -278,13 +271,13 @@ int scif_read(void) {
     }
 
     if(scif_irq_usage) {
+        int c;
+
         /* Do we have anything ready? */
-        if(rb_space_used() <= 0) {
+        if((c = rb_pop_char()) < 0)
             errno = EAGAIN;
-            return -1;
-        }
-        else
-            return rb_pop_char();
+
+        return c;
     }
     else {
         int c;
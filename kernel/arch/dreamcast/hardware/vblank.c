@@ -10,6 +10,7 @@
 
 #include <arch/irq.h>
 #include <dc/vblank.h>
+#include <kos/thread.h>
 
 /*
    Functions to multiplex the vblank IRQ out to N client routines.
@@ -33,6 +34,9 @@ static void vblank_handler(uint32 src, void *data) {
 
     (void)data;
 
+    /* Release any periodic threads that are due. */
+    thd_period_vblank();
+
     TAILQ_FOREACH(t, &vblhnds, listent) {
         t->handler(src, t->data);
     }
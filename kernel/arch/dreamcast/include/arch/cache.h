@@ -81,7 +81,8 @@ void dcache_flush_range(uintptr_t start, size_t count);
 
     \note
     dcache_flush_range() is faster than dcache_flush_all() if the count
-    param is 66560 or less.
+    param is 66560 or less (33280 with OCRAM enabled, as only the half of
+    the cache not used as RAM is walked then).
 */
 void dcache_flush_all(void);
 
@@ -104,7 +105,7 @@ void dcache_purge_range(uintptr_t start, size_t count);
 
     \note
     dcache_purge_range() is faster than dcache_purge_all() if the count
-    param is 39936 or less.
+    param is 39936 or less (19968 with OCRAM enabled).
 */
 void dcache_purge_all(void);
 
@@ -125,7 +126,11 @@ void dcache_purge_all(void);
     \param  count           The size of the temporary buffer, which can be 
                             either 8 KB or 16 KB, depending on cache 
                             configuration - 8 KB buffer with OCRAM enabled, 
-                            otherwise 16 KB.
+                            otherwise 16 KB. With OCRAM, address bit 12 is
+                            not part of the cache index, so an 8 KB buffer
+                            must start on an odd 4 KB boundary (bit 12 set)
+                            to reach every cache line; a 16 KB buffer works
+                            in both configurations.
 
 */
 void dcache_purge_all_with_buffer(uintptr_t start, size_t count);
@@ -0,0 +1,190 @@
+/* KallistiOS ##version##
+
+   arch/dreamcast/include/arch/copy.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    arch/copy.h
+    \brief   Size-aware copies to RAM, VRAM and sound RAM.
+    \ingroup system_copy
+
+    There are many ways to move a block of data on the Dreamcast: the CPU,
+    the store queues (sq_cpy(), pvr_sq_load(), spu_memload_sq()), the SH4's
+    DMAC (dma_copy_submit()), the PVR's DMA (pvr_dma_transfer()) and the G2
+    DMA (spu_dma_transfer()). Which one is fastest depends on where the data
+    goes and on how much of it there is.
+
+    kos_copy() and kos_copy_async() work that out: the destination is
+    classified into a region, and the engine is picked by comparing the size
+    of the copy with a pair of thresholds for that region. The engines
+    needing aligned buffers are only given the aligned middle of a copy; the
+    CPU takes care of the ends. The default thresholds are conservative, and
+    can be replaced with measured ones with kos_copy_set_thresholds(); the
+    copycal example prints them for the machine (or emulator) it runs on.
+
+    \author KallistiOS Team
+*/
+
+#ifndef __ARCH_COPY_H
+#define __ARCH_COPY_H
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <arch/dmac.h>
+
+/** \defgroup system_copy   Copies
+    \brief                  Copies that pick the fastest engine
+    \ingroup                system
+
+    @{
+*/
+
+/** \brief   Memory regions, as far as copies are concerned. */
+typedef enum kos_copy_region {
+    KOS_COPY_REGION_RAM,    /**< System RAM, through any area. */
+    KOS_COPY_REGION_VRAM,   /**< PVR texture memory (64 or 32-bit area). */
+    KOS_COPY_REGION_SPU,    /**< Sound RAM. */
+    KOS_COPY_REGION_OTHER,  /**< Anything else; only the CPU is used. */
+    KOS_COPY_REGION_COUNT
+} kos_copy_region_t;
+
+/** \brief   Engines used for copies. */
+typedef enum kos_copy_engine {
+    KOS_COPY_ENGINE_CPU,    /**< Plain CPU copy. */
+    KOS_COPY_ENGINE_SQ,     /**< Store queues. */
+    KOS_COPY_ENGINE_DMA,    /**< The DMA engine for the region. */
+} kos_copy_engine_t;
+
+/** \name    Copy flags
+    \brief   Restrict the engines that may be used.
+
+    Passing 0 allows them all. Whatever the flags, the CPU copies the parts
+    of a copy other engines can't handle.
+
+    @{
+*/
+#define KOS_COPY_CPU    (1 << KOS_COPY_ENGINE_CPU)  /**< \brief Allow the CPU */
+#define KOS_COPY_SQ     (1 << KOS_COPY_ENGINE_SQ)   /**< \brief Allow the SQs */
+#define KOS_COPY_DMA    (1 << KOS_COPY_ENGINE_DMA)  /**< \brief Allow DMA */
+#define KOS_COPY_ANY    (KOS_COPY_CPU | KOS_COPY_SQ | KOS_COPY_DMA)
+/** @} */
+
+/** \brief   Size thresholds for picking an engine.
+
+    For each region, copies of at least sq[region] bytes use the store
+    queues, and copies of at least dma[region] bytes use DMA. SIZE_MAX
+    disables an engine for a region.
+*/
+typedef struct kos_copy_thresholds {
+    size_t sq[KOS_COPY_REGION_COUNT];   /**< Where the SQs take over. */
+    size_t dma[KOS_COPY_REGION_COUNT];  /**< Where DMA takes over. */
+} kos_copy_thresholds_t;
+
+/** \brief   Asynchronous copy completion callback.
+
+    This is called once the copy is complete, in an interrupt context if it
+    was done by DMA.
+*/
+typedef void (*kos_copy_callback_t)(void *data);
+
+/** \brief   Asynchronous copy.
+
+    Set the callback (if any), and leave the rest alone. It must stay valid
+    until the copy completes.
+*/
+typedef struct kos_copy_op {
+    kos_copy_callback_t callback;   /**< Called when done, or NULL. */
+    void *cb_data;                  /**< Parameter of the callback. */
+
+    volatile bool done;             /**< True once complete (read only). */
+
+    /** \cond */
+    dma_copy_t dma;
+    /** \endcond */
+} kos_copy_op_t;
+
+/** \brief   Classify an address.
+
+    \param  addr            The address to classify.
+    \return                 The region the address belongs to.
+*/
+kos_copy_region_t kos_copy_region(const void *addr);
+
+/** \brief   Find which engine a copy would use.
+
+    \param  dst             The destination of the copy.
+    \param  src             The source of the copy.
+    \param  n               The size of the copy.
+    \param  flags           The engines allowed (KOS_COPY_*), or 0.
+    \return                 The engine that would move the bulk of the data.
+*/
+kos_copy_engine_t kos_copy_pick(void *dst, const void *src, size_t n,
+                                unsigned int flags);
+
+/** \brief   Copy a block of memory with the fastest engine.
+
+    This blocks until the copy is complete. The source and destination may
+    not overlap. A source outside of RAM is always copied by the CPU.
+
+    \param  dst             The destination of the copy.
+    \param  src             The source of the copy.
+    \param  n               The number of bytes to copy.
+    \param  flags           The engines allowed (KOS_COPY_*), or 0.
+    \retval 0               On success.
+    \retval -1              On error, with errno set to EINVAL if the flags
+                            are invalid.
+*/
+int kos_copy(void *dst, const void *src, size_t n, unsigned int flags);
+
+/** \brief   Start copying a block of memory with the fastest engine.
+
+    When the copy is done by DMA, this returns as soon as it is started.
+    Otherwise, it is done on the spot, and the callback is called before
+    this returns. This may not be called from an interrupt.
+
+    \param  op              The copy operation, with its callback set.
+    \param  dst             The destination of the copy.
+    \param  src             The source of the copy.
+    \param  n               The number of bytes to copy.
+    \param  flags           The engines allowed (KOS_COPY_*), or 0.
+    \retval 0               On success.
+    \retval -1              On error, with errno set to EINVAL if the flags
+                            are invalid.
+
+    \sa kos_copy_wait()
+*/
+int kos_copy_async(kos_copy_op_t *op, void *dst, const void *src, size_t n,
+                   unsigned int flags);
+
+/** \brief   Wait for an asynchronous copy to complete.
+
+    \param  op              The copy operation to wait for.
+*/
+void kos_copy_wait(kos_copy_op_t *op);
+
+/** \brief   Get the thresholds used to pick an engine.
+
+    \param  thresholds      Where to store the thresholds.
+*/
+void kos_copy_get_thresholds(kos_copy_thresholds_t *thresholds);
+
+/** \brief   Set the thresholds used to pick an engine.
+
+    RAM copies given to DMA still go through dma_copy_submit(), which does
+    the ones under its own threshold (see dma_copy_set_threshold()) with the
+    CPU.
+
+    \param  thresholds      The new thresholds.
+*/
+void kos_copy_set_thresholds(const kos_copy_thresholds_t *thresholds);
+
+/** @} */
+
+__END_DECLS
+
+#endif /* __ARCH_COPY_H */
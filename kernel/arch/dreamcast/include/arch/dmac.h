@@ -20,9 +20,12 @@
 #include <sys/cdefs.h>
 __BEGIN_DECLS
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
+#include <kos/sem.h>
+
 /** \defgroup dmac  DMA Controller API
     \brief          API to use the SH4's DMA Controller
     \ingroup        system
@@ -260,6 +263,164 @@ size_t dma_transfer_get_remaining(dma_channel_t channel);
 */
 void dma_transfer_abort(dma_channel_t channel);
 
+/** \defgroup dmac_copy  DMA copy queue
+    \brief               Background memory-to-memory copies
+    \ingroup             dmac
+
+    This API moves data from RAM to RAM in the background, on the DMA
+    channels that the rest of the system leaves free. Copies are described by
+    dma_copy_t descriptors, which are owned by the caller and must stay valid
+    until they complete.
+
+    Several descriptors can be chained with their \p next field and
+    submitted at once; the copies of a chain are done in order, one after the
+    other, so a copy may read what an earlier one of the same chain wrote.
+    Separate submissions are independent, and may run at the same time on
+    different channels.
+
+    The data cache is written back for the source and invalidated for the
+    destination with dma_map_src() and dma_map_dst(). Copies smaller than the
+    threshold (see dma_copy_set_threshold()), or that involve memory the DMAC
+    can't reach (such as OCRAM), are done by the CPU instead, in turn with the
+    rest of the queue. So are the ends of copies whose destination isn't
+    aligned to a cache line: the DMAC only ever writes whole lines, which
+    allows the destination to be invalidated safely.
+
+    The queue runs with interrupts disabled, so the CPU only takes copies of
+    up to DMA_COPY_CPU_MAX bytes: larger copies the DMAC can't reach are
+    refused, and the threshold can't be set above that. At most one such copy
+    is done at a time: when several follow each other in a chain, the rest are
+    left to a worker thread, which enables interrupts in between them.
+
+    Source and destination may not overlap.
+
+    @{
+*/
+
+/** \brief   State of a DMA copy descriptor. */
+typedef enum dma_copy_state {
+    DMA_COPY_IDLE,      /**< Never submitted. */
+    DMA_COPY_QUEUED,    /**< Waiting for a channel. */
+    DMA_COPY_RUNNING,   /**< Being copied. */
+    DMA_COPY_DONE,      /**< Completed. */
+    DMA_COPY_ABORTED,   /**< Dropped by dma_copy_shutdown(). */
+} dma_copy_state_t;
+
+/** \brief   DMA copy descriptor.
+
+    Fill in the first fields, and leave the rest to the queue. The callback
+    and semaphore are both optional; they are invoked from an interrupt
+    context, once this descriptor completes.
+*/
+typedef struct dma_copy {
+    void *dst;                  /**< Destination of the copy. */
+    const void *src;            /**< Source of the copy. */
+    size_t len;                 /**< Number of bytes to copy. */
+    struct dma_copy *next;      /**< Next copy in the chain, or NULL. */
+    dma_callback_t callback;    /**< Called with cb_data when done, or NULL. */
+    void *cb_data;              /**< Parameter of the callback. */
+    semaphore_t *sem;           /**< Signalled when done, or NULL. */
+
+    volatile dma_copy_state_t state;    /**< Current state (read only). */
+
+    /** \cond */
+    struct dma_copy *queue_next;
+    /** \endcond */
+} dma_copy_t;
+
+/** \brief   Channels used for copies by default: only channel #3. */
+#define DMA_COPY_CHANNELS_DEFAULT   (1 << DMA_CHANNEL_3)
+
+/** \brief   Default size below which copies are done by the CPU. */
+#define DMA_COPY_THRESHOLD_DEFAULT  2048
+
+/** \brief   Largest copy the CPU does at once, with interrupts disabled. */
+#define DMA_COPY_CPU_MAX            4096
+
+/** \brief   Select the DMA channels used for copies.
+
+    This is optional: the first submission uses DMA_COPY_CHANNELS_DEFAULT.
+    Channel #1 can be added to run two copies at once, but only if nothing
+    else (such as the SCI driver in DMA mode) uses it.
+
+    The first call also creates the worker thread that takes over runs of CPU
+    copies, so it can't be made from an interrupt.
+
+    \param  channels        A mask of (1 << channel), for DMA_CHANNEL_1 and
+                            DMA_CHANNEL_3 only.
+    \retval 0               On success.
+    \retval -1              On error, with errno set to EINVAL for a bad mask,
+                            EBUSY if copies are in flight, EPERM if called
+                            from an interrupt before the worker thread is
+                            created, or ENOMEM if it can't be.
+*/
+int dma_copy_init(unsigned int channels);
+
+/** \brief   Abort all copies and release the DMA channels.
+
+    Copies in flight or queued are marked DMA_COPY_ABORTED, and their waiters,
+    callbacks and semaphores are notified as if they had completed.
+*/
+void dma_copy_shutdown(void);
+
+/** \brief   Set the size below which copies are done by the CPU.
+
+    Setting up a transfer and maintaining the cache costs about as much as
+    copying a few KB with the CPU, so DMA is only worth it for large copies.
+
+    \param  bytes           The new threshold, at least 64 and at most
+                            DMA_COPY_CPU_MAX.
+*/
+void dma_copy_set_threshold(size_t bytes);
+
+/** \brief   Get the size below which copies are done by the CPU.
+
+    \return                 The current threshold.
+*/
+size_t dma_copy_get_threshold(void);
+
+/** \brief   Submit a chain of copies.
+
+    The copies are queued, and this returns right away, after doing at most
+    one small copy per idle channel with the CPU. The descriptors may not
+    be touched until they complete.
+
+    \param  chain           The first descriptor of the chain.
+    \retval 0               On success.
+    \retval -1              On error, with errno set to EINVAL if the chain is
+                            NULL, one of its descriptors is already queued
+                            or running, or copies more than DMA_COPY_CPU_MAX
+                            bytes from or to memory the DMAC can't reach.
+                            Nothing is submitted then. The first submission
+                            may also fail as dma_copy_init() does.
+
+    \sa dma_copy_wait()
+*/
+int dma_copy_submit(dma_copy_t *chain);
+
+/** \brief   Wait for a copy to complete.
+
+    To wait for a whole chain, wait for its last descriptor. This returns
+    right away for a descriptor that was never submitted.
+
+    \param  desc            The descriptor to wait for.
+    \retval 0               On success.
+    \retval -1              On error, with errno set to EPERM if called from
+                            an interrupt while the copy is still pending.
+*/
+int dma_copy_wait(dma_copy_t *desc);
+
+/** \brief   Check whether a copy is complete.
+
+    \param  desc            The descriptor to check.
+    \return                 True if the copy is done (or was aborted).
+*/
+static inline bool dma_copy_done(const dma_copy_t *desc) {
+    return desc->state >= DMA_COPY_DONE;
+}
+
+/** @} */
+
 /** @} */
 
 __END_DECLS
@@ -0,0 +1,63 @@
+/* KallistiOS ##version##
+
+   arch/dreamcast/include/arch/fiber.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    arch/fiber.h
+    \brief   Architecture support for fibers.
+    \ingroup fibers
+
+    The functions in this file implement the register switching used by the
+    fibers in kos/fiber.h. They are implemented in fiberswitch.s.
+
+    This should not be exported or accessed externally.
+
+    \author KallistiOS Team
+*/
+
+#ifndef __ARCH_FIBER_H
+#define __ARCH_FIBER_H
+
+#include <kos/cdefs.h>
+__BEGIN_DECLS
+
+#include <kos/fiber.h>
+
+/** \brief  Build the initial frame for a new fiber.
+
+    This function pushes a register frame onto a new fiber's stack, so that
+    switching to it for the first time calls fiber_entry() with the fiber as
+    its argument.
+
+    \param  stack_top       The (8-byte aligned) top of the fiber's stack.
+    \param  fiber           The fiber to pass to fiber_entry().
+    \return                 The stack pointer to switch to.
+*/
+void *arch_fiber_prepare(void *stack_top, kfiber_t *fiber);
+
+/** \brief  Switch from one fiber stack to another.
+
+    This function saves the callee-saved registers on the current stack,
+    stores the stack pointer in *save_sp and restores the registers saved on
+    the new stack, returning into whatever switched away from it (or into
+    fiber_entry() for a new fiber).
+
+    \param  save_sp         Where to store the current stack pointer.
+    \param  new_sp          The stack pointer to switch to.
+*/
+void arch_fiber_switch(void **save_sp, void *new_sp);
+
+/** \brief  Entry point of every fiber. Never returns.
+
+    This is implemented in the portable fiber code and called by the
+    architecture code when a fiber first runs.
+
+    \param  fiber           The fiber that is starting.
+*/
+void fiber_entry(kfiber_t *fiber) __noreturn;
+
+__END_DECLS
+
+#endif  /* __ARCH_FIBER_H */
@@ -106,7 +106,7 @@ __BEGIN_DECLS
 
 #define INIT_CDROM          0x00100000  /**< \brief Enable CD-ROM support */
 
-#define INIT_OCRAM          0x10000000  /**< \brief Use half of the dcache as RAM */
+#define INIT_OCRAM          0x10000000  /**< \brief Use half of the dcache as RAM (see arch/ocram.h) */
 #define INIT_NO_DCLOAD      0x20000000  /**< \brief Disable dcload */
 
 /** @} */
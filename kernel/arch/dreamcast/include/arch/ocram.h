@@ -0,0 +1,126 @@
+/* KallistiOS ##version##
+
+   arch/dreamcast/include/arch/ocram.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    arch/ocram.h
+    \brief   Operand cache RAM (OCRAM) scratchpad.
+    \ingroup system_ocram
+
+    The SH4 can use half of its 16 KB operand cache as 8 KB of on-chip RAM,
+    which is accessed with no wait states and never misses. This is enabled
+    by passing INIT_OCRAM to KOS_INIT_FLAGS(); the other half keeps working
+    as a (now 8 KB) data cache.
+
+    The RAM is made of two banks of 4 KB, which are not contiguous:
+    OCRAM_BANK0 and OCRAM_BANK1. It is a good fit for small, very hot data
+    such as matrix stacks, lookup tables, or the stack of a thread doing
+    heavy math. It can be used in two ways:
+
+    - Variables can be placed there at link time with the \ref __ocram
+      attribute. They live at the start of the first bank, and are zeroed
+      at startup, like BSS (initializers aren't allowed).
+    - The rest can be handed out at run time with ocram_alloc() and
+      ocram_free().
+
+    OCRAM is only reachable by the CPU: it can't be the source or destination
+    of a DMA transfer or of the store queues, and the cache management
+    functions in arch/cache.h must not be used on it.
+
+    \author KallistiOS Team
+*/
+
+#ifndef __ARCH_OCRAM_H
+#define __ARCH_OCRAM_H
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \defgroup system_ocram  OCRAM
+    \brief                  Operand cache used as on-chip RAM
+    \ingroup                system
+
+    @{
+*/
+
+/** \brief  Total size of the OCRAM, in bytes. */
+#define OCRAM_SIZE          8192
+
+/** \brief  Size of one OCRAM bank, in bytes. */
+#define OCRAM_BANK_SIZE     4096
+
+/** \brief  Address of the first OCRAM bank. */
+#define OCRAM_BANK0         0x7c001000
+
+/** \brief  Address of the second OCRAM bank. */
+#define OCRAM_BANK1         0x7c003000
+
+/** \brief  Granularity (and alignment) of OCRAM allocations. */
+#define OCRAM_BLOCK_SIZE    32
+
+/** \brief  Place a variable in OCRAM.
+
+    Variables with this attribute are zeroed at startup, and may not have an
+    initializer. Their total size may not exceed OCRAM_BANK_SIZE; the linker
+    will complain otherwise. They are only accessible when the program was
+    started with INIT_OCRAM.
+
+    \code
+    static matrix_t mat_stack[16] __ocram;
+    \endcode
+*/
+#define __ocram __attribute__((section(".bss.ocram"), aligned(8)))
+
+/** \brief  Check whether OCRAM is enabled.
+
+    \return                 Non-zero if the operand cache is split into cache
+                            and RAM (see INIT_OCRAM).
+*/
+static inline int ocram_enabled(void) {
+    /* CCR.ORA */
+    return !!(*(volatile uint32_t *)0xff00001c & 0x20);
+}
+
+/** \brief  Allocate memory from the OCRAM.
+
+    The allocation is rounded up to OCRAM_BLOCK_SIZE, and can't be larger
+    than a bank.
+
+    \param  size            The number of bytes to allocate.
+    \return                 The memory, aligned to OCRAM_BLOCK_SIZE, or NULL
+                            on failure, with errno set to ENODEV if OCRAM is
+                            not enabled, or ENOMEM.
+*/
+void *ocram_alloc(size_t size);
+
+/** \brief  Free memory allocated by ocram_alloc().
+
+    \param  ptr             The memory to free, or NULL.
+*/
+void ocram_free(void *ptr);
+
+/** \brief  Retrieve the number of free bytes in the OCRAM.
+
+    As allocations can't span both banks, the largest possible allocation
+    may be smaller than this.
+
+    \return                 The number of free bytes, or 0 if OCRAM is not
+                            enabled.
+*/
+size_t ocram_available(void);
+
+/** \cond */
+/* Called at startup to clear the __ocram variables. */
+void ocram_init(void);
+/** \endcond */
+
+/** @} */
+
+__END_DECLS
+
+#endif /* __ARCH_OCRAM_H */
@@ -55,6 +55,21 @@ void arch_stk_trace(int n);
 */
 void arch_stk_trace_at(uint32_t fp, size_t n);
 
+/** \brief  Collect return addresses from a frame pointer.
+
+    This function walks the stack like arch_stk_trace_at(), but stores the
+    return addresses instead of printing them, so that they can be recorded
+    cheaply (by the allocation tracer, for instance).
+
+    \param  fp              The frame pointer to start from.
+    \param  addrs           Where to store the return addresses, innermost
+                            first.
+    \param  count           The maximum number of addresses to store.
+    \return                 The number of addresses stored, which is 0 if
+                            frame pointers are not enabled.
+*/
+size_t arch_stk_trace_collect(uintptr_t fp, uintptr_t *addrs, size_t count);
+
 /** @} */
 
 __END_DECLS
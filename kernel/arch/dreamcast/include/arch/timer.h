@@ -47,8 +47,9 @@ __BEGIN_DECLS
 
     \warning
     Under normal circumstances, all 3 TMU channels are reserved by KOS for
-    various OS-related purposes. If you need a free general-purpose interval
-    timer, consider using the Watchdog Timer.
+    various OS-related purposes (TMU1 by the sampling profiler in
+    dc/profiler.h). If you need a free general-purpose interval timer,
+    consider using the Watchdog Timer.
 
     \note
     90% of the time, you will never have a need to directly interact with this
@@ -82,8 +83,8 @@ __BEGIN_DECLS
 /** \brief  SH4 Timer Channel 1.
 
     \warning
-    This timer channel is used for the timer_spin_sleep() function, which also
-    backs the kthread, C, C++, and POSIX sleep functions.
+    This timer channel is used by the sampling profiler (see dc/profiler.h)
+    while it is running.
 */
 #define TMU1    1
 
@@ -335,15 +336,19 @@ uint64_t timer_ns_gettime64(void);
     sleeping, used by the KOS, C, C++, and POSIX threading APIs.
 
     \warning
-    This API and its underlying functionality are using \ref TMU1, so any
-    direct manipulation of it will interfere with the API's proper functioning.
+    This API and its underlying functionality are using \ref TMU2, through the
+    timestamp API, so any direct manipulation of it will interfere with the
+    API's proper functioning.
 */
 
 /** \brief  Spin-loop sleep function.
     \ingroup tmu_sleep
 
     This function is meant as a very accurate delay function, even if threading
-    and interrupts are disabled. It uses \ref TMU1 to sleep.
+    and interrupts are disabled. It busy-waits on the counter of \ref TMU2,
+    counting its ticks itself rather than relying on the timestamp API,
+    whose seconds are kept by the TMU2 interrupt. If \ref TMU2 isn't running
+    yet (or anymore), it is started for the delay and stopped again.
 
     \param  ms              The number of milliseconds to sleep.
 */
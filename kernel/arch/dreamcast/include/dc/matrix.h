@@ -27,6 +27,7 @@
 #include <sys/cdefs.h>
 __BEGIN_DECLS
 
+#include <stdint.h>
 #include <dc/vector.h>
 
 /** \defgroup math_matrices Matrices
@@ -132,6 +133,75 @@ void mat_transform(const vector_t *invecs, vector_t *outvecs,
 */
 void mat_transform_sq(void *input, void *output, int veccnt);
 
+/** \name   Clip outcodes
+    \brief  Bits of the outcodes written by mat_transform_pvr().
+
+    A bit is set when the vertex is on the outer side of the matching bound.
+    @{
+*/
+#define MAT_CLIP_LEFT   0x01    /**< \brief x < xmin */
+#define MAT_CLIP_RIGHT  0x02    /**< \brief x > xmax */
+#define MAT_CLIP_TOP    0x04    /**< \brief y < ymin */
+#define MAT_CLIP_BOTTOM 0x08    /**< \brief y > ymax */
+#define MAT_CLIP_NEAR   0x10    /**< \brief w < near */
+/** @} */
+
+/** \brief  Vertex stream for mat_transform_pvr().
+
+    Each attribute is read through its own pointer, advancing by its own
+    stride (in bytes) after each vertex, so that both interleaved and
+    separate arrays can be used. A stride of 0 gives every vertex the same
+    value, such as a single color for a whole mesh.
+
+    The clip bounds are in screen coordinates, as the matrix leaves them
+    after the perspective divide. The assembly depends on the layout of this
+    structure.
+*/
+typedef struct mat_vstream {
+    const float *pos;       /**< \brief Positions (x, y, z) */
+    const float *uv;        /**< \brief Texture coordinates (u, v) */
+    const uint32_t *argb;   /**< \brief Colors */
+    int pos_stride;         /**< \brief Bytes between positions */
+    int uv_stride;          /**< \brief Bytes between texture coordinates */
+    int argb_stride;        /**< \brief Bytes between colors */
+    int strip_len;          /**< \brief Vertices per strip, at least 1 */
+    float xmin;             /**< \brief Left clip bound */
+    float xmax;             /**< \brief Right clip bound */
+    float ymin;             /**< \brief Top clip bound */
+    float ymax;             /**< \brief Bottom clip bound */
+    float near;             /**< \brief Smallest w that is not clipped */
+} mat_vstream_t;
+
+/** \brief  Transform a vertex stream into PVR vertices.
+
+    This function transforms a stream of vertices by the current internal
+    matrix, and writes them out as finished pvr_vertex_t records: x and y
+    are divided by w, z is set to 1/w (computed with fsrra), and the flags
+    are PVR_CMD_VERTEX, or PVR_CMD_VERTEX_EOL on every strip_len'th vertex.
+    The oargb field is set to 0.
+
+    Alongside, an outcode (a set of MAT_CLIP_* bits) is written for each
+    vertex. The outcodes are computed on the homogeneous coordinates, before
+    the divide, so they are right even for vertices behind the eye. The
+    records of vertices with MAT_CLIP_NEAR set are not usable as they are;
+    pvr_xform_tris_dr() uses the outcodes to cull triangles and set aside the
+    ones that need clipping.
+
+    Each record is written with a pref after it, so the output may be a store
+    queue address (sq_lock() must have been called beforehand), to send the
+    vertices straight to the TA, or a 32-byte aligned buffer in RAM, such as
+    a DMA vertex buffer or a pool for pvr_xform_tris_dr().
+
+    \param  in              The vertex stream.
+    \param  output          The output pointer (SQ address or RAM).
+    \param  codes           Where to store the outcodes, one byte per vertex.
+    \param  veccnt          The number of vertices to transform, at least 1.
+
+    \sa     pvr_xform_tris_dr(), pvr_xform_side_verts()
+*/
+void mat_transform_pvr(const mat_vstream_t *in, void *output, uint8_t *codes,
+                       int veccnt);
+
 /** \brief  Macro to transform a single vertex by the internal matrix.
 
     This macro is an inline assembly operation to transform a single vertex. It
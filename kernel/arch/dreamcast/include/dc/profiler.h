@@ -0,0 +1,125 @@
+/* KallistiOS ##version##
+
+   arch/dreamcast/include/dc/profiler.h
+   Copyright (C) 2025 KallistiOS Team
+
+*/
+
+/** \file    dc/profiler.h
+    \brief   Statistical PC-sampling profiler
+    \ingroup profiler
+
+    This file contains a sampling profiler, which periodically records where
+    the CPU was executing, without the program having to be instrumented.
+*/
+
+#ifndef __DC_PROFILER_H
+#define __DC_PROFILER_H
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** \defgroup   profiler    Sampling profiler
+    \brief                  Statistical PC-sampling profiler
+    \ingroup                debugging
+
+    The sampling profiler uses \ref TMU1 to interrupt the CPU at a fixed rate,
+    and each time records the interrupted PC, the PR (return address) register
+    and the ID of the thread that was running into a preallocated buffer.
+
+    The buffer can then be written to a file (for instance on /pc, when using
+    dcload) with profiler_dump() and turned into gprof-style flat and call
+    graph reports, or folded stacks for flame graphs, by the dcprof utility in
+    utils/dcprof.
+
+    Since only PC and PR are recorded, the call graph is limited to the
+    function that was executing and (for leaf functions, which don't save PR)
+    its caller. This is normally plenty to find the hot spots of a program.
+
+    @{
+*/
+
+/** \brief  Magic value at the start of a profile dump ("KPRF"). */
+#define PROFILER_MAGIC      0x4b505246
+
+/** \brief  Version of the profile dump format. */
+#define PROFILER_VERSION    1
+
+/** \brief  Maximum length of a thread label in a profile dump. */
+#define PROFILER_LABEL_LEN  32
+
+/** \brief  A single profiler sample. */
+typedef struct profiler_sample {
+    uint32_t pc;        /**< \brief Interrupted program counter */
+    uint32_t pr;        /**< \brief Interrupted procedure (return) register */
+    uint32_t tid;       /**< \brief Thread that was running */
+} profiler_sample_t;
+
+/** \brief  Header at the start of a profile dump.
+
+    A dump consists of this header, followed by thread_count
+    profiler_thread_t entries, followed by sample_count profiler_sample_t
+    entries. All fields are stored in the Dreamcast's (little endian) byte
+    order.
+*/
+typedef struct profiler_header {
+    uint32_t magic;         /**< \brief Always PROFILER_MAGIC */
+    uint32_t version;       /**< \brief Always PROFILER_VERSION */
+    uint32_t rate;          /**< \brief Samples per second */
+    uint32_t thread_count;  /**< \brief Number of thread entries */
+    uint32_t sample_count;  /**< \brief Number of samples in the dump */
+    uint32_t dropped;       /**< \brief Samples lost to a full buffer */
+} profiler_header_t;
+
+/** \brief  A thread's label, as stored in a profile dump. */
+typedef struct profiler_thread {
+    uint32_t tid;                       /**< \brief Thread ID */
+    char label[PROFILER_LABEL_LEN];     /**< \brief NUL-terminated label */
+} profiler_thread_t;
+
+/** \brief  Start sampling.
+
+    This function allocates room for the given number of samples and starts
+    taking samples at the given rate. Once the buffer is full, further samples
+    are counted but dropped. Any previous profile is discarded.
+
+    \param  count           The number of samples to keep.
+    \param  rate            The number of samples to take per second.
+    \retval 0               On success.
+    \retval -1              On error, setting errno to EINVAL for a zero count
+                            or rate, or ENOMEM if the buffer could not be
+                            allocated.
+*/
+int profiler_start(size_t count, unsigned int rate);
+
+/** \brief  Stop sampling.
+
+    The samples are kept until profiler_start() or profiler_release() is
+    called, so that they can be written out with profiler_dump().
+*/
+void profiler_stop(void);
+
+/** \brief  Write the samples taken to a file.
+
+    Sampling is paused while the file is written, and then resumed if it was
+    active. The names of the threads that are alive at the time of the dump
+    are included, so that the reports can show them.
+
+    \param  fn              The file to write to (e.g. "/pc/gmon.kprf").
+    \retval 0               On success.
+    \retval -1              On error, setting errno as appropriate (EINVAL if
+                            there is no profile).
+*/
+int profiler_dump(const char *fn);
+
+/** \brief  Stop sampling and free the sample buffer. */
+void profiler_release(void);
+
+/** @} */
+
+__END_DECLS
+
+#endif /* __DC_PROFILER_H */
@@ -47,6 +47,7 @@ __BEGIN_DECLS
 #include <arch/cache.h>
 #include <dc/sq.h>
 #include <kos/img.h>
+#include <kos/arena.h>
 #include <kos/regfield.h>
 
 /*  Note: This file also #includes headers from dc/pvr/. They are mostly
@@ -1145,15 +1146,46 @@ int pvr_vertex_dma_enabled(void);
 
     \param  list            The primitive list to set the buffer for.
     \param  buffer          The location of the buffer in main RAM. This must be
-                            aligned to a 32-byte boundary.
+                            aligned to a 32-byte boundary. If a frame arena was
+                            set with pvr_set_frame_arena(), this may be NULL to
+                            have the buffer allocated from it on each frame.
     \param  len             The length of the buffer. This must be a multiple of
                             64, and must be at least 128 (even if you're not
                             using the list).
     
     \return                 The old buffer location (if any)
+
+    \sa pvr_set_frame_arena()
 */
 void *pvr_set_vertbuf(pvr_list_t list, void *buffer, size_t len);
 
+/** \brief   Allocate vertex buffers from a frame arena.
+    \ingroup pvr_vertex_dma
+
+    Instead of keeping a buffer set aside for each list for the whole time the
+    PVR is in use, the buffers can be carved out of a double-buffered frame
+    arena. On each pvr_scene_begin(), the arena is flipped, and the lists set
+    up with pvr_set_vertbuf(list, NULL, len) get len / 2 bytes from the arena
+    of the new frame. The buffers of the previous frame stay around while they
+    are DMAed to the TA.
+
+    Whatever is left in the arena of the current frame can be used by the
+    program for its own per-frame data, which is all freed at once on the next
+    scene but one. If a list doesn't fit in the arena, it is submitted directly
+    for that frame instead.
+
+    \warning
+    The arena is flipped by pvr_scene_begin(), so it must not be flipped or
+    reset by the program.
+
+    \param  frame           The frame arena to use, or NULL to stop using one.
+                            Lists previously set up to use the arena won't have
+                            a vertex buffer anymore.
+
+    \sa pvr_set_vertbuf(), arena_frame_init()
+*/
+void pvr_set_frame_arena(arena_frame_t *frame);
+
 /** \brief   Retrieve a pointer to the current output location in the DMA buffer
              for the requested list.
     \ingroup pvr_vertex_dma
@@ -1607,6 +1639,8 @@ pvr_ptr_t pvr_get_front_buffer(void);
 #include "pvr/pvr_fog.h"
 #include "pvr/pvr_pal.h"
 #include "pvr/pvr_txr.h"
+#include "pvr/pvr_xform.h"
+#include "pvr/pvr_clip.h"
 
 __END_DECLS
 
@@ -0,0 +1,107 @@
+/* KallistiOS ##version##
+
+   dc/pvr/pvr_clip.h
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/** \file       dc/pvr/pvr_clip.h
+    \brief      Near plane clipping for Direct Rendering
+    \ingroup    pvr_clip
+
+    \author KallistiOS Team
+*/
+
+#ifndef __DC_PVR_PVR_CLIP_H
+#define __DC_PVR_PVR_CLIP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+/** \defgroup   pvr_clip    Near Plane Clipping
+    \brief                  Clip primitives against the near plane
+    \ingroup                pvr_scene_mgmt
+
+    The PVR clips polygons against the sides of the screen by itself, but
+    not against the near plane: a vertex behind the eye has no meaningful
+    screen coordinates. These functions clip primitives given before the
+    perspective divide, do the divide, and send the result to the TA with
+    Direct Rendering (see pvr_dr_init()), in a list opened while not using
+    DMA, after the polygon or modifier volume header.
+
+    The vertices are taken in homogeneous form, in the usual structures:
+    x and y as they come out of the matrix (mat_trans_nodiv()), and w where
+    z would be. The PVR only needs 1/w for depth, so the matrix's z is not
+    used. A vertex is in front of the near plane when w >= near; with the
+    matrix from mat_perspective(), w is 1 - z in eye space.
+
+    Triangle strips are clipped one triangle at a time. Runs of triangles
+    entirely in front of the plane stay in one strip, and each clipped
+    triangle becomes a strip of its own. The winding of every triangle is
+    kept, so culling still works. Edges are always interpolated from their
+    inner end, so the triangles on both sides of an edge get the same new
+    vertex, and no cracks open up.
+
+    @{
+*/
+
+/** \brief   Clip and send textured triangle strips.
+
+    The position, texture coordinates, base and offset colors are
+    interpolated.
+
+    \param  dr              A state variable initialized with pvr_dr_init().
+    \param  verts           The vertices, with w in z. Each strip ends with a
+                            vertex flagged PVR_CMD_VERTEX_EOL.
+    \param  count           The number of vertices.
+    \param  near            The smallest w not clipped; must be above 0.
+
+    \return                 The number of vertices sent.
+*/
+size_t pvr_clip_txr(pvr_dr_state_t *dr, const pvr_vertex_t *verts,
+                    size_t count, float near);
+
+/** \brief   Clip and send untextured triangle strips.
+
+    Only the position and the base color are interpolated; the texture
+    coordinates and offset color are not sent.
+
+    \param  dr              A state variable initialized with pvr_dr_init().
+    \param  verts           The vertices, with w in z. Each strip ends with a
+                            vertex flagged PVR_CMD_VERTEX_EOL.
+    \param  count           The number of vertices.
+    \param  near            The smallest w not clipped; must be above 0.
+
+    \return                 The number of vertices sent.
+*/
+size_t pvr_clip_gouraud(pvr_dr_state_t *dr, const pvr_vertex_t *verts,
+                        size_t count, float near);
+
+/** \brief   Clip and send a modifier volume.
+
+    The triangles must make up one closed volume. The part behind the near
+    plane is cut off, and the hole is closed with triangles on the plane,
+    so that the volume still works. As the PVR wants it, the triangles are
+    preceded by a copy of the header marked PVR_MODIFIER_OTHER_POLY, and
+    the last one by the header itself. Nothing is sent if the volume is
+    entirely behind the plane.
+
+    \param  dr              A state variable initialized with pvr_dr_init().
+    \param  hdr             The header of the volume, compiled with
+                            pvr_mod_compile() for the last polygon.
+    \param  tris            The triangles, with w in az, bz and cz.
+    \param  count           The number of triangles.
+    \param  near            The smallest w not clipped; must be above 0.
+
+    \return                 The number of triangles sent.
+*/
+size_t pvr_clip_mod(pvr_dr_state_t *dr, const pvr_mod_hdr_t *hdr,
+                    const pvr_modifier_vol_t *tris, size_t count, float near);
+
+/** @} */
+
+__END_DECLS
+
+#endif  /* __DC_PVR_PVR_CLIP_H */
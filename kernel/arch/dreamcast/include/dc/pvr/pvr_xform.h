@@ -0,0 +1,132 @@
+/* KallistiOS ##version##
+
+   dc/pvr/pvr_xform.h
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/** \file       dc/pvr/pvr_xform.h
+    \brief      Submission of triangles transformed by mat_transform_pvr()
+    \ingroup    pvr_xform
+
+    \author KallistiOS Team
+*/
+
+#ifndef __DC_PVR_PVR_XFORM_H
+#define __DC_PVR_PVR_XFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <dc/matrix.h>
+
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+
+/** \defgroup   pvr_xform   Transformed Triangles
+    \brief                  Culling and submission of transformed triangles
+    \ingroup                pvr_scene_mgmt
+
+    The vertex pipeline has two stages. mat_transform_pvr() transforms a
+    vertex stream by the current matrix into a pool of finished
+    pvr_vertex_t records in RAM, along with a clip outcode per vertex. The
+    functions here then walk the triangles of a mesh over that pool, so
+    that shared vertices are only transformed once:
+
+    - Triangles with all three vertices beyond the same bound are culled.
+    - Triangles with a vertex closer than the near bound are set aside in a
+      side list; their records can't be used as-is. pvr_xform_side_verts()
+      rebuilds them in the form the near plane clipper (see pvr_clip_txr())
+      takes.
+    - All the other triangles are sent as three-vertex strips, either to
+      the TA through the store queues (Direct Rendering), or to a DMA
+      vertex buffer (see pvr_vertbuf_tail()).
+
+    The PVR clips triangles crossing the sides of the screen by itself, so
+    only the near bound needs clipping in software.
+
+    When nothing can cross the near bound, mat_transform_pvr() can also
+    write strips straight into the store queues, skipping this stage.
+
+    @{
+*/
+
+/** \brief   Side list of triangles that need clipping.
+
+    Set the buffer and its size, and clear the count. Triangles that don't
+    fit are dropped.
+*/
+typedef struct pvr_xform_side {
+    uint32_t *tris;     /**< \brief Vertex indices, three per triangle */
+    size_t max;         /**< \brief Size of tris, in triangles */
+    size_t count;       /**< \brief Triangles stored so far */
+} pvr_xform_side_t;
+
+/** \brief   Send transformed triangles to the TA with Direct Rendering.
+
+    The polygon header must have been sent beforehand, in a list opened
+    with pvr_list_begin() while not using DMA.
+
+    \param  dr              A state variable initialized with pvr_dr_init().
+    \param  verts           The vertex pool, from mat_transform_pvr().
+    \param  codes           The outcodes, from mat_transform_pvr().
+    \param  indices         Three indices into the pool per triangle, or NULL
+                            if the pool holds the triangles one after the
+                            other.
+    \param  count           The number of triangles.
+    \param  side            Where to store the triangles that need clipping,
+                            or NULL to drop them.
+
+    \return                 The number of triangles sent.
+*/
+size_t pvr_xform_tris_dr(pvr_dr_state_t *dr, const pvr_vertex_t *verts,
+                         const uint8_t *codes, const uint16_t *indices,
+                         size_t count, pvr_xform_side_t *side);
+
+/** \brief   Write transformed triangles to a vertex buffer.
+
+    The buffer must have room for three vertices per triangle. When it is
+    the tail of a DMA vertex buffer, report what was written with
+    pvr_vertbuf_written() afterwards.
+
+    \param  buf             Where to write the vertices.
+    \param  verts           The vertex pool, from mat_transform_pvr().
+    \param  codes           The outcodes, from mat_transform_pvr().
+    \param  indices         Three indices into the pool per triangle, or NULL
+                            if the pool holds the triangles one after the
+                            other.
+    \param  count           The number of triangles.
+    \param  side            Where to store the triangles that need clipping,
+                            or NULL to drop them.
+
+    \return                 The number of triangles written.
+*/
+size_t pvr_xform_tris_buf(pvr_vertex_t *buf, const pvr_vertex_t *verts,
+                          const uint8_t *codes, const uint16_t *indices,
+                          size_t count, pvr_xform_side_t *side);
+
+/** \brief   Rebuild the triangles of a side list for clipping.
+
+    The records of the triangles set aside have already been divided by w,
+    which loses the sign of w. This function transforms their vertices again
+    from the stream, into the homogeneous form that pvr_clip_txr() and
+    pvr_clip_gouraud() take: x and y as the matrix leaves them, w in z, the
+    texture coordinates and color from the stream, and oargb at 0. Each
+    triangle becomes a strip of three vertices.
+
+    The current matrix must still be the one mat_transform_pvr() used.
+
+    \param  in              The stream given to mat_transform_pvr().
+    \param  side            The side list.
+    \param  out             Where to write the vertices, three per triangle of
+                            the side list.
+
+    \return                 The number of vertices written.
+*/
+size_t pvr_xform_side_verts(const mat_vstream_t *in,
+                            const pvr_xform_side_t *side, pvr_vertex_t *out);
+
+/** @} */
+
+__END_DECLS
+
+#endif  /* __DC_PVR_PVR_XFORM_H */
@@ -29,6 +29,7 @@
 __BEGIN_DECLS
 
 #include <arch/types.h>
+#include <kos/arena.h>
 
 /** \defgroup audio_streaming   Streaming
     \brief                      Streaming audio playback and management
@@ -139,6 +140,30 @@ void snd_stream_set_userdata(snd_stream_hnd_t hnd, void *d);
 */
 void *snd_stream_get_userdata(snd_stream_hnd_t hnd);
 
+/** \brief  Set a scratch arena for a given stream.
+
+    Callbacks which decode or mix audio into a temporary buffer can allocate
+    it from this arena with arena_alloc(), instead of going through malloc()
+    on each call or keeping a static buffer around. The arena is reset right
+    before each call to the get data callback, once the stream is done with
+    the data returned by the previous call.
+
+    Since arena allocations are 32-byte aligned, the data of mono streams can
+    be DMAed to the AICA directly, without being copied first.
+
+    \param  hnd             The stream handle.
+    \param  arena           The arena to use, or NULL to not use one. The
+                            arena must not be shared with anything else.
+*/
+void snd_stream_set_arena(snd_stream_hnd_t hnd, arena_t *arena);
+
+/** \brief  Get the scratch arena of a given stream.
+
+    \param  hnd             The stream handle.
+    \return                 The arena set for this stream, or NULL if none.
+*/
+arena_t *snd_stream_get_arena(snd_stream_hnd_t hnd);
+
 /** \brief  Stream filter callback type.
 
     Functions providing filters over the stream data will be of this type, and
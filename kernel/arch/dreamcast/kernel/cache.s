@@ -7,6 +7,7 @@
 ! Copyright (C) 2014, 2016, 2023 Ruslan Rostovtsev
 ! Copyright (C) 2023, 2024 Andy Barajas
 ! Copyright (C) 2024 Paul Cercueil
+! Copyright (C) 2025 KallistiOS Team
 !
 ! Optimized assembler code for managing the cache.
 !
@@ -130,6 +131,15 @@ _dcache_flush_range:
     mov.l    flush_check, r2
     
     bt       .dflush_exit       ! Exit early if no blocks to flush
+    mov.l    ccr_addr, r1
+
+    ! With OCRAM enabled, flushing the whole cache takes half as long
+    mov.l    @r1, r0
+    tst      #0x20, r0          ! Test CCR.ORA
+    bt       .dflush_check
+    shlr     r2
+
+.dflush_check:
     mov.l    align_mask, r0
 
     cmp/hi   r2, r5             ! Compare with flush_check
@@ -154,21 +164,40 @@ _dcache_flush_range:
 ! dcache entries.  It forces a write-back on all dcache entries where
 ! the U bit and V bit are set to 1.  Then updates the entry with
 ! U bit cleared.
+!
+! When OCRAM is enabled, entries 128-255 and 384-511 are used as RAM,
+! so only the two blocks of 128 entries still used as cache are walked.
     .align 2
 _dcache_flush_all:
+    mov.l    ccr_addr, r0
     mov.l    dca_addr, r1
+    mov.l    @r0, r0
     mov.w    cache_lines, r2
+    tst      #0x20, r0   ! Test CCR.ORA
     mov.l    dc_ubit_mask, r3
 
+    bt/s     .dflush_all_block
+    mov      #1, r6      ! One block of 512 entries
+    mov      #2, r6      ! With OCRAM, two blocks of 128 entries
+    shlr2    r2
+
+.dflush_all_block:
+    mov      r2, r7
+
 .dflush_all_loop:
     mov.l    @r1, r0     ! Get dcache array entry value
     and      r3, r0      ! Zero out U bit
-    dt       r2
+    dt       r7
     mov.l    r0, @r1     ! Update dcache entry
 
     bf/s     .dflush_all_loop
     add      #32, r1     ! Move on to next entry
 
+    mov.w    ocram_skip, r0
+    dt       r6
+    bf/s     .dflush_all_block
+    add      r0, r1      ! Skip over the OCRAM entries
+
     rts
     nop
 
@@ -186,6 +215,15 @@ _dcache_purge_range:
     mov.l    purge_check, r2
     
     bt       .dpurge_exit       ! Exit early if no blocks to purge
+    mov.l    ccr_addr, r1
+
+    ! With OCRAM enabled, purging the whole cache takes half as long
+    mov.l    @r1, r0
+    tst      #0x20, r0          ! Test CCR.ORA
+    bt       .dpurge_check
+    shlr     r2
+
+.dpurge_check:
     mov.l    align_mask, r0 
 
     cmp/hi   r2, r5             ! Compare with purge_check
@@ -208,25 +246,43 @@ _dcache_purge_range:
 
 ! This routine uses the OC address array to have direct access to the
 ! dcache entries.  It goes through and forces a write-back and invalidate
-! on all of the dcache.
+! on all of the dcache. The OCRAM entries are skipped, as above.
     .align 2
 _dcache_purge_all:
+    mov.l    ccr_addr, r0
     mov.l    dca_addr, r1
+    mov.l    @r0, r0
     mov.w    cache_lines, r2
+    tst      #0x20, r0   ! Test CCR.ORA
     mov      #0, r3
+
+    bt/s     .dpurge_all_block
+    mov      #1, r6      ! One block of 512 entries
+    mov      #2, r6      ! With OCRAM, two blocks of 128 entries
+    shlr2    r2
+
+.dpurge_all_block:
+    mov      r2, r7
     
 .dpurge_all_loop:
     mov.l    r3, @r1     ! Update dcache entry
-    dt       r2
+    dt       r7
     bf/s     .dpurge_all_loop
     add      #32, r1     ! Move on to next entry
 
+    mov.w    ocram_skip, r0
+    dt       r6
+    bf/s     .dpurge_all_block
+    add      r0, r1      ! Skip over the OCRAM entries
+
     rts
     nop
 
 
 ! This routine forces a write-back and invalidate all dcache
-! using a 8kb or 16kb 32-byte aligned buffer.
+! using a 8kb or 16kb 32-byte aligned buffer. With OCRAM enabled,
+! address bit 12 isn't part of the cache index, so an 8kb buffer
+! only reaches every entry if it starts with that bit set.
 !
 ! r4 is address for temporary buffer 32-byte aligned
 ! r5 is size of temporary buffer (8 KB or 16 KB)
@@ -279,11 +335,15 @@ purge_check:
 ! Shared    
 p2_mask:    
     .long    0xa0000000
+ccr_addr:
+    .long    0xff00001c    ! CCR, ORA bit tells whether OCRAM is enabled
 ormask:
     .long    0x100000f0
 align_mask:
     .long    ~31           ! Align address to 32-byte boundary
 cache_lines:
     .word    512           ! Total number of cache lines in dcache
+ocram_skip:
+    .word    4096          ! Size of the OCRAM entries in the address array
        
 
@@ -37,6 +37,38 @@ krn_stack:
 _irq_save_regs:
 ! On the SH4, an exception triggers a toggle of RB in SR. So all
 ! the R0-R7 registers were convienently saved for us.
+
+! Roll back any gUSA restartable atomic sequence we interrupted, as emitted
+! by GCC with -matomic-model=soft-gusa. Such a sequence looks like:
+!
+!	mova	1f,r0		! R0 = end of the sequence
+!	mov	r15,r1		! R1 = saved stack pointer
+!	mov	#(0f-1f),r15	! R15 = -(length of the sequence)
+! 0:	(loads and computations)
+!	mov.l	rX,@rY		! single store that commits the result
+! 1:	mov	r1,r15
+!
+! A stack pointer in the 0xc0000000-0xffffffff range (the top of P3/P4, which
+! no thread stack lives in) means we're inside one. If the store hasn't been
+! done yet (PC < R0), restart the sequence from its R15 setup instruction;
+! either way, put the real stack pointer back. This uses R0-R3 of the current
+! bank only, and leaves R4 (the exception code) alone.
+	mov		r15,r0
+	shll		r0
+	bf/s		1f
+	shll		r0
+	bf/s		1f
+	stc		spc,r1
+	stc		r0_bank,r0
+	cmp/hs		r0,r1		! Interrupted PC at or past the end?
+	bt/s		2f
+	stc		r1_bank,r1
+	add		#-2,r0		! PC = end - length - 2
+	add		r15,r0
+	ldc		r0,spc
+2:
+	mov		r1,r15		! Restore the stack pointer
+1:
 	mov.l		_irq_srt_addr,r0	! Grab the location of the reg store
 	add		#0x72,r0	! Start at the top of the BANK regs
 	add		#0x72,r0
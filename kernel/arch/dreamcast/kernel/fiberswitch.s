@@ -0,0 +1,108 @@
+! KallistiOS ##version##
+!
+!   arch/dreamcast/kernel/fiberswitch.s
+!   Copyright (C) 2025 KallistiOS Team
+!
+! Assembler code for switching between fibers (see kos/fiber.h).
+!
+! Unlike thd_block_now, this only has to look like a function call to the
+! code on either side of it, so only the registers that the calling
+! convention says survive a call are saved, and they're saved on the stack
+! of the fiber being switched away from. Nothing here touches SR, GBR, or
+! FPSCR: all fibers on a thread share those.
+!
+! The frame on a switched out fiber's stack looks like this:
+!
+!   sp + 0x00   FR15
+!   sp + 0x04   FR14
+!   sp + 0x08   FR13
+!   sp + 0x0c   FR12
+!   sp + 0x10   MACL
+!   sp + 0x14   MACH
+!   sp + 0x18   R14
+!   ...
+!   sp + 0x30   R8
+!   sp + 0x34   PR
+!
+! arch_fiber_prepare below must be kept in sync with it.
+!
+
+	.text
+	.balign		4
+	.globl		_arch_fiber_switch
+	.globl		_arch_fiber_prepare
+
+! R4 = where to save the current stack pointer
+! R5 = stack pointer to switch to
+!
+_arch_fiber_switch:
+	sts.l		pr,@-r15
+	mov.l		r8,@-r15
+	mov.l		r9,@-r15
+	mov.l		r10,@-r15
+	mov.l		r11,@-r15
+	mov.l		r12,@-r15
+	mov.l		r13,@-r15
+	mov.l		r14,@-r15
+	sts.l		mach,@-r15
+	sts.l		macl,@-r15
+	fmov.s		fr12,@-r15
+	fmov.s		fr13,@-r15
+	fmov.s		fr14,@-r15
+	fmov.s		fr15,@-r15
+
+	! Switch stacks
+	mov.l		r15,@r4
+	mov		r5,r15
+
+	fmov.s		@r15+,fr15
+	fmov.s		@r15+,fr14
+	fmov.s		@r15+,fr13
+	fmov.s		@r15+,fr12
+	lds.l		@r15+,macl
+	lds.l		@r15+,mach
+	mov.l		@r15+,r14
+	mov.l		@r15+,r13
+	mov.l		@r15+,r12
+	mov.l		@r15+,r11
+	mov.l		@r15+,r10
+	mov.l		@r15+,r9
+	mov.l		@r15+,r8
+	lds.l		@r15+,pr
+	rts
+	nop
+
+! Build the first frame for a new fiber. The frame "returns" into
+! fiber_start below, with the fiber pointer in R8 and everything else
+! zeroed (including R14, which ends frame pointer stack traces).
+!
+! R4 = top of the fiber's stack
+! R5 = the fiber
+!
+! Returns the initial stack pointer for the fiber.
+!
+_arch_fiber_prepare:
+	mov.l		fsaddr,r0
+	mov.l		r0,@-r4		! PR
+	mov.l		r5,@-r4		! R8
+	mov		#0,r0
+	mov		#12,r1		! R9-R14, MACH, MACL, FR12-FR15
+1:
+	dt		r1
+	bf/s		1b
+	mov.l		r0,@-r4
+	rts
+	mov		r4,r0
+
+! First code run by every fiber: hand the fiber over to the C code, which
+! never returns.
+fiber_start:
+	mov.l		feaddr,r0
+	jmp		@r0
+	mov		r8,r4
+
+	.balign	4
+fsaddr:
+	.long	fiber_start
+feaddr:
+	.long	_fiber_entry
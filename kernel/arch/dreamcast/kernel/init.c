@@ -17,6 +17,7 @@
 #include <arch/arch.h>
 #include <arch/irq.h>
 #include <arch/memory.h>
+#include <arch/ocram.h>
 #include <arch/rtc.h>
 #include <arch/timer.h>
 #include <arch/wdt.h>
@@ -295,6 +296,9 @@ void arch_main(void) {
     /* Clear out the BSS area */
     memset(bss_start, 0, (uintptr_t)(&end) - (uintptr_t)bss_start);
 
+    /* And the __ocram variables, if OCRAM is enabled */
+    ocram_init();
+
     /* Do auto-init stuff */
     arch_auto_init();
 
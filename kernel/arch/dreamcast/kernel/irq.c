@@ -22,6 +22,7 @@
 #include <kos/thread.h>
 #include <kos/library.h>
 #include <kos/regfield.h>
+#include <kos/trace.h>
 
 /* Macros for accessing related registers. */
 #define TRA    ( *((volatile uint32_t *)(0xff000020)) ) /* TRAPA Exception Register */
@@ -250,6 +251,8 @@ void irq_handle_exception(int code) {
        diagnostics returns if we try to do something in the int. */
     inside_int = ((code&0xf)<<16) | (evt&0xffff);
 
+    trace_record(TRACE_EVT_IRQ_ENTER, evt);
+
     /* If there's a global handler, call it */
     if(global_irq_handler.hdl) {
         global_irq_handler.hdl(evt, irq_srt_addr, global_irq_handler.data);
@@ -275,6 +278,8 @@ void irq_handle_exception(int code) {
         arch_panic("unhandled IRQ/Exception");
     }
 
+    trace_record(TRACE_EVT_IRQ_EXIT, evt);
+
     irq_disable();
     inside_int = 0;
 }
@@ -0,0 +1,475 @@
+/* KallistiOS ##version##
+
+   arch/dreamcast/kernel/memfuncs.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* SH4-tuned memcpy(), memmove(), memset() and memcmp(). Being part of
+   libkallisti, these take the place of Newlib's versions, which only ever
+   move 32 bits at a time.
+
+   Each function picks a path by size and by how the pointers are aligned:
+
+   - Short runs use plain loops, as there's no setup worth amortizing.
+   - When the source and destination are aligned the same way modulo 8,
+     32-byte blocks are moved with paired FPU moves (FPSCR.SZ = 1), which
+     move 64 bits per load or store.
+   - When they're aligned the same way modulo 4, 32-bit words are used.
+   - Otherwise, each destination word is built from two source words with
+     shifts, so that nothing is ever moved a byte at a time for long.
+
+   The source is prefetched a line or two ahead of the copy. When whole cache
+   lines of a cacheable destination are overwritten, they are allocated with
+   movca.l, which saves reading from RAM what is about to be replaced. That
+   is not done for uncached areas (P2, P4 and OCRAM), where it can't help.
+
+   The FPU paths clobber only caller-saved registers, so nothing needs to be
+   saved. Like the rest of KOS, they expect FPSCR.PR to be 0.
+
+   GCC must not be allowed to turn the loops below back into calls to these
+   very functions; see the Makefile. */
+
+#include <string.h>
+#include <stdint.h>
+
+#include <arch/cache.h>
+#include <arch/memory.h>
+
+/* Types that may alias anything, as these functions work on any memory. */
+typedef uint32_t __attribute__((may_alias)) word_t;
+typedef uint8_t byte_t;
+
+/* Below this many bytes, only the simple loops are used. */
+#define SMALL_SIZE      32
+
+/* Past this many bytes, the block paths are worth setting up. */
+#define BLOCK_SIZE      64
+
+/* Is movca.l of any use at this address? */
+static inline int cacheable(uintptr_t addr) {
+    return addr < 0x7c000000 ||
+           (addr >= MEM_AREA_P1_BASE && addr < MEM_AREA_P2_BASE) ||
+           (addr >= MEM_AREA_P3_BASE && addr < MEM_AREA_P4_BASE);
+}
+
+/* Copy count 32-byte blocks with 64-bit moves. Both pointers must be 8-byte
+   aligned, and count non-zero. */
+static inline void copy_blocks_fpu(void *dest, const void *src, size_t count) {
+    void *pf;
+
+    __asm__ __volatile__("fschg\n"
+                         "1:\n\t"
+                         "fmov.d  @%1+, dr0\n\t"
+                         "mov     %1, %3\n\t"
+                         "fmov.d  @%1+, dr2\n\t"
+                         "add     #32, %3\n\t"
+                         "fmov.d  @%1+, dr4\n\t"
+                         "add     #32, %0\n\t"
+                         "fmov.d  @%1+, dr6\n\t"
+                         "pref    @%3\n\t"
+                         "dt      %2\n\t"
+                         "fmov.d  dr6, @-%0\n\t"
+                         "fmov.d  dr4, @-%0\n\t"
+                         "fmov.d  dr2, @-%0\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "bf/s    1b\n\t"
+                         "add     #32, %0\n\t"
+                         "fschg\n"
+                         : "+r"(dest), "+r"(src), "+r"(count), "=&r"(pf)
+                         :
+                         : "fr0", "fr1", "fr2", "fr3", "fr4", "fr5", "fr6",
+                           "fr7", "t", "memory");
+}
+
+/* Same as above, but each destination line is allocated in the cache
+   instead of being read in, so dest must be 32-byte aligned. */
+static inline void copy_lines_fpu(void *dest, const void *src, size_t count) {
+    void *pf;
+
+    __asm__ __volatile__("fschg\n"
+                         "1:\n\t"
+                         "mov.l   @%1, r0\n\t"
+                         "mov     %1, %3\n\t"
+                         "fmov.d  @%1+, dr0\n\t"
+                         "add     #64, %3\n\t"
+                         "fmov.d  @%1+, dr2\n\t"
+                         "fmov.d  @%1+, dr4\n\t"
+                         "fmov.d  @%1+, dr6\n\t"
+                         "pref    @%3\n\t"
+                         "movca.l r0, @%0\n\t"
+                         "add     #32, %0\n\t"
+                         "dt      %2\n\t"
+                         "fmov.d  dr6, @-%0\n\t"
+                         "fmov.d  dr4, @-%0\n\t"
+                         "fmov.d  dr2, @-%0\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "bf/s    1b\n\t"
+                         "add     #32, %0\n\t"
+                         "fschg\n"
+                         : "+r"(dest), "+r"(src), "+r"(count), "=&r"(pf)
+                         :
+                         : "r0", "fr0", "fr1", "fr2", "fr3", "fr4", "fr5",
+                           "fr6", "fr7", "t", "memory");
+}
+
+/* Copy count 32-byte blocks with 64-bit moves, from the end down. Both
+   pointers point past the end of the blocks and must be 8-byte aligned. */
+static inline void copy_blocks_fpu_back(void *dest, const void *src,
+                                        size_t count) {
+    void *pf;
+
+    __asm__ __volatile__("fschg\n"
+                         "1:\n\t"
+                         "add     #-32, %1\n\t"
+                         "mov     %1, %3\n\t"
+                         "fmov.d  @%1+, dr0\n\t"
+                         "add     #-32, %3\n\t"
+                         "fmov.d  @%1+, dr2\n\t"
+                         "fmov.d  @%1+, dr4\n\t"
+                         "fmov.d  @%1+, dr6\n\t"
+                         "pref    @%3\n\t"
+                         "add     #-32, %1\n\t"
+                         "dt      %2\n\t"
+                         "fmov.d  dr6, @-%0\n\t"
+                         "fmov.d  dr4, @-%0\n\t"
+                         "fmov.d  dr2, @-%0\n\t"
+                         "bf/s    1b\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "fschg\n"
+                         : "+r"(dest), "+r"(src), "+r"(count), "=&r"(pf)
+                         :
+                         : "fr0", "fr1", "fr2", "fr3", "fr4", "fr5", "fr6",
+                           "fr7", "t", "memory");
+}
+
+/* Fill count 32-byte blocks with a 32-bit pattern, with 64-bit stores. dest
+   must be 8-byte aligned, and count non-zero. */
+static inline void set_blocks_fpu(void *dest, uint32_t val, size_t count) {
+    __asm__ __volatile__("lds     %2, fpul\n\t"
+                         "fsts    fpul, fr0\n\t"
+                         "fsts    fpul, fr1\n\t"
+                         "fschg\n"
+                         "1:\n\t"
+                         "add     #32, %0\n\t"
+                         "dt      %1\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "bf/s    1b\n\t"
+                         "add     #32, %0\n\t"
+                         "fschg\n"
+                         : "+r"(dest), "+r"(count)
+                         : "r"(val)
+                         : "fpul", "fr0", "fr1", "t", "memory");
+}
+
+/* Same as above, allocating each line in the cache first. dest must be
+   32-byte aligned. */
+static inline void set_lines_fpu(void *dest, uint32_t val, size_t count) {
+    __asm__ __volatile__("lds     %2, fpul\n\t"
+                         "fsts    fpul, fr0\n\t"
+                         "fsts    fpul, fr1\n\t"
+                         "fschg\n"
+                         "1:\n\t"
+                         "movca.l %2, @%0\n\t"
+                         "add     #32, %0\n\t"
+                         "dt      %1\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "fmov.d  dr0, @-%0\n\t"
+                         "bf/s    1b\n\t"
+                         "add     #32, %0\n\t"
+                         "fschg\n"
+                         : "+r"(dest), "+r"(count)
+                         : "z"(val)
+                         : "fpul", "fr0", "fr1", "t", "memory");
+}
+
+static inline void copy_bytes(byte_t *d, const byte_t *s, size_t count) {
+    while(count--)
+        *d++ = *s++;
+}
+
+static inline void copy_words(void *dest, const void *src, size_t count) {
+    word_t *d = dest;
+    const word_t *s = src;
+    uint32_t t0, t1, t2, t3;
+
+    while(count >= 8) {
+        dcache_pref_block(s + 8);
+        t0 = s[0]; t1 = s[1]; t2 = s[2]; t3 = s[3];
+        d[0] = t0; d[1] = t1; d[2] = t2; d[3] = t3;
+        t0 = s[4]; t1 = s[5]; t2 = s[6]; t3 = s[7];
+        d[4] = t0; d[5] = t1; d[6] = t2; d[7] = t3;
+        d += 8;
+        s += 8;
+        count -= 8;
+    }
+
+    while(count--)
+        *d++ = *s++;
+}
+
+/* Copy count 32-byte lines with 32-bit moves, allocating each destination
+   line in the cache first. dest must be 32-byte aligned. The whole source
+   line is read before the destination line is allocated, as they may
+   overlap when called from memmove(). */
+static inline void copy_lines_words(void *dest, const void *src,
+                                    size_t count) {
+    word_t *d = dest;
+    const word_t *s = src;
+    uint32_t t0, t1, t2, t3, t4, t5, t6, t7;
+
+    while(count--) {
+        dcache_pref_block(s + 16);
+        t0 = s[0]; t1 = s[1]; t2 = s[2]; t3 = s[3];
+        t4 = s[4]; t5 = s[5]; t6 = s[6]; t7 = s[7];
+        dcache_alloc_block((void *)d, t0);
+        d[1] = t1; d[2] = t2; d[3] = t3;
+        d[4] = t4; d[5] = t5; d[6] = t6; d[7] = t7;
+        d += 8;
+        s += 8;
+    }
+}
+
+/* Copy count words to an aligned destination from a source which isn't
+   aligned the same way. Only whole aligned source words are read, so this
+   never strays past the page of the last source byte. */
+static inline void copy_words_shifted(void *dest, const byte_t *src,
+                                      size_t count) {
+    word_t *d = dest;
+    const word_t *s = (const word_t *)((uintptr_t)src & ~3);
+    unsigned int lo = ((uintptr_t)src & 3) * 8, hi = 32 - lo;
+    uint32_t w0 = *s++, w1, w2;
+
+    while(count >= 4) {
+        dcache_pref_block(s + 8);
+        w1 = s[0];
+        w2 = s[1];
+        d[0] = (w0 >> lo) | (w1 << hi);
+        d[1] = (w1 >> lo) | (w2 << hi);
+        w1 = s[2];
+        w0 = s[3];
+        d[2] = (w2 >> lo) | (w1 << hi);
+        d[3] = (w1 >> lo) | (w0 << hi);
+        d += 4;
+        s += 4;
+        count -= 4;
+    }
+
+    while(count--) {
+        w1 = *s++;
+        *d++ = (w0 >> lo) | (w1 << hi);
+        w0 = w1;
+    }
+}
+
+/* The forward copy behind memcpy(). It reads ahead of where it writes, so
+   memmove() also uses it when the destination is below the source. */
+static void *copy_forward(void *dest, const void *src, size_t count) {
+    byte_t *d = dest;
+    const byte_t *s = src;
+    uintptr_t diff = (uintptr_t)d ^ (uintptr_t)s;
+    size_t n;
+
+    if(count < SMALL_SIZE) {
+        if(!(((uintptr_t)d | (uintptr_t)s) & 3)) {
+            n = count & ~3;
+            copy_words(d, s, n >> 2);
+            d += n;
+            s += n;
+            count -= n;
+        }
+
+        copy_bytes(d, s, count);
+        return dest;
+    }
+
+    /* Bring the destination to a word boundary first. */
+    n = -(uintptr_t)d & (diff & 7 ? 3 : 7);
+    copy_bytes(d, s, n);
+    d += n;
+    s += n;
+    count -= n;
+
+    if(diff & 3) {
+        n = count & ~3;
+        copy_words_shifted(d, s, n >> 2);
+    }
+    else {
+        if(count >= BLOCK_SIZE) {
+            if(cacheable((uintptr_t)d)) {
+                n = -(uintptr_t)d & 31;
+                copy_words(d, s, n >> 2);
+                d += n;
+                s += n;
+                count -= n;
+
+                n = count >> 5;
+
+                if(diff & 7)
+                    copy_lines_words(d, s, n);
+                else
+                    copy_lines_fpu(d, s, n);
+            }
+            else {
+                n = count >> 5;
+
+                if(diff & 7)
+                    copy_words(d, s, n << 3);
+                else
+                    copy_blocks_fpu(d, s, n);
+            }
+
+            d += n << 5;
+            s += n << 5;
+            count &= 31;
+        }
+
+        n = count & ~3;
+        copy_words(d, s, n >> 2);
+    }
+
+    d += n;
+    s += n;
+    copy_bytes(d, s, count - n);
+
+    return dest;
+}
+
+void *memcpy(void *restrict dest, const void *restrict src, size_t count) {
+    return copy_forward(dest, src, count);
+}
+
+void *memmove(void *dest, const void *src, size_t count) {
+    byte_t *d = dest;
+    const byte_t *s = src;
+    uintptr_t diff = (uintptr_t)d ^ (uintptr_t)s;
+    size_t n;
+
+    /* Unless the destination starts inside the source, copying forward is
+       safe. */
+    if((uintptr_t)d - (uintptr_t)s >= count)
+        return copy_forward(dest, src, count);
+
+    if(d == s)
+        return dest;
+
+    d += count;
+    s += count;
+
+    if(count >= SMALL_SIZE && !(diff & 3)) {
+        n = (uintptr_t)d & (diff & 7 ? 3 : 7);
+        count -= n;
+
+        while(n--)
+            *--d = *--s;
+
+        if(!(diff & 7) && count >= BLOCK_SIZE) {
+            n = count >> 5;
+            copy_blocks_fpu_back(d, s, n);
+            d -= n << 5;
+            s -= n << 5;
+            count &= 31;
+        }
+
+        for(n = count >> 2; n; n--) {
+            d -= 4;
+            s -= 4;
+            *(word_t *)d = *(const word_t *)s;
+        }
+
+        count &= 3;
+    }
+
+    while(count--)
+        *--d = *--s;
+
+    return dest;
+}
+
+void *memset(void *dest, int c, size_t count) {
+    byte_t *d = dest;
+    uint32_t val = (byte_t)c * 0x01010101u;
+    word_t *w;
+    size_t n;
+
+    if(count >= SMALL_SIZE) {
+        for(n = -(uintptr_t)d & 3; n; n--, count--)
+            *d++ = (byte_t)c;
+
+        if(count >= BLOCK_SIZE) {
+            for(w = (word_t *)d, n = -(uintptr_t)d & 31; n; n -= 4)
+                *w++ = val;
+
+            count -= (byte_t *)w - d;
+            d = (byte_t *)w;
+            n = count >> 5;
+
+            if(cacheable((uintptr_t)d))
+                set_lines_fpu(d, val, n);
+            else
+                set_blocks_fpu(d, val, n);
+
+            d += n << 5;
+            count &= 31;
+        }
+
+        for(w = (word_t *)d; count >= 4; count -= 4)
+            *w++ = val;
+
+        d = (byte_t *)w;
+    }
+
+    while(count--)
+        *d++ = (byte_t)c;
+
+    return dest;
+}
+
+int memcmp(const void *s1, const void *s2, size_t count) {
+    const byte_t *a = s1, *b = s2;
+    const word_t *wa, *wb;
+
+    if(count >= SMALL_SIZE && !(((uintptr_t)a ^ (uintptr_t)b) & 3)) {
+        for(; (uintptr_t)a & 3; a++, b++, count--) {
+            if(*a != *b)
+                return *a - *b;
+        }
+
+        wa = (const word_t *)a;
+        wb = (const word_t *)b;
+
+        /* Compare a line at a time, then find the word that differs. */
+        while(count >= 32) {
+            dcache_pref_block(wa + 8);
+            dcache_pref_block(wb + 8);
+
+            if(((wa[0] ^ wb[0]) | (wa[1] ^ wb[1]) | (wa[2] ^ wb[2]) |
+                (wa[3] ^ wb[3]) | (wa[4] ^ wb[4]) | (wa[5] ^ wb[5]) |
+                (wa[6] ^ wb[6]) | (wa[7] ^ wb[7])))
+                break;
+
+            wa += 8;
+            wb += 8;
+            count -= 32;
+        }
+
+        for(; count >= 4 && *wa == *wb; count -= 4) {
+            wa++;
+            wb++;
+        }
+
+        a = (const byte_t *)wa;
+        b = (const byte_t *)wb;
+    }
+
+    for(; count; a++, b++, count--) {
+        if(*a != *b)
+            return *a - *b;
+    }
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+/* KallistiOS ##version##
+
+   arch/dreamcast/kernel/ocram.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* A very small allocator for the operand cache RAM. The 8 KB are split into
+   256 blocks of 32 bytes; the first block of each allocation holds the
+   number of blocks it covers, and every other entry is zero. Scanning the
+   map is cheap enough at this size that nothing smarter is needed. The
+   __ocram variables are reserved as one allocation at the start of the
+   first bank. */
+
+#include <string.h>
+#include <errno.h>
+
+#include <arch/ocram.h>
+#include <arch/irq.h>
+
+#define OCRAM_BANK_BLOCKS   (OCRAM_BANK_SIZE / OCRAM_BLOCK_SIZE)
+#define OCRAM_BLOCKS        (OCRAM_SIZE / OCRAM_BLOCK_SIZE)
+
+/* Bounds of the .ocram section, from the linker script. */
+extern uint8_t _ocram_start[], _ocram_end[];
+
+static uint8_t ocram_map[OCRAM_BLOCKS];
+
+static inline uintptr_t ocram_block_addr(size_t blk) {
+    uintptr_t bank = blk < OCRAM_BANK_BLOCKS ? OCRAM_BANK0 : OCRAM_BANK1;
+
+    return bank + (blk % OCRAM_BANK_BLOCKS) * OCRAM_BLOCK_SIZE;
+}
+
+static int ocram_block_index(uintptr_t addr) {
+    if(addr >= OCRAM_BANK0 && addr < OCRAM_BANK0 + OCRAM_BANK_SIZE)
+        return (addr - OCRAM_BANK0) / OCRAM_BLOCK_SIZE;
+
+    if(addr >= OCRAM_BANK1 && addr < OCRAM_BANK1 + OCRAM_BANK_SIZE)
+        return OCRAM_BANK_BLOCKS + (addr - OCRAM_BANK1) / OCRAM_BLOCK_SIZE;
+
+    return -1;
+}
+
+/* Find the first run of count free blocks in [first, last). */
+static int ocram_find(size_t first, size_t last, size_t count) {
+    size_t i = first, start = first;
+
+    while(i < last) {
+        if(ocram_map[i]) {
+            i += ocram_map[i];
+            start = i;
+        }
+        else if(++i - start >= count) {
+            return start;
+        }
+    }
+
+    return -1;
+}
+
+void *ocram_alloc(size_t size) {
+    size_t count;
+    int blk;
+
+    if(!ocram_enabled()) {
+        errno = ENODEV;
+        return NULL;
+    }
+
+    count = (size + OCRAM_BLOCK_SIZE - 1) / OCRAM_BLOCK_SIZE;
+
+    if(!count || count > OCRAM_BANK_BLOCKS) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    irq_disable_scoped();
+
+    blk = ocram_find(0, OCRAM_BANK_BLOCKS, count);
+
+    if(blk < 0)
+        blk = ocram_find(OCRAM_BANK_BLOCKS, OCRAM_BLOCKS, count);
+
+    if(blk < 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    ocram_map[blk] = count;
+
+    return (void *)ocram_block_addr(blk);
+}
+
+void ocram_free(void *ptr) {
+    int blk;
+
+    if(!ptr)
+        return;
+
+    blk = ocram_block_index((uintptr_t)ptr);
+
+    /* Never give back the __ocram variables. */
+    if(blk < 0 || (blk == 0 && _ocram_end - _ocram_start))
+        return;
+
+    irq_disable_scoped();
+    ocram_map[blk] = 0;
+}
+
+size_t ocram_available(void) {
+    size_t i = 0, used = 0;
+
+    if(!ocram_enabled())
+        return 0;
+
+    irq_disable_scoped();
+
+    while(i < OCRAM_BLOCKS) {
+        if(ocram_map[i]) {
+            used += ocram_map[i];
+            i += ocram_map[i];
+        }
+        else {
+            i++;
+        }
+    }
+
+    return (OCRAM_BLOCKS - used) * OCRAM_BLOCK_SIZE;
+}
+
+void ocram_init(void) {
+    size_t size = _ocram_end - _ocram_start;
+
+    memset(ocram_map, 0, sizeof(ocram_map));
+
+    if(!ocram_enabled())
+        return;
+
+    if(size) {
+        memset(_ocram_start, 0, size);
+        ocram_map[0] = (size + OCRAM_BLOCK_SIZE - 1) / OCRAM_BLOCK_SIZE;
+    }
+}
@@ -0,0 +1,194 @@
+/* KallistiOS ##version##
+
+   arch/dreamcast/kernel/profiler.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* This file implements the statistical PC-sampling profiler described in
+   dc/profiler.h. TMU1 is run at the requested rate, and its underflow
+   interrupt records the context of whatever it interrupted. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <dc/profiler.h>
+#include <kos/thread.h>
+#include <kos/fs.h>
+#include <arch/irq.h>
+#include <arch/timer.h>
+
+static profiler_sample_t *prof_buf;
+static uint32_t prof_size;
+static uint32_t prof_count;
+static uint32_t prof_dropped;
+static uint32_t prof_rate;
+
+/* TMU1 underflow handler: take a sample. */
+static void profiler_hnd(irq_t src, irq_context_t *context, void *data) {
+    kthread_t *cur = thd_get_current();
+    profiler_sample_t *s;
+
+    (void)src;
+    (void)data;
+
+    timer_clear(TMU1);
+
+    if(prof_count >= prof_size) {
+        ++prof_dropped;
+        return;
+    }
+
+    s = &prof_buf[prof_count++];
+    s->pc = CONTEXT_PC(*context);
+    s->pr = context->pr;
+    s->tid = cur ? (uint32_t)cur->tid : 0;
+}
+
+int profiler_start(size_t count, unsigned int rate) {
+    profiler_sample_t *buf;
+
+    if(!count || !rate) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    profiler_release();
+
+    if(!(buf = (profiler_sample_t *)malloc(count * sizeof(profiler_sample_t)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    irq_disable_scoped();
+
+    prof_buf = buf;
+    prof_size = count;
+    prof_count = 0;
+    prof_dropped = 0;
+    prof_rate = rate;
+
+    irq_set_handler(EXC_TMU1_TUNI1, profiler_hnd, NULL);
+    timer_prime(TMU1, rate, 1);
+    timer_clear(TMU1);
+    timer_start(TMU1);
+
+    return 0;
+}
+
+void profiler_stop(void) {
+    /* This also masks the TMU1 interrupt. */
+    timer_stop(TMU1);
+    timer_clear(TMU1);
+}
+
+void profiler_release(void) {
+    profiler_sample_t *buf;
+
+    {
+        irq_disable_scoped();
+
+        profiler_stop();
+        buf = prof_buf;
+        prof_buf = NULL;
+        prof_size = prof_count = 0;
+    }
+
+    free(buf);
+}
+
+/* Collects the labels of all living threads for profiler_dump(). */
+typedef struct {
+    profiler_thread_t *thds;
+    uint32_t count;
+    uint32_t max;
+} profiler_thds_t;
+
+static int profiler_add_thread(kthread_t *thd, void *data) {
+    profiler_thds_t *t = (profiler_thds_t *)data;
+    profiler_thread_t *ent;
+
+    if(t->count >= t->max)
+        return 1;
+
+    ent = &t->thds[t->count++];
+    ent->tid = thd->tid;
+    strncpy(ent->label, thd_get_label(thd), PROFILER_LABEL_LEN - 1);
+    ent->label[PROFILER_LABEL_LEN - 1] = '\0';
+
+    return 0;
+}
+
+static int profiler_count_thread(kthread_t *thd, void *data) {
+    (void)thd;
+    ++*(uint32_t *)data;
+
+    return 0;
+}
+
+int profiler_dump(const char *fn) {
+    profiler_header_t hdr;
+    profiler_thds_t thds = { NULL, 0, 0 };
+    int was_running = timer_running(TMU1), rv = -1;
+    size_t len;
+    file_t fd;
+
+    if(!prof_buf) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Pause sampling while we write everything out, so that we don't end up
+       profiling the dump itself. */
+    if(was_running)
+        timer_stop(TMU1);
+
+    thd_each(profiler_count_thread, &thds.max);
+    thds.thds = (profiler_thread_t *)calloc(thds.max,
+                                            sizeof(profiler_thread_t));
+
+    if(!thds.thds && thds.max) {
+        errno = ENOMEM;
+        goto out;
+    }
+
+    {
+        irq_disable_scoped();
+        thd_each(profiler_add_thread, &thds);
+    }
+
+    hdr.magic = PROFILER_MAGIC;
+    hdr.version = PROFILER_VERSION;
+    hdr.rate = prof_rate;
+    hdr.thread_count = thds.count;
+    hdr.sample_count = prof_count;
+    hdr.dropped = prof_dropped;
+
+    if((fd = fs_open(fn, O_WRONLY | O_CREAT | O_TRUNC)) < 0)
+        goto out;
+
+    len = thds.count * sizeof(profiler_thread_t);
+
+    if(fs_write(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+       fs_write(fd, thds.thds, len) == (ssize_t)len) {
+        len = prof_count * sizeof(profiler_sample_t);
+
+        if(fs_write(fd, prof_buf, len) == (ssize_t)len)
+            rv = 0;
+    }
+
+    if(rv)
+        errno = EIO;
+
+    fs_close(fd);
+out:
+    free(thds.thds);
+
+    if(was_running) {
+        irq_disable_scoped();
+        timer_enable_ints(TMU1);
+        timer_start(TMU1);
+    }
+
+    return rv;
+}
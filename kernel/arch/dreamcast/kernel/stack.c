@@ -66,3 +66,27 @@ void arch_stk_trace_at(uint32_t fp, size_t n) {
     dbgio_printf("-------------- End Stack Trace -----------------\n");
 }
 
+/* Same walk as above, quietly storing the return addresses. */
+size_t arch_stk_trace_collect(uintptr_t fp, uintptr_t *addrs, size_t count) {
+    uintptr_t ret_addr;
+    size_t n = 0;
+
+    if(!__is_defined(FRAME_POINTERS))
+        return 0;
+
+    while(n < count && fp != 0xffffffff) {
+        if((fp & 3) || (fp < 0x8c000000) || (fp > _arch_mem_top))
+            break;
+
+        ret_addr = arch_fptr_ret_addr(fp);
+
+        if(!arch_valid_address(ret_addr))
+            break;
+
+        addrs[n++] = ret_addr;
+        fp = arch_fptr_next(fp);
+    }
+
+    return n;
+}
+
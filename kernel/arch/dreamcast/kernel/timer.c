@@ -154,24 +154,6 @@ int timer_clear(int which) {
     return !!(value & UNF);
 }
 
-/* Spin-loop kernel sleep func: uses the secondary timer in the
-   SH-4 to very accurately delay even when interrupts are disabled */
-void timer_spin_sleep(int ms) {
-    timer_prime(TMU1, 1000, 0);
-    timer_clear(TMU1);
-    timer_start(TMU1);
-
-    while(ms > 0) {
-        while(!(TIMER16(tcrs[TMU1]) & UNF))
-            ;
-
-        timer_clear(TMU1);
-        ms--;
-    }
-
-    timer_stop(TMU1);
-}
-
 void timer_spin_delay_ns(unsigned short ns) {
     uint64_t timeout = timer_ns_gettime64() + ns;
 
@@ -234,6 +216,62 @@ void timer_ms_disable(void) {
     timer_disable_ints(TMU2);
 }
 
+/* Spin-loop kernel sleep func: polls the TMU2 counter to very accurately
+   delay even when interrupts are disabled.
+
+   The timestamp API can't be used here: without the TMU2 interrupt, its
+   seconds stop moving after the first underflow. Instead, the ticks are
+   counted here between reads of the counter, which is reloaded every
+   second, so that any delay works as long as the loop isn't held off for
+   a whole second at a time.
+
+   TMU2 is only stopped before timer_ms_enable() or after it's disabled,
+   when nothing else needs it, so it is then run just for the delay and
+   put back the way it was. */
+void timer_spin_sleep(int ms) {
+    uint32_t period, prev, cur, elapsed, tcnt = 0, tcor = 0;
+    uint16_t tcr = 0;
+    uint64_t left;
+    bool borrowed;
+
+    if(ms <= 0)
+        return;
+
+    borrowed = !timer_running(TMU2);
+
+    if(borrowed) {
+        tcnt = TIMER32(tcnts[TMU2]);
+        tcor = TIMER32(tcors[TMU2]);
+        tcr = TIMER16(tcrs[TMU2]);
+
+        timer_prime(TMU2, 1, 0);
+        timer_start(TMU2);
+    }
+
+    period = TIMER32(tcors[TMU2]) + 1;
+    left = (uint64_t)ms * (TIMER_PCK / TDIV(TIMER_TPSC) / 1000);
+    prev = TIMER32(tcnts[TMU2]);
+
+    for(;;) {
+        cur = TIMER32(tcnts[TMU2]);
+        elapsed = prev >= cur ? prev - cur : prev + period - cur;
+
+        if(elapsed >= left)
+            break;
+
+        left -= elapsed;
+        prev = cur;
+    }
+
+    if(borrowed) {
+        TIMER8(TSTR) &= ~BIT(TMU2);
+
+        TIMER32(tcnts[TMU2]) = tcnt;
+        TIMER32(tcors[TMU2]) = tcor;
+        TIMER16(tcrs[TMU2]) = tcr;
+    }
+}
+
 /* Internal structure used to hold timer values in seconds + ticks. */
 typedef struct timer_value {
     uint32_t secs, ticks;
@@ -671,3 +671,165 @@ _mat_transform_sq:
     rts
     nop
 
+
+
+! Transform a stream of vertices using the current internal matrix into
+! finished pvr_vertex_t records, and compute a clip outcode for each one.
+! The layout of the stream is mat_vstream_t, in dc/matrix.h. Minimum number
+! of vertices: 1.
+!
+! r4: Input stream
+! r5: Output (store queue address, or 32-byte aligned RAM)
+! r6: Output outcodes, one byte per vertex
+! r7: Number of vertices
+!
+! Positions are transformed with w=1. The outcodes are computed before the
+! divide, from the homogeneous tests x < xmin*w, x > xmax*w, y < ymin*w,
+! y > ymax*w and w < near, so that they also hold for vertices behind the
+! eye. x and y are then scaled by 1/w, and z is set to 1/w, which is found
+! with fsrra(w*w); it is 1/|w|, so it's only meaningful for vertices that
+! pass the near test. The flags word is PVR_CMD_VERTEX, or
+! PVR_CMD_VERTEX_EOL for the last vertex of each strip, and oargb is 0.
+!
+! Each record is followed by a pref on it, which sends it out when writing
+! to the store queues, and does nothing much when writing to RAM.
+!
+! Register usage in the loop:
+! r1: positions         r2: UVs             r3: colors
+! r4: position stride - 8                   r8: UV stride - 4
+! r9: color stride      r10: vertices left in the strip
+! r11: strip length     r12: outcode        r13: color
+! fr8-fr11: xmin, xmax, ymin, ymax          fr12: near
+! fr13: 1/w             fr14, fr15: u, v
+!
+.globl _mat_transform_pvr
+_mat_transform_pvr:
+    mov.l       r8, @-r15
+    mov.l       r9, @-r15
+    mov.l       r10, @-r15
+    mov.l       r11, @-r15
+    mov.l       r12, @-r15
+    mov.l       r13, @-r15
+    fmov        fr12, @-r15
+    fmov        fr13, @-r15
+    fmov        fr14, @-r15
+    fmov        fr15, @-r15
+
+    ! Load the stream description.
+    mov.l       @r4+, r1    ! pos
+    mov.l       @r4+, r2    ! uv
+    mov.l       @r4+, r3    ! argb
+    mov.l       @r4+, r0    ! pos_stride
+    mov.l       @r4+, r8    ! uv_stride
+    mov.l       @r4+, r9    ! argb_stride
+    mov.l       @r4+, r11   ! strip_len
+    fmov        @r4+, fr8   ! xmin
+    fmov        @r4+, fr9   ! xmax
+    fmov        @r4+, fr10  ! ymin
+    fmov        @r4+, fr11  ! ymax
+    fmov        @r4, fr12   ! near
+    add         #-8, r0
+    mov         r0, r4
+    add         #-4, r8
+    pref        @r1
+    mov         r11, r10
+
+.pvrLoop:
+    ! Load a vertex.
+    fmov        @r1+, fr0   ! x
+    fmov        @r1+, fr1   ! y
+    fmov        @r1, fr2    ! z
+    fldi1       fr3         ! w (1)
+    add         r4, r1
+    fmov        @r2+, fr14  ! u
+    fmov        @r2, fr15   ! v
+    add         r8, r2
+
+    ftrv        xmtrx, fv0
+    mov.l       @r3, r13    ! argb
+    add         r9, r3
+    pref        @r1         ! next position
+
+    ! Outcode, against the bounds scaled by w.
+    fmov        fr3, fr4
+    fmul        fr8, fr4
+    fmov        fr3, fr5
+    fmul        fr9, fr5
+    fmov        fr3, fr6
+    fmul        fr10, fr6
+    fmov        fr3, fr7
+    fmul        fr11, fr7
+
+    fcmp/gt     fr0, fr4    ! x < xmin * w
+    movt        r12
+    fcmp/gt     fr5, fr0    ! x > xmax * w
+    movt        r0
+    shll        r0
+    or          r0, r12
+    fcmp/gt     fr1, fr6    ! y < ymin * w
+    movt        r0
+    shll2       r0
+    or          r0, r12
+    fcmp/gt     fr7, fr1    ! y > ymax * w
+    movt        r0
+    shll2       r0
+    shll        r0
+    or          r0, r12
+    fcmp/gt     fr3, fr12   ! w < near
+    movt        r0
+    shll2       r0
+    shll2       r0
+    or          r0, r12
+    mov.b       r12, @r6
+    add         #1, r6
+
+    ! 1/w, as 1/sqrt(w*w).
+    fmov        fr3, fr13
+    fmul        fr3, fr13
+    fsrra       fr13
+
+    ! Flags, ending the strip every strip_len vertices.
+    mov.l       .pvrCmdVertex, r0
+    dt          r10
+    bf          .pvrNoEol
+    mov.l       .pvrCmdVertexEol, r0
+    mov         r11, r10
+.pvrNoEol:
+
+    fmul        fr13, fr0
+    fmul        fr13, fr1
+
+    ! Store the vertex backwards, and send it off.
+    add         #32, r5
+    mov         #0, r12
+    mov.l       r12, @-r5   ! oargb
+    mov.l       r13, @-r5   ! argb
+    fmov        fr15, @-r5  ! v
+    fmov        fr14, @-r5  ! u
+    fmov        fr13, @-r5  ! z (1/w)
+    fmov        fr1, @-r5   ! y
+    fmov        fr0, @-r5   ! x
+    mov.l       r0, @-r5    ! flags
+    pref        @r5
+    dt          r7
+
+    bf/s        .pvrLoop
+    add         #32, r5
+
+    fmov        @r15+, fr15
+    fmov        @r15+, fr14
+    fmov        @r15+, fr13
+    fmov        @r15+, fr12
+    mov.l       @r15+, r13
+    mov.l       @r15+, r12
+    mov.l       @r15+, r11
+    mov.l       @r15+, r10
+    mov.l       @r15+, r9
+    rts
+    mov.l       @r15+, r8
+
+    .align 2
+.pvrCmdVertex:
+    .long       0xe0000000  ! PVR_CMD_VERTEX
+.pvrCmdVertexEol:
+    .long       0xf0000000  ! PVR_CMD_VERTEX_EOL
@@ -97,6 +97,9 @@ typedef struct strchan {
     /* User data. */
     void *user_data;
 
+    /* Scratch arena for the get data callback, reset before each call. */
+    arena_t *arena;
+
     uint32_t dma_length;
     uintptr_t dma_dest;
     kthread_t *mutex_thd;
@@ -166,6 +169,16 @@ void *snd_stream_get_userdata(snd_stream_hnd_t hnd) {
     return streams[hnd].user_data;
 }
 
+void snd_stream_set_arena(snd_stream_hnd_t hnd, arena_t *arena) {
+    CHECK_HND(hnd);
+    streams[hnd].arena = arena;
+}
+
+arena_t *snd_stream_get_arena(snd_stream_hnd_t hnd) {
+    CHECK_HND(hnd);
+    return streams[hnd].arena;
+}
+
 void snd_stream_filter_add(snd_stream_hnd_t hnd, snd_stream_filter_t filtfunc, void * obj) {
     filter_t *f;
 
@@ -713,6 +726,14 @@ static size_t snd_stream_fill(snd_stream_hnd_t hnd, uint32_t offset, size_t size
         return got_bytes;
     }
     if(stream->get_data) {
+        if(stream->arena) {
+            /* The last buffer may still be being DMAed out of the arena;
+               the mutex is held until that is done. */
+            mutex_lock(&stream_mutex);
+            arena_reset(stream->arena);
+            mutex_unlock(&stream_mutex);
+        }
+
         data = stream->get_data(hnd, needed_bytes, &got_bytes);
     }
 
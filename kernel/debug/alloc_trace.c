@@ -0,0 +1,404 @@
+/* KallistiOS ##version##
+
+   kernel/debug/alloc_trace.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* This file implements the allocation tracer described in kos/alloc_trace.h.
+   Records are stored in a power-of-two sized ring buffer, which is only ever
+   updated with interrupts disabled, so allocations made from interrupt
+   handlers are recorded as well.
+
+   When the trace is streamed, a thread drains the ring buffer into the file
+   every few milliseconds. In that mode, the ring isn't allowed to overwrite
+   records which haven't been written out yet; new ones are dropped and
+   counted instead, so that the heap state rebuilt from the file is only ever
+   missing records, never silently out of order. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <kos/alloc_trace.h>
+#include <kos/thread.h>
+#include <kos/fs.h>
+#include <arch/arch.h>
+#include <arch/irq.h>
+#include <arch/stack.h>
+#include <arch/timer.h>
+
+#ifdef MALLOC_TRACE
+
+/* How often the streaming thread empties the ring buffer. */
+#define ALLOC_TRACE_FLUSH_MS    10
+
+/* at_head counts every record ever made since alloc_trace_start(), and
+   at_tail the ones written out by the streaming thread. */
+static alloc_trace_rec_t *at_buf;
+static uint32_t at_mask;
+static uint32_t at_head;
+static volatile uint32_t at_tail;
+static uint32_t at_dropped;
+static volatile int at_active;
+
+static kthread_t *at_writer;
+static volatile int at_writer_quit;
+static file_t at_fd = -1;
+
+void alloc_trace_record(uint16_t op, void *ptr, uintptr_t arg, size_t size,
+                        uintptr_t pr, uintptr_t fp) {
+    uintptr_t callers[ALLOC_TRACE_DEPTH] = { 0 };
+    alloc_trace_rec_t *rec;
+    kthread_t *cur;
+    size_t i;
+
+    if(!at_active)
+        return;
+
+    cur = thd_get_current();
+
+    if(cur && cur == at_writer)
+        return;
+
+    /* Walk the stack before disabling interrupts. Without frame pointers,
+       only the immediate caller is known. */
+    if(!fp || !arch_stk_trace_collect(fp, callers, ALLOC_TRACE_DEPTH))
+        callers[0] = pr;
+
+    irq_disable_scoped();
+
+    if(!at_buf)
+        return;
+
+    if(at_writer && at_head - at_tail > at_mask) {
+        at_dropped++;
+        return;
+    }
+
+    rec = &at_buf[at_head++ & at_mask];
+    rec->time = (uint32_t)timer_us_gettime64();
+    rec->ptr = (uint32_t)(uintptr_t)ptr;
+    rec->arg = (uint32_t)arg;
+    rec->size = (uint32_t)size;
+    rec->tid = cur ? (uint16_t)cur->tid : 0;
+    rec->op = op;
+
+    for(i = 0; i < ALLOC_TRACE_DEPTH; i++)
+        rec->callers[i] = (uint32_t)callers[i];
+}
+
+void alloc_trace_mark(uint32_t arg) {
+    alloc_trace_record(ALLOC_OP_MARK, NULL, arg, 0, arch_get_ret_addr(), 0);
+}
+
+int alloc_trace_start(size_t count) {
+    alloc_trace_rec_t *buf;
+    size_t size = 1;
+
+    if(!count) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while(size < count)
+        size <<= 1;
+
+    alloc_trace_release();
+
+    if(!(buf = (alloc_trace_rec_t *)malloc(size * sizeof(alloc_trace_rec_t)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    irq_disable_scoped();
+
+    at_buf = buf;
+    at_mask = size - 1;
+    at_head = 0;
+    at_tail = 0;
+    at_dropped = 0;
+    at_active = 1;
+
+    return 0;
+}
+
+/* Collects the labels of all living threads for the trace header. */
+typedef struct {
+    alloc_trace_thread_t *thds;
+    uint32_t count;
+    uint32_t max;
+} at_thds_t;
+
+static int at_add_thread(kthread_t *thd, void *data) {
+    at_thds_t *t = (at_thds_t *)data;
+    alloc_trace_thread_t *ent;
+
+    if(t->count >= t->max)
+        return 1;
+
+    ent = &t->thds[t->count++];
+    ent->tid = thd->tid;
+    strncpy(ent->label, thd_get_label(thd), ALLOC_TRACE_LABEL_LEN - 1);
+    ent->label[ALLOC_TRACE_LABEL_LEN - 1] = '\0';
+
+    return 0;
+}
+
+static int at_count_thread(kthread_t *thd, void *data) {
+    (void)thd;
+    ++*(uint32_t *)data;
+
+    return 0;
+}
+
+static int at_write(file_t fd, const void *data, size_t size) {
+    if(fs_write(fd, data, size) != (ssize_t)size) {
+        errno = EIO;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Writes the header and thread labels. Must be called with recording
+   paused, since the thread list is built with malloc(). */
+static int at_write_header(file_t fd, uint32_t count, uint32_t dropped) {
+    alloc_trace_header_t hdr;
+    at_thds_t thds = { NULL, 0, 0 };
+    int rv;
+
+    thd_each(at_count_thread, &thds.max);
+    thds.thds = (alloc_trace_thread_t *)calloc(thds.max,
+                                               sizeof(alloc_trace_thread_t));
+
+    if(!thds.thds && thds.max) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    {
+        irq_disable_scoped();
+        thd_each(at_add_thread, &thds);
+    }
+
+    hdr.magic = ALLOC_TRACE_MAGIC;
+    hdr.version = ALLOC_TRACE_VERSION;
+    hdr.thread_count = thds.count;
+    hdr.record_count = count;
+    hdr.dropped = dropped;
+    hdr.mem_top = _arch_mem_top;
+
+    rv = at_write(fd, &hdr, sizeof(hdr));
+
+    if(!rv)
+        rv = at_write(fd, thds.thds, thds.count * sizeof(alloc_trace_thread_t));
+
+    free(thds.thds);
+
+    return rv;
+}
+
+/* Writes records [first, first + count) of the ring, oldest first. */
+static int at_write_records(file_t fd, uint32_t first, uint32_t count) {
+    uint32_t n;
+
+    while(count) {
+        n = at_mask + 1 - (first & at_mask);
+
+        if(n > count)
+            n = count;
+
+        if(at_write(fd, at_buf + (first & at_mask),
+                    n * sizeof(alloc_trace_rec_t)))
+            return -1;
+
+        first += n;
+        count -= n;
+    }
+
+    return 0;
+}
+
+/* Empties the ring buffer into the stream. */
+static void at_flush(void) {
+    alloc_trace_rec_t rec;
+    uint32_t head, dropped;
+
+    {
+        irq_disable_scoped();
+        head = at_head;
+        dropped = at_dropped;
+        at_dropped = 0;
+    }
+
+    if(head != at_tail) {
+        if(at_write_records(at_fd, at_tail, head - at_tail))
+            return;
+
+        at_tail = head;
+    }
+
+    if(dropped) {
+        memset(&rec, 0, sizeof(rec));
+        rec.time = (uint32_t)timer_us_gettime64();
+        rec.size = dropped;
+        rec.op = ALLOC_OP_DROPPED;
+        at_write(at_fd, &rec, sizeof(rec));
+    }
+}
+
+static void *at_writer_thd(void *param) {
+    int quit;
+
+    (void)param;
+
+    do {
+        quit = at_writer_quit;
+        at_flush();
+
+        if(!quit)
+            thd_sleep(ALLOC_TRACE_FLUSH_MS);
+    } while(!quit);
+
+    return NULL;
+}
+
+int alloc_trace_stream(const char *fn) {
+    int was_active = at_active;
+    uint32_t count, start;
+
+    if(!at_buf || at_writer) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    at_active = 0;
+
+    if((at_fd = fs_open(fn, O_WRONLY | O_CREAT | O_TRUNC)) < 0)
+        goto fail;
+
+    /* Write out what was recorded before streaming was asked for. */
+    count = at_head > at_mask ? at_mask + 1 : at_head;
+    start = at_head - count;
+
+    if(at_write_header(at_fd, ALLOC_TRACE_STREAMED, start) ||
+       at_write_records(at_fd, start, count))
+        goto fail_close;
+
+    at_tail = at_head;
+    at_writer_quit = 0;
+
+    if(!(at_writer = thd_create(false, at_writer_thd, NULL)))
+        goto fail_close;
+
+    thd_set_label(at_writer, "[alloc_trace]");
+    at_active = was_active;
+
+    return 0;
+
+fail_close:
+    fs_close(at_fd);
+    at_fd = -1;
+fail:
+    at_active = was_active;
+    return -1;
+}
+
+void alloc_trace_stop(void) {
+    at_active = 0;
+
+    if(at_writer) {
+        at_writer_quit = 1;
+        thd_join(at_writer, NULL);
+        at_writer = NULL;
+
+        fs_close(at_fd);
+        at_fd = -1;
+    }
+}
+
+void alloc_trace_release(void) {
+    alloc_trace_rec_t *buf;
+
+    alloc_trace_stop();
+
+    {
+        irq_disable_scoped();
+        buf = at_buf;
+        at_buf = NULL;
+    }
+
+    free(buf);
+}
+
+int alloc_trace_dump(const char *fn) {
+    int was_active = at_active, rv = -1;
+    uint32_t start, count;
+    file_t fd;
+
+    if(!at_buf || at_writer) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Pause recording while we write everything out, so that the buffer
+       doesn't change under us. */
+    at_active = 0;
+
+    count = at_head > at_mask ? at_mask + 1 : at_head;
+    start = at_head - count;
+
+    if((fd = fs_open(fn, O_WRONLY | O_CREAT | O_TRUNC)) >= 0) {
+        if(!at_write_header(fd, count, start) &&
+           !at_write_records(fd, start, count))
+            rv = 0;
+
+        fs_close(fd);
+    }
+
+    at_active = was_active;
+
+    return rv;
+}
+
+#else /* !MALLOC_TRACE */
+
+void alloc_trace_record(uint16_t op, void *ptr, uintptr_t arg, size_t size,
+                        uintptr_t pr, uintptr_t fp) {
+    (void)op;
+    (void)ptr;
+    (void)arg;
+    (void)size;
+    (void)pr;
+    (void)fp;
+}
+
+void alloc_trace_mark(uint32_t arg) {
+    (void)arg;
+}
+
+int alloc_trace_start(size_t count) {
+    (void)count;
+    errno = ENOSYS;
+    return -1;
+}
+
+int alloc_trace_stream(const char *fn) {
+    (void)fn;
+    errno = ENOSYS;
+    return -1;
+}
+
+void alloc_trace_stop(void) {
+}
+
+int alloc_trace_dump(const char *fn) {
+    (void)fn;
+    errno = ENOSYS;
+    return -1;
+}
+
+void alloc_trace_release(void) {
+}
+
+#endif /* MALLOC_TRACE */
@@ -0,0 +1,231 @@
+/* KallistiOS ##version##
+
+   kernel/debug/trace.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* This file implements the scheduler/interrupt event tracer described in
+   kos/trace.h. Events are stored in a power-of-two sized ring buffer, which
+   is only ever touched with interrupts disabled, so it's safe to record from
+   both threads and interrupt handlers. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <kos/trace.h>
+#include <kos/thread.h>
+#include <kos/fs.h>
+#include <arch/irq.h>
+#include <arch/timer.h>
+
+#ifdef KOS_TRACE
+
+/* The ring buffer itself. trace_head counts every event ever recorded since
+   trace_start(), so (trace_head & trace_mask) is the next slot to write and
+   anything more than trace_mask + 1 behind it has been overwritten. */
+static trace_event_t *trace_buf;
+static uint32_t trace_mask;
+static uint32_t trace_head;
+static volatile int trace_active;
+
+void trace_record_event(uint16_t type, uint32_t arg) {
+    kthread_t *cur;
+    trace_event_t *evt;
+
+    if(!trace_active)
+        return;
+
+    irq_disable_scoped();
+
+    /* Recording may have been stopped, or the buffer released, since the
+       check above. */
+    if(!trace_active || !trace_buf)
+        return;
+
+    cur = thd_get_current();
+    evt = &trace_buf[trace_head++ & trace_mask];
+    evt->time = timer_ns_gettime64();
+    evt->arg = arg;
+    evt->tid = cur ? (uint16_t)cur->tid : 0;
+    evt->type = type;
+}
+
+int trace_start(size_t count) {
+    trace_event_t *buf;
+    size_t size = 1;
+
+    if(!count) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while(size < count)
+        size <<= 1;
+
+    trace_release();
+
+    if(!(buf = (trace_event_t *)malloc(size * sizeof(trace_event_t)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    irq_disable_scoped();
+
+    trace_buf = buf;
+    trace_mask = size - 1;
+    trace_head = 0;
+    trace_active = 1;
+
+    return 0;
+}
+
+void trace_stop(void) {
+    trace_active = 0;
+}
+
+void trace_release(void) {
+    trace_event_t *buf;
+
+    {
+        irq_disable_scoped();
+
+        trace_active = 0;
+        buf = trace_buf;
+        trace_buf = NULL;
+    }
+
+    free(buf);
+}
+
+/* Collects the labels of all living threads for trace_dump(). */
+typedef struct {
+    trace_thread_t *thds;
+    uint32_t count;
+    uint32_t max;
+} trace_thds_t;
+
+static int trace_add_thread(kthread_t *thd, void *data) {
+    trace_thds_t *t = (trace_thds_t *)data;
+    trace_thread_t *ent;
+
+    if(t->count >= t->max)
+        return 1;
+
+    ent = &t->thds[t->count++];
+    ent->tid = thd->tid;
+    strncpy(ent->label, thd_get_label(thd), TRACE_LABEL_LEN - 1);
+    ent->label[TRACE_LABEL_LEN - 1] = '\0';
+
+    return 0;
+}
+
+static int trace_count_thread(kthread_t *thd, void *data) {
+    (void)thd;
+    ++*(uint32_t *)data;
+
+    return 0;
+}
+
+int trace_dump(const char *fn) {
+    trace_header_t hdr;
+    trace_thds_t thds = { NULL, 0, 0 };
+    uint32_t start, first, count;
+    int was_active = trace_active, rv = -1;
+    file_t fd;
+
+    if(!trace_buf) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Pause recording while we write everything out, so that the buffer
+       doesn't change under us. */
+    trace_active = 0;
+
+    thd_each(trace_count_thread, &thds.max);
+    thds.thds = (trace_thread_t *)calloc(thds.max, sizeof(trace_thread_t));
+
+    if(!thds.thds && thds.max) {
+        errno = ENOMEM;
+        goto out;
+    }
+
+    {
+        irq_disable_scoped();
+        thd_each(trace_add_thread, &thds);
+    }
+
+    count = trace_head > trace_mask ? trace_mask + 1 : trace_head;
+    start = trace_head - count;
+    first = start & trace_mask;
+
+    hdr.magic = TRACE_MAGIC;
+    hdr.version = TRACE_VERSION;
+    hdr.thread_count = thds.count;
+    hdr.event_count = count;
+    hdr.dropped = start;
+    hdr.reserved = 0;
+
+    if((fd = fs_open(fn, O_WRONLY | O_CREAT | O_TRUNC)) < 0)
+        goto out;
+
+    /* The oldest events sit from the write position to the end of the
+       buffer (if it has wrapped), and the rest from the start of it. */
+    if(fs_write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+       fs_write(fd, thds.thds, thds.count * sizeof(trace_thread_t)) !=
+            (ssize_t)(thds.count * sizeof(trace_thread_t)))
+        goto out_close;
+
+    if(first + count > trace_mask + 1) {
+        if(fs_write(fd, trace_buf + first,
+                    (trace_mask + 1 - first) * sizeof(trace_event_t)) !=
+                (ssize_t)((trace_mask + 1 - first) * sizeof(trace_event_t)))
+            goto out_close;
+
+        count -= trace_mask + 1 - first;
+        first = 0;
+    }
+
+    if(fs_write(fd, trace_buf + first, count * sizeof(trace_event_t)) ==
+            (ssize_t)(count * sizeof(trace_event_t)))
+        rv = 0;
+
+out_close:
+    if(rv)
+        errno = EIO;
+
+    fs_close(fd);
+out:
+    free(thds.thds);
+    trace_active = was_active;
+
+    return rv;
+}
+
+#else /* !KOS_TRACE */
+
+void trace_record_event(uint16_t type, uint32_t arg) {
+    (void)type;
+    (void)arg;
+}
+
+int trace_start(size_t count) {
+    (void)count;
+    errno = ENOSYS;
+    return -1;
+}
+
+void trace_stop(void) {
+}
+
+int trace_dump(const char *fn) {
+    (void)fn;
+    errno = ENOSYS;
+    return -1;
+}
+
+void trace_release(void) {
+}
+
+#endif /* KOS_TRACE */
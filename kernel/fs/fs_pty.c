@@ -28,6 +28,7 @@ or space present.
 #include <kos/mutex.h>
 #include <kos/cond.h>
 #include <kos/fs_pty.h>
+#include <kos/ringbuf.h>
 
 #include <arch/types.h>
 
@@ -57,8 +58,7 @@ typedef struct ptyhalf {
     int master;             /* Non-zero if we are master */
 
     uint8   buffer[PTY_BUFFER_SIZE];    /* Our _receive_ buffer */
-    int head, tail;         /* Insert at head, remove at tail */
-    size_t cnt;             /* Byte count in the queue */
+    ringbuf_t rb;           /* Queue in that buffer */
 
     int refcnt;             /* When this reaches zero, we close */
 
@@ -150,9 +150,8 @@ int fs_pty_create(char *buffer, int maxbuflen, file_t *master_out, file_t *slave
     slave->master = 0;
 
     /* Reset their queue pointers */
-    master->head = master->tail = 0;
-    slave->head = slave->tail = 0;
-    master->cnt = slave->cnt = 0;
+    ringbuf_init(&master->rb, master->buffer, PTY_BUFFER_SIZE, 1);
+    ringbuf_init(&slave->rb, slave->buffer, PTY_BUFFER_SIZE, 1);
 
     /* Reset their refcnts (these will get increased in a minute) */
     master->refcnt = slave->refcnt = 0;
@@ -303,7 +302,7 @@ static void * pty_open_dir(const char * fn, int mode) {
         else
             sprintf(dl->items[cnt].name, "sl%02x", ph->id);
 
-        dl->items[cnt].size = ph->cnt;
+        dl->items[cnt].size = ringbuf_used(&ph->rb);
         cnt++;
     }
 
@@ -500,7 +499,6 @@ static ssize_t pty_read_serial(pipefd_t * fdobj, ptyhalf_t * ph, void * buf, siz
 
 /* Read from a pty endpoint */
 static ssize_t pty_read(void * h, void * buf, size_t bytes) {
-    size_t avail;
     pipefd_t *fdobj;
     ptyhalf_t *ph;
 
@@ -520,7 +518,7 @@ static ssize_t pty_read(void * h, void * buf, size_t bytes) {
     mutex_lock(&ph->mutex);
 
     /* Is there anything to read? */
-    while(!ph->cnt && ph->other->refcnt > 0) {
+    while(!ringbuf_used(&ph->rb) && ph->other->refcnt > 0) {
         /* If we're in non-block, give up now */
         if(fdobj->mode & O_NONBLOCK) {
             errno = EAGAIN;
@@ -532,28 +530,13 @@ static ssize_t pty_read(void * h, void * buf, size_t bytes) {
     }
 
     /* If the buffer is empty and the other end is closed, return 0 */
-    if(!ph->cnt && ph->other->refcnt == 0) {
+    if(!ringbuf_used(&ph->rb) && ph->other->refcnt == 0) {
         bytes = 0;
         goto done;
     }
 
-    /* Figure out how much to read */
-    avail = ph->cnt;
-
-    if(avail < bytes)
-        bytes = avail;
-
-    /* Copy out the data and remove it from the buffer */
-    if((ph->head + bytes) > PTY_BUFFER_SIZE) {
-        avail = PTY_BUFFER_SIZE - ph->head;
-        memcpy(buf, ph->buffer + ph->head, avail);
-        memcpy(((uint8 *)buf) + avail, ph->buffer, bytes - avail);
-    }
-    else
-        memcpy(buf, ph->buffer + ph->head, bytes);
-
-    ph->head = (ph->head + bytes) % PTY_BUFFER_SIZE;
-    ph->cnt -= bytes;
+    /* Copy out as much data as we can and remove it from the buffer */
+    bytes = ringbuf_read(&ph->rb, buf, bytes);
 
     /* Wake anyone waiting for write space */
     cond_broadcast(&ph->ready_write);
@@ -565,7 +548,6 @@ done:
 
 /* Write to a pty endpoint */
 static ssize_t pty_write(void * h, const void * buf, size_t bytes) {
-    size_t avail;
     pipefd_t *fdobj;
     ptyhalf_t *ph;
 
@@ -591,7 +573,7 @@ static ssize_t pty_write(void * h, const void * buf, size_t bytes) {
     mutex_lock(&ph->mutex);
 
     /* Is there any room to write? */
-    while(ph->cnt >= PTY_BUFFER_SIZE && ph->refcnt > 0) {
+    while(!ringbuf_space(&ph->rb) && ph->refcnt > 0) {
         /* If we're in non-block, give up now */
         if(fdobj->mode & O_NONBLOCK) {
             errno = EAGAIN;
@@ -603,28 +585,13 @@ static ssize_t pty_write(void * h, const void * buf, size_t bytes) {
     }
 
     /* If the buffer is full and the other end is closed, return 0 */
-    if(ph->cnt >= PTY_BUFFER_SIZE && ph->refcnt == 0) {
+    if(!ringbuf_space(&ph->rb) && ph->refcnt == 0) {
         bytes = 0;
         goto done;
     }
 
-    /* Figure out how much to write */
-    avail = PTY_BUFFER_SIZE - ph->cnt;
-    if(avail < bytes)
-        bytes = avail;
-
-    /* Copy in the data and add it from the buffer */
-    if((ph->tail + bytes) > PTY_BUFFER_SIZE) {
-        avail = PTY_BUFFER_SIZE - ph->tail;
-        memcpy(ph->buffer + ph->tail, buf, avail);
-        memcpy(ph->buffer, ((const uint8 *)buf) + avail, bytes - avail);
-    }
-    else
-        memcpy(ph->buffer + ph->tail, buf, bytes);
-
-    ph->tail = (ph->tail + bytes) % PTY_BUFFER_SIZE;
-    ph->cnt += bytes;
-    assert(ph->cnt <= PTY_BUFFER_SIZE);
+    /* Copy in as much data as fits */
+    bytes = ringbuf_write(&ph->rb, buf, bytes);
 
     /* Wake anyone waiting on read */
     cond_broadcast(&ph->ready_read);
@@ -647,7 +614,7 @@ static size_t pty_total(void * h) {
         return -1;
     }
 
-    return ph->cnt;
+    return ringbuf_used(&ph->rb);
 }
 
 /* Read a directory entry */
@@ -730,7 +697,7 @@ static int pty_stat(vfs_handler_t *vfs, const char *path, struct stat *st,
     st->st_dev = (dev_t)('p' | ('t' << 8) | ('y' << 16));
     st->st_mode = S_IFCHR | S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
     st->st_nlink = 1;
-    st->st_size = ph->cnt;
+    st->st_size = ringbuf_used(&ph->rb);
     st->st_blksize = PTY_BUFFER_SIZE;
 
     return 0;
@@ -803,7 +770,7 @@ static int pty_fstat(void *h, struct stat *st) {
     st->st_mode = (fd->mode & O_DIR) ? 
         (S_IFDIR | S_IRWXU | S_IRWXG | S_IRWXO) : 
         (S_IFCHR | S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
-    st->st_size = (fd->mode & O_DIR) ? -1 : (off_t)fd->d.p->cnt;
+    st->st_size = (fd->mode & O_DIR) ? -1 : (off_t)ringbuf_used(&fd->d.p->rb);
     st->st_blksize = (fd->mode & O_DIR) ? 0 : 1;
 
     return 0;
@@ -5,8 +5,13 @@
 */
 
 /* This file provides the additional symbols required to provide
-   support for C11 atomics with the "-matomic-model=soft-imask"
-   build flag.
+   support for C11 atomics with the "-matomic-model=soft-imask" or
+   "-matomic-model=soft-gusa" build flags.
+
+   With either model, GCC inlines atomics on types of up to 32 bits itself,
+   and calls out to here for 64-bit and generically-sized types. The kernel
+   always rolls back interrupted gUSA sequences, so code built with either
+   model can be freely mixed, and the functions below work for both.
 */
 
 #include <arch/arch.h>
@@ -21,14 +26,6 @@
    For these types, we simply disable interrupts then re-enable them
    around accesses to our atomics to ensure their atomicity.
 */
-#define ATOMIC_LOAD_N_(type, n) \
-    type \
-    __atomic_load_##n(const volatile void *ptr, int model) { \
-        (void)model; \
-        irq_disable_scoped(); \
-        return *(type *)ptr; \
-    }
-
 #define ATOMIC_STORE_N_(type, n) \
     void \
     __atomic_store_##n(volatile void *ptr, type val, int model) { \
@@ -92,8 +89,34 @@
         return ret;  \
     }
 
-/* GCC provides us with all primitive atomics except for 64-bit types. */
-ATOMIC_LOAD_N_(unsigned long long, 8)
+/* GCC provides us with all primitive atomics except for 64-bit types.
+
+   A 64-bit load is done as a gUSA restartable sequence (see entry.s) made
+   of two loads and no store: if it gets interrupted halfway, it's simply
+   restarted, so it never returns a torn value and doesn't have to touch SR.
+   Everything that writes to memory needs the two halves to be stored as one,
+   which a gUSA sequence can't do, so those still mask interrupts. */
+unsigned long long
+__atomic_load_8(const volatile void *ptr, int model) {
+    uint32_t lo, hi;
+
+    (void)model;
+
+    __asm__ __volatile__(
+        "   mova    1f, r0\n"
+        "   .align  2\n"
+        "   mov     r15, r1\n"
+        "   mov     #(0f-1f), r15\n"
+        "0: mov.l   @%2, %0\n"
+        "   mov.l   @(4,%2), %1\n"
+        "1: mov     r1, r15\n"
+        : "=&r"(lo), "=&r"(hi)
+        : "r"(ptr)
+        : "r0", "r1", "memory");
+
+    return ((unsigned long long)hi << 32) | lo;
+}
+
 ATOMIC_STORE_N_(unsigned long long, 8)
 ATOMIC_EXCHANGE_N_(unsigned long long, 8)
 ATOMIC_COMPARE_EXCHANGE_N_(unsigned long long, 8)
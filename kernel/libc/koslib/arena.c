@@ -0,0 +1,100 @@
+/* KallistiOS ##version##
+
+   arena.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* Arena allocator. Most of it is inline in kos/arena.h; this only holds
+   what needs to go through the heap, or is too large to inline. */
+
+#include <kos/arena.h>
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdlib.h>
+
+int arena_init(arena_t *arena, void *mem, size_t size) {
+    int owned = 0;
+
+    if((uintptr_t)mem & (ARENA_ALIGN - 1)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Only whole cache lines are handed out. */
+    size &= ~(size_t)(ARENA_ALIGN - 1);
+
+    if(!mem) {
+        if(!(mem = memalign(ARENA_ALIGN, size))) {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        owned = 1;
+    }
+
+    arena->base = (uint8_t *)mem;
+    arena->size = size;
+    arena->used = 0;
+    arena->peak = 0;
+    arena->owned = owned;
+
+    return 0;
+}
+
+void arena_destroy(arena_t *arena) {
+    if(arena->owned)
+        free(arena->base);
+
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+    arena->owned = 0;
+}
+
+void *arena_alloc_aligned(arena_t *arena, size_t align, size_t size) {
+    uintptr_t start;
+    size_t pad, used = arena->used;
+    void *ptr;
+
+    if(align <= ARENA_ALIGN)
+        return arena_alloc(arena, size);
+
+    /* Skip over enough of the arena to reach the requested alignment. */
+    start = (uintptr_t)arena->base + arena->used;
+    pad = ((start + align - 1) & ~(uintptr_t)(align - 1)) - start;
+
+    if(pad > arena->size - arena->used)
+        return NULL;
+
+    arena->used += pad;
+
+    if(!(ptr = arena_alloc(arena, size)))
+        arena->used = used;
+
+    return ptr;
+}
+
+int arena_frame_init(arena_frame_t *frame, void *mem, size_t size) {
+    size_t half = (size / 2) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if(arena_init(&frame->arenas[0], mem, half * 2))
+        return -1;
+
+    /* The second arena shares the first one's memory, so only the first one
+       owns it. */
+    frame->arenas[0].size = half;
+    frame->arenas[1] = frame->arenas[0];
+    frame->arenas[1].base += half;
+    frame->arenas[1].owned = 0;
+    frame->current = 0;
+
+    return 0;
+}
+
+void arena_frame_destroy(arena_frame_t *frame) {
+    arena_destroy(&frame->arenas[0]);
+    frame->arenas[1].base = NULL;
+    frame->arenas[1].size = 0;
+    frame->arenas[1].used = 0;
+}
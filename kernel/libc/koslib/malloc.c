@@ -25,6 +25,8 @@
 
 #include <kos/dbglog.h>
 #include <kos/opts.h>
+#include <kos/slab.h>
+#include <kos/alloc_trace.h>
 
 #undef DEBUG
 
@@ -35,6 +37,12 @@
 #define DEBUG 1
 #endif
 
+/* Serve small allocations from the size class front-end (see kos/slab.h),
+   unless we're tracking every single block. */
+#if !defined(KM_DBG) && !defined(MALLOC_NO_SLAB)
+#define USE_SLAB 1
+#endif
+
 /* KOS specific things */
 #define USE_MALLOC_LOCK
 #define HAVE_MMAP 0
@@ -634,6 +642,23 @@ extern "C" {
 #define public_iCOMALLOc independent_comalloc
 #endif /* USE_DL_PREFIX */
 
+#ifdef MALLOC_TRACE
+/* With the allocation tracer, the public functions are thin wrappers which
+   record each call (see the end of the KOS code below). Calls made from
+   within the allocator itself go to the untraced versions, so that they
+   aren't recorded twice. */
+#undef public_cALLOc
+#undef public_fREe
+#undef public_mALLOc
+#undef public_mEMALIGn
+#undef public_rEALLOc
+#define public_cALLOc    __calloc_untraced
+#define public_fREe      __free_untraced
+#define public_mALLOc    __malloc_untraced
+#define public_mEMALIGn  __memalign_untraced
+#define public_rEALLOc   __realloc_untraced
+#endif /* MALLOC_TRACE */
+
 
     /*
       HAVE_MEMCPY should be defined if you are not otherwise using
@@ -1785,6 +1810,11 @@ Void_t* public_mALLOc(size_t bytes) {
     memctl_t * ctl;
 #endif
 
+#ifdef USE_SLAB
+    if(bytes <= SLAB_MAX_SIZE && (m = slab_alloc(bytes)))
+        return m;
+#endif
+
     if(MALLOC_PREACTION != 0) {
         return 0;
     }
@@ -1846,6 +1876,11 @@ void public_fREe(Void_t* m) {
     if(m == NULL)
         return;
 
+#ifdef USE_SLAB
+    if(slab_free(m))
+        return;
+#endif
+
     if(MALLOC_PREACTION != 0) {
         return;
     }
@@ -1920,6 +1955,27 @@ Void_t* public_rEALLOc(Void_t* m, size_t bytes) {
     memctl_t * ctl;
     int dmg = 0;
 #endif
+#ifdef USE_SLAB
+    Void_t* n;
+    size_t size;
+
+    if(m == NULL)
+        return public_mALLOc(bytes);
+
+    /* Small objects stay where they are if they still fit, or move to
+       wherever malloc() puts the new size otherwise. */
+    if((size = slab_usable_size(m))) {
+        if(bytes <= size)
+            return m;
+
+        if(!(n = public_mALLOc(bytes)))
+            return 0;
+
+        memcpy(n, m, size);
+        slab_free(m);
+        return n;
+    }
+#endif
 
     if(MALLOC_PREACTION != 0) {
         return 0;
@@ -2088,6 +2144,14 @@ Void_t* public_cALLOc(size_t n, size_t elem_size) {
     memctl_t * ctl;
 #endif
 
+#ifdef USE_SLAB
+    if((!elem_size || n <= SLAB_MAX_SIZE / elem_size) &&
+       (m = slab_alloc(n * elem_size))) {
+        memset(m, 0, n * elem_size);
+        return m;
+    }
+#endif
+
     if(MALLOC_PREACTION != 0) {
         return 0;
     }
@@ -2177,6 +2241,11 @@ int public_mTRIm(size_t s) {
 size_t public_mUSABLe(Void_t* m) {
     size_t result;
 
+#ifdef USE_SLAB
+    if((result = slab_usable_size(m)))
+        return result;
+#endif
+
     if(MALLOC_PREACTION != 0) {
         return 0;
     }
@@ -2222,6 +2291,60 @@ void public_mSTATs(void) {
     }
 }
 
+#ifdef MALLOC_TRACE
+
+/* The caller's return address has to be read before anything else is
+   called. When KM_DBG is enabled too, the addresses it records are those of
+   these wrappers. */
+#define ALLOC_TRACE(op, m, arg, bytes, pr) \
+    alloc_trace_record((op), (m), (uintptr_t)(arg), (bytes), (pr), \
+                       arch_get_fptr())
+
+Void_t* malloc(size_t bytes) {
+    uintptr_t pr = arch_get_ret_addr();
+    Void_t* m = public_mALLOc(bytes);
+
+    ALLOC_TRACE(ALLOC_OP_MALLOC, m, 0, bytes, pr);
+    return m;
+}
+
+Void_t* calloc(size_t n, size_t elem_size) {
+    uintptr_t pr = arch_get_ret_addr();
+    Void_t* m = public_cALLOc(n, elem_size);
+
+    ALLOC_TRACE(ALLOC_OP_CALLOC, m, 0, n * elem_size, pr);
+    return m;
+}
+
+Void_t* realloc(Void_t* old, size_t bytes) {
+    uintptr_t pr = arch_get_ret_addr();
+    Void_t* m = public_rEALLOc(old, bytes);
+
+    ALLOC_TRACE(ALLOC_OP_REALLOC, m, old, bytes, pr);
+    return m;
+}
+
+Void_t* memalign(size_t alignment, size_t bytes) {
+    uintptr_t pr = arch_get_ret_addr();
+    Void_t* m = public_mEMALIGn(alignment, bytes);
+
+    ALLOC_TRACE(ALLOC_OP_MEMALIGN, m, alignment, bytes, pr);
+    return m;
+}
+
+void free(Void_t* m) {
+    uintptr_t pr = arch_get_ret_addr();
+
+    /* Record this first: once the block is freed, another thread could get
+       it back and record that before we do. */
+    if(m)
+        ALLOC_TRACE(ALLOC_OP_FREE, m, 0, 0, pr);
+
+    public_fREe(m);
+}
+
+#endif /* MALLOC_TRACE */
+
 /*** End KOS Code ***/
 /******************************************************************************************************/
 /*** Begin Code Removed for KOS ***/
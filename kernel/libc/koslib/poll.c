@@ -13,6 +13,7 @@
 #include <kos/fs.h>
 #include <kos/mutex.h>
 #include <kos/cond.h>
+#include <kos/genwait.h>
 
 struct poll_int {
     LIST_ENTRY(poll_int) entry;
@@ -32,6 +33,10 @@ void __poll_event_trigger(int fd, short event) {
     int gotone = 0;
     short mask;
 
+    /* Wake up anyone waiting on the fd with thd_wait_multiple(). */
+    if(fd >= 0 && fd < FD_SETSIZE)
+        genwait_wake_all(&fd_table[fd]);
+
     if(mutex_lock_irqsafe(&mutex))
         /* XXXX: Uhh... this is bad... */
         return;
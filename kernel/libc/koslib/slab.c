@@ -0,0 +1,361 @@
+/* KallistiOS ##version##
+
+   slab.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* Small object front-end for malloc(). See kos/slab.h for the big picture.
+
+   Every page starts with a slab_page_t header, followed by as many objects of
+   its size class as fit. Free objects are chained through their first word.
+   Each class keeps a list of the pages that still have free objects; full
+   pages are off the list until one of their objects is freed.
+
+   To tell small objects from regular heap blocks in free(), a bitmap has one
+   bit per page of RAM, set for the pages belonging to us. Pages are taken
+   from the heap with memalign(), so a page is either entirely ours or not at
+   all.
+
+   The lists are protected by disabling interrupts, which makes allocating
+   and freeing objects safe in interrupt handlers. Taking pages from or giving
+   them back to the heap is only done when malloc() itself would be allowed.
+
+   This file can also be built on a host (see utils/slabbench), in which case
+   the includer provides the page source and memory range. */
+
+#include <kos/opts.h>
+#include <kos/slab.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/queue.h>
+
+#ifndef SLAB_HOST
+
+#include <malloc.h>
+#include <arch/arch.h>
+#include <arch/irq.h>
+
+/* Covers the whole of RAM, including the upper half of 32MB systems. */
+#define SLAB_MEM_BASE       0x8c000000
+#define SLAB_MEM_SIZE       HW_MEM_32
+
+#ifdef MALLOC_TRACE
+/* The objects are traced by malloc() and free() themselves, so the pages
+   they live in must not show up in the trace as well. */
+void *__memalign_untraced(size_t alignment, size_t bytes);
+void __free_untraced(void *m);
+
+#define slab_page_alloc()   __memalign_untraced(SLAB_PAGE_SIZE, SLAB_PAGE_SIZE)
+#define slab_page_free(p)   __free_untraced(p)
+#else
+#define slab_page_alloc()   memalign(SLAB_PAGE_SIZE, SLAB_PAGE_SIZE)
+#define slab_page_free(p)   free(p)
+#endif
+
+/* Whether pages can be taken from or given back to the heap right now. */
+#define slab_heap_ok()      (!irq_inside_int() || malloc_irq_safe())
+
+#define SLAB_LOCK()         int __slab_irq = irq_disable()
+#define SLAB_UNLOCK()       irq_restore(__slab_irq)
+#define SLAB_RELOCK()       __slab_irq = irq_disable()
+
+#endif /* !SLAB_HOST */
+
+#define SLAB_BITMAP_WORDS   (SLAB_MEM_SIZE / SLAB_PAGE_SIZE / 32)
+
+typedef struct slab_page {
+    LIST_ENTRY(slab_page) entry;    /* Link on the class' partial list */
+    void *free;                     /* First free object */
+    uint16_t used;                  /* Objects allocated */
+    uint16_t count;                 /* Objects in the page */
+    uint8_t cls;                    /* Size class */
+    uint8_t listed;                 /* On the partial list? */
+} slab_page_t;
+
+/* Objects start after the header, rounded up to keep 8-byte alignment. */
+#define SLAB_HDR_SIZE       ((sizeof(slab_page_t) + 7) & ~7)
+
+typedef struct slab_class {
+    LIST_HEAD(, slab_page) partial;
+    size_t pages;
+    size_t empty;
+    size_t reserved;
+    size_t used;
+    size_t peak;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t fails;
+} slab_class_t;
+
+static const uint16_t slab_sizes[SLAB_CLASS_COUNT] = {
+    8, 16, 24, 32, 48, 64, 80, 96, 128, 160, 192, 256
+};
+
+/* Size class of each size, in 8 byte steps. */
+static const uint8_t slab_lookup[SLAB_MAX_SIZE / 8 + 1] = {
+    0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 8, 8,
+    9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 11
+};
+
+static slab_class_t slab_classes[SLAB_CLASS_COUNT];
+static uint32_t slab_bitmap[SLAB_BITMAP_WORDS];
+
+static inline size_t slab_page_index(const void *ptr) {
+    return ((uintptr_t)ptr - SLAB_MEM_BASE) / SLAB_PAGE_SIZE;
+}
+
+static inline bool slab_owns(const void *ptr) {
+    size_t idx;
+
+    if((uintptr_t)ptr - SLAB_MEM_BASE >= SLAB_MEM_SIZE)
+        return false;
+
+    idx = slab_page_index(ptr);
+    return slab_bitmap[idx / 32] & (1u << (idx % 32));
+}
+
+static inline slab_page_t *slab_page_of(const void *ptr) {
+    return (slab_page_t *)((uintptr_t)ptr & ~(uintptr_t)(SLAB_PAGE_SIZE - 1));
+}
+
+/* Get a new page from the heap and hand it over to a size class. */
+static bool slab_grow(unsigned int cls) {
+    slab_class_t *c = &slab_classes[cls];
+    slab_page_t *pg;
+    size_t size = slab_sizes[cls], idx, i;
+    char *obj;
+
+    if(!slab_heap_ok())
+        return false;
+
+    pg = (slab_page_t *)slab_page_alloc();
+
+    if(!pg)
+        return false;
+
+    /* Pages outside the bitmap would be freed to the wrong place. This can't
+       happen on the console, but keep it safe. */
+    if((uintptr_t)pg - SLAB_MEM_BASE >= SLAB_MEM_SIZE) {
+        slab_page_free(pg);
+        return false;
+    }
+
+    pg->cls = cls;
+    pg->used = 0;
+    pg->count = (SLAB_PAGE_SIZE - SLAB_HDR_SIZE) / size;
+    pg->free = NULL;
+
+    /* Chain up the objects, so that they're handed out in address order. */
+    obj = (char *)pg + SLAB_HDR_SIZE + (pg->count - 1) * size;
+
+    for(i = 0; i < pg->count; i++, obj -= size) {
+        *(void **)obj = pg->free;
+        pg->free = obj;
+    }
+
+    idx = slab_page_index(pg);
+
+    SLAB_LOCK();
+    slab_bitmap[idx / 32] |= 1u << (idx % 32);
+    LIST_INSERT_HEAD(&c->partial, pg, entry);
+    pg->listed = 1;
+    c->pages++;
+    c->empty++;
+    SLAB_UNLOCK();
+
+    return true;
+}
+
+void *slab_alloc(size_t size) {
+    unsigned int cls;
+    slab_class_t *c;
+    slab_page_t *pg;
+    void *obj;
+
+    if(size > SLAB_MAX_SIZE)
+        return NULL;
+
+    cls = slab_lookup[(size + 7) / 8];
+    c = &slab_classes[cls];
+
+    SLAB_LOCK();
+
+    while(!(pg = LIST_FIRST(&c->partial))) {
+        SLAB_UNLOCK();
+
+        if(!slab_grow(cls)) {
+            SLAB_RELOCK();
+            c->fails++;
+            SLAB_UNLOCK();
+            return NULL;
+        }
+
+        SLAB_RELOCK();
+    }
+
+    obj = pg->free;
+    pg->free = *(void **)obj;
+
+    if(!pg->used++)
+        c->empty--;
+
+    if(!pg->free) {
+        LIST_REMOVE(pg, entry);
+        pg->listed = 0;
+    }
+
+    if(++c->used > c->peak)
+        c->peak = c->used;
+
+    c->allocs++;
+
+    SLAB_UNLOCK();
+
+    return obj;
+}
+
+int slab_free(void *ptr) {
+    slab_page_t *pg, *release = NULL;
+    slab_class_t *c;
+    size_t idx;
+
+    /* The page of a live object can't change owner under our feet, so this
+       doesn't need the lock. */
+    if(!slab_owns(ptr))
+        return 0;
+
+    pg = slab_page_of(ptr);
+    c = &slab_classes[pg->cls];
+
+    SLAB_LOCK();
+
+    *(void **)ptr = pg->free;
+    pg->free = ptr;
+
+    if(!pg->listed) {
+        LIST_INSERT_HEAD(&c->partial, pg, entry);
+        pg->listed = 1;
+    }
+
+    c->used--;
+    c->frees++;
+
+    /* Give the page back if it's empty, unless it's the only empty one left
+       or it's needed for the reserve. */
+    if(!--pg->used && ++c->empty > 1 && c->pages > c->reserved &&
+       slab_heap_ok()) {
+        LIST_REMOVE(pg, entry);
+        c->pages--;
+        c->empty--;
+
+        idx = slab_page_index(pg);
+        slab_bitmap[idx / 32] &= ~(1u << (idx % 32));
+        release = pg;
+    }
+
+    SLAB_UNLOCK();
+
+    if(release)
+        slab_page_free(release);
+
+    return 1;
+}
+
+size_t slab_usable_size(void *ptr) {
+    if(!slab_owns(ptr))
+        return 0;
+
+    return slab_sizes[slab_page_of(ptr)->cls];
+}
+
+int slab_reserve(size_t size, size_t count) {
+    unsigned int cls;
+    size_t per_page, pages;
+    slab_class_t *c;
+
+#if defined(KM_DBG) || defined(MALLOC_NO_SLAB)
+    /* malloc() won't ever use the pages. */
+    size = SLAB_MAX_SIZE + 1;
+#endif
+
+    if(size > SLAB_MAX_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    cls = slab_lookup[(size + 7) / 8];
+    c = &slab_classes[cls];
+    per_page = (SLAB_PAGE_SIZE - SLAB_HDR_SIZE) / slab_sizes[cls];
+    pages = (count + per_page - 1) / per_page;
+
+    SLAB_LOCK();
+    if(pages > c->reserved)
+        c->reserved = pages;
+    SLAB_UNLOCK();
+
+    while(c->pages < pages) {
+        if(!slab_grow(cls)) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int slab_get_stats(unsigned int cls, slab_stats_t *stats) {
+    slab_class_t *c;
+    size_t per_page;
+
+    if(cls >= SLAB_CLASS_COUNT) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    c = &slab_classes[cls];
+    per_page = (SLAB_PAGE_SIZE - SLAB_HDR_SIZE) / slab_sizes[cls];
+
+    SLAB_LOCK();
+    stats->obj_size = slab_sizes[cls];
+    stats->pages = c->pages;
+    stats->reserved_pages = c->reserved;
+    stats->used = c->used;
+    stats->free = c->pages * per_page - c->used;
+    stats->peak = c->peak;
+    stats->allocs = c->allocs;
+    stats->frees = c->frees;
+    stats->fails = c->fails;
+    SLAB_UNLOCK();
+
+    return 0;
+}
+
+int slab_print_stats(int (*pf)(const char *fmt, ...)) {
+    size_t pages = 0, bytes = 0;
+    slab_stats_t st;
+    unsigned int i;
+
+    pf("Small object classes:\n");
+    pf("size\tpages\t    used\t    free\t    peak\t  allocs\t   fails\n");
+
+    for(i = 0; i < SLAB_CLASS_COUNT; i++) {
+        slab_get_stats(i, &st);
+
+        pf("%lu\t%5lu\t%8lu\t%8lu\t%8lu\t%8lu\t%8lu\n",
+           (unsigned long)st.obj_size, (unsigned long)st.pages,
+           (unsigned long)st.used, (unsigned long)st.free,
+           (unsigned long)st.peak, (unsigned long)st.allocs,
+           (unsigned long)st.fails);
+
+        pages += st.pages;
+        bytes += st.used * st.obj_size;
+    }
+
+    pf("%lu pages (%lu bytes) holding %lu bytes of objects\n",
+       (unsigned long)pages, (unsigned long)(pages * SLAB_PAGE_SIZE),
+       (unsigned long)bytes);
+
+    return 0;
+}
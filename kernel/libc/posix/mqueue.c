@@ -0,0 +1,337 @@
+/* KallistiOS ##version##
+
+   mqueue.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+#include <kos/msgqueue.h>
+#include <kos/mutex.h>
+#include <kos/limits.h>
+
+#include <mqueue.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/queue.h>
+
+/* A named queue. The slots of the message queue are allocated along with it,
+   right after the structure. */
+typedef struct mq_queue {
+    LIST_ENTRY(mq_queue) entry;
+    msgqueue_t msgq;
+    int refs;
+    int unlinked;
+    char name[NAME_MAX + 1];
+} __attribute__((aligned(8))) mq_queue_t;
+
+/* An open descriptor. */
+typedef struct mq_desc {
+    mq_queue_t *queue;
+    int flags;
+} mq_desc_t;
+
+static LIST_HEAD(, mq_queue) mq_list = LIST_HEAD_INITIALIZER(mq_list);
+static mq_desc_t mq_descs[MQ_OPEN_MAX];
+static mutex_t mq_mutex = MUTEX_INITIALIZER;
+
+static mq_queue_t *mq_find(const char *name) {
+    mq_queue_t *mq;
+
+    LIST_FOREACH(mq, &mq_list, entry) {
+        if(!strcmp(mq->name, name))
+            return mq;
+    }
+
+    return NULL;
+}
+
+static mq_queue_t *mq_create(const char *name, const struct mq_attr *attr) {
+    long maxmsg = MQ_DEFAULT_MAXMSG, msgsize = MQ_DEFAULT_MSGSIZE;
+    mq_queue_t *mq;
+
+    if(attr) {
+        maxmsg = attr->mq_maxmsg;
+        msgsize = attr->mq_msgsize;
+
+        if(maxmsg <= 0 || msgsize <= 0 || msgsize > INT32_MAX - 16 ||
+           (size_t)maxmsg > (SIZE_MAX - sizeof(mq_queue_t)) /
+                            MSGQ_STORAGE_SIZE((size_t)msgsize, 1)) {
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+
+    mq = aligned_alloc(8, sizeof(mq_queue_t) +
+                       MSGQ_STORAGE_SIZE((size_t)msgsize, (size_t)maxmsg));
+    if(!mq) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    msgq_init(&mq->msgq, msgsize, maxmsg, mq + 1);
+    mq->refs = 0;
+    mq->unlinked = 0;
+    strcpy(mq->name, name);
+    LIST_INSERT_HEAD(&mq_list, mq, entry);
+
+    return mq;
+}
+
+/* Drop a reference to a queue, freeing it if it was the last one and its
+   name is gone. The mutex must be held. */
+static void mq_release(mq_queue_t *mq) {
+    if(--mq->refs == 0 && mq->unlinked) {
+        msgq_destroy(&mq->msgq);
+        free(mq);
+    }
+}
+
+static mq_desc_t *mq_get(mqd_t mqdes) {
+    if(mqdes < 0 || mqdes >= MQ_OPEN_MAX || !mq_descs[mqdes].queue) {
+        errno = EBADF;
+        return NULL;
+    }
+
+    return &mq_descs[mqdes];
+}
+
+/* Turn an absolute CLOCK_REALTIME time into a relative timeout in
+   milliseconds, rounded up. Returns 0 if the time has already passed. */
+static int mq_timeout(const struct timespec *abstime) {
+    struct timespec now;
+    int64_t ns;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    ns = (int64_t)(abstime->tv_sec - now.tv_sec) * 1000000000LL +
+         (abstime->tv_nsec - now.tv_nsec);
+
+    if(ns <= 0)
+        return 0;
+
+    if(ns >= (int64_t)INT32_MAX * 1000000LL)
+        return INT32_MAX;
+
+    return (int)((ns + 999999) / 1000000);
+}
+
+mqd_t mq_open(const char *name, int oflag, ...) {
+    struct mq_attr *attr = NULL;
+    mq_queue_t *mq;
+    mqd_t mqdes;
+    va_list ap;
+
+    if(!name || name[0] != '/') {
+        errno = EINVAL;
+        return (mqd_t)-1;
+    }
+
+    if(strlen(name) > NAME_MAX) {
+        errno = ENAMETOOLONG;
+        return (mqd_t)-1;
+    }
+
+    if(oflag & O_CREAT) {
+        va_start(ap, oflag);
+        (void)va_arg(ap, int);   /* mode, we don't have permissions */
+        attr = va_arg(ap, struct mq_attr *);
+        va_end(ap);
+    }
+
+    mutex_lock_scoped(&mq_mutex);
+
+    for(mqdes = 0; mqdes < MQ_OPEN_MAX; mqdes++) {
+        if(!mq_descs[mqdes].queue)
+            break;
+    }
+
+    if(mqdes == MQ_OPEN_MAX) {
+        errno = EMFILE;
+        return (mqd_t)-1;
+    }
+
+    mq = mq_find(name);
+
+    if(mq && (oflag & O_CREAT) && (oflag & O_EXCL)) {
+        errno = EEXIST;
+        return (mqd_t)-1;
+    }
+
+    if(!mq) {
+        if(!(oflag & O_CREAT)) {
+            errno = ENOENT;
+            return (mqd_t)-1;
+        }
+
+        if(!(mq = mq_create(name, attr)))
+            return (mqd_t)-1;
+    }
+
+    mq->refs++;
+    mq_descs[mqdes].queue = mq;
+    mq_descs[mqdes].flags = oflag & (O_ACCMODE | O_NONBLOCK);
+
+    return mqdes;
+}
+
+int mq_close(mqd_t mqdes) {
+    mq_desc_t *desc;
+
+    mutex_lock_scoped(&mq_mutex);
+
+    if(!(desc = mq_get(mqdes)))
+        return -1;
+
+    mq_release(desc->queue);
+    desc->queue = NULL;
+
+    return 0;
+}
+
+int mq_unlink(const char *name) {
+    mq_queue_t *mq;
+
+    mutex_lock_scoped(&mq_mutex);
+
+    if(!name || !(mq = mq_find(name))) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    LIST_REMOVE(mq, entry);
+    mq->unlinked = 1;
+
+    /* Keep it around until the last descriptor is closed. */
+    mq->refs++;
+    mq_release(mq);
+
+    return 0;
+}
+
+int mq_timedsend(mqd_t mqdes, const char *msg_ptr, size_t msg_len,
+                 unsigned int msg_prio, const struct timespec *abstime) {
+    mq_desc_t *desc;
+    int timeout, rv;
+
+    if(!(desc = mq_get(mqdes)))
+        return -1;
+
+    if((desc->flags & O_ACCMODE) == O_RDONLY) {
+        errno = EBADF;
+        return -1;
+    }
+
+    if(msg_prio >= MQ_PRIO_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Only block if we actually have to. */
+    rv = msgq_trysend(&desc->queue->msgq, msg_ptr, msg_len, msg_prio);
+
+    if(rv == 0 || errno != EWOULDBLOCK || (desc->flags & O_NONBLOCK))
+        return rv;
+
+    if(!abstime)
+        return msgq_send(&desc->queue->msgq, msg_ptr, msg_len, msg_prio);
+
+    if(abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if(!(timeout = mq_timeout(abstime))) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    return msgq_send_timed(&desc->queue->msgq, msg_ptr, msg_len, msg_prio,
+                           timeout);
+}
+
+int mq_send(mqd_t mqdes, const char *msg_ptr, size_t msg_len,
+            unsigned int msg_prio) {
+    return mq_timedsend(mqdes, msg_ptr, msg_len, msg_prio, NULL);
+}
+
+ssize_t mq_timedreceive(mqd_t mqdes, char *msg_ptr, size_t msg_len,
+                        unsigned int *msg_prio,
+                        const struct timespec *abstime) {
+    mq_desc_t *desc;
+    ssize_t rv;
+    int timeout;
+
+    if(!(desc = mq_get(mqdes)))
+        return -1;
+
+    if((desc->flags & O_ACCMODE) == O_WRONLY) {
+        errno = EBADF;
+        return -1;
+    }
+
+    rv = msgq_tryrecv(&desc->queue->msgq, msg_ptr, msg_len, msg_prio);
+
+    if(rv >= 0 || errno != EWOULDBLOCK || (desc->flags & O_NONBLOCK))
+        return rv;
+
+    if(!abstime)
+        return msgq_recv(&desc->queue->msgq, msg_ptr, msg_len, msg_prio);
+
+    if(abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if(!(timeout = mq_timeout(abstime))) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    return msgq_recv_timed(&desc->queue->msgq, msg_ptr, msg_len, msg_prio,
+                           timeout);
+}
+
+ssize_t mq_receive(mqd_t mqdes, char *msg_ptr, size_t msg_len,
+                   unsigned int *msg_prio) {
+    return mq_timedreceive(mqdes, msg_ptr, msg_len, msg_prio, NULL);
+}
+
+int mq_getattr(mqd_t mqdes, struct mq_attr *mqstat) {
+    mq_desc_t *desc;
+
+    if(!(desc = mq_get(mqdes)))
+        return -1;
+
+    mqstat->mq_flags = desc->flags & O_NONBLOCK;
+    mqstat->mq_maxmsg = desc->queue->msgq.count;
+    mqstat->mq_msgsize = desc->queue->msgq.msg_size;
+    mqstat->mq_curmsgs = msgq_count(&desc->queue->msgq);
+
+    return 0;
+}
+
+int mq_setattr(mqd_t mqdes, const struct mq_attr *__restrict mqstat,
+               struct mq_attr *__restrict omqstat) {
+    mq_desc_t *desc;
+
+    if(!(desc = mq_get(mqdes)))
+        return -1;
+
+    if(omqstat)
+        mq_getattr(mqdes, omqstat);
+
+    desc->flags = (desc->flags & ~O_NONBLOCK) | (mqstat->mq_flags & O_NONBLOCK);
+
+    return 0;
+}
+
+int mq_notify(mqd_t mqdes, const struct sigevent *notification) {
+    (void)mqdes;
+    (void)notification;
+
+    errno = ENOSYS;
+    return -1;
+}
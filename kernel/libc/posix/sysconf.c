@@ -12,6 +12,7 @@
 #include <kos/thread.h>
 
 #include <time.h>
+#include <mqueue.h>
 #include <malloc.h>
 #include <unistd.h>
 #include <errno.h>
@@ -73,6 +74,12 @@ long sysconf(int name) {
 
         case _SC_SEM_VALUE_MAX:
             return UINT32_MAX;
+
+        case _SC_MQ_OPEN_MAX:
+            return MQ_OPEN_MAX;
+
+        case _SC_MQ_PRIO_MAX:
+            return MQ_PRIO_MAX;
         
         case _SC_PHYS_PAGES:
             return page_count;
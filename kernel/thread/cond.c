@@ -34,13 +34,14 @@ condvar_t *cond_create(void) {
         return NULL;
     }
 
+    TAILQ_INIT(&cv->waiters);
     cv->dynamic = 1;
 
     return cv;
 }
 
 int cond_init(condvar_t *cv) {
-    cv->dummy = 0;
+    TAILQ_INIT(&cv->waiters);
     cv->dynamic = 0;
     return 0;
 }
@@ -48,7 +49,7 @@ int cond_init(condvar_t *cv) {
 /* Free a condvar */
 int cond_destroy(condvar_t *cv) {
     /* Give all sleeping threads a timed out error */
-    genwait_wake_all_err(cv, ENOTRECOVERABLE);
+    genwait_queue_wake_cnt(&cv->waiters, -1, ENOTRECOVERABLE);
 
     /* Free the memory */
     if(cv->dynamic)
@@ -78,8 +79,8 @@ int cond_wait_timed(condvar_t *cv, mutex_t *m, int timeout) {
     mutex_unlock(m);
 
     /* Now block us until we're signaled */
-    rv = genwait_wait(cv, timeout ? "cond_wait_timed" : "cond_wait", timeout,
-                      NULL);
+    rv = genwait_queue_wait(&cv->waiters, cv, timeout ? "cond_wait_timed" :
+                            "cond_wait", timeout, NULL);
 
     if(rv < 0 && errno == EAGAIN)
         errno = ETIMEDOUT;
@@ -98,7 +99,7 @@ int cond_signal(condvar_t *cv) {
     irq_disable_scoped();
 
     /* Wake one thread who's waiting, if any */
-    genwait_wake_one(cv);
+    genwait_queue_wake_cnt(&cv->waiters, 1, 0);
 
     return 0;
 }
@@ -107,7 +108,7 @@ int cond_broadcast(condvar_t *cv) {
     irq_disable_scoped();
 
     /* Wake all threads who are waiting */
-    genwait_wake_all(cv);
+    genwait_queue_wake_cnt(&cv->waiters, -1, 0);
 
     return 0;
 }
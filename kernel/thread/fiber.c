@@ -0,0 +1,119 @@
+/* KallistiOS ##version##
+
+   kernel/thread/fiber.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* This file implements the cooperative fibers described in kos/fiber.h. The
+   register switching itself lives in the architecture code (see
+   arch/fiber.h); everything here just keeps track of who resumed whom. */
+
+#include <stdint.h>
+#include <errno.h>
+
+#include <kos/fiber.h>
+#include <kos/thread.h>
+#include <arch/fiber.h>
+
+int fiber_create(kfiber_t *fiber, void *stack, size_t stack_size,
+                 void *(*routine)(void *), void *param) {
+    uintptr_t top;
+
+    if(!stack || stack_size < FIBER_STACK_MIN) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Keep the initial stack pointer 8-byte aligned, as the ABI expects. */
+    top = ((uintptr_t)stack + stack_size) & ~(uintptr_t)7;
+
+    fiber->routine = routine;
+    fiber->param = param;
+    fiber->retval = NULL;
+    fiber->caller = NULL;
+    fiber->caller_sp = NULL;
+    fiber->state = FIBER_READY;
+    fiber->sp = arch_fiber_prepare((void *)top, fiber);
+
+    return 0;
+}
+
+void fiber_entry(kfiber_t *fiber) {
+    kthread_t *cur;
+
+    fiber->retval = fiber->routine(fiber->param);
+    fiber->state = FIBER_FINISHED;
+
+    /* Go back to whoever resumed us for the last time. We may have been
+       resumed from another thread than the one we started on, so look it up
+       again. */
+    cur = thd_get_current();
+    cur->fiber = fiber->caller;
+    arch_fiber_switch(&fiber->sp, fiber->caller_sp);
+
+    /* Finished fibers are never switched back to. */
+    __builtin_unreachable();
+}
+
+int fiber_resume(kfiber_t *fiber) {
+    kthread_t *cur = thd_get_current();
+
+    if(fiber->state == FIBER_FINISHED) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if(fiber->state == FIBER_RUNNING) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    fiber->caller = cur->fiber;
+    fiber->state = FIBER_RUNNING;
+    cur->fiber = fiber;
+
+    arch_fiber_switch(&fiber->caller_sp, fiber->sp);
+
+    /* Back from the fiber: it has either yielded or finished. */
+    return fiber->state == FIBER_FINISHED;
+}
+
+int fiber_yield(void) {
+    kthread_t *cur = thd_get_current();
+    kfiber_t *fiber = cur->fiber;
+
+    if(!fiber) {
+        errno = EPERM;
+        return -1;
+    }
+
+    fiber->state = FIBER_READY;
+    cur->fiber = fiber->caller;
+
+    arch_fiber_switch(&fiber->sp, fiber->caller_sp);
+
+    return 0;
+}
+
+int fiber_join(kfiber_t *fiber, void **retval) {
+    int rv;
+
+    if(fiber->state == FIBER_RUNNING) {
+        errno = EDEADLK;
+        return -1;
+    }
+
+    while(fiber->state != FIBER_FINISHED) {
+        if((rv = fiber_resume(fiber)) < 0)
+            return rv;
+    }
+
+    if(retval)
+        *retval = fiber->retval;
+
+    return 0;
+}
+
+kfiber_t *fiber_self(void) {
+    return thd_get_current()->fiber;
+}
@@ -12,10 +12,22 @@
    hash of the address to a set of sleep queues, and then searching
    through them from the top to find matching sleepers. This functionality
    is enough to implement all of the various thread sync primitives
-   as well as some more advanced stuff. */
+   as well as some more advanced stuff.
+
+   Objects can also bring their own sleep queue (genwait_queue_t), in which
+   case no hashing or searching is needed at all. The sync primitives do
+   this, the hash table is there for everything else.
+
+   A thread can only sit in one sleep queue at a time, so waiting on several
+   objects at once works the other way around: the thread sleeps on a private
+   queue, and hangs a watch (genwait_watch_t) on each of the objects in a
+   second hash table. Waking up an object that has nobody sleeping on it (or
+   not enough sleepers to fill the quota) then goes through the watches of
+   that object, and wakes up the threads behind them. */
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <assert.h>
 #include <errno.h>
@@ -23,53 +35,144 @@
 #include <arch/timer.h>
 #include <kos/dbglog.h>
 #include <kos/genwait.h>
+#include <kos/trace.h>
 #include <kos/sem.h>
 
 /* Our sleep queues table. This is also modeled after the BSD numbers. I
    figure if they've been using it as long as they have, they must be
    on to something. :) */
 #define TABLESIZE   128
-static TAILQ_HEAD(slpquehead, kthread) slpque[TABLESIZE];
+static struct ktqueue slpque[TABLESIZE];
 #define LOOKUP(x)   (((uintptr_t)(x) >> 8) & (TABLESIZE - 1))
 
+/* Watches for genwait_wait_multiple(), hashed by the object they watch (or the
+   embedded queue of that object, if it has one). The count lets the wake up
+   functions skip looking for watches in the common case where there are
+   none at all. */
+static LIST_HEAD(watchlist, genwait_watch) watchque[TABLESIZE];
+static size_t watch_count;
+#define WATCH_KEY(w)    ((w)->queue ? (void *)(w)->queue : (w)->obj)
+
 /* Timed event queue. Anything that isn't ready to run yet, but will be
    ready to run at a later time will be placed here. Note that this doesn't
    deal with pre-emptive timeslice context switching, only things that are
    specifically blocked for a timed event (thd_sleep, genwait_wait, etc).
-   This queue is sorted by remaining time (smallest at the front). */
-static struct ktqueue timer_queue;
 
-/* Internal function to insert a thread on the timer queue. Maintains
-   sorting order by wait time. */
-static void tq_insert(kthread_t * thd) {
-    kthread_t * t;
+   This queue is a binary min-heap keyed on the wakeup time, so the next
+   event is always at the root. Each thread remembers its position in the
+   heap, so it can be taken out without searching. A thread can only be
+   waiting once, so the heap never needs more slots than there are threads;
+   the storage is grown as threads are created (see genwait_reserve). */
+static kthread_t **timer_queue;
+static size_t tq_count;
+static size_t tq_size;
+
+/* Place a thread in the given heap slot. */
+static inline void tq_set(size_t i, kthread_t *thd) {
+    timer_queue[i] = thd;
+    thd->timerq_idx = i;
+}
 
-    /* Search for its place; note that new threads will be placed at
-       the end of a group with the same timeout. */
-    TAILQ_FOREACH_REVERSE(t, &timer_queue, slpquehead, timerq) {
-        if(thd->wait_timeout >= t->wait_timeout) {
-            TAILQ_INSERT_AFTER(&timer_queue, t, thd, timerq);
-            return;
-        }
+/* Move the thread at the given slot up until its parent expires first. */
+static void tq_sift_up(size_t i) {
+    kthread_t *thd = timer_queue[i];
+    size_t parent;
+
+    while(i > 0) {
+        parent = (i - 1) / 2;
+
+        if(timer_queue[parent]->wait_timeout <= thd->wait_timeout)
+            break;
+
+        tq_set(i, timer_queue[parent]);
+        i = parent;
+    }
+
+    tq_set(i, thd);
+}
+
+/* Move the thread at the given slot down until both children expire later. */
+static void tq_sift_down(size_t i) {
+    kthread_t *thd = timer_queue[i];
+    size_t child;
+
+    while((child = 2 * i + 1) < tq_count) {
+        if(child + 1 < tq_count && timer_queue[child + 1]->wait_timeout <
+           timer_queue[child]->wait_timeout)
+            child++;
+
+        if(thd->wait_timeout <= timer_queue[child]->wait_timeout)
+            break;
+
+        tq_set(i, timer_queue[child]);
+        i = child;
     }
 
-    /* Couldn't find anything scheduled earlier, put this at the start. */
-    TAILQ_INSERT_HEAD(&timer_queue, thd, timerq);
+    tq_set(i, thd);
+}
+
+/* Internal function to insert a thread on the timer queue. */
+static void tq_insert(kthread_t * thd) {
+    assert(tq_count < tq_size);
+
+    timer_queue[tq_count] = thd;
+    tq_sift_up(tq_count++);
 }
 
 /* Internal function to remove a thread from the timer queue. */
 static void tq_remove(kthread_t * thd) {
-    TAILQ_REMOVE(&timer_queue, thd, timerq);
+    size_t i = thd->timerq_idx;
+    kthread_t *last = timer_queue[--tq_count];
+
+    /* Fill the hole with the last thread, and restore the heap order. */
+    if(last != thd) {
+        tq_set(i, last);
+
+        if(i > 0 && timer_queue[(i - 1) / 2]->wait_timeout > last->wait_timeout)
+            tq_sift_up(i);
+        else
+            tq_sift_down(i);
+    }
 }
 
 /* Returns the top thread on the timer queue (next event). If nothing is
    queued, we'll return NULL. */
 static kthread_t * tq_next(void) {
-    return TAILQ_FIRST(&timer_queue);
+    return tq_count ? timer_queue[0] : NULL;
+}
+
+int genwait_reserve(size_t count) {
+    kthread_t **nq;
+    size_t size;
+
+    irq_disable_scoped();
+
+    if(count <= tq_size)
+        return 0;
+
+    for(size = tq_size ? tq_size : 16; size < count; size *= 2)
+        ;
+
+    if(!(nq = realloc(timer_queue, size * sizeof(*nq)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    timer_queue = nq;
+    tq_size = size;
+
+    return 0;
 }
 
 int genwait_wait(void * obj, const char * mesg, int timeout, void (*callback)(void *)) {
+    return genwait_queue_wait(&slpque[LOOKUP(obj)], obj, mesg, timeout,
+                              callback);
+}
+
+int genwait_queue_wait(genwait_queue_t *queue, void *obj, const char *mesg,
+                       int timeout, void (*callback)(void *)) {
     kthread_t   * me;
+    int         rv;
 
     /* Twiddle interrupt state */
     if(irq_inside_int()) {
@@ -95,18 +198,31 @@ int genwait_wait(void * obj, const char * mesg, int timeout, void (*callback)(vo
 
     me->wait_callback = callback;
 
-    /* Insert us on the appropriate wait queue */
-    TAILQ_INSERT_TAIL(&slpque[LOOKUP(obj)], me, thdq);
+    /* Insert us on the appropriate wait queue. Embedded queues may be all
+       zeroes (or a stale copy) when empty, so (re)initialize them then. */
+    if(TAILQ_EMPTY(queue))
+        TAILQ_INIT(queue);
+
+    me->wait_queue = queue;
+    TAILQ_INSERT_TAIL(queue, me, thdq);
+
+    trace_record(TRACE_EVT_WAIT, obj);
 
     /* Block us until we're signaled */
-    return thd_block_now(&me->context);
+    rv = thd_block_now(&me->context);
+
+    trace_record(TRACE_EVT_WAIT_DONE, obj);
+
+    return rv;
 }
 
 /* Removes a thread from its wait queue; assumes ints are disabled. */
 static void genwait_unqueue(kthread_t * thd) {
     if(thd->wait_obj) {
+        trace_record(TRACE_EVT_WAKE, thd->tid);
+
         /* Remove it from the queue */
-        TAILQ_REMOVE(&slpque[LOOKUP(thd->wait_obj)], thd, thdq);
+        TAILQ_REMOVE(thd->wait_queue, thd, thdq);
 
         /* Also remove it from the timer queue if applicable */
         if(thd->wait_timeout)
@@ -114,26 +230,70 @@ static void genwait_unqueue(kthread_t * thd) {
 
         /* Clean up wait stuff */
         thd->wait_obj = NULL;
+        thd->wait_queue = NULL;
         thd->wait_msg = NULL;
         thd->wait_timeout = 0;
         thd->wait_callback = NULL;
 
+        /* Stop lending its priority to the holder of the lock, if any */
+        thd_pi_unblock(thd);
+
         /* Make it runnable again */
         thd->state = STATE_READY;
         thd_add_to_runnable(thd, 0);
     }
 }
 
-int genwait_wake_cnt(void * obj, int cntmax, int err) {
-    kthread_t       * t, * nt;
-    struct slpquehead   * qp;
-    int         cnt;
+/* Set the return value of genwait_wait() for a thread being woken up. */
+static void genwait_set_ret(kthread_t *thd, int err) {
+    if(err) {
+        CONTEXT_RET(thd->context) = -1;
+        thd->thd_errno = err;
+    }
+    else {
+        CONTEXT_RET(thd->context) = 0;
+    }
+}
 
-    /* Twiddle interrupt state */
-    irq_disable_scoped();
+/* Wake up to cntmax threads watching the given object or embedded queue. A
+   thread watching several objects only counts once, so threads that were
+   already woken up by another one of their objects are skipped. Assumes ints
+   are disabled. */
+static int genwait_fire(void *key, int cntmax, int err) {
+    genwait_watch_t *w, *set;
+    int cnt = 0;
+
+    LIST_FOREACH(w, &watchque[LOOKUP(key)], entry) {
+        set = w->set;
 
-    /* Find the queue */
-    qp = &slpque[LOOKUP(obj)];
+        if(WATCH_KEY(w) != key || set->fired >= 0)
+            continue;
+
+        set->fired = w->index;
+        set->err = err;
+
+        /* If the thread is already asleep, wake it up. Otherwise, it will see
+           that the set fired when it gets to genwait_watch_wait(). */
+        if(set->thd->wait_obj == set) {
+            genwait_unqueue(set->thd);
+            genwait_set_ret(set->thd, 0);
+        }
+
+        if(cntmax > 0 && ++cnt >= cntmax)
+            break;
+    }
+
+    return cnt;
+}
+
+/* Wake up to cntmax threads sleeping on the given queue. If obj is non-NULL,
+   only threads sleeping on that object are considered. If that doesn't fill
+   the quota, threads watching the object (or the queue, if obj is NULL) are
+   woken up as well. Assumes ints are disabled. */
+static int genwait_wake_queue(struct ktqueue *qp, void *obj, int cntmax,
+                              int err) {
+    kthread_t       * t, * nt;
+    int         cnt;
 
     /* Go through and find any matching entries */
     for(cnt = 0, t = TAILQ_FIRST(qp); t != NULL; t = nt) {
@@ -141,32 +301,48 @@ int genwait_wake_cnt(void * obj, int cntmax, int err) {
         nt = TAILQ_NEXT(t, thdq);
 
         /* Is this thread a match? */
-        if(t->wait_obj == obj) {
+        if(!obj || t->wait_obj == obj) {
             /* Yes, remove it from the wait queue */
             genwait_unqueue(t);
 
             /* Set the wake return value */
-            if(err) {
-                CONTEXT_RET(t->context) = -1;
-                t->thd_errno = err;
-            }
-            else {
-                CONTEXT_RET(t->context) = 0;
-            }
+            genwait_set_ret(t, err);
 
             /* Check to see if we've filled our quota */
             if(cntmax > 0) {
                 cnt++;
 
                 if(cnt >= cntmax)
-                    break;
+                    return cnt;
             }
         }
     }
 
+    if(watch_count)
+        cnt += genwait_fire(obj ? obj : (void *)qp,
+                            cntmax > 0 ? cntmax - cnt : -1, err);
+
     return cnt;
 }
 
+int genwait_wake_cnt(void * obj, int cntmax, int err) {
+    /* Twiddle interrupt state */
+    irq_disable_scoped();
+
+    return genwait_wake_queue(&slpque[LOOKUP(obj)], obj, cntmax, err);
+}
+
+int genwait_queue_wake_cnt(genwait_queue_t *queue, int cntmax, int err) {
+    irq_disable_scoped();
+
+    /* Nothing has ever waited on this queue if it was never initialized, but
+       it might still be watched. */
+    if(TAILQ_EMPTY(queue))
+        return watch_count ? genwait_fire(queue, cntmax, err) : 0;
+
+    return genwait_wake_queue(queue, NULL, cntmax, err);
+}
+
 void genwait_wake_all(void * obj) {
     genwait_wake_cnt(obj, -1, 0);
 }
@@ -184,40 +360,113 @@ void genwait_wake_all_err(void *obj, int err) {
 }
 
 int genwait_wake_thd(void *obj, kthread_t *thd, int err) {
-    kthread_t *t, *nt;
-    struct slpquehead *qp;
-
     /* Twiddle interrupt state */
     irq_disable_scoped();
 
-    /* Find the queue */
-    qp = &slpque[LOOKUP(obj)];
+    /* Is this thread sleeping on the object? The thread knows which queue
+       it is on, so there is no need to go looking for it. */
+    if(!obj || thd->wait_obj != obj)
+        return 0;
 
-    /* Go through and find any matching entries */
-    for(t = TAILQ_FIRST(qp); t != NULL; t = nt) {
-        /* Get the next thread up front */
-        nt = TAILQ_NEXT(t, thdq);
+    genwait_unqueue(thd);
 
-        /* Is this thread a match? */
-        if(t->wait_obj == obj && t == thd) {
-            /* Yes, remove it from the wait queue */
-            genwait_unqueue(t);
+    /* Set the wake return value */
+    genwait_set_ret(thd, err);
 
-            /* Set the wake return value */
-            if(err) {
-                CONTEXT_RET(t->context) = -1;
-                t->thd_errno = err;
-            }
-            else {
-                CONTEXT_RET(t->context) = 0;
-            }
+    return 1;
+}
 
-            /* We found it, so we're done... */
-	    return 1;
-        }
+void genwait_watch_arm(genwait_watch_t *watches, size_t count) {
+    size_t i;
+
+    irq_disable_scoped();
+
+    for(i = 0; i < count; i++) {
+        watches[i].set = watches;
+        watches[i].index = (int)i;
+        LIST_INSERT_HEAD(&watchque[LOOKUP(WATCH_KEY(&watches[i]))],
+                         &watches[i], entry);
     }
 
-    return 0;
+    watches->thd = thd_current;
+    watches->fired = -1;
+    watches->err = 0;
+    watch_count += count;
+}
+
+int genwait_watch_disarm(genwait_watch_t *watches, size_t count) {
+    size_t i;
+
+    irq_disable_scoped();
+
+    for(i = 0; i < count; i++)
+        LIST_REMOVE(&watches[i], entry);
+
+    watch_count -= count;
+
+    return watches->fired;
+}
+
+int genwait_watch_wait(genwait_watch_t *watches, size_t count,
+                       const char *mesg, int timeout) {
+    genwait_queue_t queue = GENWAIT_QUEUE_INITIALIZER;
+
+    if(irq_inside_int()) {
+        dbglog(DBG_WARNING, "genwait_watch_wait: called inside interrupt\n");
+        genwait_watch_disarm(watches, count);
+        errno = EPERM;
+        return -1;
+    }
+
+    irq_disable_scoped();
+
+    /* Only go to sleep if nothing fired since the watches were armed. The
+       private queue is never woken up directly, the watches (or the timeout)
+       take care of that. */
+    if(watches->fired < 0)
+        genwait_queue_wait(&queue, watches, mesg, timeout, NULL);
+
+    /* Prefer reporting an object over a timeout: if an object fired, it
+       counted us as woken up, so it must not go unnoticed. */
+    if(genwait_watch_disarm(watches, count) < 0)
+        return -1;
+
+    if(watches->err) {
+        errno = watches->err;
+        return -1;
+    }
+
+    return watches->fired;
+}
+
+int genwait_wait_multiple(genwait_watch_t *watches, size_t count,
+                          const char *mesg, int timeout) {
+    if(!count) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    genwait_watch_arm(watches, count);
+
+    return genwait_watch_wait(watches, count, mesg, timeout);
+}
+
+void genwait_watch_cancel(kthread_t *thd) {
+    genwait_watch_t *w, *nw;
+    int i;
+
+    irq_disable_scoped();
+
+    for(i = 0; i < TABLESIZE && watch_count; i++) {
+        for(w = LIST_FIRST(&watchque[i]); w != NULL; w = nw) {
+            nw = LIST_NEXT(w, entry);
+
+            if(w->set->thd == thd) {
+                LIST_REMOVE(w, entry);
+                watch_count--;
+            }
+        }
+    }
 }
 
 void genwait_check_timeouts(uint64_t tm) {
@@ -261,15 +510,26 @@ uint64_t genwait_next_timeout(void) {
 int genwait_init(void) {
     int i;
 
-    for(i = 0; i < TABLESIZE; i++)
+    for(i = 0; i < TABLESIZE; i++) {
         TAILQ_INIT(&slpque[i]);
+        LIST_INIT(&watchque[i]);
+    }
+
+    watch_count = 0;
+
+    /* The timer queue storage itself is set up by genwait_reserve() as
+       threads get created, which happens before we get here. */
+    tq_count = 0;
 
-    TAILQ_INIT(&timer_queue);
     return 0;
 }
 
 void genwait_shutdown(void) {
     /* XXX Do something about queued up procs */
+    free(timer_queue);
+    timer_queue = NULL;
+    tq_count = 0;
+    tq_size = 0;
 }
 
 
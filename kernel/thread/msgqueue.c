@@ -0,0 +1,427 @@
+/* KallistiOS ##version##
+
+   msgqueue.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* Defines message queues */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <assert.h>
+
+#include <kos/thread.h>
+#include <kos/msgqueue.h>
+#include <kos/genwait.h>
+#include <kos/dbglog.h>
+
+#include <arch/irq.h>
+#include <arch/timer.h>
+
+/* Every slot starts with this header, followed by up to msg_size bytes of
+   message. Slots are linked by index, either on the free list or, sorted by
+   priority, on the list of queued messages. */
+struct msgq_slot {
+    uint32_t next;
+    uint32_t len;
+    uint32_t prio;
+    uint32_t state;
+};
+
+_Static_assert(sizeof(struct msgq_slot) == 16,
+               "MSGQ_STORAGE_SIZE() assumes 16 byte slot headers");
+
+#define SLOT_NONE       UINT32_MAX
+
+/* Slot states, only used to catch misuse of the reserve/commit functions. */
+#define SLOT_FREE       0
+#define SLOT_WRITING    1
+#define SLOT_QUEUED     2
+#define SLOT_READING    3
+
+#define SLOT(q, i)      ((struct msgq_slot *)((q)->slots + (i) * (q)->stride))
+#define SLOT_INDEX(q, s) \
+    ((uint32_t)(((unsigned char *)(s) - (q)->slots) / (q)->stride))
+
+static inline bool msgq_valid(const msgqueue_t *q) {
+    return q->initialized == 1 || q->initialized == 2;
+}
+
+static inline struct msgq_slot *msg_to_slot(void *msg) {
+    return (struct msgq_slot *)msg - 1;
+}
+
+int msgq_init(msgqueue_t *q, size_t msg_size, size_t count, void *storage) {
+    uint32_t i;
+
+    if(!msg_size || !count || count >= SLOT_NONE) {
+        q->initialized = 0;
+        errno = EINVAL;
+        return -1;
+    }
+
+    q->msg_size = msg_size;
+    q->count = count;
+    q->stride = MSGQ_STORAGE_SIZE(msg_size, 1);
+    q->queued = 0;
+    q->initialized = 1;
+
+    if(!storage) {
+        storage = aligned_alloc(8, q->stride * count);
+
+        if(!storage) {
+            q->initialized = 0;
+            errno = ENOMEM;
+            return -1;
+        }
+
+        q->initialized = 2;
+    }
+
+    q->slots = (unsigned char *)storage;
+
+    /* Chain up all of the slots on the free list. */
+    for(i = 0; i < count; i++) {
+        SLOT(q, i)->next = i + 1 < count ? i + 1 : SLOT_NONE;
+        SLOT(q, i)->state = SLOT_FREE;
+    }
+
+    q->free = 0;
+    q->head = q->tail = SLOT_NONE;
+    TAILQ_INIT(&q->send_waiters);
+    TAILQ_INIT(&q->recv_waiters);
+
+    return 0;
+}
+
+int msgq_destroy(msgqueue_t *q) {
+    irq_disable_scoped();
+
+    /* Wake up any queued threads with an error */
+    genwait_queue_wake_cnt(&q->send_waiters, -1, ENOTRECOVERABLE);
+    genwait_queue_wake_cnt(&q->recv_waiters, -1, ENOTRECOVERABLE);
+
+    if(q->initialized == 2)
+        free(q->slots);
+
+    q->slots = NULL;
+    q->queued = 0;
+    q->free = q->head = q->tail = SLOT_NONE;
+    q->initialized = 0;
+
+    return 0;
+}
+
+/* Check whether the caller can block, complaining about it if not. */
+static int msgq_check_wait(const char *func, int timeout) {
+    int rv;
+
+    if((rv = irq_inside_int())) {
+        dbglog(DBG_WARNING, "%s: called inside an interrupt with code: "
+               "%x evt: %.4x\n", func, ((rv >> 16) & 0xf), (rv & 0xffff));
+        errno = EPERM;
+        return -1;
+    }
+
+    if(timeout < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Wait until the given list isn't empty anymore. Interrupts must be disabled.
+   The queue may be destroyed while we're asleep, in which case we get woken up
+   with ENOTRECOVERABLE. */
+static int msgq_wait(msgqueue_t *q, genwait_queue_t *waiters,
+                     const uint32_t *list, const char *mesg, int timeout) {
+    uint64_t deadline = 0;
+
+    if(timeout)
+        deadline = timer_ms_gettime64() + timeout;
+
+    while(*list == SLOT_NONE) {
+        if(genwait_queue_wait(waiters, q, mesg, timeout, NULL) < 0) {
+            if(errno == EAGAIN)
+                errno = ETIMEDOUT;
+            return -1;
+        }
+
+        if(timeout && *list == SLOT_NONE) {
+            timeout = deadline - timer_ms_gettime64();
+
+            if(timeout <= 0) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* Take a free slot, if there is one. Interrupts must be disabled. */
+static void *msgq_take_free(msgqueue_t *q) {
+    struct msgq_slot *slot;
+
+    if(q->free == SLOT_NONE) {
+        errno = EWOULDBLOCK;
+        return NULL;
+    }
+
+    slot = SLOT(q, q->free);
+    q->free = slot->next;
+    slot->state = SLOT_WRITING;
+
+    return slot + 1;
+}
+
+/* Take the next queued message, if there is one. Interrupts must be
+   disabled. */
+static void *msgq_take_queued(msgqueue_t *q, size_t *len, unsigned int *prio) {
+    struct msgq_slot *slot;
+
+    if(q->head == SLOT_NONE) {
+        errno = EWOULDBLOCK;
+        return NULL;
+    }
+
+    slot = SLOT(q, q->head);
+    q->head = slot->next;
+
+    if(q->head == SLOT_NONE)
+        q->tail = SLOT_NONE;
+
+    q->queued--;
+    slot->state = SLOT_READING;
+
+    *len = slot->len;
+    if(prio)
+        *prio = slot->prio;
+
+    return slot + 1;
+}
+
+/* Put a slot back on the free list, and let a sender know about it.
+   Interrupts must be disabled. */
+static void msgq_release(msgqueue_t *q, struct msgq_slot *slot) {
+    slot->state = SLOT_FREE;
+    slot->next = q->free;
+    q->free = SLOT_INDEX(q, slot);
+
+    genwait_queue_wake_cnt(&q->send_waiters, 1, 0);
+}
+
+void *msgq_send_reserve(msgqueue_t *q, int timeout) {
+    if(msgq_check_wait(timeout ? "msgq_send_timed" : "msgq_send", timeout))
+        return NULL;
+
+    irq_disable_scoped();
+
+    if(!msgq_valid(q)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if(msgq_wait(q, &q->send_waiters, &q->free, timeout ?
+                 "msgq_send_timed" : "msgq_send", timeout))
+        return NULL;
+
+    return msgq_take_free(q);
+}
+
+void *msgq_trysend_reserve(msgqueue_t *q) {
+    irq_disable_scoped();
+
+    if(!msgq_valid(q)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return msgq_take_free(q);
+}
+
+int msgq_send_commit(msgqueue_t *q, void *msg, size_t len, unsigned int prio) {
+    struct msgq_slot *slot = msg_to_slot(msg);
+    uint32_t idx, prev, cur;
+
+    if(len > q->msg_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    irq_disable_scoped();
+
+    assert_msg(slot->state == SLOT_WRITING, "Committing an unreserved slot");
+
+    idx = SLOT_INDEX(q, slot);
+    slot->len = len;
+    slot->prio = prio;
+    slot->state = SLOT_QUEUED;
+
+    /* Messages of the same priority are received in order, so most of the
+       time this goes at the end of the list. */
+    if(q->tail == SLOT_NONE) {
+        slot->next = SLOT_NONE;
+        q->head = q->tail = idx;
+    }
+    else if(SLOT(q, q->tail)->prio >= prio) {
+        slot->next = SLOT_NONE;
+        SLOT(q, q->tail)->next = idx;
+        q->tail = idx;
+    }
+    else {
+        /* Skip over the messages of higher or equal priority. We know we'll
+           stop before the tail. */
+        prev = SLOT_NONE;
+        cur = q->head;
+
+        while(SLOT(q, cur)->prio >= prio) {
+            prev = cur;
+            cur = SLOT(q, cur)->next;
+        }
+
+        slot->next = cur;
+
+        if(prev == SLOT_NONE)
+            q->head = idx;
+        else
+            SLOT(q, prev)->next = idx;
+    }
+
+    q->queued++;
+    genwait_queue_wake_cnt(&q->recv_waiters, 1, 0);
+
+    return 0;
+}
+
+void msgq_send_cancel(msgqueue_t *q, void *msg) {
+    struct msgq_slot *slot = msg_to_slot(msg);
+
+    irq_disable_scoped();
+
+    assert_msg(slot->state == SLOT_WRITING, "Cancelling an unreserved slot");
+    msgq_release(q, slot);
+}
+
+static int msgq_send_common(msgqueue_t *q, const void *data, size_t len,
+                            unsigned int prio, void *msg) {
+    if(!msg)
+        return -1;
+
+    memcpy(msg, data, len);
+    return msgq_send_commit(q, msg, len, prio);
+}
+
+int msgq_send_timed(msgqueue_t *q, const void *data, size_t len,
+                    unsigned int prio, int timeout) {
+    if(len > q->msg_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    return msgq_send_common(q, data, len, prio, msgq_send_reserve(q, timeout));
+}
+
+int msgq_send(msgqueue_t *q, const void *data, size_t len, unsigned int prio) {
+    return msgq_send_timed(q, data, len, prio, 0);
+}
+
+int msgq_trysend(msgqueue_t *q, const void *data, size_t len,
+                 unsigned int prio) {
+    if(len > q->msg_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    return msgq_send_common(q, data, len, prio, msgq_trysend_reserve(q));
+}
+
+void *msgq_recv_reserve(msgqueue_t *q, size_t *len, unsigned int *prio,
+                        int timeout) {
+    if(msgq_check_wait(timeout ? "msgq_recv_timed" : "msgq_recv", timeout))
+        return NULL;
+
+    irq_disable_scoped();
+
+    if(!msgq_valid(q)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if(msgq_wait(q, &q->recv_waiters, &q->head, timeout ?
+                 "msgq_recv_timed" : "msgq_recv", timeout))
+        return NULL;
+
+    return msgq_take_queued(q, len, prio);
+}
+
+void *msgq_tryrecv_reserve(msgqueue_t *q, size_t *len, unsigned int *prio) {
+    irq_disable_scoped();
+
+    if(!msgq_valid(q)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return msgq_take_queued(q, len, prio);
+}
+
+void msgq_recv_commit(msgqueue_t *q, void *msg) {
+    struct msgq_slot *slot = msg_to_slot(msg);
+
+    irq_disable_scoped();
+
+    assert_msg(slot->state == SLOT_READING, "Committing an unreceived slot");
+    msgq_release(q, slot);
+}
+
+static ssize_t msgq_recv_common(msgqueue_t *q, void *buf, void *msg,
+                                size_t len) {
+    if(!msg)
+        return -1;
+
+    memcpy(buf, msg, len);
+    msgq_recv_commit(q, msg);
+
+    return len;
+}
+
+ssize_t msgq_recv_timed(msgqueue_t *q, void *buf, size_t size,
+                        unsigned int *prio, int timeout) {
+    size_t len = 0;
+    void *msg;
+
+    if(size < q->msg_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    msg = msgq_recv_reserve(q, &len, prio, timeout);
+    return msgq_recv_common(q, buf, msg, len);
+}
+
+ssize_t msgq_recv(msgqueue_t *q, void *buf, size_t size, unsigned int *prio) {
+    return msgq_recv_timed(q, buf, size, prio, 0);
+}
+
+ssize_t msgq_tryrecv(msgqueue_t *q, void *buf, size_t size,
+                     unsigned int *prio) {
+    size_t len = 0;
+    void *msg;
+
+    if(size < q->msg_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    msg = msgq_tryrecv_reserve(q, &len, prio);
+    return msgq_recv_common(q, buf, msg, len);
+}
+
+size_t msgq_count(const msgqueue_t *q) {
+    return q->queued;
+}
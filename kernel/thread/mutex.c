@@ -35,6 +35,8 @@ mutex_t *mutex_create(void) {
     rv->dynamic = 1;
     rv->holder = NULL;
     rv->count = 0;
+    TAILQ_INIT(&rv->waiters);
+    rv->protocol = MUTEX_PRIO_INHERIT;
 
     return rv;
 }
@@ -51,10 +53,41 @@ int mutex_init(mutex_t *m, int mtype) {
     m->dynamic = 0;
     m->holder = NULL;
     m->count = 0;
+    TAILQ_INIT(&m->waiters);
+    m->protocol = MUTEX_PRIO_INHERIT;
 
     return 0;
 }
 
+int mutex_set_protocol(mutex_t *m, int protocol) {
+    if(protocol != MUTEX_PRIO_INHERIT && protocol != MUTEX_PRIO_NONE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    irq_disable_scoped();
+
+    if(m->count) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    m->protocol = protocol;
+    return 0;
+}
+
+/* Take ownership of a mutex. Any threads already waiting on it (which were
+   woken up or timed out, but haven't run yet) now lend their priority to the
+   new holder. */
+static inline void mutex_take(mutex_t *m, kthread_t *thd) {
+    m->holder = thd;
+    m->count = 1;
+
+    if(m->protocol == MUTEX_PRIO_INHERIT && thd != IRQ_THREAD &&
+       !TAILQ_EMPTY(&m->waiters))
+        thd_pi_adopt(&m->waiters, thd);
+}
+
 int mutex_destroy(mutex_t *m) {
     irq_disable_scoped();
 
@@ -116,8 +149,7 @@ int mutex_lock_timed(mutex_t *m, int timeout) {
         rv = -1;
     }
     else if(!m->count) {
-        m->count = 1;
-        m->holder = thd_current;
+        mutex_take(m, thd_current);
     }
     else if(m->type == MUTEX_TYPE_RECURSIVE && m->holder == thd_current) {
         if(m->count == INT_MAX) {
@@ -137,29 +169,21 @@ int mutex_lock_timed(mutex_t *m, int timeout) {
             deadline = timer_ms_gettime64() + timeout;
 
         for(;;) {
-            /* Check whether we should boost priority. */
-            if (m->holder->prio >= thd_current->prio) {
-                m->holder->prio = thd_current->prio;
-
-                /* Reschedule if currently scheduled. */
-                if(m->holder->state == STATE_READY) {
-                    /* Thread list is sorted by priority, update the position
-                     * of the thread holding the lock */
-                    thd_remove_from_runnable(m->holder);
-                    thd_add_to_runnable(m->holder, true);
-                }
-            }
-
-            rv = genwait_wait(m, timeout ? "mutex_lock_timed" : "mutex_lock",
-                              timeout, NULL);
+            /* Lend our priority to the holder, and to whatever it is blocked
+               on in turn. This is undone when we stop waiting. */
+            if(m->protocol == MUTEX_PRIO_INHERIT && m->holder != IRQ_THREAD)
+                thd_pi_block(m->holder);
+
+            rv = genwait_queue_wait(&m->waiters, m, timeout ?
+                                    "mutex_lock_timed" : "mutex_lock",
+                                    timeout, NULL);
             if(rv < 0) {
                 errno = ETIMEDOUT;
                 break;
             }
 
             if(!m->holder) {
-                m->holder = thd_current;
-                m->count = 1;
+                mutex_take(m, thd_current);
                 break;
             }
 
@@ -202,8 +226,6 @@ int mutex_trylock(mutex_t *m) {
         return -1;
     }
 
-    m->holder = thd;
-
     switch(m->type) {
         case MUTEX_TYPE_NORMAL:
         case MUTEX_TYPE_OLDNORMAL:
@@ -213,7 +235,7 @@ int mutex_trylock(mutex_t *m) {
                 return -1;
             }
 
-            m->count = 1;
+            mutex_take(m, thd);
             break;
 
         case MUTEX_TYPE_RECURSIVE:
@@ -222,7 +244,8 @@ int mutex_trylock(mutex_t *m) {
                 return -1;
             }
 
-            ++m->count;
+            if(!m->count++)
+                mutex_take(m, thd);
             break;
     }
 
@@ -230,10 +253,13 @@ int mutex_trylock(mutex_t *m) {
 }
 
 static int mutex_unlock_common(mutex_t *m, kthread_t *thd) {
+    kthread_t *holder;
     int wakeup = 0;
 
     irq_disable_scoped();
 
+    holder = m->holder;
+
     switch(m->type) {
         case MUTEX_TYPE_NORMAL:
         case MUTEX_TYPE_OLDNORMAL:
@@ -272,11 +298,12 @@ static int mutex_unlock_common(mutex_t *m, kthread_t *thd) {
 
     /* If we need to wake up a thread, do so. */
     if(wakeup) {
-        /* Restore real priority in case we were dynamically boosted. */
-        if (thd != IRQ_THREAD)
-            thd->prio = thd->real_prio;
+        /* The waiters stop lending their priority to the old holder, which
+           drops back to whatever its other locks (if any) still earn it. */
+        if(m->protocol == MUTEX_PRIO_INHERIT && holder && holder != IRQ_THREAD)
+            thd_pi_release(&m->waiters, holder);
 
-        genwait_wake_one(m);
+        genwait_queue_wake_cnt(&m->waiters, 1, 0);
     }
 
     return 0;
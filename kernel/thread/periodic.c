@@ -0,0 +1,331 @@
+/* KallistiOS ##version##
+
+   kernel/thread/periodic.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* This file implements the periodic real-time scheduling class. A periodic
+   thread alternates between working on a job at PRIO_PERIODIC and sleeping in
+   thd_wait_period() until its next release. Vblank-driven threads are
+   released straight from the vblank interrupt, while time-driven ones sleep on
+   a genwait timeout until their (absolute) release time, with the primary
+   timer armed for it.
+
+   The class doesn't touch the thread's own priority (real_prio): it only
+   changes what thd_period_prio() says, and lets the scheduler work out the
+   dynamic priority from that and from priority inheritance. */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/queue.h>
+
+#include <kos/thread.h>
+#include <kos/genwait.h>
+#include <kos/dbglog.h>
+#include <arch/irq.h>
+#include <arch/timer.h>
+
+struct kthread_period {
+    /* List of vblank-driven or time-driven threads */
+    LIST_ENTRY(kthread_period) list;
+
+    kthread_t *thd;
+
+    /* Period: either a number of vblanks, or a time in nanoseconds. */
+    uint32_t vblanks;
+    uint64_t period_ns;
+
+    /* Per-job CPU budget in nanoseconds, or 0 for none. */
+    uint64_t budget_ns;
+
+    /* Vblanks seen since the last release. */
+    uint32_t vbl_count;
+
+    /* Time of the next release, for time-driven threads. */
+    uint64_t next_release;
+
+    /* Time (in ms since boot) the primary timer is armed for while waiting
+       for a time-driven release, or 0. */
+    uint64_t wakeup_ms;
+
+    /* CPU time of the thread when the current job was released. */
+    uint64_t job_start;
+
+    /* Sleeping in thd_wait_period(). */
+    bool waiting;
+
+    /* A release happened while the job was still running. */
+    bool pending;
+
+    /* The job went over budget and was dropped to the thread's own
+       priority. */
+    bool throttled;
+
+    thd_period_stats_t stats;
+};
+
+static LIST_HEAD(, kthread_period) vbl_threads =
+    LIST_HEAD_INITIALIZER(vbl_threads);
+static LIST_HEAD(, kthread_period) time_threads =
+    LIST_HEAD_INITIALIZER(time_threads);
+
+/* Start a new job on the current thread. */
+static void period_release(struct kthread_period *p) {
+    kthread_t *thd = p->thd;
+
+    ++p->stats.releases;
+    p->job_start = thd_get_cpu_time(thd);
+
+    if(p->throttled) {
+        irq_disable_scoped();
+        p->throttled = false;
+        thd_prio_refresh(thd);
+    }
+}
+
+/* Common setup for both kinds of periods. */
+static int period_set(uint32_t vblanks, uint64_t period_ns,
+                      uint32_t budget_us) {
+    kthread_t *cur = thd_get_current();
+    struct kthread_period *p;
+
+    if(irq_inside_int()) {
+        errno = EPERM;
+        return -1;
+    }
+
+    if(!vblanks && !period_ns) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if(!(p = cur->period)) {
+        if(!(p = (struct kthread_period *)calloc(1, sizeof(*p)))) {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        p->thd = cur;
+    }
+
+    irq_disable_scoped();
+
+    if(cur->period)
+        LIST_REMOVE(p, list);
+
+    p->vblanks = vblanks;
+    p->period_ns = period_ns;
+    p->budget_ns = (uint64_t)budget_us * 1000;
+    p->vbl_count = 0;
+    p->pending = false;
+    p->throttled = false;
+    p->next_release = timer_ns_gettime64() + period_ns;
+
+    if(vblanks)
+        LIST_INSERT_HEAD(&vbl_threads, p, list);
+    else
+        LIST_INSERT_HEAD(&time_threads, p, list);
+
+    cur->period = p;
+    thd_prio_refresh(cur);
+
+    /* The current job starts now. */
+    period_release(p);
+
+    return 0;
+}
+
+int thd_set_period_vblank(unsigned int frames, uint32_t budget_us) {
+    return period_set(frames, 0, budget_us);
+}
+
+int thd_set_period_us(uint32_t period_us, uint32_t budget_us) {
+    return period_set(0, (uint64_t)period_us * 1000, budget_us);
+}
+
+int thd_wait_period(void) {
+    kthread_t *cur = thd_get_current();
+    struct kthread_period *p = cur->period;
+    uint64_t cpu, now;
+    int err, ms;
+
+    if(irq_inside_int()) {
+        errno = EPERM;
+        return -1;
+    }
+
+    if(!p) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    cpu = thd_get_cpu_time(cur) - p->job_start;
+
+    if(cpu > p->stats.max_cpu_ns)
+        p->stats.max_cpu_ns = cpu;
+
+    /* Make sure we come back at the right priority, even if this job was
+       throttled. */
+    if(p->throttled) {
+        irq_disable_scoped();
+        p->throttled = false;
+        thd_prio_refresh(cur);
+    }
+
+    if(p->vblanks) {
+        irq_disable_scoped();
+
+        if(p->pending) {
+            /* We already missed the release, so go right ahead. */
+            p->pending = false;
+            ++p->stats.misses;
+        }
+        else {
+            p->waiting = true;
+            genwait_wait(p, "thd_wait_period", 0, NULL);
+        }
+    }
+    else {
+        now = timer_ns_gettime64();
+
+        if(now >= p->next_release) {
+            ++p->stats.misses;
+
+            /* If we're more than a whole period late, don't try to catch up
+               with a burst of releases. */
+            if(now >= p->next_release + p->period_ns)
+                p->next_release = now;
+        }
+        else {
+            /* genwait timeouts are in milliseconds, so round up. Timing out
+               is the normal way of being released here, so have the timer
+               fire for it rather than at the next scheduler tick. */
+            irq_disable_scoped();
+
+            ms = (int)((p->next_release - now + 999999) / 1000000);
+            p->wakeup_ms = timer_ms_gettime64() + ms;
+            thd_wakeup_by(p->wakeup_ms);
+
+            err = errno;
+            genwait_wait(p, "thd_wait_period", ms, NULL);
+            errno = err;
+
+            p->wakeup_ms = 0;
+        }
+
+        p->next_release += p->period_ns;
+    }
+
+    period_release(p);
+
+    return 0;
+}
+
+int thd_clear_period(void) {
+    kthread_t *cur = thd_get_current();
+    struct kthread_period *p = cur->period;
+
+    if(!p) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    thd_period_destroy(cur);
+
+    irq_disable_scoped();
+    thd_prio_refresh(cur);
+
+    return 0;
+}
+
+int thd_get_period_stats(kthread_t *thd, thd_period_stats_t *stats) {
+    if(!thd->period) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    irq_disable_scoped();
+    *stats = thd->period->stats;
+
+    return 0;
+}
+
+void thd_period_vblank(void) {
+    struct kthread_period *p;
+    kthread_t *first = NULL;
+
+    LIST_FOREACH(p, &vbl_threads, list) {
+        if(++p->vbl_count < p->vblanks)
+            continue;
+
+        p->vbl_count = 0;
+
+        if(p->waiting) {
+            p->waiting = false;
+            genwait_wake_thd(p, p->thd, 0);
+
+            if(!first)
+                first = p->thd;
+        }
+        else {
+            /* Still busy with the previous job. */
+            p->pending = true;
+        }
+    }
+
+    /* Switch to a released thread right away rather than at the next
+       scheduler tick, unless a periodic job is already running. */
+    if(first && thd_current->prio > PRIO_PERIODIC)
+        thd_schedule_next(first);
+}
+
+void thd_period_check(kthread_t *thd) {
+    struct kthread_period *p = thd->period;
+
+    if(!p->budget_ns || p->throttled || p->waiting)
+        return;
+
+    if(thd_get_cpu_time(thd) - p->job_start > p->budget_ns) {
+        ++p->stats.overruns;
+        p->throttled = true;
+
+        /* Put it back at its own priority (or whatever the threads
+           waiting on its locks lend it). */
+        thd_prio_refresh(thd);
+
+        dbglog(DBG_KDEBUG, "thd_period: thread %d overran its budget\n",
+               thd->tid);
+    }
+}
+
+uint64_t thd_period_next_wakeup(uint64_t now) {
+    struct kthread_period *p;
+    uint64_t when = 0;
+
+    LIST_FOREACH(p, &time_threads, list) {
+        if(p->wakeup_ms > now && (!when || p->wakeup_ms < when))
+            when = p->wakeup_ms;
+    }
+
+    return when;
+}
+
+prio_t thd_period_prio(kthread_t *thd) {
+    return thd->period->throttled ? thd->real_prio : PRIO_PERIODIC;
+}
+
+void thd_period_destroy(kthread_t *thd) {
+    struct kthread_period *p = thd->period;
+
+    if(!p)
+        return;
+
+    {
+        irq_disable_scoped();
+
+        LIST_REMOVE(p, list);
+        thd->period = NULL;
+    }
+
+    free(p);
+}
@@ -0,0 +1,92 @@
+/* KallistiOS ##version##
+
+   ringbuf.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* The parts of the ring buffers that need the kernel: serializing several
+   producers, and sleeping until the other side catches up. Everything else
+   is inline in kos/ringbuf.h. */
+
+#include <errno.h>
+
+#include <arch/irq.h>
+#include <arch/timer.h>
+#include <kos/dbglog.h>
+#include <kos/genwait.h>
+#include <kos/ringbuf.h>
+
+size_t ringbuf_mp_write(ringbuf_t *rb, const void *src, size_t count) {
+    irq_disable_scoped();
+
+    return ringbuf_write(rb, src, count);
+}
+
+bool ringbuf_mp_push(ringbuf_t *rb, const void *elem) {
+    irq_disable_scoped();
+
+    return ringbuf_push(rb, elem);
+}
+
+void ringbuf_wake(ringbuf_t *rb) {
+    genwait_wake_all(rb);
+}
+
+static int ringbuf_wait(ringbuf_t *rb, size_t count, int timeout, bool read) {
+    uint64_t deadline = 0, now;
+    int rv = 0;
+
+    if(irq_inside_int()) {
+        dbglog(DBG_WARNING, "ringbuf_wait: called inside interrupt\n");
+        errno = EPERM;
+        return -1;
+    }
+
+    if(count > ringbuf_capacity(rb) || timeout < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* With interrupts disabled, nothing can be written or read between the
+       check and going to sleep, so the wake up can't be missed. */
+    irq_disable_scoped();
+
+    if(timeout)
+        deadline = timer_ms_gettime64() + timeout;
+
+    while((read ? ringbuf_used(rb) : ringbuf_space(rb)) < count) {
+        /* Don't start over from the full timeout after each wake up. */
+        if(deadline) {
+            now = timer_ms_gettime64();
+
+            if(now >= deadline) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+
+            timeout = (int)(deadline - now);
+        }
+
+        rb->waiting++;
+        rv = genwait_wait(rb, read ? "ringbuf_wait_read" : "ringbuf_wait_write",
+                          timeout, NULL);
+        rb->waiting--;
+
+        if(rv < 0) {
+            if(errno == EAGAIN)
+                errno = ETIMEDOUT;
+
+            break;
+        }
+    }
+
+    return rv;
+}
+
+int ringbuf_wait_read(ringbuf_t *rb, size_t count, int timeout) {
+    return ringbuf_wait(rb, count, timeout, true);
+}
+
+int ringbuf_wait_write(ringbuf_t *rb, size_t count, int timeout) {
+    return ringbuf_wait(rb, count, timeout, false);
+}
@@ -14,6 +14,18 @@
 #include <kos/genwait.h>
 #include <kos/dbglog.h>
 
+/* Take the write lock. Everything already waiting on the semaphore now waits
+   on this thread, and lends it its priority. */
+static void rwsem_take_write(rw_semaphore_t *s) {
+    s->write_lock = thd_current;
+
+    if(!TAILQ_EMPTY(&s->writers))
+        thd_pi_adopt(&s->writers, thd_current);
+
+    if(!TAILQ_EMPTY(&s->readers))
+        thd_pi_adopt(&s->readers, thd_current);
+}
+
 /* Allocate a new reader/writer semaphore */
 rw_semaphore_t *rwsem_create(void) {
     rw_semaphore_t *s;
@@ -30,6 +42,8 @@ rw_semaphore_t *rwsem_create(void) {
     s->read_count = 0;
     s->write_lock = NULL;
     s->reader_waiting = NULL;
+    TAILQ_INIT(&s->readers);
+    TAILQ_INIT(&s->writers);
 
     return s;
 }
@@ -39,6 +53,8 @@ int rwsem_init(rw_semaphore_t *s) {
     s->read_count = 0;
     s->write_lock = NULL;
     s->reader_waiting = NULL;
+    TAILQ_INIT(&s->readers);
+    TAILQ_INIT(&s->writers);
 
     return 0;
 }
@@ -85,9 +101,13 @@ int rwsem_read_lock_timed(rw_semaphore_t *s, int timeout) {
         ++s->read_count;
     }
     else {
+        /* Lend our priority to the writer while we wait for it. */
+        thd_pi_block(s->write_lock);
+
         /* Block until the write lock is not held any more */
-        rv = genwait_wait(s, timeout ? "rwsem_read_lock_timed" :
-                          "rwsem_read_lock", timeout, NULL);
+        rv = genwait_queue_wait(&s->readers, s, timeout ?
+                                "rwsem_read_lock_timed" : "rwsem_read_lock",
+                                timeout, NULL);
 
         if(rv < 0) {
             rv = -1;
@@ -134,13 +154,19 @@ int rwsem_write_lock_timed(rw_semaphore_t *s, int timeout) {
     /* If the write lock is not held and there are no readers in their critical
        sections, let the thread proceed. */
     if(!s->write_lock && !s->read_count) {
-        s->write_lock = thd_current;
+        rwsem_take_write(s);
     }
     else {
+        /* Lend our priority to the writer, if that's what we're waiting on.
+           Readers aren't tracked, so they can't be boosted. */
+        if(s->write_lock)
+            thd_pi_block(s->write_lock);
+
         /* Block until the write lock is not held and there are no readers
            inside their critical sections */
-        rv = genwait_wait(&s->write_lock, timeout ? "rwsem_write_lock_timed" :
-                          "rwsem_write_lock", timeout, NULL);
+        rv = genwait_queue_wait(&s->writers, &s->write_lock, timeout ?
+                                "rwsem_write_lock_timed" : "rwsem_write_lock",
+                                timeout, NULL);
 
         if(rv < 0) {
             rv = -1;
@@ -148,7 +174,7 @@ int rwsem_write_lock_timed(rw_semaphore_t *s, int timeout) {
                 errno = ETIMEDOUT;
         }
         else {
-            s->write_lock = thd_current;
+            rwsem_take_write(s);
         }
     }
 
@@ -184,7 +210,7 @@ int rwsem_read_unlock(rw_semaphore_t *s) {
             s->reader_waiting = NULL;
         }
         else {
-            genwait_wake_one(&s->write_lock);
+            genwait_queue_wake_cnt(&s->writers, 1, 0);
         }
     }
 
@@ -204,12 +230,16 @@ int rwsem_write_unlock(rw_semaphore_t *s) {
 
     s->write_lock = NULL;
 
+    /* Nobody waits on us any more, so drop any priority they lent us. */
+    thd_pi_release(&s->writers, thd_current);
+    thd_pi_release(&s->readers, thd_current);
+
     /* Give writers priority, attempt to wake any writers first. */
-    woken = genwait_wake_cnt(&s->write_lock, 1, 0);
+    woken = genwait_queue_wake_cnt(&s->writers, 1, 0);
 
     if(!woken) {
         /* No writers were waiting, wake up any readers. */
-        genwait_wake_all(s);
+        genwait_queue_wake_cnt(&s->readers, -1, 0);
     }
 
     return 0;
@@ -256,7 +286,7 @@ int rwsem_write_trylock(rw_semaphore_t *s) {
         return -1;
     }
 
-    s->write_lock = thd_current;
+    rwsem_take_write(s);
     return 0;
 }
 
@@ -290,9 +320,9 @@ int rwsem_read_upgrade_timed(rw_semaphore_t *s, int timeout) {
 
         --s->read_count;
         s->reader_waiting = thd_current;
-        rv = genwait_wait(&s->write_lock, timeout ?
-                          "rwsem_read_upgrade_timed" : "rwsem_read_upgrade",
-                          timeout, NULL);
+        rv = genwait_queue_wait(&s->writers, &s->write_lock, timeout ?
+                                "rwsem_read_upgrade_timed" :
+                                "rwsem_read_upgrade", timeout, NULL);
 
         if(rv < 0) {
             /* The only way we can error out is if there are still readers
@@ -305,11 +335,11 @@ int rwsem_read_upgrade_timed(rw_semaphore_t *s, int timeout) {
             return -1;
         }
 
-        s->write_lock = thd_current;
+        rwsem_take_write(s);
     }
     else {
         s->read_count = 0;
-        s->write_lock = thd_current;
+        rwsem_take_write(s);
     }
 
     return 0;
@@ -334,7 +364,7 @@ int rwsem_read_tryupgrade(rw_semaphore_t *s) {
     }
 
     s->read_count = 0;
-    s->write_lock = thd_current;
+    rwsem_take_write(s);
 
     return 0;
 }
@@ -44,6 +44,7 @@ semaphore_t *sem_create(int value) {
 
     sm->count = value;
     sm->initialized = 2;
+    TAILQ_INIT(&sm->waiters);
 
     return sm;
 }
@@ -61,13 +62,14 @@ int sem_init(semaphore_t *sm, int count) {
 
     sm->count = count;
     sm->initialized = 1;
+    TAILQ_INIT(&sm->waiters);
     return 0;
 }
 
 /* Take care of destroying a semaphore */
 int sem_destroy(semaphore_t *sm) {
     /* Wake up any queued threads with an error */
-    genwait_wake_all_err(sm, ENOTRECOVERABLE);
+    genwait_queue_wake_cnt(&sm->waiters, -1, ENOTRECOVERABLE);
 
     if(sm->initialized == 2) {
         /* Free the memory */
@@ -114,8 +116,8 @@ int sem_wait_timed(semaphore_t *sem, int timeout) {
     else {
         /* Block us until we're signaled */
         sem->count--;
-        rv = genwait_wait(sem, timeout ? "sem_wait_timed" : "sem_wait", timeout,
-                          NULL);
+        rv = genwait_queue_wait(&sem->waiters, sem, timeout ?
+                                "sem_wait_timed" : "sem_wait", timeout, NULL);
 
         /* Did we fail to get the lock? */
         if(rv < 0) {
@@ -169,14 +171,16 @@ int sem_signal(semaphore_t *sm) {
     }
     /* Is there anyone waiting? If so, pass off to them */
     else if(sm->count < 0) {
-        woken = genwait_wake_cnt(sm, 1, 0);
+        woken = genwait_queue_wake_cnt(&sm->waiters, 1, 0);
         (void)woken;
         assert(woken == 1);
         sm->count++;
     }
     else {
-        /* No one is waiting, so just add another tick */
+        /* No one is waiting, so just add another tick, and let anyone
+           watching the semaphore know that it is available. */
         sm->count++;
+        genwait_queue_wake_cnt(&sm->waiters, 1, 0);
     }
 
     return rv;
@@ -9,7 +9,6 @@
 
 #include <assert.h>
 #include <string.h>
-#include <malloc.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,6 +24,7 @@
 #include <kos/rwsem.h>
 #include <kos/cond.h>
 #include <kos/genwait.h>
+#include <kos/trace.h>
 
 #include <arch/irq.h>
 #include <arch/timer.h>
@@ -54,18 +54,66 @@ static alignas(THD_STACK_ALIGNMENT) uint8_t thd_idle_stack[64];
 /* Scheduler timer interrupt frequency (Hertz) */
 static unsigned int thd_sched_ms = 1000 / THD_SCHED_HZ;
 
+/* Tickless mode. When enabled, the primary timer is only used to time-slice
+   between threads when there actually are several threads competing for the
+   CPU at the top priority. Otherwise, it is programmed to fire at the next
+   genwait timeout, or after THD_TICKLESS_MAX_MS if there is none. */
+static bool thd_tickless = false;
+
+/* Longest we'll let the primary timer go without firing in tickless mode. */
+#define THD_TICKLESS_MAX_MS 1000
+
+/* Time (in ms since boot) at which the primary timer is due to fire, or 0 if
+   it isn't known to be armed. */
+static uint64_t thd_wakeup_time;
+
+/* Outside of tickless mode, time at which the current timeslice ends. The
+   primary timer may fire before that for the release of a time-driven periodic
+   thread, in which case the running thread keeps the rest of its timeslice.
+   Other genwait timeouts are still only checked on each tick. */
+static uint64_t thd_tick_time;
+
 /* Thread list. This includes all threads except dead ones. */
 static struct ktlist thd_list;
 
+/* Hash table of the same threads, keyed by thread ID, so that thd_by_tid()
+   doesn't have to walk the whole thread list. Thread IDs are handed out
+   sequentially, so the low bits alone spread them out evenly. */
+#define THD_TID_HASH_SIZE   64
+#define THD_TID_HASH(tid)   (&thd_tid_hash[(tid) & (THD_TID_HASH_SIZE - 1)])
+static struct ktlist thd_tid_hash[THD_TID_HASH_SIZE];
+
 /* Run queue. This is more like on a standard time sharing system than the
    previous versions. The top element of this priority queue should be the
    thread that is ready to run next. When a thread is scheduled, it will be
    removed from this queue. When it's de-scheduled, it will be re-inserted
-   by its priority value at the end of its priority group. Note that right
-   now this condition is being broken because sleeping threads are on the
-   same queue. We deal with those in thd_switch below. */
+   by its priority value at the end of its priority group.
+
+   The queue is split into one FIFO group per priority value. The groups are
+   kept back to back in a single list (so the head of the list is always the
+   next thread to run), and we remember the last thread of every non-empty
+   group along with a bitmap of which groups are non-empty. That way, finding
+   the insertion point for a thread never requires walking the list. */
 static struct ktqueue run_queue;
 
+/* Number of distinct priority groups in the run queue. */
+#define RUNQ_PRIOS      (PRIO_MAX + 1)
+
+/* Number of 32-bit words in each level of the priority bitmap. */
+#define RUNQ_WORDS      ((RUNQ_PRIOS + 31) / 32)
+#define RUNQ_GROUPS     ((RUNQ_WORDS + 31) / 32)
+
+_Static_assert(RUNQ_GROUPS <= 32, "Too many priorities for the run queue map");
+
+/* Last thread of each priority group, or NULL if the group is empty. */
+static kthread_t *runq_tail[RUNQ_PRIOS];
+
+/* Three-level bitmap of non-empty priority groups. Each bit in a level
+   summarizes whether the corresponding word in the level below is non-zero. */
+static uint32_t runq_map[RUNQ_WORDS];
+static uint32_t runq_group_map[RUNQ_GROUPS];
+static uint32_t runq_top_map;
+
 /* The currently executing thread. This thread should not be on any queues. */
 kthread_t *thd_current = NULL;
 
@@ -75,6 +123,13 @@ static kthread_mode_t thd_mode = THD_MODE_NONE;
 /* Reaper semaphore. Counts the number of threads waiting to be reaped. */
 static semaphore_t thd_reap_sem;
 
+/* Stack checking mode applied to newly created threads. */
+static int thd_stack_check = THD_STACK_CHECK_OFF;
+
+/* Pattern painted over the stacks of new threads when stack checking is
+   enabled. Stacks grow downwards, so the untouched part is at the bottom. */
+#define THD_STACK_PAINT 0xcafebabe
+
 /* Number of threads active in the system. */
 static size_t thd_count = 0;
 
@@ -160,6 +215,73 @@ int thd_pslist(int (*pf)(const char *fmt, ...)) {
     return 0;
 }
 
+/* Number of bytes at the bottom of a painted stack that were never used. */
+static size_t thd_stack_untouched(const kthread_t *thd) {
+    const uint32_t *ptr = (const uint32_t *)thd->stack;
+    const uint32_t *end = ptr + thd->stack_size / sizeof(uint32_t);
+
+    while(ptr < end && *ptr == THD_STACK_PAINT)
+        ptr++;
+
+    return (uintptr_t)ptr - (uintptr_t)thd->stack;
+}
+
+int thd_set_stack_check(int mode) {
+    if(mode < THD_STACK_CHECK_OFF || mode > THD_STACK_CHECK_GUARD) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    thd_stack_check = mode;
+    return 0;
+}
+
+ssize_t thd_get_stack_hwm(kthread_t *thd) {
+    if(!thd)
+        thd = thd_current;
+
+    if(!(thd->flags & THD_STACK_PAINTED)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return thd->stack_size - thd_stack_untouched(thd);
+}
+
+int thd_pslist_stack(int (*pf)(const char *fmt, ...)) {
+    size_t used, total_size = 0, total_suggested = 0;
+    kthread_t *cur;
+
+    pf("Thread stacks (bytes):\n");
+    pf("tid	    size	    peak	    free	 suggest	name\n");
+
+    irq_disable_scoped();
+
+    LIST_FOREACH(cur, &thd_list, t_list) {
+        pf("%d\t%8u\t", cur->tid, cur->stack_size);
+
+        if(!(cur->flags & THD_STACK_PAINTED)) {
+            pf("       -\t       -\t       -\t%s\n", cur->label);
+            continue;
+        }
+
+        used = cur->stack_size - thd_stack_untouched(cur);
+        total_size += cur->stack_size;
+
+        /* Leave a 25% margin, and round up to a kilobyte. */
+        total_suggested += (used + used / 4 + 1023) & ~1023;
+
+        pf("%8u\t%8u\t%8u\t%s\n", used, cur->stack_size - used,
+           (used + used / 4 + 1023) & ~1023, cur->label);
+    }
+
+    pf("painted stacks: %u bytes allocated, %u bytes suggested\n",
+       total_size, total_suggested);
+    pf("--end of list--\n");
+
+    return 0;
+}
+
 int thd_pslist_queue(int (*pf)(const char *fmt, ...)) {
     kthread_t *cur;
 
@@ -201,7 +323,7 @@ static tid_t thd_next_free(void) {
 kthread_t *thd_by_tid(tid_t tid) {
     kthread_t *np;
 
-    LIST_FOREACH(np, &thd_list, t_list) {
+    LIST_FOREACH(np, THD_TID_HASH(tid), tid_list) {
         if(np->tid == tid)
             return np;
     }
@@ -306,55 +428,128 @@ void thd_exit(void *rv) {
 /*****************************************************************************/
 /* Thread creation and deletion */
 
+/* Index of the most significant set bit of a non-zero word. */
+static inline unsigned int runq_msb(uint32_t x) {
+    return 31 - __builtin_clz(x);
+}
+
+/* Mark a priority group as non-empty. */
+static inline void runq_map_set(prio_t prio) {
+    unsigned int w = prio >> 5;
+
+    runq_map[w] |= 1u << (prio & 31);
+    runq_group_map[w >> 5] |= 1u << (w & 31);
+    runq_top_map |= 1u << (w >> 5);
+}
+
+/* Mark a priority group as empty. */
+static inline void runq_map_clear(prio_t prio) {
+    unsigned int w = prio >> 5;
+
+    runq_map[w] &= ~(1u << (prio & 31));
+
+    if(!runq_map[w]) {
+        runq_group_map[w >> 5] &= ~(1u << (w & 31));
+
+        if(!runq_group_map[w >> 5])
+            runq_top_map &= ~(1u << (w >> 5));
+    }
+}
+
+/* Find the last thread queued with a higher priority (lower value) than the
+   given one, or NULL if there isn't any. The new thread goes right after it. */
+static kthread_t *runq_prev_tail(prio_t prio) {
+    unsigned int w = prio >> 5, g = w >> 5;
+    uint32_t m;
+
+    if((m = runq_map[w] & ((1u << (prio & 31)) - 1)))
+        return runq_tail[(w << 5) | runq_msb(m)];
+
+    if((m = runq_group_map[g] & ((1u << (w & 31)) - 1))) {
+        w = (g << 5) | runq_msb(m);
+        return runq_tail[(w << 5) | runq_msb(runq_map[w])];
+    }
+
+    if((m = runq_top_map & ((1u << g) - 1))) {
+        g = runq_msb(m);
+        w = (g << 5) | runq_msb(runq_group_map[g]);
+        return runq_tail[(w << 5) | runq_msb(runq_map[w])];
+    }
+
+    return NULL;
+}
+
+/* Make sure the primary timer fires no later than the given time. If it is
+   already due to fire before then, leave it alone. */
+static void thd_wakeup_at(uint64_t when, uint64_t now) {
+    if(thd_wakeup_time > now && thd_wakeup_time <= when)
+        return;
+
+    thd_wakeup_time = when;
+    timer_primary_wakeup(when > now ? (uint32_t)(when - now) : 1);
+}
+
 /* Enqueue a process in the runnable queue; adds it right after the
    process group of the same priority (front_of_line==0) or
    right before the process group of the same priority (front_of_line!=0).
    See thd_schedule for why this is helpful. */
 void thd_add_to_runnable(kthread_t *t, bool front_of_line) {
-    kthread_t *i;
-    int done;
+    kthread_t *prev;
 
     if(t->flags & THD_QUEUED)
         return;
 
-    done = 0;
-
-    if(!front_of_line) {
-        /* Look for a thread of lower priority and insert
-           before it. If there is nothing on the run queue, we'll
-           fall through to the bottom. */
-        TAILQ_FOREACH(i, &run_queue, thdq) {
-            if(i->prio > t->prio) {
-                TAILQ_INSERT_BEFORE(i, t, thdq);
-                done = 1;
-                break;
-            }
-        }
+    if(!front_of_line && runq_tail[t->prio]) {
+        /* Goes at the end of its own priority group. */
+        TAILQ_INSERT_AFTER(&run_queue, runq_tail[t->prio], t, thdq);
+        runq_tail[t->prio] = t;
     }
     else {
-        /* Look for a thread of the same or lower priority and
-           insert before it. If there is nothing on the run queue,
-           we'll fall through to the bottom. */
-        TAILQ_FOREACH(i, &run_queue, thdq) {
-            if(i->prio >= t->prio) {
-                TAILQ_INSERT_BEFORE(i, t, thdq);
-                done = 1;
-                break;
-            }
+        /* Goes right after the last thread of a higher priority, which is
+           the front of its own priority group. */
+        if((prev = runq_prev_tail(t->prio)))
+            TAILQ_INSERT_AFTER(&run_queue, prev, t, thdq);
+        else
+            TAILQ_INSERT_HEAD(&run_queue, t, thdq);
+
+        if(!runq_tail[t->prio]) {
+            runq_tail[t->prio] = t;
+            runq_map_set(t->prio);
         }
     }
 
-    /* Didn't find one, put it at the end */
-    if(!done)
-        TAILQ_INSERT_TAIL(&run_queue, t, thdq);
-
     t->flags |= THD_QUEUED;
+
+    /* In tickless mode, the current thread may be running without a timer
+       armed to preempt it. If the new thread should get a share of the CPU,
+       make sure we get back into the scheduler within a timeslice. */
+    if(thd_tickless && thd_current && t != thd_current &&
+       t->prio <= thd_current->prio) {
+        uint64_t now = timer_ms_gettime64();
+        thd_wakeup_at(now + thd_sched_ms, now);
+    }
 }
 
 /* Removes a thread from the runnable queue, if it's there. */
 int thd_remove_from_runnable(kthread_t *thd) {
+    kthread_t *prev;
+
     if(!(thd->flags & THD_QUEUED)) return 0;
 
+    /* If this was the last thread of its group, the previous thread takes its
+       place, unless it belongs to another group. */
+    if(runq_tail[thd->prio] == thd) {
+        prev = TAILQ_PREV(thd, ktqueue, thdq);
+
+        if(prev && prev->prio == thd->prio) {
+            runq_tail[thd->prio] = prev;
+        }
+        else {
+            runq_tail[thd->prio] = NULL;
+            runq_map_clear(thd->prio);
+        }
+    }
+
     thd->flags &= ~THD_QUEUED;
     TAILQ_REMOVE(&run_queue, thd, thdq);
     return 0;
@@ -368,6 +563,7 @@ kthread_t *thd_create_ex(const kthread_attr_t *restrict attr,
     kthread_t *nt = NULL;
     tid_t tid;
     uint32_t params[4];
+    size_t i;
     kthread_attr_t real_attr = { false, THD_STACK_SIZE, NULL, PRIO_DEFAULT, NULL };
 
     if(attr)
@@ -388,6 +584,10 @@ kthread_t *thd_create_ex(const kthread_attr_t *restrict attr,
 
     irq_disable_scoped();
 
+    /* Make sure the new thread will have a spot in the timer queue */
+    if(genwait_reserve(thd_count + 1) < 0)
+        return NULL;
+
     /* Get a new thread id */
     tid = thd_next_free();
 
@@ -421,6 +621,15 @@ kthread_t *thd_create_ex(const kthread_attr_t *restrict attr,
 
             nt->stack_size = real_attr.stack_size;
 
+            /* Paint the stack, so that its usage can be tracked. */
+            if(thd_stack_check != THD_STACK_CHECK_OFF &&
+               nt->stack_size >= THD_STACK_GUARD_SIZE) {
+                for(i = 0; i < nt->stack_size / sizeof(uint32_t); i++)
+                    ((uint32_t *)nt->stack)[i] = THD_STACK_PAINT;
+
+                nt->flags |= THD_STACK_PAINTED;
+            }
+
             /* Populate the context */
             params[0] = (uint32_t)routine;
             params[1] = (uint32_t)param;
@@ -462,11 +671,12 @@ kthread_t *thd_create_ex(const kthread_attr_t *restrict attr,
             if(real_attr.create_detached)
                 nt->flags |= THD_DETACHED;
 
-            /* Initialize thread-local storage. */
-            LIST_INIT(&nt->tls_list);
+            /* Thread-local storage slots are allocated on first use by
+               kthread_setspecific(), so there's nothing to set up here. */
 
-            /* Insert it into the thread list */
+            /* Insert it into the thread list and ID hash */
             LIST_INSERT_HEAD(&thd_list, nt, t_list);
+            LIST_INSERT_HEAD(THD_TID_HASH(nt->tid), nt, tid_list);
 
             /* Add it to our count */
             ++thd_count;
@@ -487,7 +697,7 @@ kthread_t *thd_create(bool detach, void *(*routine)(void *), void *param) {
 /* Given a thread id, this function removes the thread from
    the execution chain. */
 int thd_destroy(kthread_t *thd) {
-    kthread_tls_kv_t *i, *i2;
+    kthread_t *cur;
 
     /* Make sure there are no ints */
     irq_disable_scoped();
@@ -501,26 +711,27 @@ int thd_destroy(kthread_t *thd) {
     if(thd->wait_obj)
         genwait_wake_thd(thd->wait_obj, thd, ECANCELED);
 
+    /* The same goes for the objects it was watching, if any. */
+    genwait_watch_cancel(thd);
+
     /* De-schedule the thread if it's scheduled. */
     thd_remove_from_runnable(thd);
 
-    /* Remove it from the thread list. */
+    /* Remove it from the thread list and ID hash. */
     LIST_REMOVE(thd, t_list);
+    LIST_REMOVE(thd, tid_list);
 
-    /* Call destructors on TLS entries.  */
-    LIST_FOREACH(i, &thd->tls_list, kv_list) {
-        if(i->destructor) {
-            i->destructor(i->data);
-        }
+    /* Anything still blocked on a lock it held can't boost it any more. */
+    while((cur = LIST_FIRST(&thd->pi_waiters))) {
+        LIST_REMOVE(cur, pi_list);
+        cur->wait_owner = NULL;
     }
 
-    /* Free TLS entries. */
-    i = LIST_FIRST(&thd->tls_list);
-    while(i != NULL) {
-        i2 = LIST_NEXT(i, kv_list);
-        free(i);
-        i = i2;
-    }
+    /* Call destructors on TLS entries and free them. */
+    kthread_tls_destroy(thd);
+
+    /* Drop out of the periodic class, if it was in it. */
+    thd_period_destroy(thd);
 
     /* Free its stack (if we're managing it). */
     if(thd->flags & THD_OWNS_STACK)
@@ -538,6 +749,107 @@ int thd_destroy(kthread_t *thd) {
     return 0;
 }
 
+/*****************************************************************************/
+/* Priority inheritance */
+
+/* Change a thread's dynamic priority, moving it to its new priority group if
+   it is currently queued. */
+static void thd_set_dyn_prio(kthread_t *thd, prio_t prio, bool front_of_line) {
+    if(thd->flags & THD_QUEUED) {
+        thd_remove_from_runnable(thd);
+        thd->prio = prio;
+        thd_add_to_runnable(thd, front_of_line);
+    }
+    else {
+        thd->prio = prio;
+    }
+}
+
+/* Raise a thread to at least the given priority, along with the holder of
+   whatever lock it is blocked on, and so on down the chain. This stops at the
+   first thread that already runs at that priority, which also takes care of
+   deadlock cycles. */
+static void thd_pi_boost(kthread_t *thd, prio_t prio) {
+    while(thd && thd->prio > prio) {
+        thd_set_dyn_prio(thd, prio, true);
+        thd = thd->wait_owner;
+    }
+}
+
+/* Recompute a thread's dynamic priority from its own priority (or the one the
+   periodic class gives it) and those of the threads blocked on locks it holds,
+   and pass any change along the chain of lock holders. Only needed when a
+   boost may have to be undone. */
+static void thd_pi_update(kthread_t *thd) {
+    kthread_t *cur;
+    prio_t prio;
+
+    while(thd) {
+        prio = thd->period ? thd_period_prio(thd) : thd->real_prio;
+
+        LIST_FOREACH(cur, &thd->pi_waiters, pi_list) {
+            if(cur->prio < prio)
+                prio = cur->prio;
+        }
+
+        if(prio == thd->prio)
+            break;
+
+        thd_set_dyn_prio(thd, prio, prio < thd->prio);
+        thd = thd->wait_owner;
+    }
+}
+
+void thd_prio_refresh(kthread_t *thd) {
+    thd_pi_update(thd);
+}
+
+void thd_pi_block(kthread_t *owner) {
+    thd_current->wait_owner = owner;
+    LIST_INSERT_HEAD(&owner->pi_waiters, thd_current, pi_list);
+    thd_pi_boost(owner, thd_current->prio);
+}
+
+void thd_pi_unblock(kthread_t *thd) {
+    kthread_t *owner = thd->wait_owner;
+
+    if(!owner)
+        return;
+
+    thd->wait_owner = NULL;
+    LIST_REMOVE(thd, pi_list);
+
+    /* Nothing to undo unless the owner runs at our priority. */
+    if(owner->prio == thd->prio && owner->prio != owner->real_prio)
+        thd_pi_update(owner);
+}
+
+void thd_pi_release(struct ktqueue *queue, kthread_t *owner) {
+    kthread_t *cur;
+
+    TAILQ_FOREACH(cur, queue, thdq) {
+        if(cur->wait_owner == owner) {
+            cur->wait_owner = NULL;
+            LIST_REMOVE(cur, pi_list);
+        }
+    }
+
+    if(owner->prio != owner->real_prio)
+        thd_pi_update(owner);
+}
+
+void thd_pi_adopt(struct ktqueue *queue, kthread_t *owner) {
+    kthread_t *cur;
+
+    TAILQ_FOREACH(cur, queue, thdq) {
+        if(!cur->wait_owner) {
+            cur->wait_owner = owner;
+            LIST_INSERT_HEAD(&owner->pi_waiters, cur, pi_list);
+            thd_pi_boost(owner, cur->prio);
+        }
+    }
+}
+
 /*****************************************************************************/
 /* Thread attribute functions */
 
@@ -549,9 +861,13 @@ int thd_set_prio(kthread_t *thd, prio_t prio) {
     if((prio < 0) || (prio > PRIO_MAX))
         return -2;
 
-    /* Set the new priority */
-    thd->prio = prio;
+    irq_disable_scoped();
+
+    /* Set the new base priority, then work out the dynamic one, in case the
+       thread is running boosted by threads waiting on its locks. */
     thd->real_prio = prio;
+    thd_pi_update(thd);
+
     return 0;
 }
 
@@ -581,18 +897,50 @@ static void thd_update_cpu_time(kthread_t *thd) {
     thd->cpu_time.scheduled = ns;
 }
 
+/* Make sure the outgoing thread didn't overflow its stack. This is only done
+   in guard mode, for threads whose stack was painted. Threads running a fiber
+   are on another stack, so only the guard words can be checked for them. */
+static void thd_stack_guard_check(kthread_t *thd) {
+    size_t i;
+
+    if(!thd || !(thd->flags & THD_STACK_PAINTED))
+        return;
+
+    if(!thd->fiber && CONTEXT_SP(thd->context) <
+       (uintptr_t)thd->stack + THD_STACK_GUARD_SIZE)
+        goto overflow;
+
+    for(i = 0; i < THD_STACK_GUARD_SIZE / sizeof(uint32_t); i++) {
+        if(((const uint32_t *)thd->stack)[i] != THD_STACK_PAINT)
+            goto overflow;
+    }
+
+    return;
+
+overflow:
+    thd_pslist(printf);
+    thd_pslist_stack(printf);
+    assert_msg(0, "Thread stack overflow");
+}
+
 /* Helper function that sets a thread being scheduled */
 static inline void thd_schedule_inner(kthread_t *thd) {
+    if(__unlikely(thd_stack_check == THD_STACK_CHECK_GUARD))
+        thd_stack_guard_check(thd_current);
+
     thd_remove_from_runnable(thd);
 
     thd_update_cpu_time(thd);
 
+    trace_record(TRACE_EVT_SWITCH, thd->tid);
+
     thd_current = thd;
     _impure_ptr = &thd->thd_reent;
     thd->state = STATE_RUNNING;
 
-    /* Make sure the thread hasn't underrun its stack */
-    if(thd_current->stack && thd_current->stack_size) {
+    /* Make sure the thread hasn't underrun its stack. A thread running a
+       fiber is on the fiber's stack, which can be anywhere. */
+    if(thd_current->stack && thd_current->stack_size && !thd_current->fiber) {
         if(CONTEXT_SP(thd_current->context) < (uintptr_t)(thd_current->stack)) {
             thd_pslist(printf);
             thd_pslist_queue(printf);
@@ -603,6 +951,24 @@ static inline void thd_schedule_inner(kthread_t *thd) {
     irq_set_context(&thd_current->context);
 }
 
+/* Tickless mode: program the primary timer for the next point in time where
+   the scheduler has something to do, now that thd_current has been picked. */
+static void thd_tickless_rearm(uint64_t now) {
+    kthread_t *next = TAILQ_FIRST(&run_queue);
+    uint64_t when = genwait_next_timeout();
+
+    /* Threads of the same or higher priority are waiting for the CPU, so we
+       still need to time-slice. */
+    if(next && next->prio <= thd_current->prio &&
+       (!when || when > now + thd_sched_ms))
+        when = now + thd_sched_ms;
+
+    if(!when || when > now + THD_TICKLESS_MAX_MS)
+        when = now + THD_TICKLESS_MAX_MS;
+
+    thd_wakeup_at(when, now);
+}
+
 /* Thread scheduler; this function will find a new thread to run when a
    context switch is requested. No work is done in here except to change
    out the thd_current variable contents. Assumed that we are in an
@@ -632,6 +998,10 @@ void thd_schedule(bool front_of_line, uint64_t now) {
         arch_exit();
     }
 
+    /* Enforce the CPU budget of a running periodic thread. */
+    if(thd_current->period && thd_current->state == STATE_RUNNING)
+        thd_period_check(thd_current);
+
     /* If the current thread is supposed to be in the front of the line, and it
        did not die, re-enqueue it to the front of the line now. */
     if(front_of_line && thd_current->state == STATE_RUNNING) {
@@ -642,14 +1012,10 @@ void thd_schedule(bool front_of_line, uint64_t now) {
     /* Look for timed out waits */
     genwait_check_timeouts(now);
 
-    /* Search downwards through the run queue for a runnable thread; if
-       we don't find a normal runnable thread, the idle process will
-       always be there at the bottom. */
-    TAILQ_FOREACH(thd, &run_queue, thdq) {
-        /* Is it runnable? If not, keep going */
-        if(thd->state == STATE_READY)
-            break;
-    }
+    /* Only runnable threads are ever queued, so the next thread to run is
+       simply the front of the run queue. If there is no other runnable
+       thread, the idle process will always be there at the bottom. */
+    thd = TAILQ_FIRST(&run_queue);
 
     /* If we didn't already re-enqueue the thread and we are supposed to do so,
        do it now. */
@@ -672,6 +1038,9 @@ void thd_schedule(bool front_of_line, uint64_t now) {
     /* We should now have a runnable thread, so remove it from the
        run queue and switch to it. */
     thd_schedule_inner(thd);
+
+    if(thd_tickless)
+        thd_tickless_rearm(now);
 }
 
 /* Temporary priority boosting function: call this from within an interrupt
@@ -701,6 +1070,9 @@ void thd_schedule_next(kthread_t *thd) {
     }
 
     thd_schedule_inner(thd);
+
+    if(thd_tickless)
+        thd_tickless_rearm(timer_ms_gettime64());
 }
 
 /* See kos/thread.h for description */
@@ -724,14 +1096,41 @@ irq_context_t *thd_choose_new(void) {
    threads, swap out contexts, and sleep. */
 static void thd_timer_hnd(irq_context_t *context) {
     /* Get the system time */
-    uint64_t now = timer_ms_gettime64();
+    uint64_t now = timer_ms_gettime64(), when;
 
     (void)context;
 
     //printf("timer woke at %d\n", (uint32_t)now);
 
-    thd_schedule(0, now);
-    timer_primary_wakeup(thd_sched_ms);
+    thd_wakeup_time = 0;
+
+    /* In tickless mode, the scheduler re-arms the timer itself. */
+    if(thd_tickless) {
+        thd_schedule(0, now);
+        return;
+    }
+
+    if(now < thd_tick_time) {
+        /* Woken early for a periodic release. */
+        thd_schedule(1, now);
+    }
+    else {
+        thd_schedule(0, now);
+        thd_tick_time = now + thd_sched_ms;
+    }
+
+    /* Fire again at the end of the timeslice, or at the next periodic release
+       if that comes first. */
+    when = thd_period_next_wakeup(now);
+
+    if(!when || when > thd_tick_time)
+        when = thd_tick_time;
+
+    thd_wakeup_at(when, now);
+}
+
+void thd_wakeup_by(uint64_t when) {
+    thd_wakeup_at(when, timer_ms_gettime64());
 }
 
 /*****************************************************************************/
@@ -958,6 +1357,25 @@ int thd_set_hz(unsigned int hertz) {
     return 0;
 }
 
+void thd_set_tickless(bool enable) {
+    irq_disable_scoped();
+
+    if(thd_tickless == enable)
+        return;
+
+    thd_tickless = enable;
+    thd_wakeup_time = 0;
+
+    /* Get back into the scheduler on the next tick either way, it will take
+       care of re-arming the timer as appropriate for the new mode. */
+    if(thd_mode != THD_MODE_NONE)
+        timer_primary_wakeup(thd_sched_ms);
+}
+
+bool thd_get_tickless(void) {
+    return thd_tickless;
+}
+
 /* Delete a TLS key. Note that currently this doesn't prevent you from reusing
    the key after deletion. This seems ok, as the pthreads standard states that
    using the key after deletion results in "undefined behavior".
@@ -965,7 +1383,6 @@ int thd_set_hz(unsigned int hertz) {
    through, so it ends up here instead. */
 int kthread_key_delete(kthread_key_t key) {
     kthread_t *cur;
-    kthread_tls_kv_t *i, *tmp;
 
     irq_disable_scoped();
 
@@ -975,21 +1392,11 @@ int kthread_key_delete(kthread_key_t key) {
         return -1;
     }
 
-    /* Make sure we can actually use free below. */
-    if(!malloc_irq_safe()) {
-        errno = EPERM;
-        return -1;
-    }
-
-    /* Go through each thread searching for (and removing) the data. */
+    /* Go through each thread clearing out its slot for the key. The slot
+       arrays themselves stay allocated until the threads exit. */
     LIST_FOREACH(cur, &thd_list, t_list) {
-        LIST_FOREACH_SAFE(i, &cur->tls_list, kv_list, tmp) {
-            if(i->key == key) {
-                LIST_REMOVE(i, kv_list);
-                free(i);
-                break;
-            }
-        }
+        if((size_t)key < cur->tls_size)
+            cur->tls_values[key] = NULL;
     }
 
     kthread_key_delete_destructor(key);
@@ -1023,6 +1430,7 @@ int thd_init(void) {
     };
 
     kthread_t *kern;
+    int i;
 
     /* Make sure we're not already running */
     if(thd_mode != THD_MODE_NONE)
@@ -1034,11 +1442,18 @@ int thd_init(void) {
     /* Initialize handle counters */
     tid_highest = 1;
 
-    /* Initialize the thread list */
+    /* Initialize the thread list and ID hash */
     LIST_INIT(&thd_list);
 
+    for(i = 0; i < THD_TID_HASH_SIZE; i++)
+        LIST_INIT(&thd_tid_hash[i]);
+
     /* Initialize the run queue */
     TAILQ_INIT(&run_queue);
+    memset(runq_tail, 0, sizeof(runq_tail));
+    memset(runq_map, 0, sizeof(runq_map));
+    memset(runq_group_map, 0, sizeof(runq_group_map));
+    runq_top_map = 0;
 
     /* Start off with no "current" thread */
     thd_current = NULL;
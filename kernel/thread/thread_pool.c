@@ -0,0 +1,313 @@
+/* KallistiOS ##version##
+
+   thread_pool.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+#include <arch/irq.h>
+#include <arch/timer.h>
+#include <assert.h>
+#include <errno.h>
+#include <kos/genwait.h>
+#include <kos/thread.h>
+#include <kos/thread_pool.h>
+#include <kos/worker_thread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/queue.h>
+
+/* Job states */
+#define JOB_IDLE        0   /* Not submitted (or done and resubmittable) */
+#define JOB_WAITING     1   /* Submitted, waiting for other jobs */
+#define JOB_QUEUED      2   /* Ready, waiting for a worker */
+#define JOB_RUNNING     3
+#define JOB_DONE        4
+
+#define JOB_PENDING(job) ((job)->state != JOB_IDLE && (job)->state != JOB_DONE)
+
+STAILQ_HEAD(pool_jobs, kthread_pool_job);
+
+struct pool_worker {
+    kthread_worker_t *worker;
+    kthread_pool_t *pool;
+    bool busy;
+};
+
+struct kthread_pool {
+    struct pool_jobs queues[THD_POOL_PRIO_COUNT];
+    size_t outstanding;
+    thd_pool_stats_t stats;
+    size_t count;
+    struct pool_worker workers[];
+};
+
+/* Wake up an idle worker, if there is one. Busy workers look for another job
+   before going back to sleep, so they don't need to be told. Called with
+   interrupts disabled. */
+static void thd_pool_kick(kthread_pool_t *pool) {
+    size_t i;
+
+    for(i = 0; i < pool->count; i++) {
+        if(!pool->workers[i].busy) {
+            pool->workers[i].busy = true;
+            thd_worker_wakeup(pool->workers[i].worker);
+            return;
+        }
+    }
+}
+
+/* Queue a job whose dependencies are all done. Called with interrupts
+   disabled. */
+static void thd_pool_ready(kthread_pool_t *pool, kthread_pool_job_t *job) {
+    job->state = JOB_QUEUED;
+    job->ready_time = timer_ns_gettime64();
+    STAILQ_INSERT_TAIL(&pool->queues[job->prio], job, entry);
+
+    if(++pool->stats.queued > pool->stats.max_queued)
+        pool->stats.max_queued = pool->stats.queued;
+
+    thd_pool_kick(pool);
+}
+
+/* Dequeue the next job to run, if any. Called with interrupts disabled. */
+static kthread_pool_job_t *thd_pool_take(kthread_pool_t *pool) {
+    kthread_pool_job_t *job;
+    uint64_t latency;
+    int i;
+
+    for(i = 0; i < THD_POOL_PRIO_COUNT; i++) {
+        job = STAILQ_FIRST(&pool->queues[i]);
+
+        if(job) {
+            STAILQ_REMOVE_HEAD(&pool->queues[i], entry);
+            job->state = JOB_RUNNING;
+
+            latency = timer_ns_gettime64() - job->ready_time;
+            pool->stats.latency_total += latency;
+
+            if(latency > pool->stats.latency_max)
+                pool->stats.latency_max = latency;
+
+            pool->stats.queued--;
+            pool->stats.running++;
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+/* Mark a job as done, and release its continuation. Called with interrupts
+   disabled. */
+static void thd_pool_done(kthread_pool_t *pool, kthread_pool_job_t *job,
+                          uint64_t run_time) {
+    kthread_pool_job_t *next = job->then;
+
+    job->then = NULL;
+    job->state = JOB_DONE;
+
+    pool->stats.running--;
+    pool->stats.completed++;
+    pool->stats.run_total += run_time;
+
+    if(run_time > pool->stats.run_max)
+        pool->stats.run_max = run_time;
+
+    if(next && !--next->deps && next->state == JOB_WAITING) {
+        pool->stats.waiting--;
+        thd_pool_ready(next->pool, next);
+    }
+
+    genwait_wake_all(job);
+
+    if(!--pool->outstanding)
+        genwait_wake_all(&pool->outstanding);
+}
+
+/* Work function of each of the pool's threaded workers: run jobs until there
+   are none left. */
+static void thd_pool_work(void *d) {
+    struct pool_worker *w = d;
+    kthread_pool_t *pool = w->pool;
+    kthread_pool_job_t *job;
+    uint64_t start;
+    uint32_t flags;
+
+    for(;;) {
+        flags = irq_disable();
+
+        job = thd_pool_take(pool);
+
+        if(!job) {
+            w->busy = false;
+            irq_restore(flags);
+            return;
+        }
+
+        irq_restore(flags);
+
+        start = timer_ns_gettime64();
+        job->routine(job->data);
+        start = timer_ns_gettime64() - start;
+
+        flags = irq_disable();
+        thd_pool_done(pool, job, start);
+        irq_restore(flags);
+    }
+}
+
+kthread_pool_t *thd_pool_create(size_t threads, const kthread_attr_t *attr) {
+    kthread_pool_t *pool;
+    size_t i;
+    int j;
+
+    if(!threads) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    pool = calloc(1, sizeof(*pool) + threads * sizeof(struct pool_worker));
+    if(!pool) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for(j = 0; j < THD_POOL_PRIO_COUNT; j++)
+        STAILQ_INIT(&pool->queues[j]);
+
+    for(i = 0; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].worker = thd_worker_create_ex(attr, thd_pool_work,
+                                                       &pool->workers[i]);
+
+        if(!pool->workers[i].worker) {
+            pool->count = i;
+            thd_pool_destroy(pool);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    pool->count = threads;
+
+    return pool;
+}
+
+void thd_pool_destroy(kthread_pool_t *pool) {
+    size_t i;
+
+    assert(pool != NULL);
+
+    thd_pool_wait_all(pool, 0);
+
+    for(i = 0; i < pool->count; i++)
+        thd_worker_destroy(pool->workers[i].worker);
+
+    free(pool);
+}
+
+void thd_pool_job_init(kthread_pool_job_t *job, void (*routine)(void *),
+                       void *data, int prio) {
+    assert(routine != NULL);
+    assert(prio >= 0 && prio < THD_POOL_PRIO_COUNT);
+
+    memset(job, 0, sizeof(*job));
+    job->routine = routine;
+    job->data = data;
+    job->prio = prio;
+    job->state = JOB_IDLE;
+}
+
+int thd_pool_job_after(kthread_pool_job_t *job, kthread_pool_job_t *before) {
+    irq_disable_scoped();
+
+    if(before->then || JOB_PENDING(job) || JOB_PENDING(before)) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    before->then = job;
+    job->deps++;
+
+    return 0;
+}
+
+int thd_pool_submit(kthread_pool_t *pool, kthread_pool_job_t *job) {
+    irq_disable_scoped();
+
+    if(JOB_PENDING(job)) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    job->pool = pool;
+    pool->outstanding++;
+
+    if(job->deps) {
+        job->state = JOB_WAITING;
+        pool->stats.waiting++;
+    }
+    else {
+        thd_pool_ready(pool, job);
+    }
+
+    return 0;
+}
+
+int thd_pool_wait(kthread_pool_job_t *job, int timeout) {
+    irq_disable_scoped();
+
+    if(!job->pool) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while(job->state != JOB_DONE) {
+        if(genwait_wait(job, "thd_pool_wait", timeout, NULL) < 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int thd_pool_wait_all(kthread_pool_t *pool, int timeout) {
+    size_t i;
+
+    irq_disable_scoped();
+
+    for(i = 0; i < pool->count; i++) {
+        if(thd_worker_get_thread(pool->workers[i].worker) == thd_current) {
+            errno = EDEADLK;
+            return -1;
+        }
+    }
+
+    while(pool->outstanding) {
+        if(genwait_wait(&pool->outstanding, "thd_pool_wait_all", timeout,
+                        NULL) < 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void thd_pool_get_stats(kthread_pool_t *pool, thd_pool_stats_t *stats,
+                        bool reset) {
+    irq_disable_scoped();
+
+    *stats = pool->stats;
+
+    if(reset) {
+        pool->stats.max_queued = pool->stats.queued;
+        pool->stats.completed = 0;
+        pool->stats.latency_total = 0;
+        pool->stats.latency_max = 0;
+        pool->stats.run_total = 0;
+        pool->stats.run_max = 0;
+    }
+}
@@ -8,6 +8,7 @@
    1.3.0. */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <errno.h>
 #include <malloc.h>
@@ -20,58 +21,67 @@
 static spinlock_t mutex = SPINLOCK_INITIALIZER;
 static kthread_key_t next_key = 1;
 
-typedef struct kthread_tls_dest {
-    /* List handle */
-    LIST_ENTRY(kthread_tls_dest) dest_list;
+typedef void (*tls_dtor_t)(void *);
 
-    /* The key */
-    kthread_key_t key;
+/* Destructors for each key, indexed by the key itself. Keys are never reused,
+   so this only ever grows, and only as far as the highest key that has been
+   given a destructor. Each thread keeps its values in an array indexed the
+   same way (see tls_values in kthread_t), which makes lookups O(1). */
+static tls_dtor_t *dest_table;
+static size_t dest_size;
 
-    /* Destructor for the key */
-    void (*destructor)(void *);
-} kthread_tls_dest_t;
+/* Smallest array we'll allocate for keys, to avoid reallocating on every
+   new key when a program creates a handful of them at startup. */
+#define TLS_MIN_SLOTS   8
 
-LIST_HEAD(kthread_tls_dest_list, kthread_tls_dest);
+/* Grow an array of pointers so that it has room for index key. New slots are
+   zeroed. kthread_key_delete() and kthread_tls_destroy() use these arrays with
+   interrupts disabled, so the new array and its size are put in place
+   together, and the old one stays valid until then. Returns -1 if out of
+   memory. */
+static int tls_grow(void ***arr, size_t *size, kthread_key_t key) {
+    size_t nsize = *size ? *size : TLS_MIN_SLOTS;
+    void **rv, **old;
 
-static struct kthread_tls_dest_list dest_list;
+    while(nsize <= (size_t)key)
+        nsize <<= 1;
 
-/* What is the next key that will be given out? */
-kthread_key_t kthread_key_next(void) {
-    return next_key;
-}
+    rv = (void **)malloc(nsize * sizeof(void *));
+
+    if(!rv)
+        return -1;
 
-typedef void (*destructor)(void *);
+    {
+        irq_disable_scoped();
 
-/* Get the destructor for a given key. */
-static destructor kthread_key_get_destructor(kthread_key_t key) {
-    kthread_tls_dest_t *i;
+        old = *arr;
 
-    LIST_FOREACH(i, &dest_list, dest_list) {
-        if(i->key == key) {
-            return i->destructor;
-        }
+        if(*size)
+            memcpy(rv, old, *size * sizeof(void *));
+
+        memset(rv + *size, 0, (nsize - *size) * sizeof(void *));
+        *arr = rv;
+        *size = nsize;
     }
 
-    return NULL;
+    free(old);
+
+    return 0;
+}
+
+/* What is the next key that will be given out? */
+kthread_key_t kthread_key_next(void) {
+    return next_key;
 }
 
 /* Delete the destructor for a given key. */
 void kthread_key_delete_destructor(kthread_key_t key) {
-    kthread_tls_dest_t *i, *tmp;
-
-    LIST_FOREACH_SAFE(i, &dest_list, dest_list, tmp) {
-        if(i->key == key) {
-            LIST_REMOVE(i, dest_list);
-            free(i);
-            return;
-        }
-    }
+    if((size_t)key < dest_size)
+        dest_table[key] = NULL;
 }
 
 /* Create a new TLS key. */
 int kthread_key_create(kthread_key_t *key, void (*destructor)(void *)) {
-    kthread_tls_dest_t *dest;
-
     if(irq_inside_int() &&
        (spinlock_is_locked(&mutex) || !malloc_irq_safe())) {
         errno = EPERM;
@@ -82,16 +92,13 @@ int kthread_key_create(kthread_key_t *key, void (*destructor)(void *)) {
 
     /* Store the destructor if need be. */
     if(destructor) {
-        dest = (kthread_tls_dest_t *)malloc(sizeof(kthread_tls_dest_t));
-
-        if(!dest) {
+        if((size_t)next_key >= dest_size &&
+           tls_grow((void ***)&dest_table, &dest_size, next_key)) {
             errno = ENOMEM;
             return -1;
         }
 
-        dest->key = next_key;
-        dest->destructor = destructor;
-        LIST_INSERT_HEAD(&dest_list, dest, dest_list);
+        dest_table[next_key] = destructor;
     }
 
     *key = next_key++;
@@ -103,13 +110,11 @@ int kthread_key_create(kthread_key_t *key, void (*destructor)(void *)) {
    or there is no data there for the current thread. */
 void *kthread_getspecific(kthread_key_t key) {
     kthread_t *cur = thd_get_current();
-    kthread_tls_kv_t *i;
 
-    LIST_FOREACH(i, &cur->tls_list, kv_list) {
-        if(i->key == key) {
-            return i->data;
-        }
-    }
+    /* Slot 0 is never handed out, and negative keys wrap around to huge
+       indices, so this covers invalid keys too. */
+    if((size_t)key < cur->tls_size)
+        return cur->tls_values[key];
 
     return NULL;
 }
@@ -117,10 +122,10 @@ void *kthread_getspecific(kthread_key_t key) {
 /* Set the value for a given TLS key. Returns -1 on failure. errno will be
    EINVAL if the key is not valid, ENOMEM if there is no memory available to
    allocate for storage, or EPERM if run inside an interrupt and the a call is
-   in progress already. */
+   in progress already or the storage would have to grow while the heap is
+   busy. */
 int kthread_setspecific(kthread_key_t key, const void *value) {
     kthread_t *cur = thd_get_current();
-    kthread_tls_kv_t *i;
 
     if(irq_inside_int() && spinlock_is_locked(&mutex)) {
         errno = EPERM;
@@ -137,46 +142,54 @@ int kthread_setspecific(kthread_key_t key, const void *value) {
         }
     }
 
-    /* Check if we already have an entry for this key. */
-    LIST_FOREACH(i, &cur->tls_list, kv_list) {
-        if(i->key == key) {
-            i->data = (void *)value;
-            return 0;
+    /* Make room for the key in this thread's slots, if there isn't any. That
+       takes the heap, which an interrupt may have caught in the middle of
+       an allocation. */
+    if((size_t)key >= cur->tls_size) {
+        if(irq_inside_int() && !malloc_irq_safe()) {
+            errno = EPERM;
+            return -1;
         }
-    }
-
-    /* No entry, create a new one. */
-    i = (kthread_tls_kv_t *)malloc(sizeof(kthread_tls_kv_t));
 
-    if(!i) {
-        errno = ENOMEM;
-        return -1;
+        if(tls_grow(&cur->tls_values, &cur->tls_size, key)) {
+            errno = ENOMEM;
+            return -1;
+        }
     }
 
-    i->key = key;
-    i->data = (void *)value;
-    i->destructor = kthread_key_get_destructor(key);
-    LIST_INSERT_HEAD(&cur->tls_list, i, kv_list);
+    cur->tls_values[key] = (void *)value;
 
     return 0;
 }
 
+/* Call destructors on a thread's TLS values and free its slots. */
+void kthread_tls_destroy(kthread_t *thd) {
+    size_t i;
+    void *data;
+
+    for(i = 1; i < thd->tls_size; ++i) {
+        data = thd->tls_values[i];
+
+        if(data && i < dest_size && dest_table[i])
+            dest_table[i](data);
+    }
+
+    free(thd->tls_values);
+    thd->tls_values = NULL;
+    thd->tls_size = 0;
+}
+
 int kthread_tls_init(void) {
-    /* Initialize the destructor list. */
-    LIST_INIT(&dest_list);
+    /* Start with an empty destructor table. */
+    dest_table = NULL;
+    dest_size = 0;
 
     return 0;
 }
 
 void kthread_tls_shutdown(void) {
-    kthread_tls_dest_t *n1, *n2;
-
-    /* Tear down the destructor list. */
-    n1 = LIST_FIRST(&dest_list);
-
-    while(n1 != NULL) {
-        n2 = LIST_NEXT(n1, dest_list);
-        free(n1);
-        n1 = n2;
-    }
+    /* Tear down the destructor table. */
+    free(dest_table);
+    dest_table = NULL;
+    dest_size = 0;
 }
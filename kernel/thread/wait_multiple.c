@@ -0,0 +1,209 @@
+/* KallistiOS ##version##
+
+   wait_multiple.c
+   Copyright (C) 2025 KallistiOS Team
+*/
+
+/* Waiting on several sync objects at once, on top of genwait_watch_*(). The
+   watches are always armed before the objects are checked, so anything that
+   happens while they are being checked makes the wait return right away,
+   instead of going unnoticed. */
+
+#include <poll.h>
+#include <errno.h>
+#include <stdbool.h>
+
+#include <arch/irq.h>
+#include <arch/timer.h>
+#include <kos/fs.h>
+#include <kos/sem.h>
+#include <kos/cond.h>
+#include <kos/genwait.h>
+#include <kos/worker_thread.h>
+#include <kos/wait_multiple.h>
+
+/* Fill in the watch for an object, and check that it makes sense. */
+static int wait_prepare(thd_wait_t *w, genwait_watch_t *watch,
+                        mutex_t **mutex) {
+    switch(w->type) {
+        case THD_WAIT_SEM:
+            if(!w->obj)
+                break;
+
+            watch->queue = &((semaphore_t *)w->obj)->waiters;
+            watch->obj = w->obj;
+            return 0;
+
+        case THD_WAIT_COND:
+            if(!w->obj || !w->mutex || (*mutex && *mutex != w->mutex) ||
+               !mutex_is_locked(w->mutex))
+                break;
+
+            *mutex = w->mutex;
+            watch->queue = &((condvar_t *)w->obj)->waiters;
+            watch->obj = w->obj;
+            return 0;
+
+        case THD_WAIT_WORKER:
+            if(!w->obj)
+                break;
+
+            watch->queue = NULL;
+            watch->obj = thd_worker_idle_obj(w->obj);
+            return 0;
+
+        case THD_WAIT_FD:
+            if(w->fd < 0 || w->fd >= FD_SETSIZE)
+                break;
+
+            /* See __poll_event_trigger() */
+            watch->queue = NULL;
+            watch->obj = &fd_table[w->fd];
+            return 0;
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+/* Check whether an object looks ready, without consuming it. */
+static bool wait_ready(thd_wait_t *w) {
+    semaphore_t *sem;
+    vfs_handler_t *hndl;
+    void *hnd;
+
+    switch(w->type) {
+        case THD_WAIT_SEM:
+            /* A destroyed semaphore is "ready", wait_claim() reports it. */
+            sem = w->obj;
+            return sem->count > 0 ||
+                   (sem->initialized != 1 && sem->initialized != 2);
+
+        case THD_WAIT_WORKER:
+            return thd_worker_is_idle(w->obj);
+
+        case THD_WAIT_FD:
+            hndl = fs_get_handler(w->fd);
+            hnd = fs_get_handle(w->fd);
+
+            /* Same rules as poll() */
+            if(!hndl || !hnd)
+                w->revents = POLLNVAL;
+            else if(!hndl->poll)
+                w->revents = (POLLRDNORM | POLLWRNORM) & w->events;
+            else
+                w->revents = hndl->poll(hnd, w->events);
+
+            return w->revents != 0;
+    }
+
+    /* Condition variables have no state, they are only ever signaled. */
+    return false;
+}
+
+/* Consume an object that looked ready. Returns 1 on success, 0 if another
+   thread got to it first, or -1 on error. */
+static int wait_claim(thd_wait_t *w) {
+    if(w->type != THD_WAIT_SEM)
+        return 1;
+
+    if(!sem_trywait(w->obj))
+        return 1;
+
+    return errno == EWOULDBLOCK ? 0 : -1;
+}
+
+int thd_wait_multiple(thd_wait_t *objs, size_t count, int timeout) {
+    genwait_watch_t watches[THD_WAIT_MAX];
+    mutex_t *mutex = NULL;
+    bool unlocked = false;
+    uint64_t deadline = 0, now;
+    size_t i;
+    int rv, fired;
+
+    if(irq_inside_int()) {
+        errno = EPERM;
+        return -1;
+    }
+
+    if(!count || count > THD_WAIT_MAX || timeout < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for(i = 0; i < count; i++) {
+        if(wait_prepare(&objs[i], &watches[i], &mutex) < 0)
+            return -1;
+    }
+
+    if(timeout)
+        deadline = timer_ms_gettime64() + timeout;
+
+    for(;;) {
+        genwait_watch_arm(watches, count);
+
+        for(i = 0; i < count; i++) {
+            if(wait_ready(&objs[i]))
+                break;
+        }
+
+        if(i < count) {
+            /* A condition variable signaled while checking was counted as
+               waking us up, so report it rather than lose it. The object that
+               looked ready is left alone, for next time. */
+            fired = genwait_watch_disarm(watches, count);
+
+            if(fired >= 0 && objs[fired].type == THD_WAIT_COND) {
+                rv = fired;
+                break;
+            }
+
+            rv = wait_claim(&objs[i]);
+
+            if(rv) {
+                rv = rv > 0 ? (int)i : -1;
+                break;
+            }
+
+            continue;
+        }
+
+        if(deadline) {
+            now = timer_ms_gettime64();
+
+            if(now >= deadline) {
+                genwait_watch_disarm(watches, count);
+                errno = ETIMEDOUT;
+                rv = -1;
+                break;
+            }
+
+            timeout = (int)(deadline - now);
+        }
+
+        /* Signals that come in after this are caught by the watches. */
+        if(mutex && !unlocked) {
+            mutex_unlock(mutex);
+            unlocked = true;
+        }
+
+        rv = genwait_watch_wait(watches, count, "thd_wait_multiple", timeout);
+
+        if(rv < 0) {
+            if(errno == EAGAIN)
+                errno = ETIMEDOUT;
+
+            break;
+        }
+
+        /* Anything but a condition variable is checked again on the next
+           round, as another thread might have claimed it in the meantime. */
+        if(objs[rv].type == THD_WAIT_COND)
+            break;
+    }
+
+    if(unlocked)
+        mutex_lock(mutex);
+
+    return rv;
+}
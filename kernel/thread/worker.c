@@ -18,6 +18,7 @@ struct kthread_worker {
     void (*routine)(void *);
     void *data;
     bool pending;
+    bool running;
     bool quit;
     STAILQ_HEAD(kthread_jobs, kthread_job) jobs;
 };
@@ -29,9 +30,15 @@ static void *thd_worker_thread(void *d) {
     for (;;) {
         flags = irq_disable();
 
-        if ((!worker->pending) && (!worker->quit))
+        if ((!worker->pending) && (!worker->quit)) {
+            /* Let anyone waiting for the work to be done know about it */
+            worker->running = false;
+            genwait_wake_all(&worker->running);
+
             genwait_wait(worker, worker->thd->label, 0, NULL);
+        }
 
+        worker->running = true;
         irq_restore(flags);
 
         if (worker->quit)
@@ -59,6 +66,7 @@ kthread_worker_t *thd_worker_create_ex(const kthread_attr_t *attr,
     worker->data = data;
     worker->routine = routine;
     worker->pending = false;
+    worker->running = false;
     worker->quit = false;
     STAILQ_INIT(&worker->jobs);
 
@@ -106,6 +114,16 @@ kthread_t *thd_worker_get_thread(kthread_worker_t *worker) {
     return worker->thd;
 }
 
+bool thd_worker_is_idle(kthread_worker_t *worker) {
+    irq_disable_scoped();
+
+    return !worker->pending && !worker->running;
+}
+
+void *thd_worker_idle_obj(kthread_worker_t *worker) {
+    return &worker->running;
+}
+
 void thd_worker_add_job(kthread_worker_t *worker, kthread_job_t *job) {
     irq_disable_scoped();
 
@@ -79,6 +79,25 @@ add_compile_options(
     "$<${ENABLE_RELEASE_FLAGS}:-fomit-frame-pointer>"
     )
 
+# Atomic model: defaults to the one KOS was configured with (KOS_ATOMIC_MODEL
+# in environ.sh), but can be overridden per project with -DKOS_ATOMIC_MODEL=.
+# Both models can be mixed within a program.
+if(DEFINED ENV{KOS_ATOMIC_MODEL})
+    set(KOS_ATOMIC_MODEL_DEFAULT $ENV{KOS_ATOMIC_MODEL})
+else()
+    set(KOS_ATOMIC_MODEL_DEFAULT soft-imask)
+endif()
+
+set(KOS_ATOMIC_MODEL ${KOS_ATOMIC_MODEL_DEFAULT} CACHE STRING
+    "SH4 atomic model (soft-imask or soft-gusa)")
+set_property(CACHE KOS_ATOMIC_MODEL PROPERTY STRINGS soft-imask soft-gusa)
+
+if(NOT KOS_ATOMIC_MODEL MATCHES "^soft-(imask|gusa)$")
+    message(FATAL_ERROR "Unsupported KOS_ATOMIC_MODEL: ${KOS_ATOMIC_MODEL}")
+endif()
+
+add_compile_options(-matomic-model=${KOS_ATOMIC_MODEL})
+
 set(CMAKE_ASM_FLAGS "")
 set(CMAKE_ASM_FLAGS_RELEASE "")
 
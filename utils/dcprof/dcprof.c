@@ -0,0 +1,550 @@
+/* KallistiOS ##version##
+
+   dcprof.c
+   Copyright (C) 2025 KallistiOS Team
+
+   Symbolizes a profile written by profiler_dump() (see dc/profiler.h) against
+   the ELF file of the program that was profiled, and prints gprof-style flat
+   and call graph reports, or folded stacks for flamegraph.pl and similar
+   tools.
+
+   Usage: dcprof [-F] [-i] program.elf profile.kprf
+
+     -F     Print folded stacks ("thread;caller;function count") instead of
+            the flat profile and call graph.
+     -i     Ignore samples taken while the idle thread was running.
+
+   Only PC and PR are sampled, so a "caller" is only known when PR points into
+   a different function than PC. That's always the case for leaf functions,
+   which is where most of the time tends to go anyway.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* These must match dc/profiler.h. Everything is little endian. */
+#define PROFILER_MAGIC      0x4b505246
+#define PROFILER_VERSION    1
+#define PROFILER_LABEL_LEN  32
+
+#define HEADER_SIZE         24
+#define THREAD_SIZE         (4 + PROFILER_LABEL_LEN)
+#define SAMPLE_SIZE         12
+
+/* ELF bits we care about. */
+#define SHT_SYMTAB          2
+#define SHF_EXECINSTR       4
+#define STT_NOTYPE          0
+#define STT_FUNC            2
+
+/* Index used for addresses that don't belong to any symbol. */
+#define UNKNOWN             0
+
+typedef struct {
+    uint32_t addr;
+    uint32_t end;
+    const char *name;
+    int is_func;
+    uint32_t self;
+    uint32_t children;
+    uint32_t called;
+} func_t;
+
+typedef struct {
+    uint32_t caller;
+    uint32_t callee;
+    uint32_t count;
+} edge_t;
+
+typedef struct {
+    uint32_t tid;
+    uint32_t caller;
+    uint32_t callee;
+} stack_t_;
+
+typedef struct {
+    uint32_t tid;
+    char label[PROFILER_LABEL_LEN + 1];
+} thread_t;
+
+static func_t *funcs;
+static uint32_t nfuncs;
+static edge_t *edges;
+static uint32_t nedges;
+static thread_t *threads;
+static uint32_t nthreads;
+static uint32_t rate;
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+/* Strip the SH4 memory area bits, so P1 (cached) and P2 (uncached) addresses
+   of the same code compare equal. */
+static uint32_t phys(uint32_t addr) {
+    return addr & 0x1fffffff;
+}
+
+static void *load_file(const char *fn, size_t *size) {
+    FILE *fp;
+    uint8_t *buf;
+    long len;
+
+    if(!(fp = fopen(fn, "rb"))) {
+        perror(fn);
+        exit(1);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if(len < 0 || !(buf = malloc(len ? len : 1)) ||
+       fread(buf, 1, len, fp) != (size_t)len) {
+        fprintf(stderr, "%s: unable to read file\n", fn);
+        exit(1);
+    }
+
+    fclose(fp);
+    *size = len;
+
+    return buf;
+}
+
+static int func_cmp(const void *a, const void *b) {
+    const func_t *fa = a, *fb = b;
+
+    if(fa->addr != fb->addr)
+        return fa->addr < fb->addr ? -1 : 1;
+
+    /* Prefer real function symbols over plain labels at the same address. */
+    return fb->is_func - fa->is_func;
+}
+
+static void load_symbols(const char *fn) {
+    size_t size;
+    uint8_t *elf = load_file(fn, &size);
+    uint8_t *sh, *sym;
+    uint32_t shoff, shnum, shentsize, i, j, n;
+    uint32_t symoff, symsize, stroff, strsize, link;
+    const char *name;
+
+    if(size < 52 || memcmp(elf, "\177ELF", 4) || elf[4] != 1 || elf[5] != 1) {
+        fprintf(stderr, "%s: not a 32-bit little endian ELF file\n", fn);
+        exit(1);
+    }
+
+    shoff = get32(elf + 0x20);
+    shentsize = get16(elf + 0x2e);
+    shnum = get16(elf + 0x30);
+
+    if(shoff + shnum * shentsize > size) {
+        fprintf(stderr, "%s: bad section headers\n", fn);
+        exit(1);
+    }
+
+    /* Leave slot 0 for unknown addresses. */
+    funcs = calloc(1, sizeof(func_t));
+    funcs[0].name = "<unknown>";
+    nfuncs = 1;
+
+    for(i = 0; i < shnum; ++i) {
+        sh = elf + shoff + i * shentsize;
+
+        if(get32(sh + 4) != SHT_SYMTAB)
+            continue;
+
+        symoff = get32(sh + 16);
+        symsize = get32(sh + 20);
+        link = get32(sh + 24);
+
+        if(link >= shnum || symoff + symsize > size)
+            continue;
+
+        stroff = get32(elf + shoff + link * shentsize + 16);
+        strsize = get32(elf + shoff + link * shentsize + 20);
+
+        if(stroff + strsize > size)
+            continue;
+
+        n = symsize / 16;
+        funcs = realloc(funcs, (nfuncs + n) * sizeof(func_t));
+
+        for(j = 0; j < n; ++j) {
+            uint32_t type, shndx;
+
+            sym = elf + symoff + j * 16;
+            type = sym[12] & 0xf;
+            shndx = get16(sym + 14);
+
+            if(type != STT_FUNC && type != STT_NOTYPE)
+                continue;
+
+            /* Only symbols in code sections. */
+            if(!shndx || shndx >= shnum ||
+               !(get32(elf + shoff + shndx * shentsize + 8) & SHF_EXECINSTR))
+                continue;
+
+            if(get32(sym) >= strsize)
+                continue;
+
+            name = (const char *)elf + stroff + get32(sym);
+
+            /* Skip local labels and mapping symbols. */
+            if(!*name || name[0] == '$' || !strncmp(name, ".L", 2))
+                continue;
+
+            memset(&funcs[nfuncs], 0, sizeof(func_t));
+            funcs[nfuncs].addr = phys(get32(sym + 4));
+            funcs[nfuncs].end = funcs[nfuncs].addr + get32(sym + 8);
+            funcs[nfuncs].name = name;
+            funcs[nfuncs].is_func = type == STT_FUNC;
+            ++nfuncs;
+        }
+    }
+
+    if(nfuncs == 1) {
+        fprintf(stderr, "%s: no symbols found (was it stripped?)\n", fn);
+        exit(1);
+    }
+
+    qsort(funcs + 1, nfuncs - 1, sizeof(func_t), func_cmp);
+
+    /* Drop duplicate addresses, keeping the preferred symbol. */
+    for(i = j = 1; i < nfuncs; ++i) {
+        if(j > 1 && funcs[j - 1].addr == funcs[i].addr)
+            continue;
+
+        funcs[j++] = funcs[i];
+    }
+
+    nfuncs = j;
+
+    /* The ELF buffer is intentionally kept around for the symbol names. */
+}
+
+/* Find the function containing addr. */
+static uint32_t lookup(uint32_t addr) {
+    uint32_t lo = 1, hi = nfuncs, mid;
+
+    addr = phys(addr);
+
+    if(addr < funcs[1].addr)
+        return UNKNOWN;
+
+    while(hi - lo > 1) {
+        mid = (lo + hi) / 2;
+
+        if(funcs[mid].addr <= addr)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    /* Past the end of a sized symbol, with no other symbol after it? */
+    if(lo == nfuncs - 1 && funcs[lo].end > funcs[lo].addr &&
+       addr >= funcs[lo].end)
+        return UNKNOWN;
+
+    return lo;
+}
+
+static void add_edge(uint32_t caller, uint32_t callee) {
+    uint32_t i;
+
+    for(i = 0; i < nedges; ++i) {
+        if(edges[i].caller == caller && edges[i].callee == callee) {
+            ++edges[i].count;
+            return;
+        }
+    }
+
+    if(!(nedges & (nedges - 1)) || !nedges)
+        edges = realloc(edges, (nedges ? nedges * 2 : 16) * sizeof(edge_t));
+
+    edges[nedges].caller = caller;
+    edges[nedges].callee = callee;
+    edges[nedges].count = 1;
+    ++nedges;
+}
+
+static const char *thread_label(uint32_t tid) {
+    static char buf[32];
+    uint32_t i;
+
+    for(i = 0; i < nthreads; ++i) {
+        if(threads[i].tid == tid)
+            return threads[i].label;
+    }
+
+    snprintf(buf, sizeof(buf), "tid %u", (unsigned int)tid);
+    return buf;
+}
+
+static double secs(uint32_t samples) {
+    return (double)samples / rate;
+}
+
+static int self_cmp(const void *a, const void *b) {
+    const func_t *fa = *(func_t * const *)a, *fb = *(func_t * const *)b;
+
+    if(fa->self != fb->self)
+        return fa->self > fb->self ? -1 : 1;
+
+    return strcmp(fa->name, fb->name);
+}
+
+static int total_cmp(const void *a, const void *b) {
+    const func_t *fa = *(func_t * const *)a, *fb = *(func_t * const *)b;
+    uint32_t ta = fa->self + fa->children, tb = fb->self + fb->children;
+
+    if(ta != tb)
+        return ta > tb ? -1 : 1;
+
+    return strcmp(fa->name, fb->name);
+}
+
+static int stack_cmp(const void *a, const void *b) {
+    const stack_t_ *sa = a, *sb = b;
+
+    if(sa->tid != sb->tid)
+        return sa->tid < sb->tid ? -1 : 1;
+
+    if(sa->caller != sb->caller)
+        return sa->caller < sb->caller ? -1 : 1;
+
+    if(sa->callee != sb->callee)
+        return sa->callee < sb->callee ? -1 : 1;
+
+    return 0;
+}
+
+/* Print a frame name for folded output, which can't contain semicolons. */
+static void print_frame(const char *name) {
+    for(; *name; ++name)
+        putchar(*name == ';' || *name == ' ' ? '_' : *name);
+}
+
+static void print_flat(uint32_t total) {
+    func_t **sorted = malloc(nfuncs * sizeof(func_t *));
+    uint32_t i, n = 0, cumulative = 0;
+
+    for(i = 0; i < nfuncs; ++i) {
+        if(funcs[i].self)
+            sorted[n++] = &funcs[i];
+    }
+
+    qsort(sorted, n, sizeof(func_t *), self_cmp);
+
+    printf("Flat profile:\n\n");
+    printf("Each sample counts as %g seconds.\n", 1.0 / rate);
+    printf("  %%   cumulative   self              \n");
+    printf(" time   seconds   seconds   samples  name\n");
+
+    for(i = 0; i < n; ++i) {
+        cumulative += sorted[i]->self;
+        printf("%6.2f %9.3f %9.3f %9u  %s\n",
+               100.0 * sorted[i]->self / total, secs(cumulative),
+               secs(sorted[i]->self), (unsigned int)sorted[i]->self,
+               sorted[i]->name);
+    }
+
+    free(sorted);
+}
+
+static void print_graph(uint32_t total) {
+    func_t **sorted = malloc(nfuncs * sizeof(func_t *));
+    uint32_t *index = calloc(nfuncs, sizeof(uint32_t));
+    uint32_t i, j, n = 0, f;
+
+    for(i = 0; i < nfuncs; ++i) {
+        if(funcs[i].self || funcs[i].children)
+            sorted[n++] = &funcs[i];
+    }
+
+    qsort(sorted, n, sizeof(func_t *), total_cmp);
+
+    for(i = 0; i < n; ++i)
+        index[sorted[i] - funcs] = i + 1;
+
+    printf("\n\t\t     Call graph\n\n");
+    printf("Samples are attributed to callers through PR only, so the "
+           "children column\nonly covers time spent directly in leaf "
+           "callees.\n\n");
+    printf("index %% time    self  children    samples     name\n");
+
+    for(i = 0; i < n; ++i) {
+        f = sorted[i] - funcs;
+
+        for(j = 0; j < nedges; ++j) {
+            if(edges[j].callee == f)
+                printf("             %7.3f %9.3f %6u/%-6u     %s [%u]\n",
+                       secs(edges[j].count), 0.0,
+                       (unsigned int)edges[j].count,
+                       (unsigned int)funcs[f].called,
+                       funcs[edges[j].caller].name,
+                       (unsigned int)index[edges[j].caller]);
+        }
+
+        printf("[%u]%*s%5.1f %7.3f %9.3f %6u         %s [%u]\n",
+               (unsigned int)(i + 1), (int)(5 - snprintf(NULL, 0, "%u",
+                                                          (unsigned int)(i + 1))),
+               "", 100.0 * (funcs[f].self + funcs[f].children) / total,
+               secs(funcs[f].self), secs(funcs[f].children),
+               (unsigned int)funcs[f].self, funcs[f].name,
+               (unsigned int)(i + 1));
+
+        for(j = 0; j < nedges; ++j) {
+            if(edges[j].caller == f)
+                printf("             %7.3f %9.3f %6u/%-6u     %s [%u]\n",
+                       secs(edges[j].count), 0.0,
+                       (unsigned int)edges[j].count,
+                       (unsigned int)funcs[edges[j].callee].called,
+                       funcs[edges[j].callee].name,
+                       (unsigned int)index[edges[j].callee]);
+        }
+
+        printf("-----------------------------------------------\n");
+    }
+
+    free(index);
+    free(sorted);
+}
+
+static void print_folded(stack_t_ *stacks, uint32_t n) {
+    uint32_t i, count;
+
+    qsort(stacks, n, sizeof(stack_t_), stack_cmp);
+
+    for(i = 0; i < n; i += count) {
+        for(count = 1; i + count < n &&
+            !stack_cmp(&stacks[i], &stacks[i + count]); ++count)
+            ;
+
+        print_frame(thread_label(stacks[i].tid));
+
+        if(stacks[i].caller != stacks[i].callee) {
+            putchar(';');
+            print_frame(funcs[stacks[i].caller].name);
+        }
+
+        putchar(';');
+        print_frame(funcs[stacks[i].callee].name);
+        printf(" %u\n", (unsigned int)count);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int folded = 0, no_idle = 0, argi;
+    uint8_t *prof, *p;
+    size_t size;
+    uint32_t nsamples, i, pc, pr, tid, f, c, total = 0, idle_tid = 0;
+    stack_t_ *stacks;
+
+    for(argi = 1; argi < argc && argv[argi][0] == '-'; ++argi) {
+        if(!strcmp(argv[argi], "-F"))
+            folded = 1;
+        else if(!strcmp(argv[argi], "-i"))
+            no_idle = 1;
+        else
+            break;
+    }
+
+    if(argc - argi != 2) {
+        fprintf(stderr, "Usage: %s [-F] [-i] program.elf profile.kprf\n",
+                argv[0]);
+        return 1;
+    }
+
+    load_symbols(argv[argi]);
+    prof = load_file(argv[argi + 1], &size);
+
+    if(size < HEADER_SIZE || get32(prof) != PROFILER_MAGIC) {
+        fprintf(stderr, "%s: not a KOS profile\n", argv[argi + 1]);
+        return 1;
+    }
+
+    if(get32(prof + 4) != PROFILER_VERSION) {
+        fprintf(stderr, "%s: unsupported profile version %u\n",
+                argv[argi + 1], (unsigned int)get32(prof + 4));
+        return 1;
+    }
+
+    rate = get32(prof + 8);
+    nthreads = get32(prof + 12);
+    nsamples = get32(prof + 16);
+
+    if(!rate || HEADER_SIZE + (uint64_t)nthreads * THREAD_SIZE +
+       (uint64_t)nsamples * SAMPLE_SIZE > size) {
+        fprintf(stderr, "%s: truncated profile\n", argv[argi + 1]);
+        return 1;
+    }
+
+    if(get32(prof + 20))
+        fprintf(stderr, "warning: %u samples were dropped (buffer full)\n",
+                (unsigned int)get32(prof + 20));
+
+    p = prof + HEADER_SIZE;
+    threads = calloc(nthreads ? nthreads : 1, sizeof(thread_t));
+
+    for(i = 0; i < nthreads; ++i, p += THREAD_SIZE) {
+        threads[i].tid = get32(p);
+        memcpy(threads[i].label, p + 4, PROFILER_LABEL_LEN);
+
+        if(!strcmp(threads[i].label, "[idle]"))
+            idle_tid = threads[i].tid;
+    }
+
+    stacks = malloc((nsamples ? nsamples : 1) * sizeof(stack_t_));
+
+    for(i = 0; i < nsamples; ++i, p += SAMPLE_SIZE) {
+        pc = get32(p);
+        pr = get32(p + 4);
+        tid = get32(p + 8);
+
+        if(no_idle && idle_tid && tid == idle_tid)
+            continue;
+
+        f = lookup(pc);
+        c = lookup(pr);
+
+        ++funcs[f].self;
+
+        /* PR pointing into the same function just means it has already been
+           saved on the stack, so we don't know the real caller. */
+        if(c != UNKNOWN && c != f) {
+            ++funcs[c].children;
+            ++funcs[f].called;
+            add_edge(c, f);
+        }
+        else {
+            c = f;
+        }
+
+        stacks[total].tid = tid;
+        stacks[total].caller = c;
+        stacks[total].callee = f;
+        ++total;
+    }
+
+    if(!total) {
+        fprintf(stderr, "No samples to report.\n");
+        return 0;
+    }
+
+    if(folded) {
+        print_folded(stacks, total);
+    }
+    else {
+        print_flat(total);
+        print_graph(total);
+    }
+
+    return 0;
+}
@@ -0,0 +1,1350 @@
+/* KallistiOS ##version##
+
+   kosheap.c
+   Copyright (C) 2025 KallistiOS Team
+
+   Rebuilds the state of the heap over time from an allocation trace taken
+   with kos/alloc_trace.h, and reports how it evolved, where the memory went
+   at its peak, and what was never freed.
+
+   Usage: kosheap [options] trace.kalc [program.elf]
+
+     -p N       Print the heap state at N evenly spaced points in time, rather
+                than at the markers dropped with alloc_trace_mark().
+     -n N       List the top N call sites (default 10).
+     -s         Replay the trace into a few alternative allocation strategies,
+                and compare how much memory each would have needed.
+     -l size    Heap size for -s; allocations which don't fit are counted as
+                failures (default: unlimited).
+     -x file    Write the trace as a utils/slabbench trace.
+
+   With the program's ELF file, call sites are shown as function names rather
+   than addresses.
+
+   Fragmentation is estimated from the addresses of the live blocks: the gaps
+   between them are free memory the allocator couldn't give back. Gaps of up
+   to 16 bytes are counted as chunk overhead rather than free memory.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/* These must match kos/alloc_trace.h. Everything is little endian. */
+#define ALLOC_TRACE_MAGIC       0x4b414c43
+#define ALLOC_TRACE_VERSION     1
+#define ALLOC_TRACE_LABEL_LEN   32
+#define ALLOC_TRACE_DEPTH       3
+#define ALLOC_TRACE_STREAMED    0xffffffff
+
+#define HEADER_SIZE             24
+#define THREAD_SIZE             (4 + ALLOC_TRACE_LABEL_LEN)
+#define RECORD_SIZE             32
+
+#define ALLOC_OP_MALLOC         1
+#define ALLOC_OP_CALLOC         2
+#define ALLOC_OP_REALLOC        3
+#define ALLOC_OP_MEMALIGN       4
+#define ALLOC_OP_FREE           5
+#define ALLOC_OP_MARK           6
+#define ALLOC_OP_DROPPED        7
+
+/* Largest gap between two blocks still considered chunk overhead. */
+#define OVERHEAD_GAP            16
+
+/* ELF bits we care about. */
+#define SHT_SYMTAB              2
+#define SHF_EXECINSTR           4
+#define STT_NOTYPE              0
+#define STT_FUNC                2
+
+typedef struct {
+    uint32_t addr;
+    uint32_t end;
+    const char *name;
+    int is_func;
+} func_t;
+
+typedef struct {
+    uint32_t callers[ALLOC_TRACE_DEPTH];
+    uint32_t allocs;
+    uint64_t total;
+    uint32_t live_blocks;
+    uint32_t live;
+    uint32_t peak;
+    uint32_t at_peak;
+    uint32_t at_peak_blocks;
+} site_t;
+
+typedef struct {
+    uint32_t addr;
+    uint32_t size;
+    uint32_t site;
+    uint32_t id;
+} block_t;
+
+/* Normalized operations, for the replays. */
+enum { EV_ALLOC, EV_REALLOC, EV_FREE };
+
+typedef struct {
+    uint8_t type;
+    uint32_t id;
+    uint32_t size;
+    uint32_t align;
+} event_t;
+
+static func_t *funcs;
+static uint32_t nfuncs;
+
+static site_t *sites;
+static uint32_t nsites, max_sites;
+static uint32_t *site_hash;
+static uint32_t site_hash_mask;
+
+static block_t *blocks;
+static uint32_t blocks_mask, nblocks;
+
+static event_t *events;
+static size_t nevents, max_events;
+static uint32_t next_id;
+
+static uint64_t live, live_peak, peak_time;
+static uint32_t live_count;
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+/* Strip the SH4 memory area bits, so P1 (cached) and P2 (uncached) addresses
+   of the same code compare equal. */
+static uint32_t phys(uint32_t addr) {
+    return addr & 0x1fffffff;
+}
+
+static void *xrealloc(void *ptr, size_t size) {
+    if(!(ptr = realloc(ptr, size ? size : 1))) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    return ptr;
+}
+
+static void *load_file(const char *fn, size_t *size) {
+    FILE *fp;
+    uint8_t *buf;
+    long len;
+
+    if(!(fp = fopen(fn, "rb"))) {
+        perror(fn);
+        exit(1);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if(len < 0 || !(buf = malloc(len ? len : 1)) ||
+       fread(buf, 1, len, fp) != (size_t)len) {
+        fprintf(stderr, "%s: unable to read file\n", fn);
+        exit(1);
+    }
+
+    fclose(fp);
+    *size = len;
+
+    return buf;
+}
+
+static int func_cmp(const void *a, const void *b) {
+    const func_t *fa = a, *fb = b;
+
+    if(fa->addr != fb->addr)
+        return fa->addr < fb->addr ? -1 : 1;
+
+    /* Prefer real function symbols over plain labels at the same address. */
+    return fb->is_func - fa->is_func;
+}
+
+static void load_symbols(const char *fn) {
+    size_t size;
+    uint8_t *elf = load_file(fn, &size);
+    uint8_t *sh, *sym;
+    uint32_t shoff, shnum, shentsize, i, j, n;
+    uint32_t symoff, symsize, stroff, strsize, link;
+    const char *name;
+
+    if(size < 52 || memcmp(elf, "\177ELF", 4) || elf[4] != 1 || elf[5] != 1) {
+        fprintf(stderr, "%s: not a 32-bit little endian ELF file\n", fn);
+        exit(1);
+    }
+
+    shoff = get32(elf + 0x20);
+    shentsize = get16(elf + 0x2e);
+    shnum = get16(elf + 0x30);
+
+    if(shoff + shnum * shentsize > size) {
+        fprintf(stderr, "%s: bad section headers\n", fn);
+        exit(1);
+    }
+
+    for(i = 0; i < shnum; ++i) {
+        sh = elf + shoff + i * shentsize;
+
+        if(get32(sh + 4) != SHT_SYMTAB)
+            continue;
+
+        symoff = get32(sh + 16);
+        symsize = get32(sh + 20);
+        link = get32(sh + 24);
+
+        if(link >= shnum || symoff + symsize > size)
+            continue;
+
+        stroff = get32(elf + shoff + link * shentsize + 16);
+        strsize = get32(elf + shoff + link * shentsize + 20);
+
+        if(stroff + strsize > size)
+            continue;
+
+        n = symsize / 16;
+        funcs = xrealloc(funcs, (nfuncs + n) * sizeof(func_t));
+
+        for(j = 0; j < n; ++j) {
+            uint32_t type, shndx;
+
+            sym = elf + symoff + j * 16;
+            type = sym[12] & 0xf;
+            shndx = get16(sym + 14);
+
+            if(type != STT_FUNC && type != STT_NOTYPE)
+                continue;
+
+            /* Only symbols in code sections. */
+            if(!shndx || shndx >= shnum ||
+               !(get32(elf + shoff + shndx * shentsize + 8) & SHF_EXECINSTR))
+                continue;
+
+            if(get32(sym) >= strsize)
+                continue;
+
+            name = (const char *)elf + stroff + get32(sym);
+
+            /* Skip local labels and mapping symbols. */
+            if(!*name || name[0] == '$' || !strncmp(name, ".L", 2))
+                continue;
+
+            funcs[nfuncs].addr = phys(get32(sym + 4));
+            funcs[nfuncs].end = funcs[nfuncs].addr + get32(sym + 8);
+            funcs[nfuncs].name = name;
+            funcs[nfuncs].is_func = type == STT_FUNC;
+            ++nfuncs;
+        }
+    }
+
+    if(!nfuncs) {
+        fprintf(stderr, "%s: no symbols found (was it stripped?)\n", fn);
+        exit(1);
+    }
+
+    qsort(funcs, nfuncs, sizeof(func_t), func_cmp);
+
+    /* Drop duplicate addresses, keeping the preferred symbol. */
+    for(i = j = 1; i < nfuncs; ++i) {
+        if(funcs[j - 1].addr == funcs[i].addr)
+            continue;
+
+        funcs[j++] = funcs[i];
+    }
+
+    nfuncs = j;
+
+    /* The ELF buffer is intentionally kept around for the symbol names. */
+}
+
+/* Print a code address as function+offset, if we can. */
+static void print_addr(uint32_t addr) {
+    uint32_t lo = 0, hi = nfuncs, mid, pa = phys(addr);
+
+    if(!nfuncs || pa < funcs[0].addr) {
+        printf("%08x", (unsigned int)addr);
+        return;
+    }
+
+    while(hi - lo > 1) {
+        mid = (lo + hi) / 2;
+
+        if(funcs[mid].addr <= pa)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    if(lo == nfuncs - 1 && funcs[lo].end > funcs[lo].addr &&
+       pa >= funcs[lo].end) {
+        printf("%08x", (unsigned int)addr);
+        return;
+    }
+
+    printf("%s+0x%x", funcs[lo].name, (unsigned int)(pa - funcs[lo].addr));
+}
+
+static void print_site(const site_t *s) {
+    int i;
+
+    for(i = 0; i < ALLOC_TRACE_DEPTH && s->callers[i]; i++) {
+        if(i)
+            printf(" <- ");
+
+        print_addr(s->callers[i]);
+    }
+
+    if(!s->callers[0])
+        printf("<unknown>");
+
+    printf("\n");
+}
+
+static uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+/* Call sites, found by their return addresses. */
+static uint32_t get_site(const uint32_t *callers) {
+    uint32_t h, i, s;
+
+    if(nsites * 2 >= site_hash_mask) {
+        free(site_hash);
+        site_hash_mask = site_hash_mask ? site_hash_mask * 2 + 1 : 1023;
+        site_hash = xrealloc(NULL, (site_hash_mask + 1) * sizeof(uint32_t));
+        memset(site_hash, 0xff, (site_hash_mask + 1) * sizeof(uint32_t));
+
+        for(s = 0; s < nsites; s++) {
+            h = hash32(sites[s].callers[0] ^ hash32(sites[s].callers[1] ^
+                       hash32(sites[s].callers[2])));
+
+            while(site_hash[h & site_hash_mask] != 0xffffffff)
+                h++;
+
+            site_hash[h & site_hash_mask] = s;
+        }
+    }
+
+    h = hash32(callers[0] ^ hash32(callers[1] ^ hash32(callers[2])));
+
+    for(;; h++) {
+        s = site_hash[h & site_hash_mask];
+
+        if(s == 0xffffffff)
+            break;
+
+        if(!memcmp(sites[s].callers, callers, sizeof(sites[s].callers)))
+            return s;
+    }
+
+    if(nsites == max_sites) {
+        max_sites = max_sites ? max_sites * 2 : 256;
+        sites = xrealloc(sites, max_sites * sizeof(site_t));
+    }
+
+    s = nsites++;
+    memset(&sites[s], 0, sizeof(site_t));
+
+    for(i = 0; i < ALLOC_TRACE_DEPTH; i++)
+        sites[s].callers[i] = callers[i];
+
+    site_hash[h & site_hash_mask] = s;
+
+    return s;
+}
+
+/* Live blocks, found by their address. Open addressing with linear probing,
+   and backward shift deletion so that there are no tombstones. */
+static block_t *find_block(uint32_t addr) {
+    uint32_t h;
+
+    if(!blocks)
+        return NULL;
+
+    for(h = hash32(addr);; h++) {
+        block_t *b = &blocks[h & blocks_mask];
+
+        if(!b->addr)
+            return NULL;
+
+        if(b->addr == addr)
+            return b;
+    }
+}
+
+static void insert_block(const block_t *nb) {
+    block_t *old;
+    uint32_t h, i, size;
+
+    if((nblocks + 1) * 2 > blocks_mask) {
+        old = blocks;
+        size = blocks ? blocks_mask + 1 : 0;
+        blocks_mask = blocks ? blocks_mask * 2 + 1 : 4095;
+        blocks = calloc(blocks_mask + 1, sizeof(block_t));
+
+        if(!blocks) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+
+        for(i = 0; i < size; i++) {
+            if(!old[i].addr)
+                continue;
+
+            for(h = hash32(old[i].addr); blocks[h & blocks_mask].addr; h++)
+                ;
+
+            blocks[h & blocks_mask] = old[i];
+        }
+
+        free(old);
+    }
+
+    for(h = hash32(nb->addr); blocks[h & blocks_mask].addr; h++)
+        ;
+
+    blocks[h & blocks_mask] = *nb;
+    nblocks++;
+}
+
+static void remove_block(block_t *b) {
+    uint32_t i = b - blocks, j = i, k;
+
+    for(;;) {
+        blocks[i].addr = 0;
+
+        for(;;) {
+            j = (j + 1) & blocks_mask;
+
+            if(!blocks[j].addr) {
+                nblocks--;
+                return;
+            }
+
+            k = hash32(blocks[j].addr) & blocks_mask;
+
+            /* Move it back if its home slot isn't between i and j. */
+            if(i <= j ? (i < k && k <= j) : (i < k || k <= j))
+                continue;
+
+            blocks[i] = blocks[j];
+            i = j;
+            break;
+        }
+    }
+}
+
+static void add_event(uint8_t type, uint32_t id, uint32_t size, uint32_t align) {
+    if(nevents == max_events) {
+        max_events = max_events ? max_events * 2 : 65536;
+        events = xrealloc(events, max_events * sizeof(event_t));
+    }
+
+    events[nevents].type = type;
+    events[nevents].id = id;
+    events[nevents].size = size;
+    events[nevents].align = align;
+    nevents++;
+}
+
+static void at_global_peak(void);
+
+static void block_alloc(uint32_t addr, uint32_t size, uint32_t site,
+                        uint32_t id, uint64_t now) {
+    block_t b = { addr, size, site, id };
+    site_t *s = &sites[site];
+
+    insert_block(&b);
+
+    s->live += size;
+    s->live_blocks++;
+
+    if(s->live > s->peak)
+        s->peak = s->live;
+
+    live += size;
+    live_count++;
+
+    if(live > live_peak) {
+        live_peak = live;
+        peak_time = now;
+        at_global_peak();
+    }
+}
+
+static void block_free(block_t *b) {
+    site_t *s = &sites[b->site];
+
+    s->live -= b->size;
+    s->live_blocks--;
+    live -= b->size;
+    live_count--;
+
+    remove_block(b);
+}
+
+/* Remember how much each site held when the heap peaked. This is done on
+   every new peak, which is cheap enough as peaks come in bursts. */
+static void at_global_peak(void) {
+    uint32_t i;
+
+    for(i = 0; i < nsites; i++) {
+        sites[i].at_peak = sites[i].live;
+        sites[i].at_peak_blocks = sites[i].live_blocks;
+    }
+}
+
+/* State of the heap, as seen from the live blocks' addresses. */
+static int addr_cmp(const void *a, const void *b) {
+    const block_t *ba = a, *bb = b;
+
+    return ba->addr < bb->addr ? -1 : ba->addr > bb->addr;
+}
+
+static void print_state_header(void) {
+    printf("%12s %10s %8s %10s %10s %10s %6s\n", "time (ms)", "live", "blocks",
+           "extent", "free gaps", "largest", "frag");
+}
+
+static void print_state(uint64_t now, const char *tag) {
+    block_t *sorted = xrealloc(NULL, nblocks * sizeof(block_t));
+    uint64_t gaps = 0, largest = 0, extent = 0, gap, end;
+    uint32_t i, n = 0;
+
+    for(i = 0; blocks && i <= blocks_mask; i++) {
+        if(blocks[i].addr)
+            sorted[n++] = blocks[i];
+    }
+
+    qsort(sorted, n, sizeof(block_t), addr_cmp);
+
+    if(n) {
+        end = sorted[0].addr + sorted[0].size;
+
+        for(i = 1; i < n; i++) {
+            if(sorted[i].addr > end) {
+                gap = sorted[i].addr - end;
+
+                if(gap > OVERHEAD_GAP) {
+                    gaps += gap;
+
+                    if(gap > largest)
+                        largest = gap;
+                }
+            }
+
+            if(sorted[i].addr + sorted[i].size > end)
+                end = sorted[i].addr + sorted[i].size;
+        }
+
+        extent = end - sorted[0].addr;
+    }
+
+    /* Fragmentation is how much of the free memory between the blocks can't
+       be had in one piece. */
+    printf("%12.1f %10llu %8u %10llu %10llu %10llu %5.1f%%  %s\n", now / 1000.0,
+           (unsigned long long)live, (unsigned int)live_count,
+           (unsigned long long)extent, (unsigned long long)gaps,
+           (unsigned long long)largest,
+           gaps ? 100.0 * (1.0 - (double)largest / gaps) : 0.0, tag);
+
+    free(sorted);
+}
+
+/* The sites with the most memory, by the given key. */
+static uint32_t site_key;
+
+static uint32_t site_value(const site_t *s) {
+    switch(site_key) {
+        case 0:
+            return s->peak;
+        case 1:
+            return s->at_peak;
+        default:
+            return s->live;
+    }
+}
+
+static int site_cmp(const void *a, const void *b) {
+    uint32_t va = site_value(&sites[*(const uint32_t *)a]);
+    uint32_t vb = site_value(&sites[*(const uint32_t *)b]);
+
+    return va < vb ? 1 : va > vb ? -1 : 0;
+}
+
+static void print_sites(uint32_t key, uint32_t top) {
+    uint32_t *order = xrealloc(NULL, nsites * sizeof(uint32_t));
+    uint32_t i;
+    site_t *s;
+
+    for(i = 0; i < nsites; i++)
+        order[i] = i;
+
+    site_key = key;
+    qsort(order, nsites, sizeof(uint32_t), site_cmp);
+
+    for(i = 0; i < nsites && i < top; i++) {
+        s = &sites[order[i]];
+
+        if(!site_value(s))
+            break;
+
+        if(key == 0)
+            printf("%10u %10u %8u %12llu  ", (unsigned int)s->peak,
+                   (unsigned int)s->live, (unsigned int)s->allocs,
+                   (unsigned long long)s->total);
+        else if(key == 1)
+            printf("%10u %8u  ", (unsigned int)s->at_peak,
+                   (unsigned int)s->at_peak_blocks);
+        else
+            printf("%10u %8u  ", (unsigned int)s->live,
+                   (unsigned int)s->live_blocks);
+
+        print_site(s);
+    }
+
+    free(order);
+}
+
+/* Replays into simulated allocators. The heap is a range of addresses
+   starting at 0, which grows upwards as needed, like sbrk(). Free memory is
+   kept as a sorted array of ranges. Blocks get an 8 byte header and are
+   rounded up to 8 bytes, like dlmalloc's chunks. */
+typedef struct {
+    uint32_t addr;
+    uint32_t size;
+} range_t;
+
+typedef struct {
+    const char *name;
+    int policy;
+    range_t *free;
+    uint32_t nfree, max_free, rover;
+    uint64_t top, top_peak, used, used_peak;
+    uint32_t fails;
+} sim_t;
+
+enum { FIRST_FIT, BEST_FIT, NEXT_FIT };
+
+static uint64_t sim_limit;
+
+static void sim_insert_free(sim_t *h, uint32_t addr, uint32_t size) {
+    uint32_t lo = 0, hi = h->nfree, mid;
+
+    while(lo < hi) {
+        mid = (lo + hi) / 2;
+
+        if(h->free[mid].addr < addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    /* Merge with the neighbours if they touch. */
+    if(lo > 0 && h->free[lo - 1].addr + h->free[lo - 1].size == addr) {
+        h->free[lo - 1].size += size;
+
+        if(lo < h->nfree && addr + size == h->free[lo].addr) {
+            h->free[lo - 1].size += h->free[lo].size;
+            memmove(&h->free[lo], &h->free[lo + 1],
+                    (h->nfree - lo - 1) * sizeof(range_t));
+            h->nfree--;
+        }
+    }
+    else if(lo < h->nfree && addr + size == h->free[lo].addr) {
+        h->free[lo].addr = addr;
+        h->free[lo].size += size;
+    }
+    else {
+        if(h->nfree == h->max_free) {
+            h->max_free = h->max_free ? h->max_free * 2 : 1024;
+            h->free = xrealloc(h->free, h->max_free * sizeof(range_t));
+        }
+
+        memmove(&h->free[lo + 1], &h->free[lo],
+                (h->nfree - lo) * sizeof(range_t));
+        h->free[lo].addr = addr;
+        h->free[lo].size = size;
+        h->nfree++;
+    }
+
+    /* Give the space back to the top, like malloc_trim() would. */
+    if(h->nfree && h->free[h->nfree - 1].addr + h->free[h->nfree - 1].size ==
+       h->top) {
+        h->top = h->free[h->nfree - 1].addr;
+        h->nfree--;
+    }
+
+    if(h->rover > h->nfree)
+        h->rover = 0;
+}
+
+static uint32_t sim_chunk(uint32_t size, uint32_t align) {
+    uint32_t chunk = ((size + 7) & ~7) + 8;
+
+    if(chunk < 16)
+        chunk = 16;
+
+    /* Over-allocate so that the block can be aligned within the chunk. */
+    if(align > 8)
+        chunk += align;
+
+    return chunk;
+}
+
+/* Returns the address of a chunk of the given size, or UINT32_MAX. */
+static uint32_t sim_alloc(sim_t *h, uint32_t chunk) {
+    uint32_t i, n, best = UINT32_MAX, addr;
+
+    if(h->policy == BEST_FIT) {
+        for(i = 0; i < h->nfree; i++) {
+            if(h->free[i].size >= chunk &&
+               (best == UINT32_MAX || h->free[i].size < h->free[best].size)) {
+                best = i;
+
+                if(h->free[i].size == chunk)
+                    break;
+            }
+        }
+    }
+    else {
+        i = h->policy == NEXT_FIT ? h->rover : 0;
+
+        for(n = 0; n < h->nfree; n++, i++) {
+            if(i >= h->nfree)
+                i = 0;
+
+            if(h->free[i].size >= chunk) {
+                best = i;
+                break;
+            }
+        }
+    }
+
+    if(best != UINT32_MAX) {
+        addr = h->free[best].addr;
+        h->free[best].addr += chunk;
+        h->free[best].size -= chunk;
+
+        if(!h->free[best].size) {
+            memmove(&h->free[best], &h->free[best + 1],
+                    (h->nfree - best - 1) * sizeof(range_t));
+            h->nfree--;
+        }
+
+        h->rover = best;
+    }
+    else {
+        if(sim_limit && h->top + chunk > sim_limit)
+            return UINT32_MAX;
+
+        addr = h->top;
+        h->top += chunk;
+
+        if(h->top > h->top_peak)
+            h->top_peak = h->top;
+    }
+
+    h->used += chunk;
+
+    if(h->used > h->used_peak)
+        h->used_peak = h->used;
+
+    return addr;
+}
+
+static void sim_free(sim_t *h, uint32_t addr, uint32_t chunk) {
+    h->used -= chunk;
+    sim_insert_free(h, addr, chunk);
+}
+
+/* Segregated size classes in front of best-fit, like the small object
+   front-end in kernel/libc/koslib/slab.c. Pages are taken from and given
+   back to the best-fit heap. */
+#define SEG_MAX         256
+#define SEG_CLASSES     12
+#define SEG_PAGE        4096
+#define SEG_HDR         32
+
+static const uint16_t seg_sizes[SEG_CLASSES] = {
+    8, 16, 24, 32, 48, 64, 80, 96, 128, 160, 192, 256
+};
+
+typedef struct {
+    uint32_t addr;
+    uint16_t cls;
+    uint16_t used;
+    uint16_t count;
+    uint16_t nfree;
+    uint16_t *free;
+    int listed;
+} seg_page_t;
+
+/* Each class keeps a stack of its pages which have free slots. Pages given
+   back leave a hole in the page array, which is reused. */
+typedef struct {
+    seg_page_t *pages;
+    uint32_t npages, max_pages;
+    uint32_t *partial[SEG_CLASSES];
+    uint32_t npartial[SEG_CLASSES], max_partial[SEG_CLASSES];
+    uint32_t *holes;
+    uint32_t nholes;
+    uint32_t empty[SEG_CLASSES];
+} seg_t;
+
+static void seg_list(seg_t *s, uint32_t idx) {
+    seg_page_t *pg = &s->pages[idx];
+    int cls = pg->cls;
+
+    if(pg->listed)
+        return;
+
+    if(s->npartial[cls] == s->max_partial[cls]) {
+        s->max_partial[cls] = s->max_partial[cls] ? s->max_partial[cls] * 2 : 64;
+        s->partial[cls] = xrealloc(s->partial[cls],
+                                   s->max_partial[cls] * sizeof(uint32_t));
+    }
+
+    s->partial[cls][s->npartial[cls]++] = idx;
+    pg->listed = 1;
+}
+
+static int seg_class(uint32_t size) {
+    int i;
+
+    for(i = 0; i < SEG_CLASSES; i++) {
+        if(size <= seg_sizes[i])
+            return i;
+    }
+
+    return -1;
+}
+
+/* Returns a (page, slot) pair packed in a uint32_t, or UINT32_MAX. */
+static uint32_t seg_alloc(seg_t *s, sim_t *h, int cls) {
+    seg_page_t *pg = NULL;
+    uint32_t idx, addr;
+
+    /* Drop pages which filled up or were given back from the stack. */
+    while(s->npartial[cls]) {
+        idx = s->partial[cls][s->npartial[cls] - 1];
+        pg = &s->pages[idx];
+
+        if(pg->addr != UINT32_MAX && pg->cls == cls && pg->nfree)
+            break;
+
+        if(pg->cls == cls)
+            pg->listed = 0;
+
+        s->npartial[cls]--;
+        pg = NULL;
+    }
+
+    if(!pg) {
+        if((addr = sim_alloc(h, SEG_PAGE)) == UINT32_MAX)
+            return UINT32_MAX;
+
+        if(s->nholes) {
+            idx = s->holes[--s->nholes];
+        }
+        else {
+            if(s->npages == s->max_pages) {
+                s->max_pages = s->max_pages ? s->max_pages * 2 : 64;
+                s->pages = xrealloc(s->pages, s->max_pages * sizeof(seg_page_t));
+                s->holes = xrealloc(s->holes, s->max_pages * sizeof(uint32_t));
+            }
+
+            idx = s->npages++;
+            s->pages[idx].free = NULL;
+        }
+
+        pg = &s->pages[idx];
+        pg->addr = addr;
+        pg->cls = cls;
+        pg->used = 0;
+        pg->listed = 0;
+        pg->count = (SEG_PAGE - SEG_HDR) / seg_sizes[cls];
+        pg->free = xrealloc(pg->free, pg->count * sizeof(uint16_t));
+
+        for(pg->nfree = 0; pg->nfree < pg->count; pg->nfree++)
+            pg->free[pg->nfree] = pg->count - 1 - pg->nfree;
+
+        s->empty[cls]++;
+        seg_list(s, idx);
+    }
+
+    if(!pg->used++)
+        s->empty[cls]--;
+
+    return idx << 16 | pg->free[--pg->nfree];
+}
+
+static void seg_free(seg_t *s, sim_t *h, uint32_t handle) {
+    seg_page_t *pg = &s->pages[handle >> 16];
+
+    pg->free[pg->nfree++] = handle & 0xffff;
+
+    /* Keep one empty page per class around, like the front-end does. The
+       page stays on the partial stack until it's popped. */
+    if(!--pg->used && ++s->empty[pg->cls] > 1) {
+        s->empty[pg->cls]--;
+        sim_free(h, pg->addr, SEG_PAGE);
+        pg->addr = UINT32_MAX;
+        s->holes[s->nholes++] = handle >> 16;
+        return;
+    }
+
+    seg_list(s, handle >> 16);
+}
+
+typedef struct {
+    uint32_t addr;      /* Chunk address, or (page, slot) for small objects */
+    uint32_t chunk;     /* Chunk size, or 0 for small objects */
+} sim_block_t;
+
+static void sim_run(sim_t *h, int segregated) {
+    sim_block_t *map = calloc(next_id ? next_id : 1, sizeof(sim_block_t));
+    uint8_t *live_ids = calloc(next_id ? next_id : 1, 1);
+    seg_t seg;
+    size_t i;
+    int cls;
+
+    memset(&seg, 0, sizeof(seg));
+
+    if(!map || !live_ids) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    for(i = 0; i < nevents; i++) {
+        event_t *ev = &events[i];
+        sim_block_t *b = &map[ev->id];
+
+        /* A realloc'ed block is freed and allocated again, unless it still
+           fits where it is. */
+        if(ev->type == EV_REALLOC && live_ids[ev->id]) {
+            if(b->chunk && sim_chunk(ev->size, 0) <= b->chunk)
+                continue;
+
+            if(!b->chunk && (cls = seg_class(ev->size)) >= 0 &&
+               seg.pages[b->addr >> 16].cls == cls)
+                continue;
+        }
+
+        if((ev->type == EV_FREE || ev->type == EV_REALLOC) &&
+           live_ids[ev->id]) {
+            if(b->chunk)
+                sim_free(h, b->addr, b->chunk);
+            else
+                seg_free(&seg, h, b->addr);
+
+            live_ids[ev->id] = 0;
+        }
+
+        if(ev->type == EV_FREE)
+            continue;
+
+        cls = segregated && ev->align <= 8 ? seg_class(ev->size) : -1;
+
+        if(cls >= 0) {
+            b->addr = seg_alloc(&seg, h, cls);
+            b->chunk = 0;
+        }
+        else {
+            b->chunk = sim_chunk(ev->size, ev->align);
+            b->addr = sim_alloc(h, b->chunk);
+        }
+
+        if(b->addr == UINT32_MAX)
+            h->fails++;
+        else
+            live_ids[ev->id] = 1;
+    }
+
+    for(i = 0; i < seg.npages; i++)
+        free(seg.pages[i].free);
+
+    for(cls = 0; cls < SEG_CLASSES; cls++)
+        free(seg.partial[cls]);
+
+    free(seg.pages);
+    free(seg.holes);
+    free(map);
+    free(live_ids);
+}
+
+static void simulate(void) {
+    sim_t heaps[4] = {
+        { "first fit", FIRST_FIT, NULL, 0, 0, 0, 0, 0, 0, 0, 0 },
+        { "next fit", NEXT_FIT, NULL, 0, 0, 0, 0, 0, 0, 0, 0 },
+        { "best fit", BEST_FIT, NULL, 0, 0, 0, 0, 0, 0, 0, 0 },
+        { "size classes + best fit", BEST_FIT, NULL, 0, 0, 0, 0, 0, 0, 0, 0 }
+    };
+    int i;
+
+    printf("\nReplay into other allocation strategies");
+
+    if(sim_limit)
+        printf(" (heap limited to %llu bytes)", (unsigned long long)sim_limit);
+
+    printf(":\n%-24s %12s %12s %7s %8s\n", "strategy", "heap needed",
+           "peak in use", "waste", "failed");
+
+    for(i = 0; i < 4; i++) {
+        sim_run(&heaps[i], i == 3);
+
+        printf("%-24s %12llu %12llu %6.1f%% %8u\n", heaps[i].name,
+               (unsigned long long)heaps[i].top_peak,
+               (unsigned long long)heaps[i].used_peak,
+               heaps[i].top_peak ? 100.0 * (1.0 - (double)heaps[i].used_peak /
+                                            heaps[i].top_peak) : 0.0,
+               (unsigned int)heaps[i].fails);
+
+        free(heaps[i].free);
+    }
+}
+
+static void export_slabbench(const char *fn) {
+    uint8_t *live_ids = calloc(next_id ? next_id : 1, 1);
+    FILE *fp;
+    size_t i;
+
+    if(!(fp = fopen(fn, "w")) || !live_ids) {
+        perror(fn);
+        exit(1);
+    }
+
+    fprintf(fp, "# Converted from an allocation trace by kosheap\n");
+
+    for(i = 0; i < nevents; i++) {
+        event_t *ev = &events[i];
+
+        switch(ev->type) {
+            case EV_ALLOC:
+                fprintf(fp, "a %u %u\n", (unsigned int)ev->id,
+                        (unsigned int)ev->size);
+                live_ids[ev->id] = 1;
+                break;
+
+            case EV_REALLOC:
+                fprintf(fp, "%c %u %u\n", live_ids[ev->id] ? 'r' : 'a',
+                        (unsigned int)ev->id, (unsigned int)ev->size);
+                live_ids[ev->id] = 1;
+                break;
+
+            case EV_FREE:
+                if(live_ids[ev->id])
+                    fprintf(fp, "f %u\n", (unsigned int)ev->id);
+
+                live_ids[ev->id] = 0;
+                break;
+        }
+    }
+
+    fclose(fp);
+    free(live_ids);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-p points] [-n sites] [-s] [-l size] "
+                    "[-x slabbench.txt] trace.kalc [program.elf]\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t nthreads, nrecs, i, top = 10, points = 0, dropped;
+    uint32_t op, addr, arg, size, prev_time, mark_count = 0;
+    uint64_t now = 0, end_time = 0, next_point = 0, step = 1;
+    uint32_t counts[8] = { 0 }, unknown_frees = 0, overlaps = 0, failed = 0;
+    const char *export_fn = NULL;
+    const uint8_t *thds, *p;
+    int simulate_opt = 0, opt;
+    uint8_t *trace;
+    size_t tsize;
+    block_t *b;
+
+    while((opt = getopt(argc, argv, "p:n:sl:x:")) != -1) {
+        switch(opt) {
+            case 'p':
+                points = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                top = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                simulate_opt = 1;
+                break;
+            case 'l':
+                sim_limit = strtoull(optarg, NULL, 0);
+                break;
+            case 'x':
+                export_fn = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if(optind >= argc || argc - optind > 2)
+        usage(argv[0]);
+
+    trace = load_file(argv[optind], &tsize);
+
+    if(optind + 1 < argc)
+        load_symbols(argv[optind + 1]);
+
+    if(tsize < HEADER_SIZE || get32(trace) != ALLOC_TRACE_MAGIC) {
+        fprintf(stderr, "%s: not a KOS allocation trace\n", argv[optind]);
+        return 1;
+    }
+
+    if(get32(trace + 4) != ALLOC_TRACE_VERSION) {
+        fprintf(stderr, "%s: unsupported trace version %u\n", argv[optind],
+                (unsigned int)get32(trace + 4));
+        return 1;
+    }
+
+    nthreads = get32(trace + 8);
+    nrecs = get32(trace + 12);
+    dropped = get32(trace + 16);
+
+    if(HEADER_SIZE + (uint64_t)nthreads * THREAD_SIZE > tsize) {
+        fprintf(stderr, "%s: truncated trace\n", argv[optind]);
+        return 1;
+    }
+
+    thds = trace + HEADER_SIZE;
+    p = thds + nthreads * THREAD_SIZE;
+
+    /* A streamed trace goes on until the end of the file; a partial last
+       record means the program died while it was being written. */
+    if(nrecs == ALLOC_TRACE_STREAMED)
+        nrecs = (tsize - (p - trace)) / RECORD_SIZE;
+    else if((p - trace) + (uint64_t)nrecs * RECORD_SIZE > tsize) {
+        fprintf(stderr, "%s: truncated trace\n", argv[optind]);
+        return 1;
+    }
+
+    if(!nrecs) {
+        fprintf(stderr, "No records to report.\n");
+        return 0;
+    }
+
+    if(dropped)
+        fprintf(stderr, "warning: %u records were overwritten before the "
+                "dump; blocks allocated before that show up as unknown "
+                "frees\n", (unsigned int)dropped);
+
+    /* Timestamps are 32-bit microseconds, so they wrap around every 71
+       minutes; only the differences between records are used. */
+    prev_time = get32(p);
+
+    for(i = 0; i < nrecs; i++) {
+        end_time += (uint32_t)(get32(p + i * RECORD_SIZE) - prev_time);
+        prev_time = get32(p + i * RECORD_SIZE);
+
+        if(get16(p + i * RECORD_SIZE + 18) == ALLOC_OP_MARK)
+            mark_count++;
+    }
+
+    if(!points && !mark_count)
+        points = 20;
+
+    if(points) {
+        step = end_time / points ? end_time / points : 1;
+        next_point = step;
+    }
+
+    printf("Heap state over time (%s):\n",
+           points ? "evenly spaced" : "at markers");
+    print_state_header();
+
+    prev_time = get32(p);
+
+    for(i = 0; i < nrecs; i++, p += RECORD_SIZE) {
+        uint32_t callers[ALLOC_TRACE_DEPTH], t = get32(p), site, id = 0;
+        int j, resized;
+
+        now += (uint32_t)(t - prev_time);
+        prev_time = t;
+
+        addr = get32(p + 4);
+        arg = get32(p + 8);
+        size = get32(p + 12);
+        op = get16(p + 18);
+
+        for(j = 0; j < ALLOC_TRACE_DEPTH; j++)
+            callers[j] = get32(p + 20 + j * 4);
+
+        if(op < 8)
+            counts[op]++;
+
+        while(points && now >= next_point && next_point < end_time) {
+            print_state(next_point, "");
+            next_point += step;
+        }
+
+        switch(op) {
+            case ALLOC_OP_MARK: {
+                char tag[32];
+
+                snprintf(tag, sizeof(tag), "mark %u", (unsigned int)arg);
+
+                if(!points)
+                    print_state(now, tag);
+
+                continue;
+            }
+
+            case ALLOC_OP_DROPPED:
+                fprintf(stderr, "warning: %u records dropped at %.1f ms, the "
+                        "heap state is approximate from there\n",
+                        (unsigned int)size, now / 1000.0);
+                continue;
+
+            case ALLOC_OP_FREE:
+                if(!(b = find_block(addr))) {
+                    unknown_frees++;
+                    continue;
+                }
+
+                add_event(EV_FREE, b->id, 0, 0);
+                block_free(b);
+                continue;
+
+            case ALLOC_OP_MALLOC:
+            case ALLOC_OP_CALLOC:
+            case ALLOC_OP_MEMALIGN:
+            case ALLOC_OP_REALLOC:
+                break;
+
+            default:
+                continue;
+        }
+
+        site = get_site(callers);
+        resized = 0;
+
+        if(op == ALLOC_OP_REALLOC && arg) {
+            b = find_block(arg);
+
+            /* realloc(p, 0) frees the block; any other NULL result means it
+               failed and the old block is still there. */
+            if(!addr) {
+                if(!size && b) {
+                    add_event(EV_FREE, b->id, 0, 0);
+                    block_free(b);
+                }
+                else {
+                    failed++;
+                }
+
+                continue;
+            }
+
+            if(b) {
+                id = b->id;
+                resized = 1;
+                block_free(b);
+            }
+            else {
+                unknown_frees++;
+            }
+        }
+        else if(!addr) {
+            failed++;
+            continue;
+        }
+
+        /* An allocation on top of a live block means its free was lost. */
+        if((b = find_block(addr))) {
+            overlaps++;
+            block_free(b);
+        }
+
+        if(!resized)
+            id = next_id++;
+
+        add_event(resized ? EV_REALLOC : EV_ALLOC, id, size,
+                  op == ALLOC_OP_MEMALIGN ? arg : 0);
+
+        sites[site].allocs++;
+        sites[site].total += size;
+
+        block_alloc(addr, size, site, id, now);
+    }
+
+    print_state(now, "end");
+
+    printf("\n%u records over %.1f ms: %u malloc, %u calloc, %u realloc, "
+           "%u memalign, %u free\n", (unsigned int)nrecs, now / 1000.0,
+           counts[ALLOC_OP_MALLOC], counts[ALLOC_OP_CALLOC],
+           counts[ALLOC_OP_REALLOC], counts[ALLOC_OP_MEMALIGN],
+           counts[ALLOC_OP_FREE]);
+
+    if(failed)
+        printf("%u allocations failed\n", failed);
+
+    if(unknown_frees)
+        printf("%u frees or reallocs of blocks allocated before the trace\n",
+               unknown_frees);
+
+    if(overlaps)
+        printf("%u allocations on top of live blocks (lost frees?)\n",
+               overlaps);
+
+    printf("\nPeak: %llu bytes live at %.1f ms\n",
+           (unsigned long long)live_peak, peak_time / 1000.0);
+    printf("%10s %8s  %s\n", "bytes", "blocks", "call site (at the peak)");
+    print_sites(1, top);
+
+    printf("\nCall sites by their own peak:\n");
+    printf("%10s %10s %8s %12s  %s\n", "peak", "live now", "allocs", "total",
+           "call site");
+    print_sites(0, top);
+
+    if(live_count) {
+        printf("\nLeaks: %llu bytes in %u blocks still live at the end:\n",
+               (unsigned long long)live, (unsigned int)live_count);
+        printf("%10s %8s  %s\n", "bytes", "blocks", "call site");
+        print_sites(2, top);
+    }
+    else {
+        printf("\nNo leaks: every block allocated in the trace was freed.\n");
+    }
+
+    if(nthreads) {
+        printf("\nThreads at the start of the trace:");
+
+        for(i = 0; i < nthreads; i++)
+            printf(" %u (%.*s)", (unsigned int)get32(thds + i * THREAD_SIZE),
+                   ALLOC_TRACE_LABEL_LEN,
+                   (const char *)thds + i * THREAD_SIZE + 4);
+
+        printf("\n");
+    }
+
+    if(simulate_opt)
+        simulate();
+
+    if(export_fn)
+        export_slabbench(export_fn);
+
+    return 0;
+}
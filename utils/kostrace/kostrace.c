@@ -0,0 +1,258 @@
+/* KallistiOS ##version##
+
+   kostrace.c
+   Copyright (C) 2025 KallistiOS Team
+
+   Converts a trace dump written by trace_dump() (see kos/trace.h) into the
+   Chrome trace event JSON format, which can be loaded into Perfetto
+   (https://ui.perfetto.dev) or chrome://tracing.
+
+   Usage: kostrace trace.bin [trace.json]
+
+   Each thread gets its own track showing when it was running and when it was
+   blocked on a genwait object, and IRQs and ASIC events are shown nested on a
+   separate "[irq]" track.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* These must match kos/trace.h. Everything in the dump is little endian. */
+#define TRACE_MAGIC     0x4b545243
+#define TRACE_VERSION   1
+#define TRACE_LABEL_LEN 32
+
+#define HEADER_SIZE     24
+#define THREAD_SIZE     (4 + TRACE_LABEL_LEN)
+#define EVENT_SIZE      16
+
+#define TRACE_EVT_SWITCH     1
+#define TRACE_EVT_WAIT       2
+#define TRACE_EVT_WAIT_DONE  3
+#define TRACE_EVT_WAKE       4
+#define TRACE_EVT_IRQ_ENTER  5
+#define TRACE_EVT_IRQ_EXIT   6
+#define TRACE_EVT_ASIC_ENTER 7
+#define TRACE_EVT_ASIC_EXIT  8
+#define TRACE_EVT_USER       9
+
+/* Thread IDs are stored in 16 bits, so we can just use flat tables. */
+#define MAX_TIDS        65536
+
+/* Pseudo-thread that IRQ and ASIC events are drawn on. */
+#define IRQ_TID         0
+
+static uint32_t wait_obj[MAX_TIDS];
+static uint8_t waiting[MAX_TIDS];
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint64_t get64(const uint8_t *p) {
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+static FILE *out;
+static int first = 1;
+
+/* Start a new JSON event object, printing the fields that they all share. */
+static void begin_event(const char *ph, uint64_t ns, unsigned int tid) {
+    fprintf(out, "%s\n{\"ph\":\"%s\",\"pid\":1,\"tid\":%u,"
+            "\"ts\":%llu.%03u", first ? "" : ",", ph, tid,
+            (unsigned long long)(ns / 1000), (unsigned int)(ns % 1000));
+    first = 0;
+}
+
+static void thread_name(unsigned int tid, const char *name) {
+    fprintf(out, "%s\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+            "\"name\":\"thread_name\",\"args\":{\"name\":\"", first ? "" : ",",
+            tid);
+
+    /* Labels are set by programs, so escape anything JSON won't like. */
+    for(; *name; ++name) {
+        if(*name == '"' || *name == '\\')
+            fprintf(out, "\\%c", *name);
+        else if((unsigned char)*name < 0x20)
+            fprintf(out, "\\u%04x", (unsigned char)*name);
+        else
+            fputc(*name, out);
+    }
+
+    fprintf(out, "\"}}");
+    first = 0;
+}
+
+int main(int argc, char *argv[]) {
+    FILE *in;
+    uint8_t hdr[HEADER_SIZE], buf[THREAD_SIZE];
+    uint32_t nthds, nevts, i;
+    uint64_t ns = 0;
+    unsigned int tid, arg, type, irq_depth = 0;
+    int running = -1;
+    char label[TRACE_LABEL_LEN + 1];
+
+    if(argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s trace.bin [trace.json]\n", argv[0]);
+        return 1;
+    }
+
+    if(!(in = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    if(fread(hdr, HEADER_SIZE, 1, in) != 1 || get32(hdr) != TRACE_MAGIC) {
+        fprintf(stderr, "%s: not a KOS trace dump\n", argv[1]);
+        return 1;
+    }
+
+    if(get32(hdr + 4) != TRACE_VERSION) {
+        fprintf(stderr, "%s: unsupported trace version %u\n", argv[1],
+                (unsigned int)get32(hdr + 4));
+        return 1;
+    }
+
+    nthds = get32(hdr + 8);
+    nevts = get32(hdr + 12);
+
+    if(get32(hdr + 16))
+        fprintf(stderr, "warning: %u events were lost to ring buffer "
+                "overflow\n", (unsigned int)get32(hdr + 16));
+
+    if(argc == 3) {
+        if(!(out = fopen(argv[2], "w"))) {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+    else {
+        out = stdout;
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    fprintf(out, "\n{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\","
+            "\"args\":{\"name\":\"KallistiOS\"}}");
+    first = 0;
+    thread_name(IRQ_TID, "[irq]");
+
+    for(i = 0; i < nthds; ++i) {
+        if(fread(buf, THREAD_SIZE, 1, in) != 1) {
+            fprintf(stderr, "%s: truncated thread table\n", argv[1]);
+            return 1;
+        }
+
+        memcpy(label, buf + 4, TRACE_LABEL_LEN);
+        label[TRACE_LABEL_LEN] = '\0';
+        thread_name(get32(buf) & (MAX_TIDS - 1), label);
+    }
+
+    for(i = 0; i < nevts; ++i) {
+        if(fread(buf, EVENT_SIZE, 1, in) != 1) {
+            fprintf(stderr, "%s: truncated after %u events\n", argv[1],
+                    (unsigned int)i);
+            break;
+        }
+
+        ns = get64(buf);
+        arg = get32(buf + 8);
+        tid = get16(buf + 12);
+        type = get16(buf + 14);
+
+        switch(type) {
+            case TRACE_EVT_SWITCH:
+                /* The outgoing thread is in tid, the incoming one in arg. We
+                   can only close a slice that we saw the start of. */
+                if(running >= 0) {
+                    begin_event("E", ns, running);
+                    fprintf(out, "}");
+                }
+
+                running = arg & (MAX_TIDS - 1);
+                begin_event("B", ns, running);
+                fprintf(out, ",\"name\":\"running\",\"cat\":\"sched\"}");
+                break;
+
+            case TRACE_EVT_WAIT:
+                begin_event("b", ns, tid);
+                fprintf(out, ",\"name\":\"wait 0x%08x\",\"cat\":\"genwait\","
+                        "\"id\":%u}", arg, tid);
+                wait_obj[tid] = arg;
+                waiting[tid] = 1;
+                break;
+
+            case TRACE_EVT_WAIT_DONE:
+                if(waiting[tid] && wait_obj[tid] == arg) {
+                    begin_event("e", ns, tid);
+                    fprintf(out, ",\"name\":\"wait 0x%08x\",\"cat\":\"genwait\","
+                            "\"id\":%u}", arg, tid);
+                }
+
+                waiting[tid] = 0;
+                break;
+
+            case TRACE_EVT_WAKE:
+                begin_event("i", ns, irq_depth ? IRQ_TID : tid);
+                fprintf(out, ",\"name\":\"wake %u\",\"cat\":\"genwait\","
+                        "\"s\":\"t\",\"args\":{\"tid\":%u}}", arg, arg);
+                break;
+
+            case TRACE_EVT_IRQ_ENTER:
+                ++irq_depth;
+                begin_event("B", ns, IRQ_TID);
+                fprintf(out, ",\"name\":\"irq 0x%03x\",\"cat\":\"irq\","
+                        "\"args\":{\"thread\":%u}}", arg, tid);
+                break;
+
+            case TRACE_EVT_ASIC_ENTER:
+                begin_event("B", ns, IRQ_TID);
+                fprintf(out, ",\"name\":\"asic 0x%04x\",\"cat\":\"irq\"}",
+                        arg);
+                break;
+
+            case TRACE_EVT_IRQ_EXIT:
+                if(!irq_depth)
+                    break;
+
+                --irq_depth;
+                /* Fall through */
+
+            case TRACE_EVT_ASIC_EXIT:
+                begin_event("E", ns, IRQ_TID);
+                fprintf(out, "}");
+                break;
+
+            case TRACE_EVT_USER:
+                begin_event("i", ns, tid);
+                fprintf(out, ",\"name\":\"mark %u\",\"cat\":\"user\","
+                        "\"s\":\"g\"}", arg);
+                break;
+
+            default:
+                fprintf(stderr, "warning: unknown event type %u\n", type);
+                break;
+        }
+    }
+
+    /* Close off whatever was still running at the end of the trace. */
+    if(running >= 0) {
+        begin_event("E", ns, running);
+        fprintf(out, "}");
+    }
+
+    fprintf(out, "\n]}\n");
+
+    fclose(in);
+
+    if(out != stdout)
+        fclose(out);
+
+    return 0;
+}
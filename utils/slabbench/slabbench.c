@@ -0,0 +1,355 @@
+/* KallistiOS ##version##
+
+   slabbench.c
+   Copyright (C) 2025 KallistiOS Team
+
+   Replays an allocation trace against the host's malloc(), and against the
+   small object front-end from kernel/libc/koslib/slab.c sitting in front of
+   it, and compares the time taken and the memory held by the front-end.
+
+   Usage: slabbench [-n passes] trace.txt
+          slabbench [-n passes] -g ops [-s seed]
+
+   A trace is a text file with one operation per line:
+
+     a <id> <size>      allocate size bytes, and call the block id
+     r <id> <size>      resize block id to size bytes
+     f <id>             free block id
+
+   Lines starting with '#' are ignored. With -g, a synthetic trace of the
+   given number of operations is generated instead, mimicking lots of short
+   lived small C++ objects mixed with a few larger buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Build the front-end for the host: pages come from a private arena, and
+   there is no need for locking. */
+#define SLAB_HOST           1
+#define SLAB_MEM_SIZE       (64 * 1024 * 1024)
+#define SLAB_MEM_BASE       arena_base
+
+#define slab_heap_ok()      1
+#define SLAB_LOCK()         (void)0
+#define SLAB_UNLOCK()       (void)0
+#define SLAB_RELOCK()       (void)0
+
+static uintptr_t arena_base;
+static size_t arena_used;
+static void *arena_free_pages;
+
+static void *slab_page_alloc(void);
+static void slab_page_free(void *page);
+
+#include "../../kernel/libc/koslib/slab.c"
+
+static void *slab_page_alloc(void) {
+    void *page;
+
+    if((page = arena_free_pages)) {
+        arena_free_pages = *(void **)page;
+        return page;
+    }
+
+    if(arena_used == SLAB_MEM_SIZE)
+        return NULL;
+
+    page = (void *)(arena_base + arena_used);
+    arena_used += SLAB_PAGE_SIZE;
+    return page;
+}
+
+static void slab_page_free(void *page) {
+    *(void **)page = arena_free_pages;
+    arena_free_pages = page;
+}
+
+typedef struct op {
+    char type;
+    uint32_t id;
+    uint32_t size;
+} op_t;
+
+static op_t *ops;
+static size_t op_count, op_max;
+static uint32_t id_max;
+
+static void add_op(char type, uint32_t id, uint32_t size) {
+    if(op_count == op_max) {
+        op_max = op_max ? op_max * 2 : 4096;
+        ops = realloc(ops, op_max * sizeof(op_t));
+
+        if(!ops) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    ops[op_count].type = type;
+    ops[op_count].id = id;
+    ops[op_count].size = size;
+    op_count++;
+
+    if(id >= id_max)
+        id_max = id + 1;
+}
+
+static int load_trace(const char *fn) {
+    unsigned long id, size;
+    char line[256], type;
+    FILE *fp;
+    int n;
+
+    if(!(fp = fopen(fn, "r"))) {
+        perror(fn);
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), fp)) {
+        if(line[0] == '#' || line[0] == '\n')
+            continue;
+
+        size = 0;
+        n = sscanf(line, "%c %lu %lu", &type, &id, &size);
+
+        if(n < 2 || (type != 'f' && n < 3) ||
+           (type != 'a' && type != 'r' && type != 'f')) {
+            fprintf(stderr, "%s: bad line: %s", fn, line);
+            fclose(fp);
+            return -1;
+        }
+
+        add_op(type, id, size);
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/* Mostly small objects with short lifetimes, some medium ones which live a
+   bit longer, and the odd large buffer. */
+static uint32_t gen_size(void) {
+    int r = rand() % 100;
+
+    if(r < 80)
+        return 8 + rand() % 120;
+    else if(r < 92)
+        return 128 + rand() % 128;
+    else if(r < 99)
+        return 256 + rand() % 3840;
+    else
+        return 4096 + rand() % 65536;
+}
+
+static void gen_trace(size_t count) {
+    uint32_t *live, next_id = 0, idx;
+    size_t nlive = 0;
+
+    live = malloc(count * sizeof(uint32_t));
+
+    while(op_count < count) {
+        int r = rand() % 100;
+
+        if(nlive && (r < 45 || nlive > 20000)) {
+            idx = rand() % nlive;
+            add_op('f', live[idx], 0);
+            live[idx] = live[--nlive];
+        }
+        else if(nlive && r < 50) {
+            add_op('r', live[rand() % nlive], gen_size());
+        }
+        else {
+            live[nlive++] = next_id;
+            add_op('a', next_id++, gen_size());
+        }
+    }
+
+    /* Free everything still around at the end. */
+    while(nlive)
+        add_op('f', live[--nlive], 0);
+
+    free(live);
+}
+
+static void *fe_malloc(size_t size) {
+    void *ptr = slab_alloc(size);
+    return ptr ? ptr : malloc(size);
+}
+
+static void fe_free(void *ptr) {
+    if(!slab_free(ptr))
+        free(ptr);
+}
+
+static void *fe_realloc(void *ptr, size_t size) {
+    size_t old = slab_usable_size(ptr);
+    void *nptr;
+
+    if(!ptr)
+        return fe_malloc(size);
+
+    if(!old)
+        return realloc(ptr, size);
+
+    if(size <= old)
+        return ptr;
+
+    if((nptr = fe_malloc(size))) {
+        memcpy(nptr, ptr, old);
+        slab_free(ptr);
+    }
+
+    return nptr;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t replay(void **blocks, int front_end) {
+    uint64_t start = now_ns();
+    size_t i;
+    op_t *op;
+
+    for(i = 0; i < op_count; i++) {
+        op = &ops[i];
+
+        switch(op->type) {
+            case 'a':
+                blocks[op->id] = front_end ? fe_malloc(op->size) :
+                                 malloc(op->size);
+                /* Touch the block, like a real program would. */
+                if(blocks[op->id])
+                    *(char *)blocks[op->id] = 0;
+                break;
+
+            case 'r':
+                blocks[op->id] = front_end ?
+                                 fe_realloc(blocks[op->id], op->size) :
+                                 realloc(blocks[op->id], op->size);
+                break;
+
+            case 'f':
+                if(front_end)
+                    fe_free(blocks[op->id]);
+                else
+                    free(blocks[op->id]);
+
+                blocks[op->id] = NULL;
+                break;
+        }
+    }
+
+    return now_ns() - start;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-n passes] trace.txt\n"
+                    "       %s [-n passes] -g ops [-s seed]\n", name, name);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+    uint64_t t_host = 0, t_fe = 0, t;
+    size_t gen = 0, allocs = 0, small = 0, peak_pages = 0, i;
+    unsigned int passes = 5, seed = 1, p;
+    slab_stats_t st;
+    void **blocks;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:g:s:")) != -1) {
+        switch(opt) {
+            case 'n':
+                passes = atoi(optarg);
+                break;
+            case 'g':
+                gen = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if(gen) {
+        srand(seed);
+        gen_trace(gen);
+    }
+    else if(optind < argc) {
+        if(load_trace(argv[optind]))
+            return EXIT_FAILURE;
+    }
+    else {
+        usage(argv[0]);
+    }
+
+    if(!passes)
+        passes = 1;
+
+    arena_base = (uintptr_t)aligned_alloc(SLAB_PAGE_SIZE, SLAB_MEM_SIZE);
+    blocks = calloc(id_max ? id_max : 1, sizeof(void *));
+
+    if(!arena_base || !blocks) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    for(i = 0; i < op_count; i++) {
+        if(ops[i].type == 'a') {
+            allocs++;
+            small += ops[i].size <= SLAB_MAX_SIZE;
+        }
+    }
+
+    printf("%zu operations, %zu allocations (%.1f%% of them small)\n\n",
+           op_count, allocs, allocs ? 100.0 * small / allocs : 0.0);
+
+    /* Interleave the passes, so that both see the same cache conditions. */
+    for(p = 0; p < passes; p++) {
+        t = replay(blocks, 0);
+        if(!t_host || t < t_host)
+            t_host = t;
+
+        t = replay(blocks, 1);
+        if(!t_fe || t < t_fe)
+            t_fe = t;
+
+        if(arena_used / SLAB_PAGE_SIZE > peak_pages)
+            peak_pages = arena_used / SLAB_PAGE_SIZE;
+    }
+
+    printf("allocator        best time     ns/op\n");
+    printf("host malloc   %10.3f ms  %8.1f\n", t_host / 1e6,
+           (double)t_host / op_count);
+    printf("slab + host   %10.3f ms  %8.1f\n\n", t_fe / 1e6,
+           (double)t_fe / op_count);
+
+    slab_print_stats(printf);
+
+    for(i = 0; i < SLAB_CLASS_COUNT; i++) {
+        slab_get_stats(i, &st);
+
+        if(st.used)
+            printf("warning: %zu objects of %zu bytes leaked by the trace\n",
+                   st.used, st.obj_size);
+    }
+
+    printf("\npeak small object memory: %zu pages (%zu KB)\n", peak_pages,
+           peak_pages * SLAB_PAGE_SIZE / 1024);
+
+    free(blocks);
+    free((void *)arena_base);
+    free(ops);
+
+    return 0;
+}